@@ -2,11 +2,16 @@
 #include <iostream>
 #include <fstream>
 #include <iterator>
+#include <sstream>
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "mvg/utils/cmd_line.h"
 #include "mvg/utils/file_system.h"
 #include "mvg/utils/progress.h"
+#include "mvg/threads/bounded_queue.h"
+#include "mvg/threads/thread.h"
 
 #include "mvg/image/image.h"
 
@@ -17,8 +22,12 @@
 #include "mvg/feature/pairwise_adjacency_display.h"
 #include "mvg/feature/image_list_io_helper.h"
 #include "mvg/feature/matcher_brute_force.h"
+#include "mvg/feature/matcher_brute_force_simd.h"
 #include "mvg/feature/matcher_kdtree_flann.h"
 #include "mvg/feature/indexed_match_utils.h"
+#include "mvg/feature/pair_selection_vlad.h"
+#include "mvg/feature/region_cache.h"
+#include "mvg/feature/descriptor_compression.h"
 
 #include "mvg/multiview/fundamental_acransac.h"
 #include "mvg/multiview/essential_acransac.h"
@@ -44,6 +53,404 @@ bool testIntrinsicsEquality(
 	return ci1.camera_matrix == ci2.camera_matrix;
 }
 
+// 使用指定的匹配算子计算指定图像对可能的匹配，结果插入到map_putatives_matches中
+template <typename KeypointSetT, typename MatcherT, typename RegionCacheT>
+static bool ComputePutativeMatches(float distance_ratio, bool is_symmetric, bool is_save_index,
+	const std::shared_ptr<RegionCacheT> & region_cache,
+	const std::vector<std::string> & file_names, const std::string & out_dir,
+	const std::vector<std::pair<size_t, size_t> > & vec_pairs,
+	PairWiseMatches & map_putatives_matches)
+{
+	MatcherAllInMemory<KeypointSetT, MatcherT> collectionMatcher(distance_ratio, region_cache);
+	collectionMatcher.setSymmetric(is_symmetric);
+	collectionMatcher.setSaveIndex(is_save_index);
+	if (!collectionMatcher.LoadData(file_names, out_dir))
+		return false;
+	return collectionMatcher.Match(file_names, vec_pairs, map_putatives_matches);
+}
+
+// 读取或训练描述子压缩的码本(out_dir/codebook.extension)，将每幅图像的描述子编码保存为basename.extension，
+// 编码文件比描述子文件或码本旧时重新编码。返回的缓存只包含编码后的描述子
+template <typename CodeT, typename DescriptorT, typename EncoderT>
+static std::shared_ptr<RegionCache<ScalePointFeature, CodeT> > CompressDescriptors(
+	EncoderT & encoder, size_t encoder_param, const std::string & extension,
+	const std::vector<std::string> & file_names, const std::string & out_dir, size_t memory_budget)
+{
+	typedef RegionCache<ScalePointFeature, CodeT> CodeCacheT;
+	const std::string codebook_file = create_filespec(out_dir, "codebook", extension);
+	if (!file_exists(codebook_file) || !encoder.load(codebook_file))
+	{
+		// 从所有图像的描述子中均匀采样训练码本
+		const size_t max_sample_count = 100000;
+		const size_t samples_per_image = std::max<size_t>(1, max_sample_count / std::max<size_t>(1, file_names.size()));
+		std::vector<std::vector<float> > vec_samples(file_names.size());
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int i = 0; i < (int)file_names.size(); ++i)
+		{
+			std::vector<DescriptorT> vec_descs;
+			LoadDescsFromBinFile(create_filespec(out_dir, basename_part(file_names[i]), "desc"), vec_descs);
+			const size_t step = std::max<size_t>(1, vec_descs.size() / samples_per_image);
+			for (size_t k = 0; k < vec_descs.size(); k += step)
+				vec_samples[i].insert(vec_samples[i].end(),
+					vec_descs[k].getData(), vec_descs[k].getData() + DescriptorT::kStaticSize);
+		}
+		std::vector<float> vec_data;
+		for (size_t i = 0; i < vec_samples.size(); ++i)
+			vec_data.insert(vec_data.end(), vec_samples[i].begin(), vec_samples[i].end());
+		if (vec_data.empty()
+			|| !encoder.train(&vec_data[0], vec_data.size() / DescriptorT::kStaticSize, DescriptorT::kStaticSize, encoder_param)
+			|| !encoder.save(codebook_file))
+			return std::shared_ptr<CodeCacheT>();
+	}
+
+	const time_t codebook_time = file_modified(codebook_file);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int i = 0; i < (int)file_names.size(); ++i)
+	{
+		const std::string basename = basename_part(file_names[i]);
+		const std::string desc_file = create_filespec(out_dir, basename, "desc");
+		const std::string code_file = create_filespec(out_dir, basename, extension);
+		if (file_exists(code_file) && file_modified(code_file) >= std::max(codebook_time, file_modified(desc_file)))
+			continue;
+		std::vector<DescriptorT> vec_descs;
+		LoadDescsFromBinFile(desc_file, vec_descs);
+		std::vector<CodeT> vec_codes(vec_descs.size());
+		for (size_t k = 0; k < vec_descs.size(); ++k)
+			encoder.encode(vec_descs[k].getData(), vec_codes[k].getData());
+		SaveDescsToBinFile(code_file, vec_codes);
+	}
+
+	std::shared_ptr<CodeCacheT> code_cache(new CodeCacheT(memory_budget));
+	for (size_t i = 0; i < file_names.size(); ++i) {
+		const std::string basename = basename_part(file_names[i]);
+		code_cache->addImage(i, create_filespec(out_dir, basename, "feat"), create_filespec(out_dir, basename, extension));
+	}
+	return code_cache;
+}
+
+// 使用PCA降维并量化为kCodeSize字节的描述子计算可能的匹配，匹配算子与未压缩的描述子相同
+template <int kCodeSize>
+static bool ComputePCAPutativeMatches(const std::string & nearest_method, float distance_ratio, bool is_symmetric,
+	size_t memory_budget, const std::vector<std::string> & file_names, const std::string & out_dir,
+	const std::vector<std::pair<size_t, size_t> > & vec_pairs,
+	PairWiseMatches & map_putatives_matches)
+{
+	typedef Descriptor<unsigned char, kCodeSize> CodeT;
+	typedef KeypointSet<std::vector<ScalePointFeature>, std::vector<CodeT> > CodeKeypointSetT;
+	DescriptorPCA pca;
+	std::ostringstream extension;
+	extension << "pca" << kCodeSize;
+	const std::shared_ptr<RegionCache<ScalePointFeature, CodeT> > code_cache =
+		CompressDescriptors<CodeT, Descriptor<unsigned char, 128> >(pca, kCodeSize, extension.str(),
+			file_names, out_dir, memory_budget);
+	if (!code_cache)
+		return false;
+	// 保存的索引对应未压缩的描述子，压缩时不使用索引文件
+	return (nearest_method == "BRUTEFORCE")
+		? ComputePutativeMatches<CodeKeypointSetT, ArrayMatcherBruteForceSIMD<unsigned char> >(distance_ratio,
+			is_symmetric, false, code_cache, file_names, out_dir, vec_pairs, map_putatives_matches)
+		: ComputePutativeMatches<CodeKeypointSetT, ArrayMatcherKdtreeFlann<unsigned char, flann::L2<unsigned char> > >(
+			distance_ratio, is_symmetric, false, code_cache, file_names, out_dir, vec_pairs, map_putatives_matches);
+}
+
+// 创建使用同一个码本的乘积量化匹配算子
+struct PQMatcherFactory
+{
+	explicit PQMatcherFactory(const std::shared_ptr<const ProductQuantizer> & quantizer) : quantizer_(quantizer) {}
+
+	std::shared_ptr<ArrayMatcherProductQuantization> operator()() const
+	{
+		return std::shared_ptr<ArrayMatcherProductQuantization>(new ArrayMatcherProductQuantization(quantizer_));
+	}
+
+	std::shared_ptr<const ProductQuantizer> quantizer_;
+};
+
+// 使用乘积量化的16字节编码计算可能的匹配，每幅图像的索引为编码，
+// 查询使用.desc中未压缩的描述子，与编码计算非对称距离(ADC)
+static bool ComputePQPutativeMatches(float distance_ratio, bool is_symmetric,
+	size_t memory_budget, const std::vector<std::string> & file_names, const std::string & out_dir,
+	const std::vector<std::pair<size_t, size_t> > & vec_pairs,
+	PairWiseMatches & map_putatives_matches)
+{
+	typedef Descriptor<unsigned char, 16> CodeT;
+	typedef KeypointSet<std::vector<ScalePointFeature>, std::vector<CodeT> > CodeKeypointSetT;
+	std::shared_ptr<ProductQuantizer> quantizer(new ProductQuantizer);
+	const std::shared_ptr<RegionCache<ScalePointFeature, CodeT> > code_cache =
+		CompressDescriptors<CodeT, Descriptor<unsigned char, 128> >(*quantizer, CodeT::kStaticSize, "pq16",
+			file_names, out_dir, memory_budget);
+	if (!code_cache)
+		return false;
+
+	typedef MatcherAllInMemory<CodeKeypointSetT, ArrayMatcherProductQuantization, Descriptor<unsigned char, 128> > PQMatcherT;
+	PQMatcherT collectionMatcher(distance_ratio, code_cache);
+	collectionMatcher.setSymmetric(is_symmetric);
+	// 未压缩的查询描述子只在匹配一个图像对时使用，没有内存预算时也按需读取，避免同时保存所有图像的描述子
+	collectionMatcher.setQueryCache(std::shared_ptr<PQMatcherT::QueryCacheT>(
+		new PQMatcherT::QueryCacheT(memory_budget > 0 ? memory_budget : (size_t(256) << 20))));
+	std::shared_ptr<PQMatcherT::IndexRegistryT> index_registry(new PQMatcherT::IndexRegistryT(code_cache));
+	index_registry->setMatcherFactory(PQMatcherFactory(quantizer));
+	collectionMatcher.setIndexRegistry(index_registry);
+	if (!collectionMatcher.LoadData(file_names, out_dir))
+		return false;
+	return collectionMatcher.Match(file_names, vec_pairs, map_putatives_matches);
+}
+
+// 读取已有的匹配文件，并按当前的图像列表重新映射图像索引
+// vec_is_new返回当前列表中还没有匹配的图像，is_outdated表示匹配文件需要重新保存
+// 没有图像列表的旧文件认为已经包含了当前所有的图像，之后补上图像列表
+static bool LoadPreviousMatches(const std::string & matches_file,
+	const std::vector<std::string> & image_names,
+	PairWiseMatches & map_matches, std::vector<bool> & vec_is_new, bool & is_outdated)
+{
+	vec_is_new.assign(image_names.size(), true);
+	is_outdated = true;
+	if (!mvg::utils::file_exists(matches_file) || !pairedIndexedMatchImport(matches_file, map_matches))
+		return false;
+
+	std::vector<std::string> vec_matched_names;
+	if (!LoadImageNames(ImageListFile(matches_file), vec_matched_names)) {
+		vec_is_new.assign(image_names.size(), false);
+		return true;
+	}
+	is_outdated = (vec_matched_names != image_names);
+	if (is_outdated) {
+		std::vector<int> vec_new_index;
+		CompareImageLists(vec_matched_names, image_names, vec_new_index, vec_is_new);
+		PairWiseMatches map_remapped_matches;
+		RemapPairWiseMatches(map_matches, vec_new_index, map_remapped_matches);
+		map_matches.swap(map_remapped_matches);
+	}
+	else {
+		vec_is_new.assign(image_names.size(), false);
+	}
+	return true;
+}
+
+// 根据几何性质过滤可能的匹配，结果插入到map_geometric_matches中。
+// is_stream时从初始匹配文件按块流式过滤，结果直接写入最终的几何匹配文件，不读回内存
+template <typename CollectionFilterT, typename GeometricFilterT>
+static bool FilterPutativeMatches(const CollectionFilterT & collection_geom_filter,
+	const GeometricFilterT & geometric_filter, bool is_stream,
+	const std::string & putative_file, const std::string & geometric_file,
+	PairWiseMatches & map_matches_to_filter, PairWiseMatches & map_geometric_matches,
+	const std::vector<std::pair<size_t, size_t> > & vec_images_size)
+{
+	if (!is_stream)
+		return collection_geom_filter.Filter(geometric_filter, map_matches_to_filter, map_geometric_matches, vec_images_size);
+	return collection_geom_filter.FilterStream(geometric_filter, putative_file, geometric_file, vec_images_size);
+}
+
+// 特征提取流水线中的一幅图像
+template <typename KeypointSetT>
+struct ExtractionItem
+{
+	size_t index;                                       //!< 图像的索引
+	std::shared_ptr<Image<unsigned char> > image;       //!< 解码后的图像，解码失败或提取特征后为空
+	int scale;                                          //!< 解码时图像缩小的倍数
+	std::shared_ptr<KeypointSetT> keypoint_set;         //!< 提取的特征及描述子
+};
+
+// 特征提取流水线：解码线程 -> SIFT线程 -> 写文件线程，各阶段之间通过有界队列连接，
+// 流水线中的图像个数达到max_in_flight时解码线程等待，峰值内存与图像总数无关
+template <typename KeypointSetT>
+struct ExtractionPipeline
+{
+	typedef ExtractionItem<KeypointSetT> ItemT;
+
+	ExtractionPipeline(const std::vector<std::string> & file_names, const std::string & out_dir,
+		const std::vector<size_t> & vec_indices, size_t max_in_flight, int max_dimension,
+		int tile_size, int max_tile_features,
+		bool is_zoom, float contrast_threshold, ControlProgressDisplay & progress_bar)
+		: file_names(file_names), out_dir(out_dir), vec_indices(vec_indices), max_dimension(max_dimension),
+		tile_size(tile_size), max_tile_features(max_tile_features),
+		is_zoom(is_zoom), contrast_threshold(contrast_threshold), progress_bar(progress_bar),
+		is_write_failed(false), next(0),
+		in_flight(max_in_flight), decoded(max_in_flight), extracted(max_in_flight) {}
+
+	// 取下一幅需要解码的图像
+	bool nextIndex(size_t & index)
+	{
+		mvg::threads::ScopedLock<mvg::threads::Mutex> lock(mutex);
+		if (next >= vec_indices.size())
+			return false;
+		index = vec_indices[next++];
+		return true;
+	}
+
+	const std::vector<std::string> & file_names;
+	const std::string & out_dir;
+	const std::vector<size_t> & vec_indices;    //!< 需要提取特征的图像
+	const int max_dimension;                    //!< 解码后图像的最大边长，0表示原始分辨率
+	const int tile_size;                        //!< 分块提取特征的网格大小，0表示不分块
+	const int max_tile_features;                //!< 每个网格保留的特征个数上限
+	const bool is_zoom;
+	const float contrast_threshold;
+	ControlProgressDisplay & progress_bar;      //!< 只在写文件线程中更新
+	bool is_write_failed;                       //!< 是否有特征文件写入失败，只在写文件线程中更新
+
+	mvg::threads::Mutex mutex;
+	size_t next;                                            //!< 下一幅需要解码的图像在vec_indices中的位置
+	mvg::threads::BoundedQueue<size_t> in_flight;           //!< 流水线中的图像，满时解码线程等待(反压)
+	mvg::threads::BoundedQueue<ItemT> decoded;              //!< 已解码，等待提取特征
+	mvg::threads::BoundedQueue<ItemT> extracted;            //!< 已提取特征，等待写文件
+};
+
+// 解码线程，读取图像
+template <typename KeypointSetT>
+class DecodeThread : public mvg::threads::Thread
+{
+public:
+	explicit DecodeThread(ExtractionPipeline<KeypointSetT> & pipeline) : pipeline_(pipeline) {}
+
+	virtual void run()
+	{
+		size_t index;
+		while (pipeline_.nextIndex(index)) {
+			pipeline_.in_flight.push(index);
+			typename ExtractionPipeline<KeypointSetT>::ItemT item;
+			item.index = index;
+			item.image.reset(new Image<unsigned char>);
+			// JPEG图像在解码时直接缩小，跳过原始分辨率的IDCT和颜色转换
+			if (!readImage(pipeline_.file_names[index].c_str(), item.image.get(),
+				pipeline_.max_dimension, &item.scale))
+				item.image.reset();
+			pipeline_.decoded.push(item);
+		}
+	}
+
+private:
+	ExtractionPipeline<KeypointSetT> & pipeline_;
+};
+
+// SIFT线程，每个处理器一个，提取特征后立即释放图像
+template <typename KeypointSetT>
+class SiftThread : public mvg::threads::Thread
+{
+public:
+	explicit SiftThread(ExtractionPipeline<KeypointSetT> & pipeline) : pipeline_(pipeline) {}
+
+	virtual void run()
+	{
+		typename ExtractionPipeline<KeypointSetT>::ItemT item;
+		while (pipeline_.decoded.pop(item)) {
+			if (item.image) {
+				item.keypoint_set.reset(new KeypointSetT);
+				if (pipeline_.tile_size > 0)
+					SIFTDetectorTiled(*item.image,
+						item.keypoint_set->features(), item.keypoint_set->descriptors(),
+						pipeline_.tile_size, pipeline_.max_tile_features, 64,
+						pipeline_.is_zoom, true, pipeline_.contrast_threshold, false);
+				else
+					SIFTDetector(*item.image,
+						item.keypoint_set->features(), item.keypoint_set->descriptors(),
+						pipeline_.is_zoom, true, pipeline_.contrast_threshold, false);
+				// 特征坐标及尺度变换回原图，之后的匹配和几何过滤都使用原图坐标
+				RescaleFeatures(item.keypoint_set->features(), static_cast<float>(item.scale));
+				item.image.reset();
+			}
+			pipeline_.extracted.push(item);
+		}
+	}
+
+private:
+	ExtractionPipeline<KeypointSetT> & pipeline_;
+};
+
+// 写文件线程，保存特征及描述子后图像离开流水线。
+// 先写入临时文件再重命名，其他进程(例如其他分片)看到的.feat和.desc总是完整的
+template <typename KeypointSetT>
+class WriterThread : public mvg::threads::Thread
+{
+public:
+	explicit WriterThread(ExtractionPipeline<KeypointSetT> & pipeline) : pipeline_(pipeline) {}
+
+	virtual void run()
+	{
+		typename ExtractionPipeline<KeypointSetT>::ItemT item;
+		while (pipeline_.extracted.pop(item)) {
+			if (item.keypoint_set) {
+				const std::string basename = mvg::utils::basename_part(pipeline_.file_names[item.index]);
+				const std::string feat = mvg::utils::create_filespec(pipeline_.out_dir, basename, "feat");
+				const std::string desc = mvg::utils::create_filespec(pipeline_.out_dir, basename, "desc");
+				const std::string feat_tmp = feat + ".tmp", desc_tmp = desc + ".tmp";
+				// 旧文件先删除，.feat最后出现，两个文件都存在时一定是同一次提取的结果
+				const bool is_ok = item.keypoint_set->saveToBinFile(feat_tmp, desc_tmp)
+					&& (!mvg::utils::file_exists(feat) || mvg::utils::file_delete(feat))
+					&& (!mvg::utils::file_exists(desc) || mvg::utils::file_delete(desc))
+					&& mvg::utils::file_rename(desc_tmp, desc)
+					&& mvg::utils::file_rename(feat_tmp, feat);
+				if (!is_ok) {
+					std::cerr << std::endl << "Cannot write the features of " << pipeline_.file_names[item.index]
+						<< " to " << feat << " and " << desc << std::endl;
+					// 删除不完整的文件，下次运行时重新提取
+					mvg::utils::file_delete(feat_tmp);
+					mvg::utils::file_delete(desc_tmp);
+					mvg::utils::file_delete(feat);
+					mvg::utils::file_delete(desc);
+					pipeline_.is_write_failed = true;
+				}
+			}
+			size_t token;
+			pipeline_.in_flight.pop(token);
+			++pipeline_.progress_bar;
+		}
+	}
+
+private:
+	ExtractionPipeline<KeypointSetT> & pipeline_;
+};
+
+// 通过流水线并行提取vec_indices中图像的特征，max_in_flight为0时取SIFT线程数的两倍，
+// max_dimension大于0时JPEG图像以缩小的分辨率解码，tile_size大于0时分块提取并限制每块的特征个数，
+// 有特征文件写入失败时返回false
+template <typename KeypointSetT>
+static bool ExtractFeatures(const std::vector<std::string> & file_names, const std::string & out_dir,
+	const std::vector<size_t> & vec_indices, size_t max_in_flight, int max_dimension,
+	int tile_size, int max_tile_features,
+	bool is_zoom, float contrast_threshold, ControlProgressDisplay & progress_bar)
+{
+	if (vec_indices.empty())
+		return true;
+	const int sift_thread_count = std::max(1, mvg::threads::GetNumberOfProcessors());
+	const int decode_thread_count = std::min(2, sift_thread_count);
+	if (max_in_flight == 0)
+		max_in_flight = 2 * sift_thread_count;
+
+	ExtractionPipeline<KeypointSetT> pipeline(file_names, out_dir, vec_indices,
+		max_in_flight, max_dimension, tile_size, max_tile_features, is_zoom, contrast_threshold, progress_bar);
+
+	// vlfeat的全局状态只初始化一次，SIFT线程不再各自初始化
+	vl_constructor();
+	std::vector<std::shared_ptr<mvg::threads::Thread> > vec_decoders, vec_sift_workers;
+	for (int i = 0; i < decode_thread_count; ++i)
+		vec_decoders.push_back(std::make_shared<DecodeThread<KeypointSetT> >(pipeline));
+	for (int i = 0; i < sift_thread_count; ++i)
+		vec_sift_workers.push_back(std::make_shared<SiftThread<KeypointSetT> >(pipeline));
+	WriterThread<KeypointSetT> writer(pipeline);
+
+	writer.start();
+	for (size_t i = 0; i < vec_sift_workers.size(); ++i)
+		vec_sift_workers[i]->start();
+	for (size_t i = 0; i < vec_decoders.size(); ++i)
+		vec_decoders[i]->start();
+
+	// 按阶段依次关闭队列，每个阶段处理完剩余的图像后退出
+	for (size_t i = 0; i < vec_decoders.size(); ++i)
+		vec_decoders[i]->join();
+	pipeline.decoded.close();
+	for (size_t i = 0; i < vec_sift_workers.size(); ++i)
+		vec_sift_workers[i]->join();
+	pipeline.extracted.close();
+	writer.join();
+	vl_destructor();
+	return !pipeline.is_write_failed;
+}
+
 int main(int argc, char **argv)
 {
 	CmdLine cmd;
@@ -54,6 +461,18 @@ int main(int argc, char **argv)
 	float distance_ratio = .6f;
 	bool is_zoom = false;
 	float contrast_threshold = 0.04f;
+	size_t memory_budget = 0;
+	std::string nearest_method = "ANN";
+	bool is_symmetric = false;
+	bool is_save_index = false;
+	size_t pair_top_k = 0;
+	size_t max_in_flight = 0;
+	int max_dimension = 0;
+	int tile_size = 0;
+	int max_tile_features = 2000;
+	std::string compression = "";
+	std::string shard = "";
+	bool is_early_exit = false;
 
 	cmd.add(make_option('i', image_dir, "imadir"));
 	cmd.add(make_option('o', out_dir, "outdir"));
@@ -61,6 +480,18 @@ int main(int argc, char **argv)
 	cmd.add(make_option('s', is_zoom, "isZoom"));
 	cmd.add(make_option('p', contrast_threshold, "contrastThreshold"));
 	cmd.add(make_option('g', geometric_model, "geometricModel"));
+	cmd.add(make_option('m', memory_budget, "memoryBudget"));
+	cmd.add(make_option('n', nearest_method, "nearestMethod"));
+	cmd.add(make_option('c', is_symmetric, "crossCheck"));
+	cmd.add(make_option('x', is_save_index, "saveIndex"));
+	cmd.add(make_option('k', pair_top_k, "pairTopK"));
+	cmd.add(make_option('f', max_in_flight, "maxInFlight"));
+	cmd.add(make_option('d', max_dimension, "maxDimension"));
+	cmd.add(make_option('t', tile_size, "tileSize"));
+	cmd.add(make_option('b', max_tile_features, "tileFeatures"));
+	cmd.add(make_option('q', compression, "compression"));
+	cmd.add(make_option('h', shard, "shard"));
+	cmd.add(make_option('e', is_early_exit, "earlyExit"));
 
 	try {
 		if (argc == 1) throw std::string("Invalid command line parameter.");
@@ -74,7 +505,24 @@ int main(int argc, char **argv)
 			<< "[-r|--distratio 0.6] \n"
 			<< "[-s|--isZoom 0 or 1] \n"
 			<< "[-p|--contrastThreshold 0.04 -> 0.01] \n"
-			<< "[-g]--geometricModel f, e or h]"
+			<< "[-g]--geometricModel f, e or h]\n"
+			<< "[-m|--memoryBudget 0 (MB of features and descriptors kept in memory, 0: unlimited;\n"
+			<< "   with a budget the geometric filtering streams the pairs from matches.putative.bin in chunks)]\n"
+			<< "[-n|--nearestMethod ANN (kd-tree FLANN) or BRUTEFORCE (exact, SIMD)]\n"
+			<< "[-c|--crossCheck 0 or 1 (keep only mutual nearest neighbors)]\n"
+			<< "[-x|--saveIndex 0 or 1 (save the ANN index of each image next to its descriptors and reuse it)]\n"
+			<< "[-k|--pairTopK 0 (match each image only with its K most similar images by VLAD retrieval, 0: all pairs)]\n"
+			<< "[-f|--maxInFlight 0 (images held in the feature extraction pipeline, 0: twice the number of processors)]\n"
+			<< "[-d|--maxDimension 0 (decode JPEG images at 1/2, 1/4 or 1/8 resolution so that the longer side fits, 0: full resolution)]\n"
+			<< "[-t|--tileSize 0 (extract SIFT in tiles of this size with a per-tile feature budget, 0: whole image)]\n"
+			<< "[-b|--tileFeatures 2000 (maximal number of features kept per tile, strongest DoG response first)]\n"
+			<< "[-q|--compression PCA64, PCA32 or PQ16 (match descriptors reduced by PCA to 64 or 32 bytes, or product-quantized to 16 bytes, default: uncompressed)]\n"
+			<< "[-h|--shard k/N (extract the features of every N-th image and match the k-th of N balanced blocks of pairs into matches.putative.shard-k-of-N.bin,\n"
+			<< "   merge all shards with merge_matches then run again without --shard for the geometric filtering; requires --nearestMethod BRUTEFORCE)]\n"
+			<< "[-e|--earlyExit 0 or 1 (essential matrix only: skip pairs with less than 50 putative matches, and stop AC-RANSAC\n"
+			<< "   after the probe iterations when no meaningful model with at least 50 inliers and 30% inlier ratio was found.\n"
+			<< "   Faster on collections with many non-overlapping pairs, but the cutoff is probabilistic and may drop a few valid pairs,\n"
+			<< "   default: 0)]"
 			<< std::endl;
 
 		std::cerr << s << std::endl;
@@ -88,28 +536,68 @@ int main(int argc, char **argv)
 		<< "--distratio " << distance_ratio << std::endl
 		<< "--octminus1 " << is_zoom << std::endl
 		<< "--peakThreshold " << contrast_threshold << std::endl
-		<< "--geometricModel " << geometric_model << std::endl;
+		<< "--geometricModel " << geometric_model << std::endl
+		<< "--memoryBudget " << memory_budget << std::endl
+		<< "--nearestMethod " << nearest_method << std::endl
+		<< "--crossCheck " << is_symmetric << std::endl
+		<< "--saveIndex " << is_save_index << std::endl
+		<< "--pairTopK " << pair_top_k << std::endl
+		<< "--maxInFlight " << max_in_flight << std::endl
+		<< "--maxDimension " << max_dimension << std::endl
+		<< "--tileSize " << tile_size << std::endl
+		<< "--tileFeatures " << max_tile_features << std::endl
+		<< "--compression " << compression << std::endl
+		<< "--shard " << shard << std::endl
+		<< "--earlyExit " << is_early_exit << std::endl;
 
 	if (out_dir.empty())  {
 		std::cerr << "\nIt is an invalid output directory" << std::endl;
 		return EXIT_FAILURE;
 	}
 
+	if (!compression.empty() && compression != "PCA64" && compression != "PCA32" && compression != "PQ16") {
+		std::cerr << "\nUnknown descriptor compression" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// 分片模式，k/N表示共N个分片中的第k个
+	size_t shard_index = 0, shard_count = 0;
+	if (!shard.empty())
+	{
+		std::istringstream iss(shard);
+		char separator = 0;
+		if (!(iss >> shard_index >> separator >> shard_count) || separator != '/'
+			|| shard_count == 0 || shard_index >= shard_count) {
+			std::cerr << "\nInvalid shard, expected k/N with 0 <= k < N" << std::endl;
+			return EXIT_FAILURE;
+		}
+		// 每个进程各自训练的词典、码本和保存的索引互相冲突，分片之间的结果也不一致
+		if (pair_top_k > 0 || !compression.empty() || is_save_index) {
+			std::cerr << "\n--shard cannot be combined with --pairTopK, --compression or --saveIndex" << std::endl;
+			return EXIT_FAILURE;
+		}
+		// FLANN的随机kd树在每个进程中建立的结果不同，只有精确的暴力匹配能保证合并的分片与单进程的结果相同
+		if (nearest_method != "BRUTEFORCE") {
+			std::cerr << "\n--shard requires --nearestMethod BRUTEFORCE" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
 	GeometricModel geometric_model_to_compute = FUNDAMENTAL_MATRIX;
 	std::string geometric_matches_filename = "";
 	switch (geometric_model[0])
 	{
 	case 'f': case 'F':
 		geometric_model_to_compute = FUNDAMENTAL_MATRIX;
-		geometric_matches_filename = "matches.f.txt";
+		geometric_matches_filename = "matches.f.bin";
 		break;
 	case 'e': case 'E':
 		geometric_model_to_compute = ESSENTIAL_MATRIX;
-		geometric_matches_filename = "matches.e.txt";
+		geometric_matches_filename = "matches.e.bin";
 		break;
 	case 'h': case 'H':
 		geometric_model_to_compute = HOMOGRAPHY_MATRIX;
-		geometric_matches_filename = "matches.h.txt";
+		geometric_matches_filename = "matches.h.bin";
 		break;
 	default:
 		std::cerr << "Unknown geometric model" << std::endl;
@@ -167,6 +655,7 @@ int main(int argc, char **argv)
 
 	// 两个别名，以便方便的访问图像文件名及图像大小
 	std::vector<std::string> file_names;
+	std::vector<std::string> image_names;
 	std::vector<std::pair<size_t, size_t> > vec_images_size;
 	for (std::vector<mvg::feature::CameraInfo>::const_iterator
 		iter_camera_info = vec_camera_info.begin();
@@ -176,6 +665,7 @@ int main(int argc, char **argv)
 		vec_images_size.push_back(std::make_pair(vec_cameras_intrinsic[iter_camera_info->intrinsic_id].width,
 			vec_cameras_intrinsic[iter_camera_info->intrinsic_id].height));
 		file_names.push_back(mvg::utils::create_filespec(image_dir, iter_camera_info->image_name));
+		image_names.push_back(iter_camera_info->image_name);
 	}
 
 	//计算特征和描述子，如果特征已经计算，则导入特征，否则重新计算并保存
@@ -189,32 +679,37 @@ int main(int argc, char **argv)
 		std::cout << "\n\nEXTRACT FEATURES" << std::endl;
 		vec_images_size.resize(file_names.size());
 
-		Image<unsigned char> gray_image;
 		// 显示处理百分比
 		ControlProgressDisplay my_progress_bar(file_names.size());
+		//如果文件夹下不存在特征及描述，则进行计算
+		// 分片模式下每个分片只提取第shard_index + k * shard_count幅图像，多个进程不会写同一个文件
+		std::vector<size_t> vec_indices;
 		for (size_t i = 0; i < file_names.size(); ++i)  {
 			std::string feat = mvg::utils::create_filespec(out_dir,
 				mvg::utils::basename_part(file_names[i]), "feat");
 			std::string desc = mvg::utils::create_filespec(out_dir,
 				mvg::utils::basename_part(file_names[i]), "desc");
 
-			//如果文件夹下不存在特征及描述，则进行计算
-			if (!mvg::utils::file_exists(feat) || !mvg::utils::file_exists(desc)) {
-
-				if (!readImage(file_names[i].c_str(), &gray_image))
-					continue;
-
-				// 计算特征和描述，然后将他们导入到文件中
-				KeypointSetT keypoint_set;
-				SIFTDetector(gray_image,
-					keypoint_set.features(), keypoint_set.descriptors(),
-					is_zoom, true, contrast_threshold);
-				keypoint_set.saveToBinFile(feat, desc);
-			}
-			++my_progress_bar;
+			const bool is_own_image = shard_count == 0 || i % shard_count == shard_index;
+			if (is_own_image && (!mvg::utils::file_exists(feat) || !mvg::utils::file_exists(desc)))
+				vec_indices.push_back(i);
+			else
+				++my_progress_bar;
+		}
+		// 计算特征和描述，然后将他们导入到文件中
+		if (!ExtractFeatures<KeypointSetT>(file_names, out_dir, vec_indices, max_in_flight, max_dimension,
+			tile_size, max_tile_features, is_zoom, contrast_threshold, my_progress_bar))
+		{
+			std::cerr << std::endl << "Feature extraction failed: some feature files could not be written" << std::endl;
+			return EXIT_FAILURE;
 		}
 	}
 
+	// 匹配和几何过滤共享特征及描述子的缓存，每幅图像只读取一次
+	typedef RegionCache<FeatureT, DescriptorT> RegionCacheT;
+	std::shared_ptr<RegionCacheT> region_cache(new RegionCacheT(memory_budget << 20));
+	region_cache->setImages(file_names, out_dir);
+
 	// 计算可能的匹配
 	PairWiseMatches map_putatives_matches;
 
@@ -222,28 +717,114 @@ int main(int argc, char **argv)
 	typedef flann::L2<DescriptorT::bin_type> MetricT;
 	typedef ArrayMatcherKdtreeFlann<DescriptorT::bin_type, MetricT> MatcherT;
 
-	// 或者可以采用暴力匹配，具体如下：
-	//typedef SquaredEuclideanDistanceVectorized<DescriptorT::bin_type> MetricT;
-	//typedef ArrayMatcherBruteForce<DescriptorT::bin_type, MetricT> MatcherT;
-
-	// 如果匹配已经存在，重新导入
-	if (mvg::utils::file_exists(out_dir + "/matches.putative.txt"))
+	// 或者采用分块的SIMD暴力匹配，结果为精确的最近邻
+	typedef ArrayMatcherBruteForceSIMD<DescriptorT::bin_type> BruteForceMatcherT;
+
+	// 如果匹配已经存在，重新导入(优先使用二进制文件，兼容旧的文本文件)，
+	// 图像列表中新加入的图像只与其他图像匹配，结果合并到已有的匹配中
+	const std::string putative_bin_file = out_dir + "/matches.putative.bin";
+	std::string putative_matches_file = putative_bin_file;
+	if (!mvg::utils::file_exists(putative_matches_file))
+		putative_matches_file = out_dir + "/matches.putative.txt";
+	std::vector<bool> vec_is_new_putative;
+	bool is_putative_outdated = true;
+	if (LoadPreviousMatches(putative_matches_file, image_names,
+		map_putatives_matches, vec_is_new_putative, is_putative_outdated))
 	{
-		pairedIndexedMatchImport(out_dir + "/matches.putative.txt", map_putatives_matches);
-		std::cout << std::endl << "PUTATIVE MATCHES -- PREVIOUS RESULTS LOADED" << std::endl;
+		std::cout << std::endl << "PUTATIVE MATCHES -- PREVIOUS RESULTS LOADED" << std::endl
+			<< std::count(vec_is_new_putative.begin(), vec_is_new_putative.end(), true)
+			<< " new image(s) to match" << std::endl;
 	}
-	else // 计算匹配
+	std::vector<std::pair<size_t, size_t> > vec_new_pairs = PairsWithNewImages(vec_is_new_putative);
+	if (pair_top_k > 0 && !vec_new_pairs.empty())
 	{
-		MatcherAllInMemory<KeypointSetT, MatcherT> collectionMatcher(distance_ratio);
-		if (collectionMatcher.LoadData(file_names, out_dir))
-		{
-			std::cout << std::endl << "PUTATIVE MATCHES" << std::endl;
-			collectionMatcher.Match(file_names, map_putatives_matches);
-			// 导出可能的匹配
-			std::ofstream file(std::string(out_dir + "/matches.putative.txt").c_str());
-			if (file.is_open())
-				PairedIndexedMatchToStream(map_putatives_matches, file);
-			file.close();
+		// 通过VLAD全局描述子检索，每幅图像只与最相似的pair_top_k幅图像匹配
+		std::cout << std::endl << "PAIR PRE-SELECTION (top " << pair_top_k << ")" << std::endl;
+		VladPairSelector<RegionCacheT> pair_selector(region_cache);
+		std::vector<std::pair<size_t, size_t> > vec_candidate_pairs, vec_selected_pairs;
+		if (pair_selector.selectPairs(file_names.size(), pair_top_k, vec_candidate_pairs)) {
+			std::set_intersection(vec_new_pairs.begin(), vec_new_pairs.end(),
+				vec_candidate_pairs.begin(), vec_candidate_pairs.end(), std::back_inserter(vec_selected_pairs));
+			vec_new_pairs.swap(vec_selected_pairs);
+		}
+		else {
+			std::cerr << "Pair pre-selection failed, all pairs are matched." << std::endl;
+		}
+	}
+	if (shard_count > 0)
+	{
+		// 分片模式只匹配属于本分片的图像对，已有的匹配只写入第0个分片
+		vec_new_pairs = ShardPairs(vec_new_pairs, shard_index, shard_count);
+		if (shard_index > 0)
+			map_putatives_matches.clear();
+
+		// 只注册本分片用到的图像，其他分片的图像可能还没有提取特征
+		std::vector<bool> vec_is_used(file_names.size(), false);
+		for (size_t k = 0; k < vec_new_pairs.size(); ++k)
+			vec_is_used[vec_new_pairs[k].first] = vec_is_used[vec_new_pairs[k].second] = true;
+		region_cache.reset(new RegionCacheT(memory_budget << 20));
+		size_t missing_count = 0;
+		for (size_t i = 0; i < file_names.size(); ++i) {
+			if (!vec_is_used[i])
+				continue;
+			const std::string basename = mvg::utils::basename_part(file_names[i]);
+			const std::string feat = mvg::utils::create_filespec(out_dir, basename, "feat");
+			const std::string desc = mvg::utils::create_filespec(out_dir, basename, "desc");
+			if (!mvg::utils::file_exists(feat) || !mvg::utils::file_exists(desc))
+				++missing_count;
+			else
+				region_cache->addImage(i, feat, desc);
+		}
+		if (missing_count > 0) {
+			std::cerr << std::endl << missing_count << " image(s) of shard " << shard
+				<< " have no features yet, run again once every shard has extracted its features" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	bool is_putative_ok = true;
+	if (!vec_new_pairs.empty()) // 计算匹配
+	{
+		std::cout << std::endl << "PUTATIVE MATCHES (" << vec_new_pairs.size() << " pairs)" << std::endl;
+		if (compression == "PCA64")
+			is_putative_ok = ComputePCAPutativeMatches<64>(nearest_method, distance_ratio, is_symmetric,
+				memory_budget << 20, file_names, out_dir, vec_new_pairs, map_putatives_matches);
+		else if (compression == "PCA32")
+			is_putative_ok = ComputePCAPutativeMatches<32>(nearest_method, distance_ratio, is_symmetric,
+				memory_budget << 20, file_names, out_dir, vec_new_pairs, map_putatives_matches);
+		else if (compression == "PQ16")
+			is_putative_ok = ComputePQPutativeMatches(distance_ratio, is_symmetric,
+				memory_budget << 20, file_names, out_dir, vec_new_pairs, map_putatives_matches);
+		else
+			is_putative_ok = (nearest_method == "BRUTEFORCE")
+				? ComputePutativeMatches<KeypointSetT, BruteForceMatcherT>(distance_ratio, is_symmetric,
+					is_save_index, region_cache, file_names, out_dir, vec_new_pairs, map_putatives_matches)
+				: ComputePutativeMatches<KeypointSetT, MatcherT>(distance_ratio, is_symmetric,
+					is_save_index, region_cache, file_names, out_dir, vec_new_pairs, map_putatives_matches);
+	}
+	if (shard_count > 0)
+	{
+		// 分片的匹配由merge_matches合并后，再次运行时只进行几何过滤
+		const std::string shard_file = ShardMatchesFile(putative_bin_file, shard_index, shard_count);
+		if (!is_putative_ok || !PairedIndexedMatchToBinFile(map_putatives_matches, shard_file)
+			|| !SaveImageNames(ImageListFile(shard_file), image_names)) {
+			std::cerr << "\nUnable to compute or save the shard matches " << shard_file << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << std::endl << "Shard matches saved to " << shard_file << std::endl;
+		return EXIT_SUCCESS;
+	}
+	if (!is_putative_ok)
+	{
+		std::cerr << "\nUnable to compute the putative matches" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (is_putative_outdated)
+	{
+		// 导出可能的匹配及对应的图像列表
+		if (!PairedIndexedMatchToBinFile(map_putatives_matches, putative_bin_file)
+			|| !SaveImageNames(ImageListFile(putative_bin_file), image_names)) {
+			std::cerr << "\nUnable to save the putative matches " << putative_bin_file << std::endl;
+			return EXIT_FAILURE;
 		}
 	}
 	//导出可能的匹配，通过邻接矩阵的方式显示
@@ -251,71 +832,108 @@ int main(int argc, char **argv)
 		map_putatives_matches,
 		mvg::utils::create_filespec(out_dir, "PutativeAdjacencyMatrix", "svg"));
 
-	// 根据几何性质对可能的匹配进行过滤
+	// 根据几何性质对可能的匹配进行过滤，已有的几何匹配只需要过滤包含新图像的图像对
 	PairWiseMatches map_geometric_matches;
+	const std::string geometric_matches_file = out_dir + "/" + geometric_matches_filename;
+	std::vector<bool> vec_is_new_geometric;
+	bool is_geometric_outdated = true;
+	const bool is_geometric_loaded = LoadPreviousMatches(geometric_matches_file, image_names,
+		map_geometric_matches, vec_is_new_geometric, is_geometric_outdated);
+	PairWiseMatches map_new_putatives_matches;
+	if (is_geometric_loaded) {
+		const std::vector<std::pair<size_t, size_t> > vec_pairs = PairsWithNewImages(vec_is_new_geometric);
+		for (size_t k = 0; k < vec_pairs.size(); ++k) {
+			PairWiseMatches::const_iterator iter = map_putatives_matches.find(vec_pairs[k]);
+			if (iter != map_putatives_matches.end())
+				map_new_putatives_matches.insert(*iter);
+		}
+		std::cout << std::endl << "GEOMETRIC MATCHES -- PREVIOUS RESULTS LOADED" << std::endl;
+	}
+	PairWiseMatches & map_matches_to_filter = is_geometric_loaded ? map_new_putatives_matches : map_putatives_matches;
+	PairWiseMatches map_new_geometric_matches;
 
-	ImageCollectionGeometricFilter<FeatureT> collection_geom_filter;
+	// 有内存预算且需要过滤所有的图像对时流式过滤，初始匹配从文件中按块读取，先释放内存中的初始匹配，
+	// 几何匹配直接写入最终的文件，内存只与正在过滤的图像对有关
+	const bool is_stream_filter = memory_budget > 0 && !is_geometric_loaded && is_putative_ok
+		&& mvg::utils::file_exists(putative_bin_file);
+	if (is_stream_filter)
+		PairWiseMatches().swap(map_putatives_matches);
+
+	ImageCollectionGeometricFilter<FeatureT, DescriptorT> collection_geom_filter(region_cache);
 	const double max_residual_error = 4.0;
 	if (collection_geom_filter.LoadData(file_names, out_dir))
 	{
-		std::cout << std::endl << " - GEOMETRIC FILTERING - " << std::endl;
+		std::cout << std::endl << " - GEOMETRIC FILTERING - " << (is_stream_filter ? "(streamed from file)" : "") << std::endl;
+		bool is_filter_ok = true;
 		switch (geometric_model_to_compute)
 		{
 		case FUNDAMENTAL_MATRIX:
 		{
-			collection_geom_filter.Filter(
-				GeometricFilter_FMatrix_AC(max_residual_error),
-				map_putatives_matches,
-				map_geometric_matches,
-				vec_images_size);
+			is_filter_ok = FilterPutativeMatches(collection_geom_filter, GeometricFilter_FMatrix_AC(max_residual_error), is_stream_filter,
+				putative_bin_file, geometric_matches_file,
+				map_matches_to_filter, map_new_geometric_matches, vec_images_size);
 		}
 			break;
 		case ESSENTIAL_MATRIX:
 		{
-			collection_geom_filter.Filter(
-				GeometricFilter_EMatrix_AC(vec_cameras_intrinsic[0].camera_matrix, max_residual_error),
-				map_putatives_matches,
-				map_geometric_matches,
-				vec_images_size);
-
-			//进行额外的检查，用于移除比较差的重叠
-			std::vector<PairWiseMatches::key_type> vec_to_remove;
-			for (PairWiseMatches::const_iterator iter_map = map_geometric_matches.begin();
-				iter_map != map_geometric_matches.end(); ++iter_map)
-			{
-				size_t putative_photometric_count = map_putatives_matches.find(iter_map->first)->second.size();
-				size_t putative_geometric_count = iter_map->second.size();
-				float ratio = putative_geometric_count / (float)putative_photometric_count;
-				if (putative_geometric_count < 50 || ratio < .3f)  {
-					//添加到移除向量中
-					vec_to_remove.push_back(iter_map->first);
-				}
-			}
-			//移除废弃的匹配对
-			for (std::vector<PairWiseMatches::key_type>::const_iterator
-				iter = vec_to_remove.begin(); iter != vec_to_remove.end(); ++iter)
-			{
-				map_geometric_matches.erase(*iter);
+			// 要求至少50个内点且内点比例不低于0.3，用于移除比较差的重叠，达不到要求的图像对不输出，
+			// earlyExit时提前跳过或终止
+			const size_t min_geometric_count = 50;
+			const float min_geometric_ratio = .3f;
+			GeometricFilter_EMatrix_AC essential_filter(vec_cameras_intrinsic[0].camera_matrix, max_residual_error);
+			collection_geom_filter.setMinInliers(min_geometric_count, min_geometric_ratio);
+			if (is_early_exit) {
+				collection_geom_filter.setMinPutativeCount(min_geometric_count);
+				essential_filter.early_exit = ACRansacEarlyExit(min_geometric_count, min_geometric_ratio);
 			}
+			is_filter_ok = FilterPutativeMatches(collection_geom_filter, essential_filter, is_stream_filter,
+				putative_bin_file, geometric_matches_file,
+				map_matches_to_filter, map_new_geometric_matches, vec_images_size);
 		}
 			break;
 		case HOMOGRAPHY_MATRIX:
 		{
 
-			collection_geom_filter.Filter(
-				GeometricFilter_HMatrix_AC(max_residual_error),
-				map_putatives_matches,
-				map_geometric_matches,
-				vec_images_size);
+			is_filter_ok = FilterPutativeMatches(collection_geom_filter, GeometricFilter_HMatrix_AC(max_residual_error), is_stream_filter,
+				putative_bin_file, geometric_matches_file,
+				map_matches_to_filter, map_new_geometric_matches, vec_images_size);
 		}
 			break;
 		}
 
-		// 导出根据几何性质过滤之后的匹配
-		std::ofstream file(string(out_dir + "/" + geometric_matches_filename).c_str());
-		if (file.is_open())
-			PairedIndexedMatchToStream(map_geometric_matches, file);
-		file.close();
+		if (!is_filter_ok) {
+			// 流式过滤中途失败时不保留几何匹配文件
+			if (is_stream_filter)
+				mvg::utils::file_delete(geometric_matches_file);
+			std::cerr << "\nUnable to filter " << putative_bin_file << " into " << geometric_matches_file << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (is_stream_filter) {
+			// 流式过滤的结果已经是最终的文件，只保存图像列表，邻接矩阵直接遍历映射的文件
+			PairWiseMatchesStore geometric_store;
+			if (!geometric_store.open(geometric_matches_file)
+				|| !SaveImageNames(ImageListFile(geometric_matches_file), image_names)) {
+				std::cerr << "\nUnable to save the geometric matches " << geometric_matches_file << std::endl;
+				return EXIT_FAILURE;
+			}
+			std::cout << "\n Export Adjacency Matrix of the pairwise's geometric matches"
+				<< std::endl;
+			PairWiseMatchingToAdjacencyMatrixSVG(file_names.size(),
+				geometric_store,
+				mvg::utils::create_filespec(out_dir, "GeometricAdjacencyMatrix", "svg"));
+			return EXIT_SUCCESS;
+		}
+
+		// 合并新的几何匹配，导出根据几何性质过滤之后的匹配及对应的图像列表
+		map_geometric_matches.insert(map_new_geometric_matches.begin(), map_new_geometric_matches.end());
+		if (!map_new_geometric_matches.empty() || is_geometric_outdated) {
+			if (!PairedIndexedMatchToBinFile(map_geometric_matches, geometric_matches_file)
+				|| !SaveImageNames(ImageListFile(geometric_matches_file), image_names)) {
+				std::cerr << "\nUnable to save the geometric matches " << geometric_matches_file << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
 
 		// 导出邻接矩阵
 		std::cout << "\n Export Adjacency Matrix of the pairwise's geometric matches"
@@ -324,5 +942,10 @@ int main(int argc, char **argv)
 			map_geometric_matches,
 			mvg::utils::create_filespec(out_dir, "GeometricAdjacencyMatrix", "svg"));
 	}
+	else
+	{
+		std::cerr << "\nUnable to read the features for the geometric filtering" << std::endl;
+		return EXIT_FAILURE;
+	}
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
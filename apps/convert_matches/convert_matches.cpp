@@ -0,0 +1,73 @@
+﻿#include <cstdlib>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+#include "mvg/feature/indexed_match.h"
+#include "mvg/feature/indexed_match_utils.h"
+#include "mvg/feature/pairwise_matches_store.h"
+#include "mvg/utils/cmd_line.h"
+#include "mvg/utils/file_system.h"
+
+using namespace mvg::utils;
+using namespace mvg::feature;
+
+/** 文本匹配文件(matches.*.txt)与二进制匹配文件(matches.*.bin)的相互转换，
+ *  输入文件的格式自动识别，输出为另一种格式
+ */
+int main(int argc, char ** argv)
+{
+	CmdLine cmd;
+
+	std::string input_file;
+	std::string output_file;
+
+	cmd.add(make_option('i', input_file, "input"));
+	cmd.add(make_option('o', output_file, "output"));
+
+	try {
+		if (argc == 1) throw std::string("Invalid command line parameter.");
+		cmd.process(argc, argv);
+	}
+	catch (const std::string& s) {
+		std::cerr << "Convert pairwise matches between text and binary format.\nUsage: " << argv[0] << "\n"
+			<< "[-i|--input matches.f.txt or matches.f.bin]\n"
+			<< "[-o|--output matches.f.bin or matches.f.txt]\n"
+			<< std::endl;
+
+		std::cerr << s << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!mvg::utils::is_file(input_file) || output_file.empty())  {
+		std::cerr << "\nInvalid input or output file" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const bool is_binary_input = PairWiseMatchesStore::isBinaryFile(input_file);
+
+	// 导入匹配，文本和二进制格式都支持
+	PairWiseMatches map_matches;
+	if (!pairedIndexedMatchImport(input_file, map_matches))
+		return EXIT_FAILURE;
+
+	bool is_ok = false;
+	if (is_binary_input) {
+		std::ofstream file(output_file.c_str());
+		if (file.is_open())
+			is_ok = PairedIndexedMatchToStream(map_matches, file);
+		file.close();
+	}
+	else {
+		is_ok = PairedIndexedMatchToBinFile(map_matches, output_file);
+	}
+
+	if (!is_ok) {
+		std::cerr << "\nUnable to write " << output_file << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Converted " << map_matches.size() << " image pairs to "
+		<< (is_binary_input ? "text" : "binary") << " file " << output_file << std::endl;
+	return EXIT_SUCCESS;
+}
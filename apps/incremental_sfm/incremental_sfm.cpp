@@ -22,6 +22,7 @@ int main(int argc, char **argv)
   bool is_pmvs_export = false;
   bool is_refine_point_and_distortion = true;
   bool is_colored_point_cloud = false;
+  bool is_local_bundle_adjustment = false;
   std::pair<size_t,size_t> initial_pair(0,0);
 
   cmd.add( make_option('i', image_dir, "imadir") );
@@ -32,6 +33,7 @@ int main(int argc, char **argv)
   cmd.add( make_option('b', initial_pair.second, "initialPairB") );
   cmd.add( make_option('c', is_colored_point_cloud, "coloredPointCloud") );
   cmd.add( make_option('d', is_refine_point_and_distortion, "refinePPandDisto") );
+  cmd.add( make_option('l', is_local_bundle_adjustment, "localBA") );
 
 
   try {
@@ -49,6 +51,10 @@ int main(int argc, char **argv)
     << "[-d|--refinePPandDisto \n"
     << "\t 0-> refine only the Focal,\n"
     << "\t 1-> refine Focal, Principal point and radial distortion factors.] \n"
+    << "[-l|--localBA \n"
+    << "\t 0(default)-> global bundle adjustment after each resection,\n"
+    << "\t 1-> local bundle adjustment of the new cameras and their covisible cameras,\n"
+    << "\t    global bundle adjustment each time the model grows by 25%.] \n"
     << std::endl;
 
     std::cerr << s << std::endl;
@@ -74,6 +80,7 @@ int main(int argc, char **argv)
 
   to_3d_engine.setInitialPair(initial_pair);
   to_3d_engine.setIfRefinePrincipalPointAndRadialDistortion(is_refine_point_and_distortion);
+  to_3d_engine.setLocalBundleAdjustment(is_local_bundle_adjustment);
 
   if (to_3d_engine.Process())
   {
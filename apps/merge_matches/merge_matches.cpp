@@ -0,0 +1,87 @@
+﻿#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <vector>
+
+#include "mvg/feature/indexed_match.h"
+#include "mvg/feature/indexed_match_utils.h"
+#include "mvg/feature/pairwise_matches_store.h"
+#include "mvg/utils/cmd_line.h"
+#include "mvg/utils/file_system.h"
+
+using namespace mvg::utils;
+using namespace mvg::feature;
+
+/** 合并compute_matches --shard k/N生成的所有分片的匹配文件(matches.putative.shard-k-of-N.bin)，
+ *  所有分片的图像列表必须相同，图像对不能重复。结果写入matches.putative.bin及其图像列表，
+ *  之后不带--shard运行compute_matches时读取合并后的匹配，只进行几何过滤
+ */
+int main(int argc, char ** argv)
+{
+	CmdLine cmd;
+
+	std::string matches_file;
+	size_t shard_count = 0;
+
+	cmd.add(make_option('m', matches_file, "matches"));
+	cmd.add(make_option('n', shard_count, "shardCount"));
+
+	try {
+		if (argc == 1) throw std::string("Invalid command line parameter.");
+		cmd.process(argc, argv);
+	}
+	catch (const std::string& s) {
+		std::cerr << "Merge the pairwise matches computed by compute_matches --shard k/N.\nUsage: " << argv[0] << "\n"
+			<< "[-m|--matches outdir/matches.putative.bin (merged file, shards are read from outdir/matches.putative.shard-k-of-N.bin)]\n"
+			<< "[-n|--shardCount N]\n"
+			<< std::endl;
+
+		std::cerr << s << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (matches_file.empty() || shard_count == 0)  {
+		std::cerr << "\nInvalid matches file or shard count" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	PairWiseMatches map_matches;
+	std::vector<std::string> vec_image_names;
+	for (size_t k = 0; k < shard_count; ++k)
+	{
+		const std::string shard_file = ShardMatchesFile(matches_file, k, shard_count);
+		std::vector<std::string> vec_shard_names;
+		PairWiseMatches map_shard_matches;
+		if (!mvg::utils::is_file(shard_file) || !LoadImageNames(ImageListFile(shard_file), vec_shard_names)
+			|| !pairedIndexedMatchImport(shard_file, map_shard_matches)) {
+			std::cerr << "\nMissing or invalid shard " << shard_file << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (k == 0)
+			vec_image_names = vec_shard_names;
+		else if (vec_shard_names != vec_image_names) {
+			std::cerr << "\nThe image list of " << shard_file << " differs from the first shard" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		// 分片之间的图像对互不相交，按图像对排序的结果与单个进程相同
+		for (PairWiseMatches::const_iterator iter = map_shard_matches.begin();
+			iter != map_shard_matches.end(); ++iter) {
+			if (!map_matches.insert(*iter).second) {
+				std::cerr << "\nImage pair (" << iter->first.first << ", " << iter->first.second
+					<< ") appears in more than one shard" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (!PairedIndexedMatchToBinFile(map_matches, matches_file)
+		|| !SaveImageNames(ImageListFile(matches_file), vec_image_names)) {
+		std::cerr << "\nUnable to write " << matches_file << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Merged " << shard_count << " shard(s), " << map_matches.size()
+		<< " image pairs saved to " << matches_file << std::endl;
+	return EXIT_SUCCESS;
+}
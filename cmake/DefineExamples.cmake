@@ -65,6 +65,15 @@ IF(BUILD_EXAMPLES)
 	SET(CMAKE_EXAMPLE_LINK_LIBS ${MVG_LINKER_LIBS})
 	GENERATE_CMAKE_FILES_SAMPLES_DIRECTORY()
 
+	SET(LIST_EXAMPLES_IN_THIS_DIR
+		matches_io_benchmark
+		matching_scaling_benchmark
+		matching_thread_scaling_benchmark
+		)
+	SET(CMAKE_EXAMPLE_DEPS mvg_base mvg_feature)
+	SET(CMAKE_EXAMPLE_LINK_LIBS ${MVG_LINKER_LIBS})
+	GENERATE_CMAKE_FILES_SAMPLES_DIRECTORY()
+
 	# Generate the CMakeLists.txt in the "/samples" directory
 	SET(CMAKE_COMMANDS_INCLUDE_EXAMPLE_DIRS ${CMAKE_COMMANDS_INCLUDE_EXAMPLE_DIRS_ROOT})
 	CONFIGURE_FILE(${CMAKE_SOURCE_DIR}/samples/CMakeLists_list_template.txt.in "${CMAKE_SOURCE_DIR}/samples/CMakeLists.txt" )
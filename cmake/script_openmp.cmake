@@ -0,0 +1,19 @@
+# OpenMP: enables the "#ifdef USE_OPENMP" parallel paths of the libraries,
+#  apps and samples (feature loading, matching, filtering, tracks, SfM).
+# ===================================================
+SET(MVG_USE_OPENMP ON CACHE BOOL "Enable OpenMP parallelism (adds the OpenMP flags and defines USE_OPENMP)")
+
+SET(CMAKE_MVG_HAS_OPENMP 0)
+IF(MVG_USE_OPENMP)
+	FIND_PACKAGE(OpenMP)
+	IF(OPENMP_FOUND)
+		SET(CMAKE_MVG_HAS_OPENMP 1)
+		SET(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
+		SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+		SET(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} ${OpenMP_EXE_LINKER_FLAGS}")
+		SET(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} ${OpenMP_EXE_LINKER_FLAGS}")
+		ADD_DEFINITIONS(-DUSE_OPENMP)
+	ELSE(OPENMP_FOUND)
+		MESSAGE(STATUS "OpenMP not found: the parallel code paths are disabled")
+	ENDIF(OPENMP_FOUND)
+ENDIF(MVG_USE_OPENMP)
@@ -90,6 +90,7 @@ ELSE(MVG_AUTODETECT_SSE)
 	set(STR_SSE_DETECT_MODE "Manually set")
 ENDIF(MVG_AUTODETECT_SSE)
 MESSAGE(STATUS " Use SIMD optimizations?           : SSE2=" ${CMAKE_MVG_HAS_SSE2} " SSE3=" ${CMAKE_MVG_HAS_SSE3} " SSE4.1=" ${CMAKE_MVG_HAS_SSE4_1} " SSE4.2=" ${CMAKE_MVG_HAS_SSE4_2} " SSE4a=" ${CMAKE_MVG_HAS_SSE4_A} " [" ${STR_SSE_DETECT_MODE} "]")
+SHOW_CONFIG_LINE("Use OpenMP parallelism?          " CMAKE_MVG_HAS_OPENMP)
 
 IF($ENV{VERBOSE})
 	SHOW_CONFIG_LINE("Additional checks even in Release  " CMAKE_MVG_ALWAYS_CHECKS_DEBUG)
@@ -0,0 +1,44 @@
+﻿/*******************************************************************************
+ * 文件： cpu_features.h
+ * 时间： 2026/10/17 14:20
+ * 作者： 冯兵
+ * 邮件： fengbing123@gmail.com
+ *
+ * 说明： 运行时通过CPUID检测处理器支持的SIMD指令集，用于在同一个程序中选择最优的实现
+ *
+********************************************************************************/
+#ifndef MVG_SYSTEM_CPU_FEATURES_H_
+#define MVG_SYSTEM_CPU_FEATURES_H_
+
+#include <mvg/config.h>
+#include <mvg/base/link_pragmas.h>
+
+namespace mvg
+{
+	namespace system
+	{
+		/**	SIMD指令集的级别，高的级别包含低的级别
+		 */
+		enum SimdLevel
+		{
+			SIMD_NONE = 0,      //!< 只使用标量指令
+			SIMD_SSE2,          //!< SSE2
+			SIMD_AVX2,          //!< AVX2 + FMA + POPCNT
+			SIMD_AVX512         //!< AVX-512F + AVX-512BW
+		};
+
+		/**
+		 * \brief	处理器及操作系统支持的最高SIMD级别，只检测一次。
+		 *			可以通过环境变量MVG_MAX_SIMD(none, sse2, avx2, avx512)限制最高级别
+		 */
+		SimdLevel BASE_IMPEXP getSimdLevel();
+
+		/**	SIMD级别的名称
+		 */
+		const char BASE_IMPEXP * getSimdLevelName(SimdLevel level);
+
+	} // End of namespace
+
+} // End of namespace
+
+#endif // MVG_SYSTEM_CPU_FEATURES_H_
@@ -0,0 +1,124 @@
+﻿/*******************************************************************************
+ * 文件： bounded_queue.h
+ * 时间： 2026/10/17 16:05
+ * 作者： 冯兵
+ * 邮件： fengbing123@gmail.com
+ *
+ * 说明： 有容量上限的阻塞队列，用于生产者/消费者流水线。队列满时push()阻塞生产者(反压)，
+ *        队列空时pop()阻塞消费者；close()之后不再接收新的元素，取完剩余元素后pop()返回false
+ *
+********************************************************************************/
+#ifndef MVG_THREADS_BOUNDED_QUEUE_H_
+#define MVG_THREADS_BOUNDED_QUEUE_H_
+
+#include <cstddef>
+#include <deque>
+
+#include <mvg/threads/condition.h>
+#include <mvg/threads/mutex.h>
+#include <mvg/threads/scoped_lock.h>
+
+namespace mvg
+{
+	namespace threads
+	{
+		/**
+		 *  有容量上限的多生产者多消费者阻塞队列
+		 *
+		 *  \code
+		 *   BoundedQueue<int> queue(4);
+		 *   // 生产者线程
+		 *   queue.push(1);
+		 *   queue.close();
+		 *   // 消费者线程
+		 *   int value;
+		 *   while (queue.pop(value)) { ... }
+		 *  \endcode
+		 */
+		template <typename T>
+		class BoundedQueue
+		{
+		public:
+			/**
+			 *  构造函数
+			 *
+			 *  @param capacity 队列中最多的元素个数，至少为1
+			 */
+			explicit BoundedQueue(size_t capacity)
+				: m_capacity(capacity > 0 ? capacity : 1), m_closed(false) {}
+
+			/**
+			 *  放入一个元素，队列满时阻塞
+			 *
+			 *  @return 队列已经关闭时不放入并返回false
+			 */
+			bool push(const T &value)
+			{
+				ScopedLock<Mutex> lock(m_mutex);
+				while (!m_closed && m_items.size() >= m_capacity)
+					m_notFull.wait(&m_mutex);
+				if (m_closed)
+					return false;
+				m_items.push_back(value);
+				m_notEmpty.signal();
+				return true;
+			}
+
+			/**
+			 *  取出一个元素，队列空时阻塞
+			 *
+			 *  @return 队列已经关闭并且没有剩余元素时返回false
+			 */
+			bool pop(T &value)
+			{
+				ScopedLock<Mutex> lock(m_mutex);
+				while (!m_closed && m_items.empty())
+					m_notEmpty.wait(&m_mutex);
+				if (m_items.empty())
+					return false;
+				value = m_items.front();
+				m_items.pop_front();
+				m_notFull.signal();
+				return true;
+			}
+
+			/**
+			 *  关闭队列，唤醒所有等待的线程
+			 */
+			void close()
+			{
+				ScopedLock<Mutex> lock(m_mutex);
+				m_closed = true;
+				m_notFull.broadcast();
+				m_notEmpty.broadcast();
+			}
+
+			/**
+			 *  当前队列中元素的个数
+			 */
+			size_t size()
+			{
+				ScopedLock<Mutex> lock(m_mutex);
+				return m_items.size();
+			}
+
+			/**
+			 *  队列的容量
+			 */
+			size_t capacity() const { return m_capacity; }
+
+		private:
+			BoundedQueue(const BoundedQueue &);
+			BoundedQueue &operator=(const BoundedQueue &);
+
+			Mutex m_mutex;
+			Condition m_notFull;        //!< 队列不满
+			Condition m_notEmpty;       //!< 队列不空
+			std::deque<T> m_items;
+			size_t m_capacity;
+			bool m_closed;
+		};
+	}
+}
+
+#endif // MVG_THREADS_BOUNDED_QUEUE_H_
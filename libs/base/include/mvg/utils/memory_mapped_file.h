@@ -0,0 +1,76 @@
+﻿/*******************************************************************************
+ * 文件： memory_mapped_file.h
+ * 时间： 2026/10/17 10:12
+ * 作者： 冯兵
+ * 邮件： fengbing123@gmail.com
+ *
+ * 说明： 只读的内存映射文件，用于大文件(匹配，特征)的零拷贝读取
+ *
+********************************************************************************/
+#ifndef MVG_UTILS_MEMORY_MAPPED_FILE_H_
+#define MVG_UTILS_MEMORY_MAPPED_FILE_H_
+
+#include <string>
+
+#include <mvg/base/link_pragmas.h>
+#include <mvg/utils/noncopyable.h>
+
+namespace mvg
+{
+	namespace utils
+	{
+		/** 只读的内存映射文件，文件内容在对象生命周期内一直有效
+		 *  例子：
+		 *
+		 *  \code
+		 *   MemoryMappedFile mapped_file;
+		 *   if (mapped_file.open("matches.f.bin"))
+		 *     parse(mapped_file.data(), mapped_file.size());
+		 *  \endcode
+		 * \ingroup mvg_base_grp
+		 */
+		class BASE_IMPEXP MemoryMappedFile : public mvg::utils::Noncopyable
+		{
+		public:
+			/** 构造函数，不打开任何文件 */
+			MemoryMappedFile();
+
+			/** 构造函数，直接映射给定的文件，通过isOpen()判断是否成功 */
+			explicit MemoryMappedFile(const std::string &file_name);
+
+			/** 析构函数，解除映射 */
+			~MemoryMappedFile();
+
+			/** 映射文件，之前映射的文件会被关闭
+			 * \return 文件存在并且映射成功返回true
+			 */
+			bool open(const std::string &file_name);
+
+			/** 解除映射，关闭文件 */
+			void close();
+
+			/** 文件是否已经映射 */
+			bool isOpen() const { return is_open_; }
+
+			/** 映射内存的首地址，空文件返回NULL */
+			const char *data() const { return data_; }
+
+			/** 映射文件的大小，单位字节 */
+			size_t size() const { return size_; }
+
+		private:
+			const char *data_;//!< 映射内存的首地址
+			size_t size_;//!< 文件的大小
+			bool is_open_;//!< 文件是否打开(空文件不进行映射)
+#ifdef MVG_OS_WINDOWS
+			void *file_handle_;//!< 文件句柄
+			void *mapping_handle_;//!< 映射对象句柄
+#else
+			int file_descriptor_;//!< 文件描述符
+#endif
+		}; // End of class def.
+
+	} // End of namespace
+} // End of namespace
+
+#endif // MVG_UTILS_MEMORY_MAPPED_FILE_H_
@@ -0,0 +1,144 @@
+﻿/*******************************************************************************
+ * 文件： cpu_features.cpp
+ * 时间： 2026/10/17 14:20
+ * 作者： 冯兵
+ * 邮件： fengbing123@gmail.com
+ *
+ * 说明： 运行时通过CPUID检测处理器支持的SIMD指令集
+ *
+********************************************************************************/
+#include "base_precomp.h"  // 预编译头
+
+#include <mvg/system/cpu_features.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MVG_CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace mvg::system;
+
+namespace
+{
+#ifdef MVG_CPU_X86
+	/**	执行CPUID指令，regs依次为eax, ebx, ecx, edx
+	 */
+	void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, int(leaf), int(subleaf));
+		for (int i = 0; i < 4; ++i)
+			regs[i] = static_cast<unsigned int>(info[i]);
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	/**	读取XCR0，判断操作系统是否保存了AVX/AVX-512的寄存器状态
+	 */
+	unsigned long long xgetbv0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+#endif
+
+	SimdLevel detectSimdLevel()
+	{
+		SimdLevel level = SIMD_NONE;
+#ifdef MVG_CPU_X86
+		unsigned int regs[4];
+		cpuid(0, 0, regs);
+		const unsigned int max_leaf = regs[0];
+		if (max_leaf < 1)
+			return level;
+
+		cpuid(1, 0, regs);
+		const unsigned int ecx1 = regs[2], edx1 = regs[3];
+		if (!(edx1 & (1u << 26)))
+			return level;
+		level = SIMD_SSE2;
+
+		const bool has_osxsave = (ecx1 & (1u << 27)) != 0;
+		const bool has_avx = (ecx1 & (1u << 28)) != 0;
+		const bool has_fma = (ecx1 & (1u << 12)) != 0;
+		const bool has_popcnt = (ecx1 & (1u << 23)) != 0;
+		if (max_leaf < 7 || !has_osxsave || !has_avx)
+			return level;
+
+		// 操作系统需要保存XMM和YMM寄存器(XCR0的第1、2位)
+		const unsigned long long xcr0 = xgetbv0();
+		if ((xcr0 & 0x6) != 0x6)
+			return level;
+
+		cpuid(7, 0, regs);
+		const unsigned int ebx7 = regs[1];
+		if (!(ebx7 & (1u << 5)) || !has_fma || !has_popcnt)
+			return level;
+		level = SIMD_AVX2;
+
+		// AVX-512F(第16位)和AVX-512BW(第30位)，操作系统还需要保存opmask和ZMM寄存器(XCR0的第5~7位)
+		if ((ebx7 & (1u << 16)) && (ebx7 & (1u << 30)) && (xcr0 & 0xE0) == 0xE0)
+			level = SIMD_AVX512;
+#endif
+		return level;
+	}
+
+	/**	环境变量MVG_MAX_SIMD设置的最高级别
+	 */
+	SimdLevel maxSimdLevelFromEnv()
+	{
+		const char *value = getenv("MVG_MAX_SIMD");
+		if (value == NULL)
+			return SIMD_AVX512;
+		for (int level = SIMD_NONE; level <= SIMD_AVX512; ++level) {
+			if (strcmp(value, getSimdLevelName(SimdLevel(level))) == 0)
+				return SimdLevel(level);
+		}
+		return SIMD_AVX512;
+	}
+
+	/**	处理器支持并且不超过环境变量限制的最高级别
+	 */
+	SimdLevel computeSimdLevel()
+	{
+		const SimdLevel detected = detectSimdLevel();
+		const SimdLevel max_level = maxSimdLevelFromEnv();
+		return detected < max_level ? detected : max_level;
+	}
+}
+
+SimdLevel mvg::system::getSimdLevel()
+{
+	// 函数内静态变量的初始化是线程安全的(C++11)，只检测一次
+	static const SimdLevel level = computeSimdLevel();
+	return level;
+}
+
+const char * mvg::system::getSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_SSE2:
+		return "sse2";
+	case SIMD_AVX2:
+		return "avx2";
+	case SIMD_AVX512:
+		return "avx512";
+	default:
+		return "none";
+	}
+}
@@ -0,0 +1,92 @@
+﻿#include "mvg/threads/bounded_queue.h"
+#include "mvg/threads/thread.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace mvg {
+	namespace threads {
+
+		// 生产者，放入[begin, end)
+		class Producer : public Thread {
+		public:
+			Producer(BoundedQueue<int> &queue, int begin, int end)
+				: queue(queue), begin(begin), end(end) {}
+			virtual void run() {
+				for (int i = begin; i < end; ++i)
+					queue.push(i);
+			}
+			BoundedQueue<int> &queue;
+			int begin, end;
+		};
+
+		// 消费者，累加取出的值，并记录队列中元素个数的最大值
+		class Consumer : public Thread {
+		public:
+			explicit Consumer(BoundedQueue<int> &queue)
+				: queue(queue), sum(0), count(0), max_size(0) {}
+			virtual void run() {
+				int value;
+				while (queue.pop(value)) {
+					sum += value;
+					++count;
+					max_size = std::max(max_size, queue.size());
+				}
+			}
+			BoundedQueue<int> &queue;
+			long long sum;
+			int count;
+			size_t max_size;
+		};
+
+		TEST(BoundedQueue, SingleThread) {
+			BoundedQueue<int> queue(2);
+			EXPECT_TRUE(queue.push(1));
+			EXPECT_TRUE(queue.push(2));
+			EXPECT_EQ(2, queue.size());
+			queue.close();
+			// 关闭后不再接收新的元素，剩余的元素仍然可以取出
+			EXPECT_FALSE(queue.push(3));
+			int value = 0;
+			EXPECT_TRUE(queue.pop(value));
+			EXPECT_EQ(1, value);
+			EXPECT_TRUE(queue.pop(value));
+			EXPECT_EQ(2, value);
+			EXPECT_FALSE(queue.pop(value));
+		}
+
+		TEST(BoundedQueue, ProducersAndConsumers) {
+			const int producer_count = 3, consumer_count = 4, item_count = 10000;
+			BoundedQueue<int> queue(8);
+
+			std::vector<std::shared_ptr<Producer> > vec_producers;
+			std::vector<std::shared_ptr<Consumer> > vec_consumers;
+			for (int i = 0; i < consumer_count; ++i) {
+				vec_consumers.push_back(std::make_shared<Consumer>(queue));
+				vec_consumers.back()->start();
+			}
+			for (int i = 0; i < producer_count; ++i) {
+				vec_producers.push_back(std::make_shared<Producer>(queue, i * item_count, (i + 1) * item_count));
+				vec_producers.back()->start();
+			}
+			for (int i = 0; i < producer_count; ++i)
+				vec_producers[i]->join();
+			queue.close();
+
+			long long sum = 0;
+			int count = 0;
+			for (int i = 0; i < consumer_count; ++i) {
+				vec_consumers[i]->join();
+				sum += vec_consumers[i]->sum;
+				count += vec_consumers[i]->count;
+				// 队列中的元素个数不超过容量
+				EXPECT_TRUE(vec_consumers[i]->max_size <= queue.capacity());
+			}
+			const long long n = producer_count * item_count;
+			EXPECT_EQ(n, count);
+			EXPECT_EQ(n * (n - 1) / 2, sum);
+		}
+	} // namespace threads
+} // namespace mvg
@@ -0,0 +1,132 @@
+﻿/*******************************************************************************
+ * 文件： memory_mapped_file.cpp
+ * 时间： 2026/10/17 10:40
+ * 作者： 冯兵
+ * 邮件： fengbing123@gmail.com
+ *
+ * 说明： 只读的内存映射文件，Windows下使用MapViewOfFile，其他系统使用mmap
+ *
+********************************************************************************/
+#include "base_precomp.h"
+#include <mvg/utils/memory_mapped_file.h>
+
+#ifdef MVG_OS_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+using namespace mvg::utils;
+
+/**	构造函数
+ */
+MemoryMappedFile::MemoryMappedFile()
+	: data_(NULL), size_(0), is_open_(false)
+#ifdef MVG_OS_WINDOWS
+	, file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(NULL)
+#else
+	, file_descriptor_(-1)
+#endif
+{
+}
+
+/**	构造函数，映射给定文件
+ */
+MemoryMappedFile::MemoryMappedFile(const std::string &file_name)
+	: data_(NULL), size_(0), is_open_(false)
+#ifdef MVG_OS_WINDOWS
+	, file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(NULL)
+#else
+	, file_descriptor_(-1)
+#endif
+{
+	open(file_name);
+}
+
+/**	析构函数
+ */
+MemoryMappedFile::~MemoryMappedFile()
+{
+	close();
+}
+
+/**	映射文件
+ */
+bool MemoryMappedFile::open(const std::string &file_name)
+{
+	close();
+#ifdef MVG_OS_WINDOWS
+	file_handle_ = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle_ == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle_, &file_size)) {
+		close();
+		return false;
+	}
+	size_ = static_cast<size_t>(file_size.QuadPart);
+	is_open_ = true;
+	if (size_ == 0)//空文件不能被映射
+		return true;
+
+	mapping_handle_ = CreateFileMappingA(file_handle_, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_handle_ == NULL) {
+		close();
+		return false;
+	}
+	data_ = static_cast<const char*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+#else
+	file_descriptor_ = ::open(file_name.c_str(), O_RDONLY);
+	if (file_descriptor_ < 0)
+		return false;
+
+	struct stat file_stat;
+	if (fstat(file_descriptor_, &file_stat) != 0) {
+		close();
+		return false;
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	is_open_ = true;
+	if (size_ == 0)//空文件不能被映射
+		return true;
+
+	void *address = mmap(NULL, size_, PROT_READ, MAP_SHARED, file_descriptor_, 0);
+	data_ = (address == MAP_FAILED) ? NULL : static_cast<const char*>(address);
+#endif
+	if (data_ == NULL) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**	解除映射，关闭文件
+ */
+void MemoryMappedFile::close()
+{
+#ifdef MVG_OS_WINDOWS
+	if (data_ != NULL)
+		UnmapViewOfFile(data_);
+	if (mapping_handle_ != NULL)
+		CloseHandle(mapping_handle_);
+	if (file_handle_ != INVALID_HANDLE_VALUE)
+		CloseHandle(file_handle_);
+	mapping_handle_ = NULL;
+	file_handle_ = INVALID_HANDLE_VALUE;
+#else
+	if (data_ != NULL)
+		munmap(const_cast<char*>(data_), size_);
+	if (file_descriptor_ >= 0)
+		::close(file_descriptor_);
+	file_descriptor_ = -1;
+#endif
+	data_ = NULL;
+	size_ = 0;
+	is_open_ = false;
+}
@@ -0,0 +1,132 @@
+﻿#ifndef MVG_FEATURE_DAISY_HPP_
+#define MVG_FEATURE_DAISY_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mvg/feature/feature.h"
+#include "mvg/feature/descriptor.h"
+#include "mvg/image/image.h"
+
+#include "daisy/daisy.h"
+
+namespace mvg {
+	namespace feature{
+
+		using namespace mvg::image;
+
+		/**
+		 * \brief	在规则网格上计算稠密的DAISY描述子(Tola et al. PAMI 2010)，
+		 *			3个半径 x 8个方向的采样点加上中心点，每点8个方向的梯度直方图，共200维。
+		 *			梯度层的卷积对整幅图像只计算一次，之后按网格的行并行计算描述子，
+		 *			所有描述子按行优先顺序存放在一块连续的内存中。
+		 *			描述子不具有旋转不变性，适合两幅图像大致同向的宽基线稠密匹配。
+		 *
+		 *			3rdparty/daisy把采样半径的量化结果保存在全局变量中，
+		 *			同时运行的多个提取器必须使用相同的半径。
+		 *
+		 *  \code
+		 *   DaisyExtractor extractor(15.f, 4);
+		 *   std::vector<PointFeature> feats;
+		 *   std::vector<DaisyExtractor::DescriptorT> descs;
+		 *   extractor.compute(float_image, feats, descs);
+		 *  \endcode
+		 */
+		class DaisyExtractor
+		{
+		public:
+			enum
+			{
+				kRadiusQuantization = 3,    //!< 半径方向的采样个数
+				kAngleQuantization = 8,     //!< 每个半径上的采样个数
+				kHistogramQuantization = 8, //!< 梯度直方图的方向个数
+				kDimension = (kRadiusQuantization * kAngleQuantization + 1) * kHistogramQuantization
+			};
+			typedef Descriptor<float, kDimension> DescriptorT;
+
+			/**
+			 * \brief	构造函数
+			 *
+			 * \param	radius	描述子最外层采样点的半径(像素)
+			 * \param	step  	网格的间隔(像素)
+			 */
+			explicit DaisyExtractor(float radius = 15.f, int step = 4)
+				: radius_(radius), step_(step) {}
+
+			/**	网格点到图像边界的最小距离，描述子的采样点都在图像内
+			 */
+			int border() const { return static_cast<int>(std::ceil(radius_)) + 1; }
+
+			/**
+			 * \brief	网格的列数和行数
+			 *
+			 * \param	width 	图像的宽度
+			 * \param	height	图像的高度
+			 * \param [out]	cols	网格的列数
+			 * \param [out]	rows	网格的行数
+			 */
+			void gridSize(int width, int height, int & cols, int & rows) const
+			{
+				const int b = border();
+				cols = width > 2 * b ? (width - 1 - 2 * b) / step_ + 1 : 0;
+				rows = height > 2 * b ? (height - 1 - 2 * b) / step_ + 1 : 0;
+			}
+
+			/**
+			 * \brief	计算网格上所有点的描述子
+			 *
+			 * \param	image	   	输入图像，灰度范围为0-255
+			 * \param [out]	feats	网格点的坐标，按行优先顺序
+			 * \param [out]	descs	每个网格点的描述子，与feats一一对应
+			 *
+			 * \return	参数无效或图像小于描述子时返回false
+			 */
+			bool compute(const Image<float> & image,
+				std::vector<PointFeature> & feats,
+				std::vector<DescriptorT> & descs) const
+			{
+				feats.clear();
+				descs.clear();
+				int cols = 0, rows = 0;
+				gridSize(image.Width(), image.Height(), cols, rows);
+				if (radius_ <= 0.f || step_ < 1 || cols == 0 || rows == 0)
+					return false;
+
+				// 直接使用图像数据，不经过kutility的图像读写
+				daisy desc;
+				desc.verbose(0);
+				desc.set_image(image.data(), image.Height(), image.Width());
+				desc.set_parameters(radius_, kRadiusQuantization, kAngleQuantization, kHistogramQuantization);
+				desc.initialize_single_descriptor_mode();
+
+				feats.resize(size_t(cols) * rows);
+				descs.resize(size_t(cols) * rows);
+				const int b = border();
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int r = 0; r < rows; ++r)
+				{
+					const int y = b + r * step_;
+					for (int c = 0; c < cols; ++c) {
+						const int x = b + c * step_;
+						const size_t index = size_t(r) * cols + c;
+						float * data = descs[index].getData();
+						std::fill(data, data + kDimension, 0.f);
+						desc.get_descriptor(double(y), double(x), 0, data);
+						feats[index] = PointFeature(float(x), float(y));
+					}
+				}
+				return true;
+			}
+
+		private:
+			float radius_;  //!< 最外层采样点的半径
+			int step_;      //!< 网格的间隔
+		};
+
+	}// namespace feature
+} // namespace mvg
+
+#endif // MVG_FEATURE_DAISY_HPP_
@@ -166,16 +166,20 @@ namespace mvg {
 
 			vec_desc.clear();
 			std::ifstream file_in(descs_filename.c_str(), std::ios::in | std::ios::binary);
+			if (!file_in.is_open())
+				return false;
 
 			std::size_t card_desc = 0;
-			file_in.read((char*)&card_desc, sizeof(std::size_t));
+			if (!file_in.read((char*)&card_desc, sizeof(std::size_t)))
+				return false;
 			vec_desc.resize(card_desc);
 			for (typename DescriptorsT::const_iterator iter = vec_desc.begin();
 				iter != vec_desc.end(); ++iter) {
 				file_in.read((char*)(*iter).getData(),
 					DescValue::kStaticSize*sizeof(typename DescValue::bin_type));
 			}
-			bool is_ok = !file_in.bad();
+			// 文件不完整时读取失败
+			bool is_ok = !file_in.fail();
 			file_in.close();
 			return is_ok;
 		}
@@ -0,0 +1,479 @@
+﻿#ifndef MVG_FEATURE_DESCRIPTOR_COMPRESSION_H_
+#define MVG_FEATURE_DESCRIPTOR_COMPRESSION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+
+#include "flann/flann.h"
+#include "mvg/feature/descriptor.h"
+#include "mvg/feature/matching_interface.h"
+#include "mvg/feature/matcher_brute_force_simd.h"
+
+namespace mvg {
+	namespace feature {
+
+		/**
+		 * \brief	PCA降维并量化为unsigned char的描述子压缩，例如128维SIFT压缩为64或32字节。
+		 *			投影后的各维使用同一个缩放系数，量化后的描述子之间的欧式距离与投影空间的距离成比例，
+		 *			可以直接使用unsigned char的匹配算子(ArrayMatcherBruteForceSIMD、ArrayMatcherKdtreeFlann)。
+		 *
+		 *  \code
+		 *   DescriptorPCA pca;
+		 *   pca.train(&vec_samples[0], vec_samples.size() / 128, 128, 64);
+		 *   pca.save("descriptors.pca64");
+		 *   Descriptor<unsigned char, 64> code;
+		 *   pca.encode(sift_desc.getData(), code.getData());
+		 *  \endcode
+		 */
+		class DescriptorPCA
+		{
+		public:
+			typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXf;
+
+			DescriptorPCA() : input_dim_(0), output_dim_(0), scale_(1.f) {}
+
+			/**
+			 * \brief	由采样的描述子计算主成分
+			 *
+			 * \param	data	  	按行存储的采样描述子，count x input_dim
+			 * \param	count	  	采样描述子的个数
+			 * \param	input_dim 	原始描述子的维数
+			 * \param	output_dim	降维后的维数
+			 *
+			 * \return	参数无效时返回false
+			 */
+			bool train(const float * data, size_t count, size_t input_dim, size_t output_dim)
+			{
+				if (data == NULL || count < 2 || input_dim == 0 || output_dim == 0 || output_dim > input_dim)
+					return false;
+				Eigen::Map<const RowMatrixXf> samples(data, count, input_dim);
+				mean_ = samples.colwise().mean().transpose();
+				const RowMatrixXf centered = samples.rowwise() - mean_.transpose();
+				const Eigen::MatrixXf covariance = centered.transpose() * centered / float(count - 1);
+				Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> es(covariance, Eigen::ComputeEigenvectors);
+				if (es.info() != Eigen::Success)
+					return false;
+
+				// 特征值按升序排列，取最大的output_dim个
+				basis_.resize(output_dim, input_dim);
+				for (size_t k = 0; k < output_dim; ++k)
+					basis_.row(k) = es.eigenvectors().col(input_dim - 1 - k).transpose();
+				input_dim_ = input_dim;
+				output_dim_ = output_dim;
+
+				// 第一主成分的3倍标准差对应量化范围的一半
+				const float sigma = std::sqrt(std::max(es.eigenvalues()(input_dim - 1), 1e-12f));
+				scale_ = 127.f / (3.f * sigma);
+				return true;
+			}
+
+			size_t inputDimension() const { return input_dim_; }
+			size_t outputDimension() const { return output_dim_; }
+
+			/**
+			 * \brief	投影到主成分空间
+			 *
+			 * \param	desc		   	原始描述子，input_dim维
+			 * \param [out]	projected	投影结果，output_dim维
+			 */
+			template <typename T>
+			void project(const T * desc, float * projected) const
+			{
+				Eigen::VectorXf centered(input_dim_);
+				for (size_t d = 0; d < input_dim_; ++d)
+					centered(d) = float(desc[d]) - mean_(d);
+				Eigen::Map<Eigen::VectorXf>(projected, output_dim_) = basis_ * centered;
+			}
+
+			/**
+			 * \brief	投影并量化为unsigned char，超出范围的分量被截断
+			 *
+			 * \param	desc	  	原始描述子，input_dim维
+			 * \param [out]	code	量化结果，output_dim个字节
+			 */
+			template <typename T>
+			void encode(const T * desc, unsigned char * code) const
+			{
+				std::vector<float> projected(output_dim_);
+				project(desc, &projected[0]);
+				for (size_t d = 0; d < output_dim_; ++d) {
+					const float value = std::floor(128.f + projected[d] * scale_ + 0.5f);
+					code[d] = static_cast<unsigned char>(std::min(255.f, std::max(0.f, value)));
+				}
+			}
+
+			/**	将主成分保存到二进制文件
+			 */
+			bool save(const std::string & file_name) const
+			{
+				std::ofstream file(file_name.c_str(), std::ios::out | std::ios::binary);
+				file.write((const char*)&input_dim_, sizeof(std::size_t));
+				file.write((const char*)&output_dim_, sizeof(std::size_t));
+				file.write((const char*)&scale_, sizeof(float));
+				file.write((const char*)mean_.data(), input_dim_ * sizeof(float));
+				file.write((const char*)basis_.data(), input_dim_ * output_dim_ * sizeof(float));
+				return file.good();
+			}
+
+			/**	从二进制文件读取主成分
+			 */
+			bool load(const std::string & file_name)
+			{
+				std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+				std::size_t input_dim = 0, output_dim = 0;
+				file.read((char*)&input_dim, sizeof(std::size_t));
+				file.read((char*)&output_dim, sizeof(std::size_t));
+				if (!file || input_dim == 0 || output_dim == 0 || output_dim > input_dim)
+					return false;
+				file.read((char*)&scale_, sizeof(float));
+				mean_.resize(input_dim);
+				basis_.resize(output_dim, input_dim);
+				file.read((char*)mean_.data(), input_dim * sizeof(float));
+				file.read((char*)basis_.data(), input_dim * output_dim * sizeof(float));
+				if (!file)
+					return false;
+				input_dim_ = input_dim;
+				output_dim_ = output_dim;
+				return true;
+			}
+
+		private:
+			size_t input_dim_;      //!< 原始描述子的维数
+			size_t output_dim_;     //!< 降维后的维数
+			float scale_;           //!< 量化的缩放系数
+			Eigen::VectorXf mean_;  //!< 描述子的均值
+			RowMatrixXf basis_;     //!< 主成分，每行一个
+		};
+
+		/**
+		 * \brief	描述子的乘积量化(Jegou et al. PAMI 2011)。描述子分为subspace_count段，
+		 *			每段用k-means训练256个中心，编码为每段最近中心的索引，
+		 *			128维SIFT分为16段时每个描述子只占16字节。
+		 *			码本对整个数据集训练一次并保存到文件中。
+		 *
+		 *  \code
+		 *   ProductQuantizer pq;
+		 *   pq.train(&vec_samples[0], vec_samples.size() / 128, 128, 16);
+		 *   pq.save("descriptors.pq16");
+		 *   Descriptor<unsigned char, 16> code;
+		 *   pq.encode(sift_desc.getData(), code.getData());
+		 *  \endcode
+		 */
+		class ProductQuantizer
+		{
+		public:
+			enum { kCentroidCount = 256 };  //!< 每段的中心个数，索引为一个字节
+			enum { kMaxDimension = 4096 };  //!< 可读取码本的最大描述子维数
+
+			ProductQuantizer() : dimension_(0), subspace_count_(0) {}
+
+			/**
+			 * \brief	由采样的描述子训练每段的中心
+			 *
+			 * \param	data		  	按行存储的采样描述子，count x dimension
+			 * \param	count		  	采样描述子的个数，不能少于kCentroidCount
+			 * \param	dimension	  	描述子的维数
+			 * \param	subspace_count	分段的个数，必须整除dimension
+			 *
+			 * \return	参数无效或聚类失败时返回false
+			 */
+			bool train(const float * data, size_t count, size_t dimension, size_t subspace_count)
+			{
+				if (data == NULL || count < kCentroidCount || subspace_count == 0 || dimension % subspace_count != 0)
+					return false;
+				const size_t sub_dim = dimension / subspace_count;
+				std::vector<float> centroids(subspace_count * kCentroidCount * sub_dim, 0.f);
+				bool is_ok = true;
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int m = 0; m < (int)subspace_count; ++m)
+				{
+					std::vector<float> vec_sub(count * sub_dim);
+					for (size_t i = 0; i < count; ++i)
+						std::copy(data + i * dimension + m * sub_dim, data + i * dimension + (m + 1) * sub_dim,
+							&vec_sub[i * sub_dim]);
+
+					// 分支数等于中心个数时，层次k-means只有一层
+					float * sub_centroids = &centroids[m * kCentroidCount * sub_dim];
+					flann::Matrix<float> samples(&vec_sub[0], count, sub_dim);
+					flann::Matrix<float> centers(sub_centroids, kCentroidCount, sub_dim);
+					const int center_count = flann::hierarchicalClustering<flann::L2<float> >(samples, centers,
+						flann::KMeansIndexParams(kCentroidCount, 11, flann::FLANN_CENTERS_KMEANSPP));
+					if (center_count <= 0) {
+						is_ok = false;
+						continue;
+					}
+					// 聚类个数不足时重复已有的中心，编码时不会选到重复的中心
+					for (int c = center_count; c < kCentroidCount; ++c)
+						std::copy(sub_centroids + (c % center_count) * sub_dim,
+							sub_centroids + (c % center_count + 1) * sub_dim, sub_centroids + c * sub_dim);
+				}
+				if (!is_ok)
+					return false;
+				centroids_.swap(centroids);
+				dimension_ = dimension;
+				subspace_count_ = subspace_count;
+				return true;
+			}
+
+			size_t dimension() const { return dimension_; }
+			size_t subspaceCount() const { return subspace_count_; }
+
+			/**
+			 * \brief	编码一个描述子
+			 *
+			 * \param	desc	  	描述子，dimension维
+			 * \param [out]	code	每段最近中心的索引，subspace_count个字节
+			 */
+			template <typename T>
+			void encode(const T * desc, unsigned char * code) const
+			{
+				const size_t sub_dim = dimension_ / subspace_count_;
+				for (size_t m = 0; m < subspace_count_; ++m) {
+					const T * sub_desc = desc + m * sub_dim;
+					const float * centroid = &centroids_[m * kCentroidCount * sub_dim];
+					float best_distance = std::numeric_limits<float>::max();
+					for (int c = 0; c < kCentroidCount; ++c, centroid += sub_dim) {
+						float distance = 0.f;
+						for (size_t d = 0; d < sub_dim; ++d) {
+							const float diff = float(sub_desc[d]) - centroid[d];
+							distance += diff * diff;
+						}
+						if (distance < best_distance) {
+							best_distance = distance;
+							code[m] = static_cast<unsigned char>(c);
+						}
+					}
+				}
+			}
+
+			/**	由编码重建描述子的近似值
+			 */
+			void decode(const unsigned char * code, float * desc) const
+			{
+				const size_t sub_dim = dimension_ / subspace_count_;
+				for (size_t m = 0; m < subspace_count_; ++m) {
+					const float * centroid = &centroids_[(m * kCentroidCount + code[m]) * sub_dim];
+					std::copy(centroid, centroid + sub_dim, desc + m * sub_dim);
+				}
+			}
+
+			/**
+			 * \brief	非对称距离计算(ADC)的距离表，查询描述子的每一段到该段所有中心的欧式距离平方
+			 *
+			 * \param	query	   	未编码的查询描述子，dimension维
+			 * \param [out]	table	subspace_count x kCentroidCount的距离表
+			 */
+			template <typename T>
+			void distanceTable(const T * query, float * table) const
+			{
+				const size_t sub_dim = dimension_ / subspace_count_;
+				const float * centroid = centroids_.empty() ? NULL : &centroids_[0];
+				for (size_t m = 0; m < subspace_count_; ++m) {
+					const T * sub_query = query + m * sub_dim;
+					for (int c = 0; c < kCentroidCount; ++c, centroid += sub_dim) {
+						float distance = 0.f;
+						for (size_t d = 0; d < sub_dim; ++d) {
+							const float diff = float(sub_query[d]) - centroid[d];
+							distance += diff * diff;
+						}
+						*table++ = distance;
+					}
+				}
+			}
+
+			/**	查询描述子到编码描述子的近似欧式距离平方，table由distanceTable计算
+			 */
+			float distance(const float * table, const unsigned char * code) const
+			{
+				float result = 0.f;
+				for (size_t m = 0; m < subspace_count_; ++m, table += kCentroidCount)
+					result += table[code[m]];
+				return result;
+			}
+
+			/**	将码本保存到二进制文件
+			 */
+			bool save(const std::string & file_name) const
+			{
+				std::ofstream file(file_name.c_str(), std::ios::out | std::ios::binary);
+				file.write((const char*)&dimension_, sizeof(std::size_t));
+				file.write((const char*)&subspace_count_, sizeof(std::size_t));
+				if (!centroids_.empty())
+					file.write((const char*)&centroids_[0], centroids_.size() * sizeof(float));
+				return file.good();
+			}
+
+			/**	从二进制文件读取码本
+			 *
+			 * \return	维数或分段个数为零、不能整除、超过kMaxDimension，或者文件大小与码本不符时返回false
+			 */
+			bool load(const std::string & file_name)
+			{
+				std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+				std::size_t dimension = 0, subspace_count = 0;
+				file.read((char*)&dimension, sizeof(std::size_t));
+				file.read((char*)&subspace_count, sizeof(std::size_t));
+				if (!file || dimension == 0 || dimension > kMaxDimension ||
+					subspace_count == 0 || dimension % subspace_count != 0)
+					return false;
+				// 在分配之前检查剩余的文件大小正好是码本的大小
+				const std::streamoff header_end = file.tellg();
+				file.seekg(0, std::ios::end);
+				const std::streamoff file_end = file.tellg();
+				const std::size_t centroid_size = dimension * kCentroidCount;
+				if (!file || header_end < 0 || file_end < header_end ||
+					(std::size_t)(file_end - header_end) != centroid_size * sizeof(float))
+					return false;
+				file.seekg(header_end, std::ios::beg);
+				std::vector<float> centroids(centroid_size);
+				file.read((char*)&centroids[0], centroids.size() * sizeof(float));
+				if (!file)
+					return false;
+				centroids_.swap(centroids);
+				dimension_ = dimension;
+				subspace_count_ = subspace_count;
+				return true;
+			}
+
+		private:
+			size_t dimension_;              //!< 描述子的维数
+			size_t subspace_count_;         //!< 分段的个数
+			std::vector<float> centroids_;  //!< 每段的中心，subspace_count x kCentroidCount x (dimension / subspace_count)
+		};
+
+		/**	乘积量化编码之间的距离，只用于确定距离的类型(欧式距离平方)
+		 */
+		struct ProductQuantizationDistance
+		{
+			typedef unsigned char ElementType;
+			typedef float ResultType;
+		};
+
+		/**
+		 * \brief	乘积量化编码的暴力匹配，使用非对称距离计算(ADC)：
+		 *			数据集是编码(例如Descriptor<unsigned char, 16>)，查询是未编码的描述子(码本的维数，例如128字节的SIFT)，
+		 *			每个查询先计算一次到所有中心的距离表，之后与每个编码的距离只需要subspace_count次查表相加。
+		 *			作为MatcherAllInMemory的MatcherT时，码本通过ImageIndexRegistry::setMatcherFactory传入，
+		 *			未编码的查询描述子通过MatcherAllInMemory::setQueryCache提供
+		 */
+		class ArrayMatcherProductQuantization : public ArrayMatcher < unsigned char, ProductQuantizationDistance >
+		{
+		public:
+			typedef ProductQuantizationDistance::ResultType DistanceType;
+
+			/**	没有码本的匹配算子，Build总是失败
+			 */
+			ArrayMatcherProductQuantization()
+				: dataset_(NULL), rows_num_(0) {}
+
+			explicit ArrayMatcherProductQuantization(const std::shared_ptr<const ProductQuantizer> & quantizer)
+				: quantizer_(quantizer), dataset_(NULL), rows_num_(0) {}
+
+			/**
+			 * 建立匹配的结构，只保存数据的指针
+			 *
+			 * \param[in] dataset   所有编码
+			 * \param[in] rows_num  编码的个数
+			 * \param[in] dimension 每个编码的字节数，必须等于码本的分段个数
+			 *
+			 * \return True if success.
+			 */
+			bool Build(const unsigned char * dataset, int rows_num, int dimension)
+			{
+				if (!quantizer_ || rows_num < 1 || dimension != (int)quantizer_->subspaceCount())
+					return false;
+				dataset_ = dataset;
+				rows_num_ = rows_num;
+				return true;
+			}
+
+			bool SearchNeighbour(const unsigned char * query, int * indice, DistanceType * distance)
+			{
+				std::vector<int> vec_indice;
+				std::vector<DistanceType> vec_distance;
+				if (!SearchNeighbours(query, 1, &vec_indice, &vec_distance, 1))
+					return false;
+				*indice = vec_indice[0];
+				*distance = vec_distance[0];
+				return true;
+			}
+
+			/**
+			 * \brief	未编码的查询描述子(unsigned char，例如SIFT)的k近邻
+			 *
+			 * \param	query		 	按行存储的查询描述子，每行为码本的维数
+			 * \param	query_num	 	查询的个数
+			 * \param [out]	vec_indice  	每个查询的k个近邻的索引，不足k个时为-1
+			 * \param [out]	vec_distance	对应的近似欧式距离平方
+			 * \param	nearest_neighbor_num	近邻的个数k
+			 *
+			 * \return	没有建立匹配结构时返回false
+			 */
+			bool SearchNeighbours(const unsigned char * query, int query_num,
+				std::vector<int> * vec_indice,
+				std::vector<DistanceType> * vec_distance,
+				size_t nearest_neighbor_num)
+			{
+				return searchADC(query, query_num, vec_indice, vec_distance, nearest_neighbor_num);
+			}
+
+			/**	float的查询描述子的k近邻，参数同SearchNeighbours
+			 */
+			bool SearchNeighboursADC(const float * query, int query_num,
+				std::vector<int> * vec_indice,
+				std::vector<DistanceType> * vec_distance,
+				size_t nearest_neighbor_num) const
+			{
+				return searchADC(query, query_num, vec_indice, vec_distance, nearest_neighbor_num);
+			}
+
+		private:
+			/**	每个查询计算一次距离表，再与所有编码查表求距离
+			 */
+			template <typename T>
+			bool searchADC(const T * query, int query_num,
+				std::vector<int> * vec_indice,
+				std::vector<DistanceType> * vec_distance,
+				size_t nearest_neighbor_num) const
+			{
+				if (dataset_ == NULL || query_num < 1 || nearest_neighbor_num < 1)
+					return false;
+				const int k = static_cast<int>(nearest_neighbor_num);
+				const size_t dimension = quantizer_->dimension(), code_size = quantizer_->subspaceCount();
+				vec_indice->assign(query_num * nearest_neighbor_num, -1);
+				vec_distance->assign(query_num * nearest_neighbor_num, std::numeric_limits<DistanceType>::max());
+
+				std::vector<float> vec_table(code_size * ProductQuantizer::kCentroidCount);
+				for (int i = 0; i < query_num; ++i) {
+					quantizer_->distanceTable(query + i * dimension, &vec_table[0]);
+					DistanceType * best_distances = &(*vec_distance)[i * nearest_neighbor_num];
+					int * best_indices = &(*vec_indice)[i * nearest_neighbor_num];
+					const unsigned char * code = dataset_;
+					for (int r = 0; r < rows_num_; ++r, code += code_size) {
+						const DistanceType distance = quantizer_->distance(&vec_table[0], code);
+						if (distance < best_distances[k - 1])
+							InsertNeighbour(distance, r, best_distances, best_indices, k);
+					}
+				}
+				return true;
+			}
+
+			std::shared_ptr<const ProductQuantizer> quantizer_;  //!< 码本
+			const unsigned char * dataset_;                      //!< 数据集的编码
+			int rows_num_;                                       //!< 编码的个数
+		};
+
+	} // namespace feature
+} // namespace mvg
+
+#endif // MVG_FEATURE_DESCRIPTOR_COMPRESSION_H_
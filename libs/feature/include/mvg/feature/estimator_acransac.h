@@ -29,6 +29,7 @@
 #include <iterator>
 #include <vector>
 #include <limits>
+#include <random>
 #include <iostream>
 
 #include "mvg/feature/random_sampling.h"
@@ -99,16 +100,54 @@ namespace mvg {
 		/// \param sample_size The size of the sample.
 		/// \param vec_index  The possible data indices.
 		/// \param sample The random sample of sample_size indices (output).
+		/// \param generator 随机数生成器，为NULL时使用全局的rand()
 		static void UniformSample(int sample_size,
 			const std::vector<size_t> &vec_index,
-			std::vector<size_t> *sample)
+			std::vector<size_t> *sample,
+			std::mt19937 * generator = NULL)
 		{
 			sample->resize(sample_size);
-			RandomSample(sample_size, vec_index.size(), sample);
+			if (generator)
+				RandomSample(sample_size, vec_index.size(), sample, *generator);
+			else
+				RandomSample(sample_size, vec_index.size(), sample);
 			for (int i = 0; i < sample_size; ++i)
 				(*sample)[i] = vec_index[(*sample)[i]];
 		}
 
+		/** ACRANSAC的提前终止策略，默认不启用，迭代次数与原来相同。
+		 *  数据个数少于min_inlier_count时直接返回；否则按照需要的内点比例计算探测迭代次数，
+		 *  内点比例不低于要求的数据在探测迭代内以confidence的概率至少抽到一个全是内点的样本，
+		 *  探测迭代结束时仍没有找到内点足够的有意义模型则提前终止(不重叠的图像对大多如此)。
+		 *  只在均匀采样阶段检查，已经开始在内点中采样(聚焦采样)时不会终止
+		 */
+		struct ACRansacEarlyExit
+		{
+			ACRansacEarlyExit(size_t min_inliers = 0, double min_ratio = 0.0, double confidence_level = 0.99)
+				: min_inlier_count(min_inliers), min_inlier_ratio(min_ratio), confidence(confidence_level) {}
+
+			/// 探测的迭代次数，0表示不提前终止
+			size_t probeIterations(size_t sample_size, size_t data_count) const
+			{
+				if (data_count == 0 || confidence <= 0.0 || confidence >= 1.0)
+					return 0;
+				const double ratio = (std::max)(double(min_inlier_count) / data_count, min_inlier_ratio);
+				if (ratio <= 0.0)
+					return 0;
+				if (ratio >= 1.0)
+					return 1;
+				// 全是内点的样本的概率过小时探测迭代次数没有意义
+				const double sample_probability = std::pow(ratio, (double)sample_size);
+				if (sample_probability < 1e-12)
+					return 0;
+				return static_cast<size_t>(std::ceil(std::log(1.0 - confidence) / std::log(1.0 - sample_probability)));
+			}
+
+			size_t min_inlier_count; //!< 需要的最少内点个数
+			double min_inlier_ratio; //!< 需要的最小内点比例
+			double confidence; //!< 内点比例达到要求的数据在探测迭代内找到模型的概率
+		};
+
 		/**
 		 * @brief ACRANSAC routine (ErrorThreshold, NFA)
 		 *
@@ -118,6 +157,9 @@ namespace mvg {
 		 * @param[out] model returned model if found
 		 * @param[in] precision upper bound of the precision (squared error)
 		 * @param[in] is_verbose display console log
+		 * @param[in] early_exit 内点不可能达到要求时提前终止的策略
+		 * @param[in] generator 采样使用的随机数生成器，为NULL时使用全局的rand()；
+		 *            多个线程同时估计时每个任务使用自己的生成器，结果可以复现
 		 *
 		 * @return (errorMax, minNFA)
 		 */
@@ -127,14 +169,19 @@ namespace mvg {
 			size_t iter_num = 1024,
 			typename Kernel::Model * model = NULL,
 			double precision = std::numeric_limits<double>::infinity(),
-			bool is_verbose = false)
+			bool is_verbose = false,
+			const ACRansacEarlyExit & early_exit = ACRansacEarlyExit(),
+			std::mt19937 * generator = NULL)
 		{
 			vec_inliers.clear();
 
 			const size_t sample_size = Kernel::MINIMUM_SAMPLES;
 			const size_t nData = kernel.NumSamples();
-			if (nData <= (size_t)sample_size)
+			if (nData <= (size_t)sample_size || nData < early_exit.min_inlier_count)
 				return std::make_pair(0.0, 0.0);
+			const size_t probe_iteration = early_exit.probeIterations(sample_size, nData);
+			bool is_aborted = false;
+			bool is_focused_sampling = false; // 是否已经开始在内点中采样
 
 			const double maxThreshold = (precision == std::numeric_limits<double>::infinity()) ?
 				std::numeric_limits<double>::infinity() :
@@ -164,7 +211,7 @@ namespace mvg {
 
 			// Main estimation loop.
 			for (size_t iter = 0; iter < iter_num; ++iter) {
-				UniformSample(sample_size, vec_index, &vec_sample); // Get random sample
+				UniformSample(sample_size, vec_index, &vec_sample, generator); // Get random sample
 
 				std::vector<typename Kernel::Model> vec_models; // Up to max_models solutions
 				kernel.Fit(vec_sample, &vec_models);
@@ -222,15 +269,23 @@ namespace mvg {
 					else {
 						// ACRANSAC optimization: draw samples among best set of inliers so far
 						vec_index = vec_inliers;
+						is_focused_sampling = true;
 						if (nIterReserve) {
 							iter_num = iter + 1 + nIterReserve;
 							nIterReserve = 0;
 						}
 					}
 				}
+
+				// 探测迭代内没有找到内点足够的有意义模型，内点比例不可能达到要求
+				if (iter + 1 == probe_iteration && !is_focused_sampling
+					&& (minNFA >= 0 || vec_inliers.size() < early_exit.min_inlier_count)) {
+					is_aborted = true;
+					break;
+				}
 			}
 
-			if (minNFA >= 0)
+			if (minNFA >= 0 || is_aborted)
 				vec_inliers.clear();
 
 			if (!vec_inliers.empty())
@@ -4,10 +4,15 @@
 #include <iostream>
 #include <iterator>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <map>
 #include <string>
 #include <vector>
 
 #include "mvg/math/numeric.h"
+#include "mvg/utils/memory_mapped_file.h"
+#include "mvg/utils/mvg_stdint.h"
 using namespace mvg::math;
 
 namespace mvg {
@@ -112,17 +117,148 @@ namespace mvg {
 			float _orientation;  // 单位弧度
 		};
 
-		/**	从文件中读取特征
+		/**
+		 * 二进制特征文件的格式：
+		 *   FeatureFileHeader
+		 *   FeatureRecord[count]
+		 * 特征点以POD的形式连续存放，可以一次读入或直接映射
+		 */
+		static const char kFeatureFileMagic[8] = { 'M', 'V', 'G', 'F', 'E', 'A', 'T', '\0' };
+		static const uint32_t kFeatureFileVersion = 1;
+
+		/**	二进制特征文件的文件头
+		 */
+		struct FeatureFileHeader
+		{
+			char magic[8];          //!< 文件标识 "MVGFEAT"
+			uint32_t version;       //!< 文件格式版本号
+			uint32_t record_size;   //!< sizeof(FeatureRecord)
+			uint64_t count;         //!< 特征点的个数
+		};
+
+		/**	二进制特征文件中的一个特征点，PointFeature的尺度和方向保存为0
+		 */
+		struct FeatureRecord
+		{
+			float x, y;             //!< 特征点坐标
+			float scale;            //!< 尺度，单位像素
+			float orientation;      //!< 方向，单位弧度
+		};
+
+		inline void FeatureToRecord(const PointFeature & feat, FeatureRecord & record)
+		{
+			record.x = feat.x();
+			record.y = feat.y();
+			record.scale = 0.0f;
+			record.orientation = 0.0f;
+		}
+
+		inline void FeatureToRecord(const ScalePointFeature & feat, FeatureRecord & record)
+		{
+			record.x = feat.x();
+			record.y = feat.y();
+			record.scale = feat.scale();
+			record.orientation = feat.orientation();
+		}
+
+		inline void RecordToFeature(const FeatureRecord & record, PointFeature & feat)
+		{
+			feat = PointFeature(record.x, record.y);
+		}
+
+		inline void RecordToFeature(const FeatureRecord & record, ScalePointFeature & feat)
+		{
+			feat = ScalePointFeature(record.x, record.y, record.scale, record.orientation);
+		}
+
+		/**	判断特征文件是否为二进制格式(只检查文件标识)
+		 */
+		static bool IsFeatsBinFile(const std::string & feature_filename)
+		{
+			std::ifstream file_in(feature_filename.c_str(), std::ios::in | std::ios::binary);
+			char magic[sizeof(kFeatureFileMagic)];
+			if (!file_in.read(magic, sizeof(magic)))
+				return false;
+			return std::memcmp(magic, kFeatureFileMagic, sizeof(magic)) == 0;
+		}
+
+		/**	以二进制的形式从文件中读取特征，文件通过内存映射读入
+		 */
+		template<typename FeaturesT >
+		static bool LoadFeatsFromBinFile(
+			const std::string & feature_filename,
+			FeaturesT & vec_feat)
+		{
+			vec_feat.clear();
+			mvg::utils::MemoryMappedFile mapped_file;
+			if (!mapped_file.open(feature_filename)
+				|| mapped_file.size() < sizeof(FeatureFileHeader))
+				return false;
+
+			FeatureFileHeader header;
+			std::memcpy(&header, mapped_file.data(), sizeof(header));
+			if (std::memcmp(header.magic, kFeatureFileMagic, sizeof(header.magic)) != 0
+				|| header.version != kFeatureFileVersion
+				|| header.record_size != sizeof(FeatureRecord)
+				|| mapped_file.size() != sizeof(FeatureFileHeader) + header.count * sizeof(FeatureRecord))
+				return false;
+
+			const FeatureRecord * records = reinterpret_cast<const FeatureRecord *>(
+				mapped_file.data() + sizeof(FeatureFileHeader));
+			vec_feat.resize(static_cast<size_t>(header.count));
+			size_t i = 0;
+			for (typename FeaturesT::iterator iter = vec_feat.begin();
+				iter != vec_feat.end(); ++iter, ++i) {
+				RecordToFeature(records[i], *iter);
+			}
+			return true;
+		}
+
+		/**	将特征以二进制的形式写入到文件中
+		 */
+		template<typename FeaturesT >
+		static bool SaveFeatsToBinFile(
+			const std::string & feature_filename,
+			const FeaturesT & vec_feat)
+		{
+			FeatureFileHeader header;
+			std::memcpy(header.magic, kFeatureFileMagic, sizeof(header.magic));
+			header.version = kFeatureFileVersion;
+			header.record_size = static_cast<uint32_t>(sizeof(FeatureRecord));
+			header.count = vec_feat.size();
+
+			std::vector<FeatureRecord> vec_records(vec_feat.size());
+			size_t i = 0;
+			for (typename FeaturesT::const_iterator iter = vec_feat.begin();
+				iter != vec_feat.end(); ++iter, ++i) {
+				FeatureToRecord(*iter, vec_records[i]);
+			}
+
+			std::ofstream file(feature_filename.c_str(), std::ios::out | std::ios::binary);
+			file.write((const char*)&header, sizeof(header));
+			if (!vec_records.empty())
+				file.write((const char*)&vec_records[0], sizeof(FeatureRecord) * vec_records.size());
+			bool is_ok = file.good();
+			file.close();
+			return is_ok;
+		}
+
+		/**	从文件中读取特征，自动识别文本格式和二进制格式
 		 */
 		template<typename FeaturesT >
 		static bool LoadFeatsFromFile(
 			const std::string & feature_filename,
 			FeaturesT & vec_feat)
 		{
+			if (IsFeatsBinFile(feature_filename))
+				return LoadFeatsFromBinFile(feature_filename, vec_feat);
+
 			vec_feat.clear();
 			bool is_ok = false;
 
 			std::ifstream file_in(feature_filename.c_str());
+			if (!file_in.is_open())
+				return false;
 			std::copy(
 				std::istream_iterator<typename FeaturesT::value_type >(file_in),
 				std::istream_iterator<typename FeaturesT::value_type >(),
@@ -147,6 +283,34 @@ namespace mvg {
 			return is_ok;
 		}
 
+		/**
+		 * \brief	并行读取多幅图像的特征，map_feats[i]对应feature_filenames[i]
+		 *
+		 * \param	feature_filenames	每幅图像的特征文件名
+		 * \param [out]	map_feats	 	每幅图像的特征
+		 *
+		 * \return	所有文件都读取成功返回true
+		 */
+		template<typename FeaturesT >
+		static bool LoadFeatsFromFiles(
+			const std::vector<std::string> & feature_filenames,
+			std::map<size_t, FeaturesT> & map_feats)
+		{
+			// 先在串行中建立所有的项，并行时只访问已有的元素
+			std::vector<FeaturesT *> vec_feats(feature_filenames.size());
+			for (size_t i = 0; i < feature_filenames.size(); ++i)
+				vec_feats[i] = &map_feats[i];
+
+			std::vector<char> vec_ok(feature_filenames.size(), 0);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+			for (int i = 0; i < (int)feature_filenames.size(); ++i)
+				vec_ok[i] = LoadFeatsFromFile(feature_filenames[i], *vec_feats[i]);
+
+			return std::find(vec_ok.begin(), vec_ok.end(), 0) == vec_ok.end();
+		}
+
 		/**	将点特征转矩阵的形式
 		 */
 		template< typename FeaturesT, typename MatT >
@@ -167,6 +331,25 @@ namespace mvg {
 				m.col(i)(1) = Scalar(feat.y());
 			}
 		}
+
+		/**
+		 * \brief	将在缩小scale倍的图像上检测的特征变换到原图坐标，像素中心对齐：
+		 *			原图坐标 = (缩小图像上的坐标 + 0.5) * scale - 0.5，尺度同时放大scale倍
+		 *
+		 * \param [in,out]	vec_feats	特征
+		 * \param	scale			 	图像缩小的倍数
+		 */
+		inline void RescaleFeatures(std::vector<ScalePointFeature> & vec_feats, float scale)
+		{
+			if (scale == 1.f)
+				return;
+			for (size_t i = 0; i < vec_feats.size(); ++i) {
+				ScalePointFeature & feat = vec_feats[i];
+				feat.x() = (feat.x() + 0.5f) * scale - 0.5f;
+				feat.y() = (feat.y() + 0.5f) * scale - 0.5f;
+				feat.scale() *= scale;
+			}
+		}
 	} //namespace feature
 } // namespace mvg
 
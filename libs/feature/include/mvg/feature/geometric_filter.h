@@ -1,21 +1,50 @@
 ﻿#ifndef MVG_FEATURE_GEOMETRIC_FILTER_H_
 #define MVG_FEATURE_GEOMETRIC_FILTER_H_
 
+#include <algorithm>
 #include <vector>
 #include <map>
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include "mvg/feature/features.h"
+#include "mvg/feature/pairwise_matches_store.h"
+#include "mvg/feature/region_cache.h"
 #include "mvg/utils//file_system.h"
 #include "mvg/utils/progress.h"
 
 namespace mvg{
 	namespace feature{
 
-		template <typename FeatureT>
+		template <typename FeatureT, typename DescriptorT = Descriptor<unsigned char, 128> >
 		class ImageCollectionGeometricFilter
 		{
 		public:
-			ImageCollectionGeometricFilter(){}
+			typedef RegionCache<FeatureT, DescriptorT> RegionCacheT;//!< 特征及描述子的缓存
+
+			ImageCollectionGeometricFilter() : min_putative_count_(0), min_inlier_count_(0), min_inlier_ratio_(0.f) {}
+
+			/**	使用共享的特征缓存(例如匹配时使用的缓存)，避免重新读取特征
+			 */
+			explicit ImageCollectionGeometricFilter(const std::shared_ptr<RegionCacheT> & region_cache)
+				: region_cache_(region_cache), min_putative_count_(0), min_inlier_count_(0), min_inlier_ratio_(0.f) {}
+
+			/**	设置最少的初始匹配个数，初始匹配更少的图像对不可能得到足够的内点，
+			 *  直接跳过而不读取特征和估计模型。默认为0，过滤所有的图像对
+			 */
+			void setMinPutativeCount(size_t min_putative_count) { min_putative_count_ = min_putative_count; }
+			size_t minPutativeCount() const { return min_putative_count_; }
+
+			/**	设置保留图像对需要的最少内点个数及内点占初始匹配的最小比例，用于移除重叠较差的图像对。
+			 *  不满足的图像对不输出，流式过滤时不会写入文件。默认都为0，保留所有找到内点的图像对
+			 */
+			void setMinInliers(size_t min_inlier_count, float min_inlier_ratio)
+			{
+				min_inlier_count_ = min_inlier_count;
+				min_inlier_ratio_ = min_inlier_ratio;
+			}
 
 			/**	导入特征  
 			 * \param [in,out]	file_names	输入文件名
@@ -23,86 +52,203 @@ namespace mvg{
 			 */
 			bool LoadData(const std::vector<std::string> &file_names, const std::string &match_dir) 
 			{
-				bool is_ok = true;
-				for (size_t j = 0; j < file_names.size(); ++j)  {
-					// 导入第j张图片的特征数据
-					const std::string feat_filename = mvg::utils::create_filespec(match_dir,
-						mvg::utils::basename_part(file_names[j]), "feat");
-					is_ok &= LoadFeatsFromFile(feat_filename, map_features[j]);
-				}
-				return is_ok;
+				if (!region_cache_)
+					region_cache_.reset(new RegionCacheT());
+				// 共享的缓存可能已经注册了图像，几何过滤只需要特征
+				if (region_cache_->size() == 0)
+					region_cache_->setImages(file_names, match_dir);
+				if (region_cache_->memoryBudget() == 0)
+					return region_cache_->preloadAll(false);
+				return true;
 			}
 
-			/// Filter all putative correspondences according the templated geometric filter
+			/// Filter all putative correspondences according the templated geometric filter,
+			/// return false if the features of an image cannot be read
 			template <typename GeometricFilterT>
-			void Filter(
+			bool Filter(
 				const GeometricFilterT &geometric_filter,
 				PairWiseMatches &map_putatives_matches_pair, // putative correspondences to filter
 				PairWiseMatches &map_geometric_matches,
 				const std::vector<std::pair<size_t, size_t> > &vec_images_size) const
 			{
-				ControlProgressDisplay my_progress_bar(map_putatives_matches_pair.size());
+				mvg::utils::ControlProgressDisplay my_progress_bar(map_putatives_matches_pair.size());
+
+				// 将图像对展开为连续的数组，并行循环中可以O(1)访问第k个图像对
+				std::vector<PairWiseMatches::const_iterator> vec_pairs;
+				vec_pairs.reserve(map_putatives_matches_pair.size());
+				for (PairWiseMatches::const_iterator iter = map_putatives_matches_pair.begin();
+					iter != map_putatives_matches_pair.end(); ++iter)
+					vec_pairs.push_back(iter);
+				std::vector<char> vec_failed(vec_pairs.size(), 0);
 
 #ifdef USE_OPENMP
 #pragma omp parallel for schedule(dynamic, 1)
 #endif
-				for (size_t i = 0; i < map_putatives_matches_pair.size(); ++i)
+				for (int k = 0; k < (int)vec_pairs.size(); ++k)
 				{
-					PairWiseMatches::const_iterator iter = map_putatives_matches_pair.begin();
-					std::advance(iter, i);
-
-					const size_t i_index = iter->first.first;
-					const size_t j_index = iter->first.second;
+					const PairWiseMatches::const_iterator iter = vec_pairs[k];
 					const std::vector<IndexedMatch> &vec_putative_matches = iter->second;
 
-					//导入第i和j图像的特征
-					typename std::map<size_t, std::vector<FeatureT> >::const_iterator iter_i_feats = map_features.begin();
-					typename std::map<size_t, std::vector<FeatureT> >::const_iterator iter_j_feats = map_features.begin();
-					std::advance(iter_i_feats, i_index);
-					std::advance(iter_j_feats, j_index);
-					const std::vector<FeatureT> & kpSetI = iter_i_feats->second;
-					const std::vector<FeatureT> & kpSetJ = iter_j_feats->second;
-
-					//-- Copy point to array in order to estimate fundamental matrix :
-					const size_t n = vec_putative_matches.size();
-					Mat xI(2, n), xJ(2, n);
-
-					for (size_t i = 0; i < vec_putative_matches.size(); ++i)  {
-						const FeatureT & left_img = kpSetI[vec_putative_matches[i]._i];
-						const FeatureT & right_img = kpSetJ[vec_putative_matches[i]._j];
-						xI.col(i) = Vec2f(left_img.coords()).cast<double>();
-						xJ.col(i) = Vec2f(right_img.coords()).cast<double>();
-					}
-
-					//-- Apply the geometric filter
-	  {
-		  std::vector<size_t> vec_inliers;
-		  // Use a copy in order to copy use internal functor parameters
-		  // and use it safely in multi-thread environment
-		  GeometricFilterT filter = geometric_filter;
-		  filter.Fit(xI, vec_images_size[i_index], xJ, vec_images_size[j_index], vec_inliers);
-
-		  if (!vec_inliers.empty())
-		  {
-			  std::vector<IndexedMatch> vec_filtered_matches;
-			  vec_filtered_matches.reserve(vec_inliers.size());
-			  for (size_t i = 0; i < vec_inliers.size(); ++i)  {
-				  vec_filtered_matches.push_back(vec_putative_matches[vec_inliers[i]]);
-			  }
+					std::vector<IndexedMatch> vec_filtered_matches;
+					bool is_read_failed = false;
+					if (!vec_putative_matches.empty() && filterPair(geometric_filter, iter->first.first, iter->first.second,
+						&vec_putative_matches[0], vec_putative_matches.size(), vec_images_size, vec_filtered_matches,
+						is_read_failed))
+					{
 #ifdef USE_OPENMP
 #pragma omp critical
 #endif
-		  {
-			  map_geometric_matches[std::make_pair(i_index, j_index)] = vec_filtered_matches;
-		  }
-		  }
-	  }
+						{
+							map_geometric_matches[iter->first].swap(vec_filtered_matches);
+						}
+					}
+					vec_failed[k] = is_read_failed ? 1 : 0;
 					++my_progress_bar;
 				}
+				return std::find(vec_failed.begin(), vec_failed.end(), 1) == vec_failed.end();
+			}
+
+			/**
+			 * \brief	流式的几何过滤：从二进制匹配文件中按块读取图像对并行过滤，
+			 *			每个线程的结果放在自己的缓冲区中，不需要加锁，每块结束后依次追加到输出文件。
+			 *			内存只与每块的图像对个数有关，与初始匹配的总数无关(特征的内存由缓存的预算限制)
+			 *
+			 * \param	geometric_filter	几何过滤的算子
+			 * \param	putative_file   	初始匹配的二进制文件
+			 * \param	geometric_file  	保存几何匹配的二进制文件
+			 * \param	vec_images_size 	每幅图像的大小
+			 * \param	chunk_pair_count	每块的图像对个数
+			 *
+			 * \return	读写文件或读取特征失败时返回false
+			 */
+			template <typename GeometricFilterT>
+			bool FilterStream(
+				const GeometricFilterT &geometric_filter,
+				const std::string &putative_file,
+				const std::string &geometric_file,
+				const std::vector<std::pair<size_t, size_t> > &vec_images_size,
+				size_t chunk_pair_count = 1024) const
+			{
+				PairWiseMatchesStore store;
+				PairWiseMatchesWriter writer;
+				if (chunk_pair_count == 0 || !store.open(putative_file) || !writer.open(geometric_file))
+					return false;
+
+#ifdef USE_OPENMP
+				const int thread_count = omp_get_max_threads();
+#else
+				const int thread_count = 1;
+#endif
+				typedef std::vector<std::pair<std::pair<size_t, size_t>, std::vector<IndexedMatch> > > MatchBuffer;
+				std::vector<MatchBuffer> vec_thread_buffers(thread_count);
+
+				mvg::utils::ControlProgressDisplay my_progress_bar(store.size());
+				for (size_t chunk_begin = 0; chunk_begin < store.size(); chunk_begin += chunk_pair_count)
+				{
+					const size_t chunk_end = (std::min)(store.size(), chunk_begin + chunk_pair_count);
+					std::vector<char> vec_failed(chunk_end - chunk_begin, 0);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+					for (int k = (int)chunk_begin; k < (int)chunk_end; ++k)
+					{
+#ifdef USE_OPENMP
+						MatchBuffer & buffer = vec_thread_buffers[omp_get_thread_num()];
+#else
+						MatchBuffer & buffer = vec_thread_buffers[0];
+#endif
+						const std::pair<size_t, size_t> pair = store.pairAt(k);
+						std::vector<IndexedMatch> vec_filtered_matches;
+						bool is_read_failed = false;
+						if (store.matchCountAt(k) > 0 && filterPair(geometric_filter, pair.first, pair.second,
+							store.matchesAt(k), store.matchCountAt(k), vec_images_size, vec_filtered_matches,
+							is_read_failed))
+						{
+							buffer.push_back(std::make_pair(pair, std::vector<IndexedMatch>()));
+							buffer.back().second.swap(vec_filtered_matches);
+						}
+						vec_failed[k - chunk_begin] = is_read_failed ? 1 : 0;
+						++my_progress_bar;
+					}
+					if (std::find(vec_failed.begin(), vec_failed.end(), 1) != vec_failed.end())
+						return false;
+
+					for (size_t t = 0; t < vec_thread_buffers.size(); ++t)
+					{
+						MatchBuffer & buffer = vec_thread_buffers[t];
+						for (size_t i = 0; i < buffer.size(); ++i) {
+							if (!writer.append(buffer[i].first.first, buffer[i].first.second,
+								&buffer[i].second[0], buffer[i].second.size()))
+								return false;
+						}
+						MatchBuffer().swap(buffer);
+					}
+				}
+				return writer.close();
 			}
 
 		private:
-			std::map<size_t, std::vector<FeatureT> > map_features;//!<每张图片对应的特征
+			/**
+			 * \brief	对一个图像对的初始匹配进行几何过滤
+			 *
+			 * \param [out]	vec_filtered_matches	内点对应的匹配
+			 * \param [out]	is_read_failed	图像的特征读取失败
+			 *
+			 * \return	找到内点时返回true
+			 */
+			template <typename GeometricFilterT>
+			bool filterPair(
+				const GeometricFilterT &geometric_filter,
+				size_t i_index, size_t j_index,
+				const IndexedMatch *putative_matches, size_t putative_count,
+				const std::vector<std::pair<size_t, size_t> > &vec_images_size,
+				std::vector<IndexedMatch> &vec_filtered_matches,
+				bool &is_read_failed) const
+			{
+				is_read_failed = false;
+				if (putative_count < min_putative_count_)
+					return false;
+
+				//导入第i和j图像的特征，不需要描述子
+				const typename RegionCacheT::RegionsPtr regions_i = region_cache_->get(i_index, false);
+				const typename RegionCacheT::RegionsPtr regions_j = region_cache_->get(j_index, false);
+				if (!regions_i || !regions_j) {
+					is_read_failed = true;
+					return false;
+				}
+				const std::vector<FeatureT> & kpSetI = regions_i->features;
+				const std::vector<FeatureT> & kpSetJ = regions_j->features;
+
+				//-- Copy point to array in order to estimate fundamental matrix :
+				Mat xI(2, putative_count), xJ(2, putative_count);
+				for (size_t i = 0; i < putative_count; ++i)  {
+					const FeatureT & left_img = kpSetI[putative_matches[i]._i];
+					const FeatureT & right_img = kpSetJ[putative_matches[i]._j];
+					xI.col(i) = Vec2f(left_img.coords()).cast<double>();
+					xJ.col(i) = Vec2f(right_img.coords()).cast<double>();
+				}
+
+				//-- Apply the geometric filter
+				std::vector<size_t> vec_inliers;
+				// Use a copy in order to copy use internal functor parameters
+				// and use it safely in multi-thread environment
+				GeometricFilterT filter = geometric_filter;
+				filter.Fit(xI, vec_images_size[i_index], xJ, vec_images_size[j_index], vec_inliers);
+				if (vec_inliers.empty() || vec_inliers.size() < min_inlier_count_
+					|| vec_inliers.size() / (float)putative_count < min_inlier_ratio_)
+					return false;
+
+				vec_filtered_matches.clear();
+				vec_filtered_matches.reserve(vec_inliers.size());
+				for (size_t i = 0; i < vec_inliers.size(); ++i)
+					vec_filtered_matches.push_back(putative_matches[vec_inliers[i]]);
+				return true;
+			}
+
+			std::shared_ptr<RegionCacheT> region_cache_;//!<每张图片对应的特征
+			size_t min_putative_count_;//!<最少的初始匹配个数
+			size_t min_inlier_count_;//!<保留图像对需要的最少内点个数
+			float min_inlier_ratio_;//!<保留图像对需要的内点最小比例
 		};
 
 	}
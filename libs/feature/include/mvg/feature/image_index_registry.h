@@ -0,0 +1,266 @@
+﻿#ifndef MVG_FEATURE_IMAGE_INDEX_REGISTRY_H_
+#define MVG_FEATURE_IMAGE_INDEX_REGISTRY_H_
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mvg/feature/region_cache.h"
+#include "mvg/utils/file_system.h"
+
+namespace mvg {
+	namespace feature {
+
+		/**
+		 * \brief	每幅图像描述子索引(例如FLANN的kd树)的注册表，每幅图像的索引只建立一次，
+		 *			在所有图像对、对称匹配和后续的匹配过程之间共享。
+		 *			设置了索引文件时优先从文件读取，建立之后保存到文件，重新运行时不需要再建立索引。
+		 *			索引引用的描述子与索引一起保存，索引有效期间描述子不会被缓存释放。
+		 *
+		 *  \code
+		 *   typedef ImageIndexRegistry<RegionCacheT, ArrayMatcherKdtreeFlann<unsigned char> > RegistryT;
+		 *   RegistryT registry(region_cache);
+		 *   registry.setIndexFiles(file_names, match_dir);
+		 *   registry.buildAll(file_names.size());
+		 *   RegistryT::Entry entry = registry.get(0);
+		 *   entry.matcher->SearchNeighbours(...);
+		 *  \endcode
+		 *
+		 * \tparam	RegionCacheT	特征及描述子缓存的类型
+		 * \tparam	MatcherT		索引(匹配器)的类型，需要实现ArrayMatcher的接口
+		 */
+		template <typename RegionCacheT, typename MatcherT>
+		class ImageIndexRegistry
+		{
+		public:
+			typedef typename RegionCacheT::RegionsPtr RegionsPtr;
+			typedef std::function<std::shared_ptr<MatcherT>()> MatcherFactory;  //!< 创建空的匹配器
+
+			/**	一幅图像的描述子及其索引
+			 */
+			struct Entry
+			{
+				RegionsPtr regions;                 //!< 特征及描述子，索引引用其中的描述子
+				std::shared_ptr<MatcherT> matcher;  //!< 描述子的索引
+
+				/**	索引是否有效
+				 */
+				bool isValid() const { return matcher.get() != NULL; }
+			};
+
+			/**
+			 * \brief	构造函数
+			 *
+			 * \param	region_cache	提供特征及描述子的缓存
+			 */
+			explicit ImageIndexRegistry(const std::shared_ptr<RegionCacheT> & region_cache)
+				: region_cache_(region_cache), built_count_(0), loaded_count_(0) {}
+
+			/**
+			 * \brief	设置创建匹配器的函数，用于需要构造参数的匹配器(例如乘积量化的码本)，
+			 *			不设置时使用默认构造函数，不能与get()并发调用
+			 *
+			 * \param	matcher_factory	返回新建匹配器的函数，可以被多个线程同时调用
+			 */
+			void setMatcherFactory(const MatcherFactory & matcher_factory)
+			{
+				matcher_factory_ = matcher_factory;
+			}
+
+			/**
+			 * \brief	设置一幅图像的索引文件，不能与get()并发调用
+			 *
+			 * \param	image_id	 	图像的索引
+			 * \param	index_file   	索引文件名
+			 * \param	desc_file	 	描述子文件名，索引文件比描述子文件旧时重新建立索引，为空时不检查
+			 */
+			void setIndexFile(size_t image_id, const std::string & index_file,
+				const std::string & desc_file = "")
+			{
+				if (vec_index_files_.size() <= image_id)
+					vec_index_files_.resize(image_id + 1);
+				vec_index_files_[image_id] = std::make_pair(index_file, desc_file);
+			}
+
+			/**
+			 * \brief	按照compute_matches的命名规则，将索引文件保存在描述子文件旁边(basename.flann)
+			 *
+			 * \param	file_names	图像文件名
+			 * \param	match_dir 	描述子所在的目录
+			 */
+			void setIndexFiles(const std::vector<std::string> & file_names, const std::string & match_dir)
+			{
+				for (size_t i = 0; i < file_names.size(); ++i) {
+					const std::string basename = mvg::utils::basename_part(file_names[i]);
+					setIndexFile(i, mvg::utils::create_filespec(match_dir, basename, "flann"),
+						mvg::utils::create_filespec(match_dir, basename, "desc"));
+				}
+			}
+
+			/**
+			 * \brief	获取图像的索引，没有建立时读取或建立索引，可以被多个线程同时调用
+			 *
+			 * \param	image_id	图像的索引
+			 *
+			 * \return	图像没有描述子或建立失败时matcher为空，特征及描述子读取失败时regions也为空
+			 */
+			Entry get(size_t image_id)
+			{
+				Entry entry;
+#ifdef USE_OPENMP
+#pragma omp critical(ImageIndexRegistry)
+#endif
+				{
+					if (image_id < vec_entries_.size())
+						entry = vec_entries_[image_id];
+				}
+				if (entry.isValid())
+					return entry;
+
+				// 在临界区外建立索引，其他线程可以同时建立别的图像的索引
+				bool is_loaded = false;
+				entry = create(image_id, is_loaded);
+				if (!entry.isValid())
+					return entry;
+
+#ifdef USE_OPENMP
+#pragma omp critical(ImageIndexRegistry)
+#endif
+				{
+					if (vec_entries_.size() <= image_id)
+						vec_entries_.resize(image_id + 1);
+					// 其他线程可能已经建立了同一幅图像的索引，使用已有的结果
+					if (vec_entries_[image_id].isValid()) {
+						entry = vec_entries_[image_id];
+					}
+					else {
+						vec_entries_[image_id] = entry;
+						if (is_loaded)
+							++loaded_count_;
+						else
+							++built_count_;
+					}
+				}
+				return entry;
+			}
+
+			/**
+			 * \brief	并行建立一组图像的索引
+			 *
+			 * \param	vec_image_ids	图像的索引
+			 */
+			void build(const std::vector<size_t> & vec_image_ids)
+			{
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int i = 0; i < (int)vec_image_ids.size(); ++i)
+					get(vec_image_ids[i]);
+			}
+
+			/**	并行建立前image_count幅图像的索引
+			 */
+			void buildAll(size_t image_count)
+			{
+				std::vector<size_t> vec_image_ids(image_count);
+				for (size_t i = 0; i < image_count; ++i)
+					vec_image_ids[i] = i;
+				build(vec_image_ids);
+			}
+
+			/**	释放一幅图像的索引，之后的get()会重新读取或建立
+			 */
+			void release(size_t image_id)
+			{
+#ifdef USE_OPENMP
+#pragma omp critical(ImageIndexRegistry)
+#endif
+				{
+					if (image_id < vec_entries_.size())
+						vec_entries_[image_id] = Entry();
+				}
+			}
+
+			/**	释放所有的索引
+			 */
+			void clear()
+			{
+#ifdef USE_OPENMP
+#pragma omp critical(ImageIndexRegistry)
+#endif
+				{
+					std::fill(vec_entries_.begin(), vec_entries_.end(), Entry());
+				}
+			}
+
+			/**	建立索引的次数
+			 */
+			size_t builtCount() const { return built_count_; }
+
+			/**	从文件读取索引的次数
+			 */
+			size_t loadedCount() const { return loaded_count_; }
+
+		private:
+			typedef typename RegionCacheT::DescsT::value_type DescriptorT;
+			typedef typename DescriptorT::bin_type DescBin_typeT;
+
+			/**	索引文件存在并且不比描述子文件旧
+			 */
+			bool isIndexFileValid(const std::pair<std::string, std::string> & files) const
+			{
+				if (!mvg::utils::file_exists(files.first))
+					return false;
+				return files.second.empty() || !mvg::utils::file_exists(files.second)
+					|| mvg::utils::file_modified(files.first) >= mvg::utils::file_modified(files.second);
+			}
+
+			/**	读取或建立一幅图像的索引
+			 */
+			Entry create(size_t image_id, bool & is_loaded) const
+			{
+				Entry entry;
+				is_loaded = false;
+				const RegionsPtr regions = region_cache_->get(image_id);
+				entry.regions = regions;
+				if (!regions || regions->descriptors.empty())
+					return entry;
+
+				const DescBin_typeT * dataset = reinterpret_cast<const DescBin_typeT *>(&regions->descriptors[0]);
+				const int rows_num = static_cast<int>(regions->descriptors.size());
+				std::shared_ptr<MatcherT> matcher(matcher_factory_ ? matcher_factory_() : std::shared_ptr<MatcherT>(new MatcherT));
+				if (!matcher)
+					return entry;
+
+				const std::pair<std::string, std::string> files = image_id < vec_index_files_.size()
+					? vec_index_files_[image_id] : std::pair<std::string, std::string>();
+				if (!files.first.empty() && isIndexFileValid(files)
+					&& matcher->Load(dataset, rows_num, DescriptorT::kStaticSize, files.first)) {
+					is_loaded = true;
+				}
+				else {
+					if (!matcher->Build(dataset, rows_num, DescriptorT::kStaticSize))
+						return entry;
+					// 不支持索引文件的匹配器保存失败，忽略
+					if (!files.first.empty())
+						matcher->Save(files.first);
+				}
+				entry.matcher = matcher;
+				return entry;
+			}
+
+			std::shared_ptr<RegionCacheT> region_cache_;                        //!< 特征及描述子的缓存
+			MatcherFactory matcher_factory_;                                    //!< 创建匹配器的函数，为空时使用默认构造函数
+			std::vector<Entry> vec_entries_;                                    //!< 每幅图像的索引，按图像id索引
+			std::vector<std::pair<std::string, std::string> > vec_index_files_; //!< 每幅图像的索引文件及描述子文件
+			size_t built_count_;                                                //!< 建立索引的次数
+			size_t loaded_count_;                                               //!< 从文件读取索引的次数
+		};
+
+	}  // namespace feature
+}  // namespace mvg
+
+#endif // MVG_FEATURE_IMAGE_INDEX_REGISTRY_H_
@@ -2,9 +2,13 @@
 #define MVG_FEATURE_INDEXED_MATCH_UTILS_H_
 
 #include "mvg/feature/indexed_match.h"
+#include "mvg/feature/pairwise_matches_store.h"
+#include "mvg/utils/file_system.h"
+#include <algorithm>
 #include <map>
 #include <fstream>
 #include <iterator>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -38,7 +42,7 @@ namespace mvg {
 		}
 
 		/**
-		 * \brief	从文件中导入匹配索引值对
+		 * \brief	从文件中导入匹配索引值对，支持文本格式和二进制格式(见PairWiseMatchesStore)
 		 *
 		 * \param	file_name				   	要导入的文件名
 		 * \param [in,out]	map_indexed_matches	匹配的索引值对
@@ -49,6 +53,17 @@ namespace mvg {
 			const std::string & file_name,
 			PairWiseMatches & map_indexed_matches)
 		{
+			if (PairWiseMatchesStore::isBinaryFile(file_name)) {
+				PairWiseMatchesStore store;
+				if (!store.open(file_name)) {
+					std::cout << std::endl << "ERROR IndexedMatchesUtils::import(...)" << std::endl
+						<< "invalid binary matches file : " << file_name << std::endl;
+					return false;
+				}
+				store.load(map_indexed_matches);
+				return true;
+			}
+
 			bool is_ok = false;
 			std::ifstream in(file_name.c_str());
 			if (in.is_open()) {
@@ -71,6 +86,192 @@ namespace mvg {
 			}
 			return is_ok;
 		}
+
+		/**
+		 * \brief	比较两次运行的图像列表，得到原图像在新列表中的索引以及新加入的图像，
+		 *			图像按名字对应，列表中图像的顺序可以改变
+		 *
+		 * \param	vec_old_names			 	已经匹配过的图像名
+		 * \param	vec_names				 	当前的图像名
+		 * \param [out]	vec_new_index	 	原来第i幅图像在当前列表中的索引，图像已被移除时为-1
+		 * \param [out]	vec_is_new		 	当前列表中的图像是否是新加入的
+		 *
+		 * \return	新加入的图像个数
+		 */
+		static size_t CompareImageLists(
+			const std::vector<std::string> & vec_old_names,
+			const std::vector<std::string> & vec_names,
+			std::vector<int> & vec_new_index,
+			std::vector<bool> & vec_is_new)
+		{
+			std::map<std::string, size_t> map_name_index;
+			for (size_t i = 0; i < vec_names.size(); ++i)
+				map_name_index[vec_names[i]] = i;
+
+			vec_new_index.assign(vec_old_names.size(), -1);
+			vec_is_new.assign(vec_names.size(), true);
+			size_t new_count = vec_names.size();
+			for (size_t i = 0; i < vec_old_names.size(); ++i) {
+				std::map<std::string, size_t>::const_iterator iter = map_name_index.find(vec_old_names[i]);
+				if (iter == map_name_index.end() || !vec_is_new[iter->second])
+					continue;
+				vec_new_index[i] = static_cast<int>(iter->second);
+				vec_is_new[iter->second] = false;
+				--new_count;
+			}
+			return new_count;
+		}
+
+		/**
+		 * \brief	将匹配中的图像索引映射为新的索引，移除已删除图像的匹配，
+		 *			映射后左图像索引大于右图像索引时交换图像对及每个匹配的左右索引
+		 *
+		 * \param	map_indexed_matches	   	原来的匹配
+		 * \param	vec_new_index		   	原图像索引对应的新索引，-1表示图像已被移除
+		 * \param [out]	map_remapped_matches	映射后的匹配
+		 */
+		static void RemapPairWiseMatches(
+			const PairWiseMatches & map_indexed_matches,
+			const std::vector<int> & vec_new_index,
+			PairWiseMatches & map_remapped_matches)
+		{
+			map_remapped_matches.clear();
+			for (PairWiseMatches::const_iterator iter = map_indexed_matches.begin();
+				iter != map_indexed_matches.end(); ++iter)
+			{
+				const size_t left_index = iter->first.first;
+				const size_t right_index = iter->first.second;
+				if (left_index >= vec_new_index.size() || right_index >= vec_new_index.size()
+					|| vec_new_index[left_index] < 0 || vec_new_index[right_index] < 0)
+					continue;
+
+				const size_t left = vec_new_index[left_index];
+				const size_t right = vec_new_index[right_index];
+				std::vector<IndexedMatch> & vec_matches = map_remapped_matches[std::make_pair(
+					std::min(left, right), std::max(left, right))];
+				vec_matches = iter->second;
+				if (left > right) {
+					for (size_t k = 0; k < vec_matches.size(); ++k)
+						std::swap(vec_matches[k]._i, vec_matches[k]._j);
+				}
+			}
+		}
+
+		/**
+		 * \brief	生成需要匹配的图像对：新图像与原图像、新图像与新图像，每个图像对满足i < j
+		 *
+		 * \param	vec_is_new	每幅图像是否是新加入的
+		 *
+		 * \return	按(i, j)升序排列的图像对
+		 */
+		static std::vector<std::pair<size_t, size_t> > PairsWithNewImages(
+			const std::vector<bool> & vec_is_new)
+		{
+			std::vector<std::pair<size_t, size_t> > vec_pairs;
+			for (size_t i = 0; i < vec_is_new.size(); ++i) {
+				for (size_t j = i + 1; j < vec_is_new.size(); ++j) {
+					if (vec_is_new[i] || vec_is_new[j])
+						vec_pairs.push_back(std::make_pair(i, j));
+				}
+			}
+			return vec_pairs;
+		}
+
+		/**
+		 * \brief	匹配文件对应的图像列表文件，例如matches.putative.bin对应matches.putative.images.txt
+		 */
+		static std::string ImageListFile(const std::string & matches_file)
+		{
+			return mvg::utils::create_filespec(mvg::utils::folder_part(matches_file),
+				mvg::utils::basename_part(matches_file) + ".images", "txt");
+		}
+
+		/**
+		 * \brief	读取匹配文件对应的图像列表，每行一个图像名
+		 */
+		static bool LoadImageNames(const std::string & file_name, std::vector<std::string> & vec_names)
+		{
+			std::ifstream in(file_name.c_str());
+			if (!in.is_open())
+				return false;
+			vec_names.clear();
+			std::string name;
+			while (std::getline(in, name)) {
+				if (!name.empty())
+					vec_names.push_back(name);
+			}
+			return true;
+		}
+
+		/**
+		 * \brief	保存匹配文件对应的图像列表，增量匹配时据此判断哪些图像是新加入的
+		 */
+		static bool SaveImageNames(const std::string & file_name, const std::vector<std::string> & vec_names)
+		{
+			std::ofstream out(file_name.c_str());
+			if (!out.is_open())
+				return false;
+			for (size_t i = 0; i < vec_names.size(); ++i)
+				out << vec_names[i] << '\n';
+			return out.good();
+		}
+
+		/**	图像对按所在的图像块(i / block_size, j / block_size)排序，同一块内按(i, j)排序
+		 */
+		struct PairBlockOrder
+		{
+			explicit PairBlockOrder(size_t block_size) : block_size_(block_size) {}
+
+			bool operator()(const std::pair<size_t, size_t> & a, const std::pair<size_t, size_t> & b) const
+			{
+				const std::pair<size_t, size_t> block_a(a.first / block_size_, a.second / block_size_);
+				const std::pair<size_t, size_t> block_b(b.first / block_size_, b.second / block_size_);
+				return block_a != block_b ? block_a < block_b : a < b;
+			}
+
+			size_t block_size_;
+		};
+
+		/**
+		 * \brief	将图像对确定性地划分为shard_count个均衡的分片，每个分片可以由单独的进程或机器匹配。
+		 *			图像对按所在的图像块排序后切分为个数相差不超过1的连续段，
+		 *			每个分片只涉及少数几个图像块，需要读取的图像较少。
+		 *			结果只依赖于图像对的集合和分片参数，所有分片的并集等于输入的图像对
+		 *
+		 * \param	vec_pairs  	所有要匹配的图像对
+		 * \param	shard_index	分片的索引，从0开始
+		 * \param	shard_count	分片的个数
+		 * \param	block_size 	图像块的大小
+		 *
+		 * \return	属于该分片的图像对，按(i, j)升序排列
+		 */
+		static std::vector<std::pair<size_t, size_t> > ShardPairs(
+			const std::vector<std::pair<size_t, size_t> > & vec_pairs,
+			size_t shard_index, size_t shard_count, size_t block_size = 64)
+		{
+			std::vector<std::pair<size_t, size_t> > vec_shard_pairs;
+			if (shard_count == 0 || shard_index >= shard_count)
+				return vec_shard_pairs;
+
+			std::vector<std::pair<size_t, size_t> > vec_ordered_pairs(vec_pairs);
+			std::sort(vec_ordered_pairs.begin(), vec_ordered_pairs.end(), PairBlockOrder(std::max<size_t>(1, block_size)));
+			const size_t begin = vec_ordered_pairs.size() * shard_index / shard_count;
+			const size_t end = vec_ordered_pairs.size() * (shard_index + 1) / shard_count;
+			vec_shard_pairs.assign(vec_ordered_pairs.begin() + begin, vec_ordered_pairs.begin() + end);
+			std::sort(vec_shard_pairs.begin(), vec_shard_pairs.end());
+			return vec_shard_pairs;
+		}
+
+		/**
+		 * \brief	分片的匹配文件名，例如matches.putative.bin的第0个分片(共4个)为matches.putative.shard-0-of-4.bin
+		 */
+		static std::string ShardMatchesFile(const std::string & matches_file, size_t shard_index, size_t shard_count)
+		{
+			std::ostringstream basename;
+			basename << mvg::utils::basename_part(matches_file) << ".shard-" << shard_index << "-of-" << shard_count;
+			return mvg::utils::create_filespec(mvg::utils::folder_part(matches_file), basename.str(),
+				mvg::utils::extension_part(matches_file));
+		}
 	}  // namespace feature
 }  // namespace mvg
 
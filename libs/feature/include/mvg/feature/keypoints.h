@@ -57,7 +57,8 @@ namespace mvg {
 			}
 
 			/**
-			* \brief	从文件中读取特征及对应的描述子，描述子为二进制形式
+			* \brief	从文件中读取特征及对应的描述子，描述子为二进制形式，
+			*			特征文件可以是二进制或文本形式
 			*
 			* \param	feature_filename	特征文件的文件名
 			* \param	descs_filename  	描述子文件的文件名
@@ -73,7 +74,7 @@ namespace mvg {
 			}
 
 			/**
-			 * \brief	单独将特征和描述子导出，描述子导出为二进制形式
+			 * \brief	单独将特征和描述子导出，特征和描述子都导出为二进制形式
 			 *
 			 * \param	feature_filename	特征文件的文件名
 			 * \param	descs_filename  	描述子文件的文件名
@@ -84,7 +85,7 @@ namespace mvg {
 				const std::string& feature_filename,
 				const std::string& descs_filename) const
 			{
-				return saveFeatsToFile(feature_filename, _feats)
+				return SaveFeatsToBinFile(feature_filename, _feats)
 					& SaveDescsToBinFile(descs_filename, _descs);
 			}
 
@@ -24,8 +24,10 @@ namespace mvg {
 			 *
 			 * \param	vec_filenames				 	The vector filenames.
 			 * \param [in,out]	map_putatives_matches	The map putatives matches.
+			 *
+			 * \return	false if the features or descriptors of an image cannot be read.
 			 */
-			virtual void Match(
+			virtual bool Match(
 				const std::vector<std::string> &vec_filenames,
 				PairWiseMatches &map_putatives_matches )const = 0;
 		};
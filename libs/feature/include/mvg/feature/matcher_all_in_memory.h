@@ -5,18 +5,31 @@
 #include "mvg/feature/indexed_match_decorator.h"
 #include "mvg/feature/matching_filters.h"
 #include "mvg/feature/matcher.h"
+#include "mvg/feature/metric.h"
+#include "mvg/feature/region_cache.h"
+#include "mvg/feature/image_index_registry.h"
+#include "mvg/feature/indexed_match_utils.h"
 
 #include "mvg/utils/file_system.h"
 #include "mvg/utils/progress.h"
 
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <memory>
+
 namespace mvg {
 	namespace feature{
 		/// Implementation of an Image Collection Matcher
 		/// Compute putative matches between a collection of pictures
 		/// Spurious correspondences are discarded by using the
 		///  a threshold over the distance ratio of the 2 neighbours points.
+		/// 对称模式下还要求两个特征互为最近邻(cross-check)。
+		/// 查询的描述子可以与建立索引的描述子不同(QueryDescriptorT)，例如乘积量化时
+		/// 索引使用编码，查询使用未压缩的描述子，此时通过setQueryCache提供查询的描述子。
 		///
-		template <typename KeypointSetT, typename MatcherT>
+		template <typename KeypointSetT, typename MatcherT,
+			typename QueryDescriptorT = typename KeypointSetT::DescriptorT>
 		class MatcherAllInMemory : public Matcher
 		{
 			// Alias to internal stored Feature and Descriptor type
@@ -27,14 +40,84 @@ namespace mvg {
 			typedef typename DescriptorT::bin_type DescBin_typeT;
 
 		public:
+			typedef RegionCache<FeatureT, DescriptorT> RegionCacheT;//!< 特征及描述子的缓存
+			typedef RegionCache<FeatureT, QueryDescriptorT> QueryCacheT;//!< 查询描述子的缓存
+			typedef ImageIndexRegistry<RegionCacheT, MatcherT> IndexRegistryT;//!< 每幅图像描述子的索引
+
 			MatcherAllInMemory(float distRatio) :
 				Matcher(),
-				distance_ratio(distRatio)
+				distance_ratio(distRatio),
+				is_symmetric_(false),
+				is_save_index_(false),
+				block_size_(8)
+			{
+			}
+
+			/**
+			 * \brief	使用共享的特征及描述子缓存，缓存有内存预算时按需读取
+			 *
+			 * \param	distRatio   	距离比率
+			 * \param	region_cache	共享的缓存
+			 */
+			MatcherAllInMemory(float distRatio, const std::shared_ptr<RegionCacheT> & region_cache) :
+				Matcher(),
+				distance_ratio(distRatio),
+				is_symmetric_(false),
+				is_save_index_(false),
+				block_size_(8),
+				region_cache_(region_cache)
+			{
+			}
+
+			/**
+			 * \brief	设置是否使用对称匹配，只保留互为最近邻的匹配，减少几何过滤的输入。
+			 *			对称模式下所有图像的索引都保留在内存中
+			 *
+			 * \param	is_symmetric	是否使用对称匹配
+			 */
+			void setSymmetric(bool is_symmetric) { is_symmetric_ = is_symmetric; }
+
+			/**	是否使用对称匹配
+			 */
+			bool isSymmetric() const { return is_symmetric_; }
+
+			/**
+			 * \brief	设置是否将每幅图像的索引保存在描述子文件旁边(basename.flann)，
+			 *			再次运行时直接读取，需要在LoadData之前设置
+			 *
+			 * \param	is_save_index	是否保存索引
+			 */
+			void setSaveIndex(bool is_save_index) { is_save_index_ = is_save_index; }
+
+			/**
+			 * \brief	使用共享的索引注册表，多次匹配(例如增量匹配)之间不需要重新建立索引，
+			 *			注册表必须使用同一个特征及描述子缓存
+			 *
+			 * \param	index_registry	索引注册表
+			 */
+			void setIndexRegistry(const std::shared_ptr<IndexRegistryT> & index_registry)
+			{
+				index_registry_ = index_registry;
+			}
+
+			/**	获取使用的索引注册表
+			 */
+			const std::shared_ptr<IndexRegistryT> & indexRegistry() const { return index_registry_; }
+
+			/**
+			 * \brief	设置查询使用的描述子的缓存，特征的个数和顺序必须与建立索引的描述子相同。
+			 *			不设置时使用建立索引的描述子查询，需要在LoadData之前设置
+			 *
+			 * \param	query_cache	查询描述子的缓存，没有注册图像时在LoadData中注册
+			 */
+			void setQueryCache(const std::shared_ptr<QueryCacheT> & query_cache)
 			{
+				query_cache_ = query_cache;
 			}
 
 			/**
 			 * \brief	Load all features and descriptors in memory
+			 *			(or register them in the cache when it has a memory budget)
 			 *
 			 * \param	file_names	List of names of the files.
 			 * \param	match_dir 	The match dir where the data are saved.
@@ -45,105 +128,341 @@ namespace mvg {
 				const std::vector<std::string> & file_names,
 				const std::string & match_dir) 
 			{
-				bool is_ok = true;
-				for (size_t j = 0; j < file_names.size(); ++j)  {
-					// 导入第j个图像的特征及描述子
-					const std::string feat_filename = mvg::utils::create_filespec(match_dir,
-						mvg::utils::basename_part(file_names[j]), "feat");
-					const std::string desc_filename = mvg::utils::create_filespec(match_dir,
-						mvg::utils::basename_part(file_names[j]), "desc");
-
-					is_ok &= LoadFeatsFromFile(feat_filename, map_features[j]);
-					is_ok &= LoadDescsFromBinFile(desc_filename, map_descriptors[j]);
-				}
-				return is_ok;
+				if (!region_cache_)
+					region_cache_.reset(new RegionCacheT());
+				// 共享的缓存可能已经注册了图像
+				if (region_cache_->size() == 0)
+					region_cache_->setImages(file_names, match_dir);
+				if (!index_registry_)
+					index_registry_.reset(new IndexRegistryT(region_cache_));
+				if (is_save_index_)
+					index_registry_->setIndexFiles(file_names, match_dir);
+				if (query_cache_ && query_cache_->size() == 0)
+					query_cache_->setImages(file_names, match_dir);
+				// 没有内存预算时一次性并行读入
+				if (region_cache_->memoryBudget() == 0 && !region_cache_->preloadAll())
+					return false;
+				if (query_cache_ && query_cache_->memoryBudget() == 0)
+					return query_cache_->preloadAll();
+				return true;
 			}
 
-			void Match(
+			/**	获取使用的缓存，可以共享给几何过滤等后续步骤
+			 */
+			const std::shared_ptr<RegionCacheT> & regionCache() const { return region_cache_; }
+
+			bool Match(
 				const std::vector<std::string> & file_names, // input filenames,
 				PairWiseMatches & map_putatives_matches)const // the pairwise photometric corresponding points
 			{
+				std::vector<std::pair<size_t, size_t> > vec_pairs;
+				vec_pairs.reserve(file_names.size()*(file_names.size() - 1) / 2);
+				for (size_t i = 0; i < file_names.size(); ++i)
+					for (size_t j = i + 1; j < file_names.size(); ++j)
+						vec_pairs.push_back(std::make_pair(i, j));
+				return Match(file_names, vec_pairs, map_putatives_matches);
+			}
+
+			/**
+			 * \brief	只匹配指定的图像对(例如增量匹配时新图像与其他图像组成的图像对)，
+			 *			结果插入到map_putatives_matches中，已有的其他图像对保持不变
+			 *
+			 * \param	file_names				 	图像文件名
+			 * \param	vec_pairs				 	要匹配的图像对，每个图像对满足i < j
+			 * \param [in,out]	map_putatives_matches	可能的匹配
+			 *
+			 * \return	有图像的特征或描述子读取失败时返回false
+			 */
+			bool Match(
+				const std::vector<std::string> & file_names,
+				const std::vector<std::pair<size_t, size_t> > & vec_pairs,
+				PairWiseMatches & map_putatives_matches)const
+			{
 #ifdef USE_OPENMP
 				std::cout << "Using the OPENMP thread interface" << std::endl;
 #endif
-				ControlProgressDisplay my_progress_bar(file_names.size()*(file_names.size() - 1) / 2.0);
+				if (!index_registry_)
+					return false;
 
-				for (size_t i = 0; i < file_names.size(); ++i)
+				// 图像对按(I块, J块)分块排序，块内按(i, j)排序，
+				// 处理一个块时只用到2 * block_size_幅图像的描述子和索引，在缓存中保持有效
+				std::vector<std::pair<size_t, size_t> > vec_block_pairs;
+				vec_block_pairs.reserve(vec_pairs.size());
+				for (size_t k = 0; k < vec_pairs.size(); ++k) {
+					if (vec_pairs[k].first < vec_pairs[k].second && vec_pairs[k].second < file_names.size())
+						vec_block_pairs.push_back(vec_pairs[k]);
+				}
+				const PairBlockOrder block_order(block_size_);
+				std::sort(vec_block_pairs.begin(), vec_block_pairs.end(), block_order);
+				vec_block_pairs.erase(std::unique(vec_block_pairs.begin(), vec_block_pairs.end()), vec_block_pairs.end());
+
+				// 每个块在vec_block_pairs中的起始位置，最后加上结束位置
+				std::vector<size_t> vec_block_begins;
+				for (size_t k = 0; k < vec_block_pairs.size(); ++k) {
+					if (k == 0 || vec_block_pairs[k].first / block_size_ != vec_block_pairs[k - 1].first / block_size_
+						|| vec_block_pairs[k].second / block_size_ != vec_block_pairs[k - 1].second / block_size_)
+						vec_block_begins.push_back(k);
+				}
+				vec_block_begins.push_back(vec_block_pairs.size());
+				const size_t block_count = vec_block_begins.size() - 1;
+
+				// 没有内存预算或者对称匹配(需要双向查询)时预先并行建立用到的索引
+				const bool is_prebuild = is_symmetric_ || region_cache_->memoryBudget() == 0;
+				if (is_prebuild) {
+					std::vector<bool> vec_is_used(file_names.size(), false);
+					for (size_t k = 0; k < vec_block_pairs.size(); ++k) {
+						vec_is_used[vec_block_pairs[k].first] = true;
+						if (is_symmetric_)
+							vec_is_used[vec_block_pairs[k].second] = true;
+					}
+					std::vector<size_t> vec_image_ids;
+					for (size_t i = 0; i < vec_is_used.size(); ++i) {
+						if (vec_is_used[i])
+							vec_image_ids.push_back(i);
+					}
+					index_registry_->build(vec_image_ids);
+				}
+
+				mvg::utils::ControlProgressDisplay my_progress_bar(vec_block_pairs.size());
+
+				if (is_prebuild) {
+					// 三角形的图像对空间中所有的块一起动态调度，空闲的线程取下一个块，
+					// 不会像按行并行时那样在每一行结束时等待
+					return matchBlocks(vec_block_pairs, vec_block_begins, 0, block_count, map_putatives_matches, my_progress_bar);
+				}
+
+				// 有内存预算时按I块逐行处理，每行开始前并行建立行内图像的索引，结束后释放，描述子交由缓存管理
+				for (size_t row_begin = 0; row_begin < block_count;)
 				{
-					// Load features and descriptors of Inth image
-					typename std::map<size_t, std::vector<FeatureT> >::const_iterator iter_FeaturesI = map_features.begin();
-					typename std::map<size_t, DescsT >::const_iterator iter_DescriptorI = map_descriptors.begin();
-					std::advance(iter_FeaturesI, i);
-					std::advance(iter_DescriptorI, i);
+					const size_t row = vec_block_pairs[vec_block_begins[row_begin]].first / block_size_;
+					size_t row_end = row_begin + 1;
+					while (row_end < block_count && vec_block_pairs[vec_block_begins[row_end]].first / block_size_ == row)
+						++row_end;
+
+					std::vector<size_t> vec_image_ids;
+					for (size_t k = vec_block_begins[row_begin]; k < vec_block_begins[row_end]; ++k)
+						vec_image_ids.push_back(vec_block_pairs[k].first);
+					std::sort(vec_image_ids.begin(), vec_image_ids.end());
+					vec_image_ids.erase(std::unique(vec_image_ids.begin(), vec_image_ids.end()), vec_image_ids.end());
+
+					index_registry_->build(vec_image_ids);
+					const bool is_ok = matchBlocks(vec_block_pairs, vec_block_begins, row_begin, row_end,
+						map_putatives_matches, my_progress_bar);
+					for (size_t k = 0; k < vec_image_ids.size(); ++k)
+						index_registry_->release(vec_image_ids[k]);
+					if (!is_ok)
+						return false;
+					row_begin = row_end;
+				}
+				return true;
+			}
 
-					const std::vector<FeatureT> & featureSetI = iter_FeaturesI->second;
-					const size_t featureSetI_Size = iter_FeaturesI->second.size();
-					const DescBin_typeT * tab0 =
-						reinterpret_cast<const DescBin_typeT *>(&iter_DescriptorI->second[0]);
+			/**
+			 * \brief	设置分块调度时图像块的大小，一个块包含block_size x block_size个图像对，
+			 *			应使2 * block_size幅图像的描述子及索引能放入处理器的缓存中
+			 *
+			 * \param	block_size	图像块的大小
+			 */
+			void setBlockSize(size_t block_size) { block_size_ = std::max<size_t>(1, block_size); }
 
-					MatcherT matcher10;
-					(matcher10.Build(tab0, featureSetI_Size, DescriptorT::kStaticSize));
+			/**	分块调度时图像块的大小
+			 */
+			size_t blockSize() const { return block_size_; }
 
+		private:
+			/**
+			 * \brief	并行匹配第first_block到last_block - 1个块，每个线程一次处理一个块
+			 *
+			 * \return	有图像的特征或描述子读取失败时返回false
+			 */
+			bool matchBlocks(const std::vector<std::pair<size_t, size_t> > & vec_block_pairs,
+				const std::vector<size_t> & vec_block_begins, size_t first_block, size_t last_block,
+				PairWiseMatches & map_putatives_matches,
+				mvg::utils::ControlProgressDisplay & my_progress_bar) const
+			{
+				// 每个块是否读取失败，并行循环中不共享同一个标志
+				std::vector<char> vec_failed(last_block - first_block, 0);
 #ifdef USE_OPENMP
 #pragma omp parallel for schedule(dynamic, 1)
 #endif
-					for (int j = i + 1; j < (int)file_names.size(); ++j)
+				for (int b = (int)first_block; b < (int)last_block; ++b)
+				{
+					// 块内的图像对按i排序，同一幅图像I的索引只获取一次
+					typename IndexRegistryT::Entry entryI;
+					size_t i = std::numeric_limits<size_t>::max();
+					for (size_t k = vec_block_begins[b]; k < vec_block_begins[b + 1]; ++k)
 					{
-						// Load descriptor of Jnth image
-						typename std::map<size_t, std::vector<FeatureT> >::const_iterator iter_FeaturesJ = map_features.begin();
-						typename std::map<size_t, DescsT >::const_iterator iter_DescriptorJ = map_descriptors.begin();
-						std::advance(iter_FeaturesJ, j);
-						std::advance(iter_DescriptorJ, j);
-
-						const std::vector<FeatureT> & featureSetJ = iter_FeaturesJ->second;
-						const DescBin_typeT * tab1 =
-							reinterpret_cast<const DescBin_typeT *>(&iter_DescriptorJ->second[0]);
-
-						const size_t NNN__ = 2;
-						std::vector<int> vec_nIndice10;
-						std::vector<typename MatcherT::DistanceType> vec_fDistance10;
-
-						//Find left->right
-						matcher10.SearchNeighbours(tab1, featureSetJ.size(), &vec_nIndice10, &vec_fDistance10, NNN__);
-
-						std::vector<IndexedMatch> vec_filtered_matches;
-						std::vector<int> vec_NNRatioIndexes;
-						DistanceRatioFilter(vec_fDistance10.begin(), // distance start
-							vec_fDistance10.end(),  // distance end
-							NNN__, // Number of neighbor in iterator sequence (minimum required 2)
-							vec_NNRatioIndexes, // output (index that respect Lowe Ratio)
-							Square(distance_ratio)); // squared dist ratio due to usage of a squared metric
-
-						for (size_t k = 0; k < vec_NNRatioIndexes.size() - 1 && vec_NNRatioIndexes.size()>0; ++k)
-						{
-							const size_t index = vec_NNRatioIndexes[k];
-							vec_filtered_matches.push_back(
-								IndexedMatch(vec_nIndice10[index*NNN__], index));
+						if (vec_block_pairs[k].first != i) {
+							i = vec_block_pairs[k].first;
+							// Load features, descriptors and index of Inth image
+							entryI = index_registry_->get(i);
 						}
+						// 没有描述子的图像跳过，读取失败时整个匹配失败
+						if (!entryI.regions
+							|| (entryI.isValid() && !matchPair(i, entryI, vec_block_pairs[k].second, map_putatives_matches)))
+							vec_failed[b - first_block] = 1;
+						++my_progress_bar;
+					}
+				}
+				return std::find(vec_failed.begin(), vec_failed.end(), 1) == vec_failed.end();
+			}
 
-						// Remove duplicates
-						IndexedMatch::getDeduplicated(vec_filtered_matches);
+			/**
+			 * \brief	匹配一个图像对(i, j)，J中的每个特征在I的索引中查询最近邻
+			 *
+			 * \return	J的特征或描述子读取失败时返回false
+			 */
+			bool matchPair(size_t i, const typename IndexRegistryT::Entry & entryI, size_t j,
+				PairWiseMatches & map_putatives_matches) const
+			{
+				const typename RegionCacheT::RegionsPtr & regionsI = entryI.regions;
+				const std::vector<FeatureT> & featureSetI = regionsI->features;
+				const size_t featureSetI_Size = regionsI->features.size();
+				const std::shared_ptr<MatcherT> & matcher10 = entryI.matcher;
 
-						// Remove matches that have the same X,Y coordinates
-						IndexedMatchDecorator<float> matchDeduplicator(vec_filtered_matches, featureSetI, featureSetJ);
-						matchDeduplicator.getDeduplicated(vec_filtered_matches);
+				// Load descriptor of Jnth image
+				typename IndexRegistryT::Entry entryJ;
+				if (is_symmetric_)
+					entryJ = index_registry_->get(j);
+				const typename RegionCacheT::RegionsPtr regionsJ =
+					is_symmetric_ ? entryJ.regions : region_cache_->get(j);
+				if (!regionsJ)
+					return false;
+				// J没有描述子(或对称匹配时没有索引)，没有可能的匹配
+				if (regionsJ->descriptors.empty() || (is_symmetric_ && !entryJ.isValid()))
+					return true;
+
+				// 设置了查询描述子时，J的查询及对称过滤中I的反向查询都使用查询描述子
+				typename QueryCacheT::RegionsPtr query_regionsI, query_regionsJ;
+				if (query_cache_) {
+					query_regionsJ = query_cache_->get(j);
+					if (is_symmetric_)
+						query_regionsI = query_cache_->get(i);
+					if (!query_regionsJ || (is_symmetric_ && !query_regionsI))
+						return false;
+					if (query_regionsJ->descriptors.size() != regionsJ->descriptors.size()
+						|| (is_symmetric_ && query_regionsI->descriptors.size() != regionsI->descriptors.size())) {
+						std::cerr << "Query descriptors do not match the indexed descriptors of image pair ("
+							<< i << ", " << j << ")" << std::endl;
+						return false;
+					}
+				}
+
+				const std::vector<FeatureT> & featureSetJ = regionsJ->features;
+				const typename QueryDescriptorT::bin_type * tab1 = query_regionsJ
+					? reinterpret_cast<const typename QueryDescriptorT::bin_type *>(&query_regionsJ->descriptors[0])
+					: reinterpret_cast<const typename QueryDescriptorT::bin_type *>(&regionsJ->descriptors[0]);
+
+				const size_t NNN__ = 2;
+				std::vector<int> vec_nIndice10;
+				std::vector<typename MatcherT::DistanceType> vec_fDistance10;
+
+				//Find left->right
+				matcher10->SearchNeighbours(tab1, featureSetJ.size(), &vec_nIndice10, &vec_fDistance10, NNN__);
+
+				std::vector<IndexedMatch> vec_filtered_matches;
+				std::vector<int> vec_NNRatioIndexes;
+				DistanceRatioFilter(vec_fDistance10.begin(), // distance start
+					vec_fDistance10.end(),  // distance end
+					NNN__, // Number of neighbor in iterator sequence (minimum required 2)
+					vec_NNRatioIndexes, // output (index that respect Lowe Ratio)
+					// squared dist ratio due to usage of a squared metric, plain ratio for Hamming
+					DistanceRatioThreshold<typename MatcherT::MetricT>(distance_ratio));
+
+				// 只保留互为最近邻的匹配
+				if (is_symmetric_ && query_regionsI)
+					SymmetricFilter(featureSetI_Size, query_regionsI->descriptors, *entryJ.matcher,
+						vec_nIndice10, NNN__, vec_NNRatioIndexes);
+				else if (is_symmetric_)
+					SymmetricFilter(featureSetI_Size, regionsI->descriptors, *entryJ.matcher,
+						vec_nIndice10, NNN__, vec_NNRatioIndexes);
+
+				for (size_t k = 0; k < vec_NNRatioIndexes.size(); ++k)
+				{
+					const size_t index = vec_NNRatioIndexes[k];
+					if (vec_nIndice10[index*NNN__] < 0)
+						continue;
+					vec_filtered_matches.push_back(
+						IndexedMatch(vec_nIndice10[index*NNN__], index));
+				}
+
+				// Remove duplicates
+				IndexedMatch::getDeduplicated(vec_filtered_matches);
+
+				// Remove matches that have the same X,Y coordinates
+				IndexedMatchDecorator<float> matchDeduplicator(vec_filtered_matches, featureSetI, featureSetJ);
+				matchDeduplicator.getDeduplicated(vec_filtered_matches);
 
 #ifdef USE_OPENMP
 #pragma omp critical
 #endif
-						{
-							map_putatives_matches.insert(make_pair(make_pair(i, j), vec_filtered_matches));
-						}
+				{
+					map_putatives_matches[std::make_pair(i, j)] = vec_filtered_matches;
+				}
+				return true;
+			}
 
-						++my_progress_bar;
-					}
+			/**
+			 * \brief	对称性过滤：J中特征q在I中的最近邻为p时，只有p在J中的最近邻也是q才保留。
+			 *			只查询通过了比率测试的特征在I中对应的最近邻，而不是I中所有的特征
+			 *
+			 * \param	featureSetI_Size		I中特征的个数
+			 * \param	descriptorsI			I的查询描述子
+			 * \param	matcherJ				J的描述子的索引
+			 * \param	vec_nIndice10		 	J中每个特征在I中的近邻
+			 * \param	nearest_neighbor_num	每个特征近邻的个数
+			 * \param [in,out]	vec_NNRatioIndexes	通过比率测试的J中特征的索引，输出同时满足对称性的索引
+			 */
+			template <typename QueryDescsT>
+			static void SymmetricFilter(size_t featureSetI_Size,
+				const QueryDescsT & descriptorsI,
+				MatcherT & matcherJ,
+				const std::vector<int> & vec_nIndice10,
+				int nearest_neighbor_num,
+				std::vector<int> & vec_NNRatioIndexes)
+			{
+				// 需要反向查询的I中的特征
+				std::vector<int> vec_queries;
+				vec_queries.reserve(vec_NNRatioIndexes.size());
+				for (size_t k = 0; k < vec_NNRatioIndexes.size(); ++k) {
+					// 没有找到近邻(索引为-1)的特征不需要反向查询
+					const int nearest = vec_nIndice10[vec_NNRatioIndexes[k] * nearest_neighbor_num];
+					if (nearest >= 0)
+						vec_queries.push_back(nearest);
 				}
+				std::sort(vec_queries.begin(), vec_queries.end());
+				vec_queries.erase(std::unique(vec_queries.begin(), vec_queries.end()), vec_queries.end());
+				if (vec_queries.empty())
+					return;
+
+				QueryDescsT vec_query_descs(vec_queries.size());
+				for (size_t k = 0; k < vec_queries.size(); ++k)
+					vec_query_descs[k] = descriptorsI[vec_queries[k]];
+
+				std::vector<int> vec_nIndice01;
+				std::vector<typename MatcherT::DistanceType> vec_fDistance01;
+				matcherJ.SearchNeighbours(reinterpret_cast<const typename QueryDescsT::value_type::bin_type *>(&vec_query_descs[0]),
+					vec_query_descs.size(), &vec_nIndice01, &vec_fDistance01, 1);
+
+				// 未查询的特征没有反向的最近邻
+				std::vector<int> vec_reverse_matches(featureSetI_Size * nearest_neighbor_num, -1);
+				for (size_t k = 0; k < vec_queries.size() && k < vec_nIndice01.size(); ++k)
+					vec_reverse_matches[vec_queries[k] * nearest_neighbor_num] = vec_nIndice01[k];
+
+				std::vector<int> vec_symmetric_indexes, vec_indexes;
+				SymmetricMatches(vec_nIndice10, vec_reverse_matches, nearest_neighbor_num, vec_symmetric_indexes);
+				IntersectMatches(vec_NNRatioIndexes.begin(), vec_NNRatioIndexes.end(),
+					vec_symmetric_indexes.begin(), vec_symmetric_indexes.end(), vec_indexes);
+				vec_NNRatioIndexes.swap(vec_indexes);
 			}
 
-		private:
-			std::map<size_t, std::vector<FeatureT> > map_features;//!< 每幅图像的所有特征
-			std::map<size_t, DescsT > map_descriptors;//!< 每幅图像所有特征描述符
 			float distance_ratio;//!<距离的比率用于排除一些虚假的匹配
+			bool is_symmetric_;//!< 是否只保留互为最近邻的匹配
+			bool is_save_index_;//!< 是否将索引保存到文件
+			size_t block_size_;//!< 分块调度时图像块的大小
+			std::shared_ptr<RegionCacheT> region_cache_;//!< 每幅图像的特征及描述子
+			std::shared_ptr<IndexRegistryT> index_registry_;//!< 每幅图像描述子的索引
+			std::shared_ptr<QueryCacheT> query_cache_;//!< 查询的描述子，为空时使用建立索引的描述子
 		};
 	}// namespace feature
 } // namespace mvg
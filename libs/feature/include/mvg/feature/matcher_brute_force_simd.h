@@ -0,0 +1,319 @@
+﻿#ifndef MVG_FEATURE_MATCHER_BRUTE_FORCE_SIMD_H_
+#define MVG_FEATURE_MATCHER_BRUTE_FORCE_SIMD_H_
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <mvg/config.h>
+#include "mvg/feature/matching_interface.h"
+#include "mvg/feature/metric.h"
+
+namespace mvg {
+	namespace feature {
+
+		/**
+		 * \brief	计算4个查询与一个数据的点积，数据已经扩展为16位整数并补零到16的倍数
+		 *
+		 * \param	query		 	4个查询，依次存储
+		 * \param	query_stride 	相邻两个查询之间的间隔(元素个数)
+		 * \param	row			 	数据
+		 * \param	padded_dimension	补零后的维度，必须是16的倍数
+		 * \param [out]	dots		4个点积
+		 *
+		 * 运行时根据处理器选择SSE2/AVX2的实现
+		 */
+		inline void DotProducts4I16(const short *query, size_t query_stride,
+			const short *row, int padded_dimension, int *dots)
+		{
+			GetMetricKernels().dot_products4_i16(query, query_stride, row, padded_dimension, dots);
+		}
+
+		/**
+		 * \brief	在k近邻数组中插入一个候选，数组按距离升序排列，距离相同时索引小的在前
+		 */
+		template <typename DistanceType>
+		inline void InsertNeighbour(DistanceType distance, int index,
+			DistanceType *best_distances, int *best_indices, int k)
+		{
+			int pos = k - 1;
+			while (pos > 0 && best_distances[pos - 1] > distance) {
+				best_distances[pos] = best_distances[pos - 1];
+				best_indices[pos] = best_indices[pos - 1];
+				--pos;
+			}
+			best_distances[pos] = distance;
+			best_indices[pos] = index;
+		}
+
+		/**
+		 * \brief	分块暴力匹配的计算核心，默认直接使用度量计算每一对的距离
+		 */
+		template <typename Scalar, typename Metric>
+		class BruteForceKernel
+		{
+		public:
+			typedef typename Metric::ResultType DistanceType;
+
+			enum
+			{
+				kQueryBlock = 32,       //!< 每块查询的个数
+				kDatasetBlock = 256     //!< 每块数据的个数
+			};
+
+			BruteForceKernel() : dataset_(NULL), rows_num_(0), dimension_(0) {}
+
+			void Build(const Scalar *dataset, int rows_num, int dimension)
+			{
+				dataset_ = dataset;
+				rows_num_ = rows_num;
+				dimension_ = dimension;
+			}
+
+			/**
+			 * \brief	分块计算距离，维护每个查询的k近邻，可以被多个线程同时调用
+			 *
+			 * \param	query			 	查询数据
+			 * \param	query_num		 	查询的个数
+			 * \param [out]	indices  	每个查询k个近邻的索引，大小为query_num*k
+			 * \param [out]	distances	每个查询k个近邻的距离，大小为query_num*k
+			 * \param	k				 	近邻的个数
+			 */
+			void Search(const Scalar *query, int query_num,
+				int *indices, DistanceType *distances, int k) const
+			{
+				Metric metric;
+				std::fill(distances, distances + query_num * k, std::numeric_limits<DistanceType>::max());
+				std::fill(indices, indices + query_num * k, -1);
+
+				for (int q_begin = 0; q_begin < query_num; q_begin += kQueryBlock) {
+					const int q_end = std::min(q_begin + int(kQueryBlock), query_num);
+					for (int d_begin = 0; d_begin < rows_num_; d_begin += kDatasetBlock) {
+						const int d_end = std::min(d_begin + int(kDatasetBlock), rows_num_);
+						for (int q = q_begin; q < q_end; ++q) {
+							const Scalar *query_row = query + size_t(q) * dimension_;
+							DistanceType *best_distances = distances + q * k;
+							int *best_indices = indices + q * k;
+							for (int r = d_begin; r < d_end; ++r) {
+								const DistanceType distance =
+									metric(query_row, dataset_ + size_t(r) * dimension_, dimension_);
+								if (distance < best_distances[k - 1])
+									InsertNeighbour(distance, r, best_distances, best_indices, k);
+							}
+						}
+					}
+				}
+			}
+
+		private:
+			const Scalar *dataset_;
+			int rows_num_;
+			int dimension_;
+		};
+
+		/**
+		 * \brief	unsigned char的欧式距离平方，展开为|q|^2 + |r|^2 - 2q·r，
+		 *			数据在Build时扩展为16位整数并计算模长，
+		 *			每次读取一个数据与4个查询同时计算点积，结果为精确的整数距离
+		 */
+		template <>
+		class BruteForceKernel < unsigned char, SquaredEuclideanDistanceSimple<unsigned char> >
+		{
+		public:
+			typedef SquaredEuclideanDistanceSimple<unsigned char>::ResultType DistanceType;
+
+			enum
+			{
+				kQueryBlock = 32,       //!< 每块查询的个数，必须是4的倍数
+				kDatasetBlock = 256     //!< 每块数据的个数，128维时为64KB
+			};
+
+			BruteForceKernel() : rows_num_(0), dimension_(0), padded_dimension_(0) {}
+
+			void Build(const unsigned char *dataset, int rows_num, int dimension)
+			{
+				rows_num_ = rows_num;
+				dimension_ = dimension;
+				padded_dimension_ = (dimension + 15) & ~15;
+				widened_dataset_.assign(size_t(rows_num) * padded_dimension_, 0);
+				norms_.resize(rows_num);
+				for (int r = 0; r < rows_num; ++r)
+					norms_[r] = Widen(dataset + size_t(r) * dimension, &widened_dataset_[size_t(r) * padded_dimension_]);
+			}
+
+			void Search(const unsigned char *query, int query_num,
+				int *indices, DistanceType *distances, int k) const
+			{
+				std::fill(distances, distances + query_num * k, std::numeric_limits<DistanceType>::max());
+				std::fill(indices, indices + query_num * k, -1);
+				const MetricKernels & kernels = GetMetricKernels();
+
+				// 每次调用只分配一块查询的缓冲，不足4个的查询用零补齐
+				std::vector<short> query_block(size_t(kQueryBlock) * padded_dimension_);
+				int query_norms[kQueryBlock];
+				int dots[4];
+
+				for (int q_begin = 0; q_begin < query_num; q_begin += kQueryBlock) {
+					const int q_end = std::min(q_begin + int(kQueryBlock), query_num);
+					const int q_count = q_end - q_begin;
+					const int q_padded = (q_count + 3) & ~3;
+					for (int q = 0; q < q_padded; ++q) {
+						short *widened = &query_block[size_t(q) * padded_dimension_];
+						if (q < q_count) {
+							query_norms[q] = Widen(query + size_t(q_begin + q) * dimension_, widened);
+						}
+						else {
+							std::fill(widened, widened + padded_dimension_, short(0));
+							query_norms[q] = 0;
+						}
+					}
+
+					for (int d_begin = 0; d_begin < rows_num_; d_begin += kDatasetBlock) {
+						const int d_end = std::min(d_begin + int(kDatasetBlock), rows_num_);
+						for (int q = 0; q < q_padded; q += 4) {
+							const short *query_rows = &query_block[size_t(q) * padded_dimension_];
+							const int valid = std::min(4, q_count - q);
+							for (int r = d_begin; r < d_end; ++r) {
+								kernels.dot_products4_i16(query_rows, padded_dimension_,
+									&widened_dataset_[size_t(r) * padded_dimension_], padded_dimension_, dots);
+								for (int j = 0; j < valid; ++j) {
+									// 距离不超过dimension*255*255，可以用float精确表示
+									const DistanceType distance =
+										static_cast<DistanceType>(query_norms[q + j] + norms_[r] - 2 * dots[j]);
+									const int offset = (q_begin + q + j) * k;
+									if (distance < distances[offset + k - 1])
+										InsertNeighbour(distance, r, distances + offset, indices + offset, k);
+								}
+							}
+						}
+					}
+				}
+			}
+
+		private:
+			/**	扩展为16位整数，补零到padded_dimension_，返回模长的平方
+			 */
+			int Widen(const unsigned char *src, short *dst) const
+			{
+				int norm = 0;
+				for (int i = 0; i < dimension_; ++i) {
+					dst[i] = src[i];
+					norm += int(src[i]) * int(src[i]);
+				}
+				for (int i = dimension_; i < padded_dimension_; ++i)
+					dst[i] = 0;
+				return norm;
+			}
+
+			std::vector<short> widened_dataset_;    //!< 扩展为16位整数的数据，每行补零到padded_dimension_
+			std::vector<int> norms_;                //!< 每个数据模长的平方
+			int rows_num_;
+			int dimension_;
+			int padded_dimension_;
+		};
+
+		template <>
+		class BruteForceKernel < unsigned char, SquaredEuclideanDistanceVectorized<unsigned char> >
+			: public BruteForceKernel < unsigned char, SquaredEuclideanDistanceSimple<unsigned char> >
+		{
+		};
+
+		/**
+		 * \brief	分块的暴力匹配，结果与ArrayMatcherBruteForce相同(精确的k近邻)
+		 *			查询向量和数据集按块处理，使数据集的一块可以留在缓存中被多个查询重复使用，
+		 *			每个查询的k近邻直接在输出数组中维护，查询过程中不为每个查询分配内存。
+		 *			unsigned char的欧式距离使用整数点积计算，运行时根据处理器选择SSE2/AVX2的实现，
+		 *			可以作为MatcherAllInMemory的MatcherT使用，Build之后可以被多个线程同时查询。
+		 *
+		 * \tparam	Scalar	数组元素类型，默认unsigned char
+		 * \tparam	Metric	匹配距离类型，默认采用欧式距离的平方
+		 */
+		template < typename Scalar = unsigned char, typename Metric = SquaredEuclideanDistanceSimple<Scalar> >
+		class ArrayMatcherBruteForceSIMD : public ArrayMatcher < Scalar, Metric >
+		{
+		public:
+			typedef typename Metric::ResultType DistanceType;
+
+			ArrayMatcherBruteForceSIMD() : is_built_(false), rows_num_(0) {}
+			virtual ~ArrayMatcherBruteForceSIMD() {}
+
+			/**
+			* 建立匹配的结构，数据在匹配期间必须有效
+			*
+			* \param[in] dataset   输入数据
+			* \param[in] rows_num  组件数组的数目（相当于矩阵行数）
+			* \param[in] dimension 每个组件数组的维度（相当于矩阵的列数）
+			*
+			* \return True if success.
+			*/
+			bool Build(const Scalar * dataset, int rows_num, int dimension)
+			{
+				is_built_ = false;
+				rows_num_ = 0;
+				if (rows_num < 1 || dimension < 1)
+					return false;
+				kernel_.Build(dataset, rows_num, dimension);
+				rows_num_ = rows_num;
+				is_built_ = true;
+				return true;
+			}
+
+			/**
+			 * 在待查询的数组中寻找最近邻的数组
+			 *
+			 * \param[in]   query     待查询的数组
+			 * \param[out]  indice    被计算为最近邻的多维数组的索引
+			 * \param[out]  distance  两个数组之间的距离.
+			 *
+			 * \return True if success.
+			 */
+			bool SearchNeighbour(const Scalar *query,
+				int *indice, DistanceType *distance)
+			{
+				if (!is_built_)
+					return false;
+				kernel_.Search(query, 1, indice, distance, 1);
+				return true;
+			}
+
+			/**
+			 * \brief	在待查询的数组中寻找多个最近邻的数组(k近邻)，结果按距离升序追加到输出中
+			 *
+			 * \param [in]	query		 	待查询的所有数组.
+			 * \param [in]	query_num		匹配查询的数组数目
+			 * \param [out]	vec_indice   	被计算为最近邻的多维数组的索引,这边为最近邻的个数
+			 * \param [out]	vec_distance	匹配数组之间的距离，这边为最近邻的个数
+			 * \param [out]	nearest_neighbor_num	最近邻的数目k
+			 *
+			 * \return	True if success.
+			 */
+			bool SearchNeighbours(const Scalar *query, int query_num,
+				std::vector<int> * vec_indice,
+				std::vector<DistanceType> * vec_distance,
+				size_t nearest_neighbor_num)
+			{
+				if (!is_built_ || nearest_neighbor_num < 1
+					|| nearest_neighbor_num > size_t(rows_num_) || query_num < 1) {
+					std::cerr << "Too much asked nearest neighbors" << std::endl;
+					return false;
+				}
+
+				const size_t offset = vec_indice->size();
+				vec_indice->resize(offset + query_num * nearest_neighbor_num);
+				vec_distance->resize(offset + query_num * nearest_neighbor_num);
+				kernel_.Search(query, query_num, &(*vec_indice)[offset], &(*vec_distance)[offset],
+					static_cast<int>(nearest_neighbor_num));
+				return true;
+			}
+
+		private:
+			BruteForceKernel<Scalar, Metric> kernel_;//!< 计算核心
+			bool is_built_;//!< 是否已经建立
+			int rows_num_;//!< 数据的个数
+		};
+
+	}  // namespace feature
+}  // namespace mvg
+
+#endif // MVG_FEATURE_MATCHER_BRUTE_FORCE_SIMD_H_
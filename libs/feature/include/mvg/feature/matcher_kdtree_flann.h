@@ -2,8 +2,10 @@
 #define MVG_FEATURE_MATCHER_KDTREE_FLANN_H_
 
 #include <memory>
+#include <string>
 #include "flann/flann.h"
 #include "mvg/feature/matching_interface.h"
+#include "mvg/utils/file_system.h"
 
 namespace mvg {
 	namespace feature  {
@@ -18,7 +20,7 @@ namespace mvg {
 		public:
 			typedef typename Metric::ResultType DistanceType;
 
-			ArrayMatcherKdtreeFlann() {}
+			ArrayMatcherKdtreeFlann() : _dimension(0) {}
 
 			virtual ~ArrayMatcherKdtreeFlann()  {
 				_datasetM.reset();
@@ -53,6 +55,59 @@ namespace mvg {
 				return false;
 			}
 
+			/**
+			 * 从FLANN保存的索引文件读取kd树，不需要重新建立
+			 *
+			 * \param[in] dataset    输入数据，必须与建立索引时的数据相同
+			 * \param[in] rows_num   组件的数目
+			 * \param[in] dimension  在数据集中每一行数据的长度
+			 * \param[in] index_file 索引文件名
+			 *
+			 * \return 文件不存在或者与数据不一致时返回false
+			 */
+			bool Load(const Scalar *dataset, int rows_num, int dimension,
+				const std::string & index_file)
+			{
+				_index.reset();
+				if (rows_num < 1 || !mvg::utils::file_exists(index_file))
+					return false;
+
+				_datasetM = std::shared_ptr< flann::Matrix<Scalar> >(
+					new flann::Matrix<Scalar>((Scalar*)dataset, rows_num, dimension));
+				try {
+					std::shared_ptr< flann::Index<Metric> > index(
+						new flann::Index<Metric>(*_datasetM, flann::SavedIndexParams(index_file)));
+					if (index->size() != size_t(rows_num) || index->veclen() != size_t(dimension))
+						return false;
+					_index = index;
+				}
+				catch (const flann::FLANNException &) {
+					return false;
+				}
+				_dimension = dimension;
+				return true;
+			}
+
+			/**
+			 * 保存kd树到文件，文件中不包含数据本身
+			 *
+			 * \param[in] index_file 索引文件名
+			 *
+			 * \return True if success.
+			 */
+			bool Save(const std::string & index_file) const
+			{
+				if (_index.get() == NULL)
+					return false;
+				try {
+					_index->save(index_file);
+				}
+				catch (const flann::FLANNException &) {
+					return false;
+				}
+				return true;
+			}
+
 			/**
 			 * Search the nearest Neighbor of the scalar array query.
 			 *
@@ -0,0 +1,158 @@
+﻿#ifndef MVG_FEATURE_MATCHER_LSH_FLANN_H_
+#define MVG_FEATURE_MATCHER_LSH_FLANN_H_
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "flann/flann.h"
+#include "mvg/feature/matching_interface.h"
+#include "mvg/feature/metric.h"
+
+namespace mvg {
+	namespace feature  {
+
+		/**	FLANN的汉明距离不是平方，比率直接比较
+		 */
+		template<class T>
+		struct MetricTraits < flann::Hamming<T> >
+		{
+			static const bool kIsSquared = false;
+		};
+
+		/** 二进制描述子的FLANN多探针LSH匹配，描述子按字节存储(例如BinaryDescriptor)，
+		* 使用汉明距离(flann::Hamming<unsigned char>)。结果是近似的k近邻，
+		* 找到的近邻少于k个时，剩余的索引为-1，距离为最大值。
+		* 可以作为MatcherAllInMemory的MatcherT使用，图像个数较多时比暴力匹配更快
+		*/
+		template < typename Scalar = unsigned char, typename  Metric = flann::Hamming<Scalar> >
+		class ArrayMatcherLshFlann : public ArrayMatcher < Scalar, Metric >
+		{
+		public:
+			typedef typename Metric::ResultType DistanceType;
+
+			/**
+			 * \brief	构造函数，参数参考flann::LshIndexParams
+			 *
+			 * \param	table_number	 	哈希表的个数
+			 * \param	key_size		 	哈希键的位数
+			 * \param	multi_probe_level	多探针的层数，0为标准LSH
+			 */
+			ArrayMatcherLshFlann(unsigned int table_number = 6, unsigned int key_size = 12,
+				unsigned int multi_probe_level = 1)
+				: _dimension(0), _table_number(table_number), _key_size(key_size),
+				_multi_probe_level(multi_probe_level) {}
+
+			virtual ~ArrayMatcherLshFlann()  {
+				_datasetM.reset();
+				_index.reset();
+			}
+
+			/**
+			 * 构建匹配的结构
+			 *
+			 * \param[in] dataset  输入数据
+			 * \param[in] rows_num  组件的数目
+			 * \param[in] dimension 在数据集中每一行数据的长度(字节数)
+			 *
+			 * \return True if success.
+			 */
+			bool Build(const Scalar *dataset, int rows_num, int dimension)  {
+
+				if (rows_num > 0)
+				{
+					_dimension = dimension;
+					_datasetM = std::shared_ptr< flann::Matrix<Scalar> >(
+						new flann::Matrix<Scalar>((Scalar*)dataset, rows_num, dimension));
+
+					_index = std::shared_ptr< flann::Index<Metric> >(
+						new flann::Index<Metric>(*_datasetM,
+						flann::LshIndexParams(_table_number, _key_size, _multi_probe_level)));
+					(*_index).buildIndex();
+
+					return true;
+				}
+				return false;
+			}
+
+			/**
+			 * Search the nearest Neighbor of the scalar array query.
+			 *
+			 * \param[in]   query     The query array
+			 * \param[out]  indice    The indice of array in the dataset that
+			 *  have been computed as the nearest array, -1 if none was found.
+			 * \param[out]  distance  The distance between the two arrays.
+			 *
+			 * \return True if success.
+			 */
+			bool SearchNeighbour(const Scalar * query, int * indice, DistanceType * distance)
+			{
+				if (_index.get() == NULL)
+					return false;
+				*indice = -1;
+				*distance = std::numeric_limits<DistanceType>::max();
+				flann::Matrix<Scalar> queries((Scalar*)query, 1, _dimension);
+				flann::Matrix<int> indices(indice, 1, 1);
+				flann::Matrix<DistanceType> dists(distance, 1, 1);
+				(*_index).knnSearch(queries, indices, dists, 1, flann::SearchParams());
+				ResetMissingIndices(indice, distance, 1);
+				return true;
+			}
+
+			/**
+			 * Search the N nearest Neighbor of the scalar array query.
+			 *
+			 * \param[in]   query     The query array
+			 * \param[in]   query_num   The number of query rows
+			 * \param[out]  indice    For each "query" it save the index of the "nearest_neighbor_num"
+			 * nearest entry in the dataset (provided in Build).
+			 * \param[out]  distance  The distances between the matched arrays.
+			 * \param[out]  nearest_neighbor_num        The number of maximal neighbor that will be searched.
+			 *
+			 * \return True if success.
+			 */
+			bool SearchNeighbours(const Scalar * query, int query_num,
+				std::vector<int> * vec_indice,
+				std::vector<DistanceType> * vec_distance,
+				size_t nearest_neighbor_num)
+			{
+				if (_index.get() == NULL || query_num < 1)
+					return false;
+
+				// LSH可能找不到k个近邻，未填充的位置保持无效值
+				vec_indice->assign(query_num * nearest_neighbor_num, -1);
+				vec_distance->assign(query_num * nearest_neighbor_num, std::numeric_limits<DistanceType>::max());
+
+				flann::Matrix<Scalar> queries((Scalar*)query, query_num, _dimension);
+				flann::Matrix<int> indices(&(*vec_indice)[0], query_num, nearest_neighbor_num);
+				flann::Matrix<DistanceType> dists(&(*vec_distance)[0], query_num, nearest_neighbor_num);
+				(*_index).knnSearch(queries, indices, dists, nearest_neighbor_num, flann::SearchParams());
+				ResetMissingIndices(&(*vec_indice)[0], &(*vec_distance)[0], query_num * nearest_neighbor_num);
+				return true;
+			}
+
+		private:
+
+			/**
+			 * \brief	FLANN的Matrix<int>接口把未找到的近邻也从未初始化的缓冲中复制出来，
+			 *			距离只写入找到的近邻，仍为最大值的位置把索引重置为-1
+			 */
+			static void ResetMissingIndices(int *indices, const DistanceType *distances, size_t count)
+			{
+				for (size_t i = 0; i < count; ++i)
+					if (distances[i] == std::numeric_limits<DistanceType>::max())
+						indices[i] = -1;
+			}
+
+			std::shared_ptr< flann::Matrix<Scalar> > _datasetM;
+			std::shared_ptr< flann::Index<Metric> > _index;
+			size_t _dimension;
+			unsigned int _table_number;
+			unsigned int _key_size;
+			unsigned int _multi_probe_level;
+		};
+
+	} // namespace feature
+} // namespace mvg
+
+#endif // MVG_FEATURE_MATCHER_LSH_FLANN_H_
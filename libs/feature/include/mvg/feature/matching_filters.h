@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <limits>
 #include <set>
 #include <vector>
 
@@ -14,7 +15,8 @@ namespace mvg {
 
 		/**
 		  * 通过最近距离除以次近的距离少于某个比例阈值来进行过滤 ( a < ratio * b) :
-		  * 降低这个比例阈值，匹配点数目会减少，但更加稳定
+		  * 降低这个比例阈值，匹配点数目会减少，但更加稳定。
+		  * 次近邻不存在(距离为最大值，例如LSH的桶中少于2个候选)时无法判断匹配是否有歧义，不保留
 		  *
 		  * \param[in]  first    距离序列迭代的开始
 		  * \param[in]  last     距离序列迭代的结束
@@ -32,6 +34,7 @@ namespace mvg {
 			float ratio = 0.6f) 
 		{
 			assert(nearest_neighbor_num >= 2);
+			typedef typename std::iterator_traits<DataInputIterator>::value_type DistanceT;
 
 			vec_after_ratio_index.clear();
 			const size_t n = std::distance(first, last);
@@ -41,7 +44,7 @@ namespace mvg {
 				DataInputIterator iter2 = iter;
 				std::advance(iter2, 1);
 				//不管nearest_neighbor_num的数目，只考虑最近邻与次近邻的比值
-				if ((*iter) < ratio * (*iter2))
+				if ((*iter2) != (std::numeric_limits<DistanceT>::max)() && (*iter) < ratio * (*iter2))
 					vec_after_ratio_index.push_back(static_cast<int>(i));
 			}
 		}
@@ -52,6 +55,7 @@ namespace mvg {
 		  * Suppose matches from dataset B to A stored in vec_reversematches
 		  * A matches is kept if (i == vec_reversematches[vec_matches[i]])
 		  * If nearest_neighbor_num > 1 => Only the major matches are considered.
+		  * Negative indexes (no neighbour found, e.g. LSH with empty buckets) are skipped.
 		  *
 		  * \param[in]  first    matches from A to B.
 		  * \param[in]  last     matches from B to A.
@@ -71,6 +75,9 @@ namespace mvg {
 			int index = 0;
 			for (size_t i = 0; i < vec_matches.size(); i += nearest_neighbor_num, ++index)
 			{
+				// 近似匹配(例如LSH)没有找到近邻时索引为-1
+				if (vec_matches[i] < 0)
+					continue;
 				// Add the match only if we have a symmetric result.
 				if (index == vec_reversematches[vec_matches[i] * nearest_neighbor_num])  {
 					vec_goodIndex.push_back(index);
@@ -1,6 +1,7 @@
 ﻿#ifndef MVG_FEATURE_MATCHING_INTERFACE_H_
 #define MVG_FEATURE_MATCHING_INTERFACE_H_
 
+#include <string>
 #include <vector>
 #include "mvg/math/numeric.h"
 
@@ -61,6 +62,35 @@ namespace mvg {
 				std::vector<int> * vec_indice,
 				std::vector<DistanceType> * vec_distance,
 				size_t nearest_neighbor_num) = 0;
+
+			/**
+			 * \brief	从文件读取已经建立的索引，代替Build，数据必须与建立索引时相同。
+			 *			默认不支持索引文件，返回false
+			 *
+			 * \param	dataset   	输入数据
+			 * \param	rows_num  	组件的数目
+			 * \param	dimension 	每个组件的维度
+			 * \param	index_file	索引文件名
+			 *
+			 * \return	True if success.
+			 */
+			virtual bool Load(const Scalar *dataset, int rows_num, int dimension,
+				const std::string & index_file)
+			{
+				return false;
+			}
+
+			/**
+			 * \brief	将建立的索引保存到文件，默认不支持索引文件，返回false
+			 *
+			 * \param	index_file	索引文件名
+			 *
+			 * \return	True if success.
+			 */
+			virtual bool Save(const std::string & index_file) const
+			{
+				return false;
+			}
 		};
 
 	}  // namespace feature
@@ -1,9 +1,13 @@
 ﻿#ifndef MVG_FEATURE_METRIC_H_
 #define MVG_FEATURE_METRIC_H_
 
+#include <cstddef>
+
+#include <mvg/system/cpu_features.h>
+#include "mvg/feature/link_pragmas.h"
+
 namespace mvg {
 	namespace feature {
-		//TODO:这边可以采用SSE，后续添加
 		template<typename T>
 		struct Accumulator { typedef T Type; };
 		template<>
@@ -81,6 +85,166 @@ namespace mvg {
 			}
 		};
 
+		/**
+		 * \brief	简单的计算汉明距离，即两个向量异或之后1的个数
+		 *
+		 * \tparam	T	参数类型，必须是无符号整数
+		 */
+		template<class T>
+		struct HammingDistanceSimple
+		{
+			typedef T ElementType;
+			typedef unsigned int ResultType;
+
+			template <typename Iterator1, typename Iterator2>
+			ResultType operator()(Iterator1 a, Iterator2 b, size_t size) const
+			{
+				ResultType result = 0;
+				for (size_t i = 0; i < size; ++i) {
+					T diff = static_cast<T>(*a++ ^ *b++);
+					while (diff) {
+						diff &= static_cast<T>(diff - 1);
+						++result;
+					}
+				}
+				return result;
+			}
+		};
+
+		/**
+		 * \brief	一组SIMD实现的距离函数，同一组函数使用相同的指令集
+		 */
+		struct MetricKernels
+		{
+			mvg::system::SimdLevel level;   //!< 使用的指令集
+			int (*squared_euclidean_u8)(const unsigned char *a, const unsigned char *b, size_t size);
+			float (*squared_euclidean_f32)(const float *a, const float *b, size_t size);
+			unsigned int (*hamming_u8)(const unsigned char *a, const unsigned char *b, size_t size);
+			/// 4个查询与一个数据的点积，数据为16位整数并补零到16的倍数，见DotProducts4I16
+			void (*dot_products4_i16)(const short *query, size_t query_stride,
+				const short *row, int padded_dimension, int *dots);
+		};
+
+		/**
+		 * \brief	获取指定指令集的距离函数
+		 *
+		 * \param	level	指令集
+		 *
+		 * \return	编译器或处理器不支持该指令集时返回NULL
+		 */
+		FEATURE_IMPEXP const MetricKernels * GetMetricKernels(mvg::system::SimdLevel level);
+
+		/**	运行时根据CPUID选择的最优距离函数
+		 */
+		FEATURE_IMPEXP const MetricKernels & GetMetricKernels();
+
+		/**	unsigned char向量欧式距离的平方，运行时选择指令集
+		 */
+		inline int SquaredEuclideanDistanceU8(const unsigned char *a, const unsigned char *b, size_t size)
+		{
+			return GetMetricKernels().squared_euclidean_u8(a, b, size);
+		}
+
+		/**	float向量欧式距离的平方，运行时选择指令集，累加顺序与标量版本不同，结果可能有舍入误差
+		 */
+		inline float SquaredEuclideanDistanceF32(const float *a, const float *b, size_t size)
+		{
+			return GetMetricKernels().squared_euclidean_f32(a, b, size);
+		}
+
+		/**	二进制描述子(按字节存储)的汉明距离，运行时选择指令集
+		 */
+		inline unsigned int HammingDistanceU8(const unsigned char *a, const unsigned char *b, size_t size)
+		{
+			return GetMetricKernels().hamming_u8(a, b, size);
+		}
+
+		/**
+		 * \brief	计算欧式距离的平方，运行时根据处理器选择SSE2/AVX2/AVX-512的实现，
+		 *			只支持unsigned char和float
+		 *
+		 * \tparam	T	参数类型
+		 */
+		template<class T>
+		struct SquaredEuclideanDistanceSIMD;
+
+		template<>
+		struct SquaredEuclideanDistanceSIMD < unsigned char >
+		{
+			typedef unsigned char ElementType;
+			typedef Accumulator<unsigned char>::Type ResultType;
+
+			ResultType operator()(const unsigned char *a, const unsigned char *b, size_t size) const
+			{
+				return static_cast<ResultType>(SquaredEuclideanDistanceU8(a, b, size));
+			}
+		};
+
+		template<>
+		struct SquaredEuclideanDistanceSIMD < float >
+		{
+			typedef float ElementType;
+			typedef float ResultType;
+
+			ResultType operator()(const float *a, const float *b, size_t size) const
+			{
+				return SquaredEuclideanDistanceF32(a, b, size);
+			}
+		};
+
+		/**
+		 * \brief	计算汉明距离，运行时根据处理器选择SSE2/AVX2/AVX-512的实现
+		 */
+		struct HammingDistanceSIMD
+		{
+			typedef unsigned char ElementType;
+			typedef unsigned int ResultType;
+
+			ResultType operator()(const unsigned char *a, const unsigned char *b, size_t size) const
+			{
+				return HammingDistanceU8(a, b, size);
+			}
+		};
+
+		/**
+		 * \brief	度量的性质，默认为距离的平方(欧式距离的平方)，
+		 *			最近邻距离比率的检验需要对比率取平方
+		 *
+		 * \tparam	Metric	度量类型
+		 */
+		template<class Metric>
+		struct MetricTraits
+		{
+			static const bool kIsSquared = true;   //!< 是否为距离的平方
+		};
+
+		/**	汉明距离不是平方，比率直接比较
+		 */
+		template<class T>
+		struct MetricTraits < HammingDistanceSimple<T> >
+		{
+			static const bool kIsSquared = false;
+		};
+
+		template<>
+		struct MetricTraits < HammingDistanceSIMD >
+		{
+			static const bool kIsSquared = false;
+		};
+
+		/**
+		 * \brief	按度量的性质换算最近邻距离比率的阈值
+		 *
+		 * \param	distance_ratio	距离的比率
+		 *
+		 * \return	平方度量返回比率的平方，否则返回比率本身
+		 */
+		template<class Metric>
+		inline float DistanceRatioThreshold(float distance_ratio)
+		{
+			return MetricTraits<Metric>::kIsSquared ? distance_ratio * distance_ratio : distance_ratio;
+		}
+
 	}  // namespace feature
 }  // namespace mvg
 
@@ -0,0 +1,233 @@
+﻿#ifndef MVG_FEATURE_ORB_HPP_
+#define MVG_FEATURE_ORB_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "mvg/feature/feature.h"
+#include "mvg/feature/descriptor.h"
+#include "mvg/image/image.h"
+
+#include "fast.h"
+
+namespace mvg {
+	namespace feature{
+
+		using namespace mvg::image;
+
+		/**	256位的二进制描述子，按字节存储，使用汉明距离(HammingDistanceSIMD)匹配
+		 */
+		typedef Descriptor<unsigned char, 32> BinaryDescriptor;
+
+		namespace detail {
+
+			const int kOrbPatchRadius = 15;     //!< 计算方向的圆形区域的半径
+			const int kOrbPairRadius = 13;      //!< 比较点对所在圆形区域的半径，旋转后仍在区域内
+			const int kOrbBoxRadius = 2;        //!< 比较5x5邻域的和，代替高斯平滑
+			const int kOrbBorder = kOrbPatchRadius + 1;//!< 特征点到图像边界的最小距离
+
+			/**
+			 * \brief	生成BRIEF的256个比较点对，点服从各向同性的高斯分布(Calonder et al. G II)，
+			 *			使用固定种子的线性同余生成器，每次生成的点对相同
+			 *
+			 * \param [out]	vec_pattern	每个点对依次为x1, y1, x2, y2
+			 */
+			inline void MakeBriefPattern(std::vector<int> & vec_pattern)
+			{
+				unsigned int seed = 0x2545F491u;
+				const float sigma = (2 * kOrbPatchRadius + 1) / 5.f;
+				vec_pattern.resize(256 * 4);
+				for (size_t i = 0; i < vec_pattern.size(); i += 2) {
+					int x, y;
+					do {
+						// Box-Muller变换得到两个标准正态分布的随机数
+						seed = seed * 1664525u + 1013904223u;
+						const float u1 = ((seed >> 8) + 1.f) / 16777217.f;
+						seed = seed * 1664525u + 1013904223u;
+						const float u2 = (seed >> 8) / 16777216.f;
+						const float r = sigma * std::sqrt(-2.f * std::log(u1));
+						x = static_cast<int>(std::floor(r * std::cos(6.2831853f * u2) + 0.5f));
+						y = static_cast<int>(std::floor(r * std::sin(6.2831853f * u2) + 0.5f));
+					} while (x * x + y * y > kOrbPairRadius * kOrbPairRadius);
+					vec_pattern[i] = x;
+					vec_pattern[i + 1] = y;
+				}
+			}
+
+			/**
+			 * \brief	计算积分图像，大小为(w+1)*(h+1)。使用无符号整数，
+			 *			大图像的累加和会溢出，但模2^32的差值仍然等于区域内的和
+			 */
+			inline void IntegralImage(const Image<unsigned char> & image, std::vector<unsigned int> & integral)
+			{
+				const int w = image.Width(), h = image.Height();
+				integral.assign(size_t(w + 1) * (h + 1), 0u);
+				for (int y = 0; y < h; ++y) {
+					unsigned int row_sum = 0;
+					unsigned int * cur = &integral[size_t(y + 1) * (w + 1) + 1];
+					const unsigned int * prev = &integral[size_t(y) * (w + 1) + 1];
+					for (int x = 0; x < w; ++x) {
+						row_sum += image(y, x);
+						cur[x] = prev[x] + row_sum;
+					}
+				}
+			}
+
+			/**	以(x, y)为中心的(2*kOrbBoxRadius+1)^2区域的和
+			 */
+			inline unsigned int BoxSum(const std::vector<unsigned int> & integral, int stride, int x, int y)
+			{
+				const int x0 = x - kOrbBoxRadius, x1 = x + kOrbBoxRadius + 1;
+				const int y0 = y - kOrbBoxRadius, y1 = y + kOrbBoxRadius + 1;
+				return integral[size_t(y1) * stride + x1] - integral[size_t(y0) * stride + x1]
+					- integral[size_t(y1) * stride + x0] + integral[size_t(y0) * stride + x0];
+			}
+
+			/**
+			 * \brief	灰度质心法计算特征点的方向，质心相对于中心的方向即为特征的方向
+			 *
+			 * \return	方向，单位为弧度
+			 */
+			inline float IntensityCentroidAngle(const Image<unsigned char> & image, int x, int y)
+			{
+				int m01 = 0, m10 = 0;
+				for (int dy = -kOrbPatchRadius; dy <= kOrbPatchRadius; ++dy) {
+					const int half_width = static_cast<int>(std::sqrt(float(kOrbPatchRadius * kOrbPatchRadius - dy * dy)));
+					const unsigned char * row = &image(y + dy, x);
+					int row_sum = 0;
+					for (int dx = -half_width; dx <= half_width; ++dx) {
+						m10 += dx * row[dx];
+						row_sum += row[dx];
+					}
+					m01 += dy * row_sum;
+				}
+				return std::atan2(float(m01), float(m10));
+			}
+
+			/**	按方向旋转比较点对，计算256位的描述子
+			 */
+			inline void SteeredBrief(const std::vector<unsigned int> & integral, int stride,
+				const std::vector<int> & vec_pattern, int x, int y, float angle, BinaryDescriptor & descriptor)
+			{
+				const float c = std::cos(angle), s = std::sin(angle);
+				for (int byte = 0; byte < 32; ++byte) {
+					unsigned char value = 0;
+					for (int bit = 0; bit < 8; ++bit) {
+						const int * p = &vec_pattern[(byte * 8 + bit) * 4];
+						const int x1 = x + static_cast<int>(std::floor(c * p[0] - s * p[1] + 0.5f));
+						const int y1 = y + static_cast<int>(std::floor(s * p[0] + c * p[1] + 0.5f));
+						const int x2 = x + static_cast<int>(std::floor(c * p[2] - s * p[3] + 0.5f));
+						const int y2 = y + static_cast<int>(std::floor(s * p[2] + c * p[3] + 0.5f));
+						if (BoxSum(integral, stride, x1, y1) < BoxSum(integral, stride, x2, y2))
+							value |= static_cast<unsigned char>(1 << bit);
+					}
+					descriptor[byte] = value;
+				}
+			}
+		} // namespace detail
+
+		/**
+		 * \brief	ORB特征检测：图像金字塔每层用FAST-9检测角点并做非极大值抑制，
+		 *			按FAST响应保留每层的最强角点，灰度质心法计算方向，
+		 *			按方向旋转的BRIEF点对比较5x5邻域的和，得到256位的二进制描述子。
+		 *			提取和匹配的代价远小于SIFT，适合视频和跟踪。
+		 *
+		 *  \code
+		 *   std::vector<ScalePointFeature> feats;
+		 *   std::vector<BinaryDescriptor> descs;
+		 *   ORBDetector(image, feats, descs);
+		 *   ArrayMatcherBruteForceSIMD<unsigned char, HammingDistanceSIMD> matcher;
+		 *   matcher.Build(descs[0].getData(), descs.size(), BinaryDescriptor::kStaticSize);
+		 *  \endcode
+		 *
+		 * \param	image			  	输入图像
+		 * \param [in,out]	feats	  	输出特征，坐标为原图坐标，尺度为计算方向的区域在原图上的半径，方向为弧度
+		 * \param [in,out]	descs	  	输出特征描述子
+		 * \param	max_features	  	所有层保留的特征总数，按每层的面积分配
+		 * \param	fast_threshold	  	FAST的阈值，中心与圆周像素灰度差的阈值
+		 * \param	num_levels		  	金字塔的层数，每层缩小2倍
+		 *
+		 * \return	true if it succeeds, false if it fails.
+		 */
+		static bool ORBDetector(const Image<unsigned char>& image,
+			std::vector<ScalePointFeature>& feats,
+			std::vector<BinaryDescriptor>& descs,
+			int max_features = 2000,
+			int fast_threshold = 20,
+			int num_levels = 4)
+		{
+			if (max_features < 1 || num_levels < 1)
+				return false;
+
+			std::vector<int> vec_pattern;
+			detail::MakeBriefPattern(vec_pattern);
+
+			// 每层分配的特征个数与面积成正比
+			std::vector<int> vec_level_features(num_levels);
+			float area_sum = 0.f;
+			for (int level = 0; level < num_levels; ++level)
+				area_sum += std::pow(0.25f, level);
+			for (int level = 0; level < num_levels; ++level)
+				vec_level_features[level] = static_cast<int>(std::ceil(max_features * std::pow(0.25f, level) / area_sum));
+
+			Image<unsigned char> level_image = image;
+			std::vector<unsigned int> integral;
+			BinaryDescriptor descriptor;
+			int remaining = max_features;
+			for (int level = 0; level < num_levels && remaining > 0; ++level) {
+				if (level > 0) {
+					Image<unsigned char> half_image;
+					DownsampleChannelsBy2(level_image, &half_image);
+					level_image = half_image;
+				}
+				const int w = level_image.Width(), h = level_image.Height();
+				if (w <= 2 * detail::kOrbBorder || h <= 2 * detail::kOrbBorder)
+					break;
+
+				int num_corners = 0;
+				xy * corners = fast9_detect_nonmax(level_image.data(), w, h, w, fast_threshold, &num_corners);
+				int * scores = num_corners > 0 ? fast9_score(level_image.data(), w, corners, num_corners, fast_threshold) : NULL;
+
+				// 去掉靠近边界的角点，按响应降序排列
+				std::vector<std::pair<int, int> > vec_candidates;
+				for (int i = 0; i < num_corners; ++i) {
+					const int x = corners[i].x, y = corners[i].y;
+					if (x >= detail::kOrbBorder && y >= detail::kOrbBorder
+						&& x < w - detail::kOrbBorder && y < h - detail::kOrbBorder)
+						vec_candidates.push_back(std::make_pair(-scores[i], i));
+				}
+				const size_t count = std::min<size_t>(vec_candidates.size(),
+					std::min(vec_level_features[level], remaining));
+				std::partial_sort(vec_candidates.begin(), vec_candidates.begin() + count, vec_candidates.end());
+
+				detail::IntegralImage(level_image, integral);
+				const float level_scale = static_cast<float>(1 << level);
+				for (size_t k = 0; k < count; ++k) {
+					const xy & corner = corners[vec_candidates[k].second];
+					const float angle = detail::IntensityCentroidAngle(level_image, corner.x, corner.y);
+					detail::SteeredBrief(integral, w + 1, vec_pattern, corner.x, corner.y, angle, descriptor);
+
+					// 像素中心对齐变换到原图坐标
+					ScalePointFeature fp;
+					fp.x() = (corner.x + 0.5f) * level_scale - 0.5f;
+					fp.y() = (corner.y + 0.5f) * level_scale - 0.5f;
+					fp.scale() = detail::kOrbPatchRadius * level_scale;
+					fp.orientation() = angle;
+					feats.push_back(fp);
+					descs.push_back(descriptor);
+				}
+				remaining -= static_cast<int>(count);
+
+				free(corners);
+				free(scores);
+			}
+			return true;
+		}
+
+	}// namespace feature
+} // namespace mvg
+
+#endif // MVG_FEATURE_ORB_HPP_
@@ -0,0 +1,304 @@
+﻿#ifndef MVG_FEATURE_PAIR_SELECTION_VLAD_H_
+#define MVG_FEATURE_PAIR_SELECTION_VLAD_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "flann/flann.h"
+#include "mvg/feature/metric.h"
+#include "mvg/feature/region_cache.h"
+
+namespace mvg {
+	namespace feature {
+
+		/**
+		 * \brief	基于VLAD全局描述子的图像对预选，代替所有图像对的穷举匹配。
+		 *			从所有图像的描述子中采样，用FLANN的k-means计算视觉词典；
+		 *			每幅图像的描述子对最近的视觉单词累加残差，得到一个归一化的全局向量；
+		 *			全局向量建立FLANN的kd树索引，每幅图像只与全局向量最相似的top_k幅图像组成候选图像对，
+		 *			检索和之后的匹配、几何过滤的图像对个数都与图像个数近似成线性关系。
+		 *
+		 *  \code
+		 *   VladPairSelector<RegionCacheT> selector(region_cache);
+		 *   std::vector<std::pair<size_t, size_t> > vec_pairs;
+		 *   if (selector.selectPairs(file_names.size(), 20, vec_pairs))
+		 *     collectionMatcher.Match(file_names, vec_pairs, map_putatives_matches);
+		 *  \endcode
+		 *
+		 * \tparam	RegionCacheT	特征及描述子缓存的类型
+		 */
+		template <typename RegionCacheT>
+		class VladPairSelector
+		{
+		public:
+			typedef std::vector<std::pair<size_t, size_t> > PairsT;
+
+			/**
+			 * \brief	构造函数
+			 *
+			 * \param	region_cache	 	提供描述子的缓存
+			 * \param	word_count		 	视觉单词的个数
+			 * \param	max_sample_count 	训练词典时采样的描述子总数的上限
+			 */
+			explicit VladPairSelector(const std::shared_ptr<RegionCacheT> & region_cache,
+				size_t word_count = 64, size_t max_sample_count = 100000)
+				: region_cache_(region_cache), word_count_(word_count), max_sample_count_(max_sample_count) {}
+
+			/**
+			 * \brief	从前image_count幅图像均匀采样描述子，用k-means计算视觉词典
+			 *
+			 * \return	描述子个数少于视觉单词个数时返回false
+			 */
+			bool computeVocabulary(size_t image_count)
+			{
+				const size_t samples_per_image = std::max<size_t>(1, max_sample_count_ / std::max<size_t>(1, image_count));
+				std::vector<std::vector<float> > vec_samples(image_count);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int i = 0; i < (int)image_count; ++i)
+				{
+					const typename RegionCacheT::RegionsPtr regions = region_cache_->get(i);
+					if (!regions || regions->descriptors.empty())
+						continue;
+					const size_t desc_count = regions->descriptors.size();
+					const size_t step = std::max<size_t>(1, desc_count / samples_per_image);
+					for (size_t k = 0; k < desc_count; k += step)
+						vec_samples[i].insert(vec_samples[i].end(),
+							regions->descriptors[k].getData(), regions->descriptors[k].getData() + kDim);
+				}
+
+				std::vector<float> vec_data;
+				for (size_t i = 0; i < image_count; ++i)
+					vec_data.insert(vec_data.end(), vec_samples[i].begin(), vec_samples[i].end());
+				const size_t sample_count = vec_data.size() / kDim;
+				if (word_count_ < 2 || sample_count < word_count_)
+					return false;
+
+				// 分支数等于单词个数时，层次k-means只有一层，得到word_count_个聚类中心
+				vec_vocabulary_.assign(word_count_ * kDim, 0.f);
+				flann::Matrix<float> data(&vec_data[0], sample_count, kDim);
+				flann::Matrix<float> centers(&vec_vocabulary_[0], word_count_, kDim);
+				const int center_count = flann::hierarchicalClustering<flann::L2<float> >(data, centers,
+					flann::KMeansIndexParams(static_cast<int>(word_count_), 11, flann::FLANN_CENTERS_KMEANSPP));
+				if (center_count <= 0)
+					return false;
+				vec_vocabulary_.resize(center_count * kDim);
+				return true;
+			}
+
+			/**	视觉单词的个数，计算词典之前为0
+			 */
+			size_t wordCount() const { return vec_vocabulary_.size() / kDim; }
+
+			/**
+			 * \brief	并行计算前image_count幅图像的VLAD全局向量，需要先计算词典
+			 */
+			void computeGlobalDescriptors(size_t image_count)
+			{
+				const size_t dim = wordCount() * kDim;
+				vec_global_descs_.assign(image_count, std::vector<float>());
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int i = 0; i < (int)image_count; ++i)
+				{
+					const typename RegionCacheT::RegionsPtr regions = region_cache_->get(i);
+					if (!regions || regions->descriptors.empty() || dim == 0)
+						continue;
+					std::vector<float> & vlad = vec_global_descs_[i];
+					vlad.assign(dim, 0.f);
+					float desc[kDim];
+					for (size_t k = 0; k < regions->descriptors.size(); ++k) {
+						std::copy(regions->descriptors[k].getData(), regions->descriptors[k].getData() + kDim, desc);
+						const size_t word = nearestWord(desc);
+						const float * center = &vec_vocabulary_[word * kDim];
+						float * residual = &vlad[word * kDim];
+						for (size_t d = 0; d < kDim; ++d)
+							residual[d] += desc[d] - center[d];
+					}
+					Normalize(vlad, kDim);
+				}
+			}
+
+			/**
+			 * \brief	每幅图像与全局向量最相似的top_k幅图像组成候选图像对，
+			 *			在全局向量的kd树索引中查询top_k + 1个近邻并去掉图像自身
+			 *
+			 * \param	top_k 	每幅图像的候选个数
+			 * \param	checks	每次查询检查的叶子结点个数，不少于图像个数时结果是精确的
+			 *
+			 * \return	按(i, j)升序排列并去重的图像对，每个图像对满足i < j
+			 */
+			PairsT topKPairs(size_t top_k, int checks = 256) const
+			{
+				// 只有有全局向量的图像加入索引，第r行对应图像vec_image_ids[r]
+				std::vector<size_t> vec_image_ids;
+				for (size_t i = 0; i < vec_global_descs_.size(); ++i) {
+					if (!vec_global_descs_[i].empty())
+						vec_image_ids.push_back(i);
+				}
+				const size_t row_count = vec_image_ids.size();
+				if (row_count < 2 || top_k == 0)
+					return PairsT();
+				const size_t dim = vec_global_descs_[vec_image_ids[0]].size();
+				std::vector<float> vec_data(row_count * dim);
+				for (size_t r = 0; r < row_count; ++r)
+					std::copy(vec_global_descs_[vec_image_ids[r]].begin(), vec_global_descs_[vec_image_ids[r]].end(),
+						&vec_data[r * dim]);
+
+				flann::Matrix<float> data(&vec_data[0], row_count, dim);
+				flann::Index<flann::L2<float> > index(data, flann::KDTreeIndexParams(4));
+				index.buildIndex();
+
+				const size_t knn = std::min(top_k + 1, row_count);
+				std::vector<PairsT> vec_image_pairs(row_count);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int r = 0; r < (int)row_count; ++r)
+				{
+					flann::Matrix<float> query(&vec_data[r * dim], 1, dim);
+					std::vector<std::vector<int> > vec_indices;
+					std::vector<std::vector<float> > vec_distances;
+					index.knnSearch(query, vec_indices, vec_distances, knn, flann::SearchParams(checks));
+					const size_t i = vec_image_ids[r];
+					for (size_t k = 0; k < vec_indices[0].size() && vec_image_pairs[r].size() < top_k; ++k) {
+						// 去掉图像自身，全局向量相同的图像不一定排在自身之后
+						if (vec_indices[0][k] < 0 || vec_indices[0][k] == r)
+							continue;
+						const size_t j = vec_image_ids[vec_indices[0][k]];
+						vec_image_pairs[r].push_back(std::make_pair(std::min<size_t>(i, j), std::max<size_t>(i, j)));
+					}
+				}
+				return MergePairs(vec_image_pairs);
+			}
+
+			/**
+			 * \brief	穷举比较所有图像的全局向量选择候选图像对，复杂度与图像个数的平方成正比，
+			 *			用于检验topKPairs的结果
+			 *
+			 * \param	top_k	每幅图像的候选个数
+			 *
+			 * \return	按(i, j)升序排列并去重的图像对，每个图像对满足i < j
+			 */
+			PairsT topKPairsExhaustive(size_t top_k) const
+			{
+				const size_t image_count = vec_global_descs_.size();
+				std::vector<PairsT> vec_image_pairs(image_count);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int i = 0; i < (int)image_count; ++i)
+				{
+					const std::vector<float> & desc_i = vec_global_descs_[i];
+					if (desc_i.empty())
+						continue;
+					// 全局向量都是单位向量，欧式距离越小越相似
+					std::vector<std::pair<float, size_t> > vec_scores;
+					vec_scores.reserve(image_count);
+					for (size_t j = 0; j < image_count; ++j) {
+						if (j == (size_t)i || vec_global_descs_[j].empty())
+							continue;
+						vec_scores.push_back(std::make_pair(
+							SquaredEuclideanDistanceF32(&desc_i[0], &vec_global_descs_[j][0], desc_i.size()), j));
+					}
+					const size_t count = std::min(top_k, vec_scores.size());
+					std::partial_sort(vec_scores.begin(), vec_scores.begin() + count, vec_scores.end());
+					for (size_t k = 0; k < count; ++k) {
+						const size_t j = vec_scores[k].second;
+						vec_image_pairs[i].push_back(std::make_pair(std::min<size_t>(i, j), std::max<size_t>(i, j)));
+					}
+				}
+				return MergePairs(vec_image_pairs);
+			}
+
+			/**
+			 * \brief	计算词典和全局向量，并选择候选图像对
+			 *
+			 * \param	image_count	   	图像个数
+			 * \param	top_k		   	每幅图像的候选个数
+			 * \param [out]	vec_pairs	候选图像对
+			 *
+			 * \return	true if it succeeds, false if it fails.
+			 */
+			bool selectPairs(size_t image_count, size_t top_k, PairsT & vec_pairs)
+			{
+				if (!computeVocabulary(image_count))
+					return false;
+				computeGlobalDescriptors(image_count);
+				vec_pairs = topKPairs(top_k);
+				return true;
+			}
+
+		private:
+			typedef typename RegionCacheT::DescsT::value_type DescriptorT;
+			static const size_t kDim = DescriptorT::kStaticSize;
+
+			/**	合并每幅图像的候选图像对，排序并去重
+			 */
+			static PairsT MergePairs(const std::vector<PairsT> & vec_image_pairs)
+			{
+				PairsT vec_pairs;
+				for (size_t i = 0; i < vec_image_pairs.size(); ++i)
+					vec_pairs.insert(vec_pairs.end(), vec_image_pairs[i].begin(), vec_image_pairs[i].end());
+				std::sort(vec_pairs.begin(), vec_pairs.end());
+				vec_pairs.erase(std::unique(vec_pairs.begin(), vec_pairs.end()), vec_pairs.end());
+				return vec_pairs;
+			}
+
+			/**	最近的视觉单词
+			 */
+			size_t nearestWord(const float * desc) const
+			{
+				size_t best_word = 0;
+				float best_distance = SquaredEuclideanDistanceF32(desc, &vec_vocabulary_[0], kDim);
+				for (size_t w = 1; w < wordCount(); ++w) {
+					const float distance = SquaredEuclideanDistanceF32(desc, &vec_vocabulary_[w * kDim], kDim);
+					if (distance < best_distance) {
+						best_distance = distance;
+						best_word = w;
+					}
+				}
+				return best_word;
+			}
+
+			/**	VLAD的归一化：符号平方根、每个单词内的L2归一化，最后整体L2归一化
+			 */
+			static void Normalize(std::vector<float> & vlad, size_t block_size)
+			{
+				for (size_t d = 0; d < vlad.size(); ++d)
+					vlad[d] = vlad[d] < 0.f ? -std::sqrt(-vlad[d]) : std::sqrt(vlad[d]);
+				float total = 0.f;
+				for (size_t b = 0; b < vlad.size(); b += block_size) {
+					float norm = 0.f;
+					for (size_t d = b; d < b + block_size; ++d)
+						norm += vlad[d] * vlad[d];
+					if (norm <= 0.f)
+						continue;
+					norm = 1.f / std::sqrt(norm);
+					for (size_t d = b; d < b + block_size; ++d)
+						vlad[d] *= norm;
+					total += 1.f;
+				}
+				if (total > 0.f) {
+					total = 1.f / std::sqrt(total);
+					for (size_t d = 0; d < vlad.size(); ++d)
+						vlad[d] *= total;
+				}
+			}
+
+			std::shared_ptr<RegionCacheT> region_cache_;        //!< 特征及描述子的缓存
+			size_t word_count_;                                 //!< 视觉单词的个数
+			size_t max_sample_count_;                           //!< 训练词典时采样的描述子个数上限
+			std::vector<float> vec_vocabulary_;                 //!< 视觉词典，每行为一个聚类中心
+			std::vector<std::vector<float> > vec_global_descs_; //!< 每幅图像的VLAD全局向量，没有描述子时为空
+		};
+
+	}  // namespace feature
+}  // namespace mvg
+
+#endif // MVG_FEATURE_PAIR_SELECTION_VLAD_H_
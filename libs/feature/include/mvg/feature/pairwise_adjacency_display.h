@@ -3,37 +3,30 @@
 
 #include "mvg/utils/svg_drawer.h"
 #include "mvg/feature/indexed_match.h"
+#include "mvg/feature/pairwise_matches_store.h"
 using namespace mvg::feature;
 using namespace mvg::utils;
 
 namespace mvg  {
 	namespace feature{
 		
-		/**	将匹配图像通过邻接矩阵的方式进行存储，存储为svg格式
+		/**	将有匹配的图像对(按(I, J)升序)通过邻接矩阵的方式进行存储，存储为svg格式
 		 */
-		void PairWiseMatchingToAdjacencyMatrixSVG(const size_t image_nums,
-			const PairWiseMatches &map_matches,
+		static void AdjacencyMatrixToSVG(const size_t image_nums,
+			const std::vector<std::pair<size_t, size_t> > &vec_pairs,
 			const std::string &output_name)
 		{
-			if (!map_matches.empty())
+			if (!vec_pairs.empty())
 			{
 				float scale_factor = 5.0f;
 				SvgDrawer svg_stream((image_nums + 3) * 5, (image_nums + 3) * 5);
-				// 对所有可能的匹配进行遍历
-				for (size_t I = 0; I < image_nums; ++I) {
-					for (size_t J = 0; J < image_nums; ++J) {
-						// 如果这对图像匹配，则在I,J的位置上画上蓝色盒子
-						PairWiseMatches::const_iterator iter_search =
-							map_matches.find(std::make_pair(I, J));
-						if (iter_search != map_matches.end() && !iter_search->second.empty())
-						{
-							// Display as a tooltip: (IndexI, IndexJ NbMatches)
-							std::ostringstream os;
-							os << "(" << J << "," << I << " " << iter_search->second.size() << ")";
-							svg_stream.drawSquare(J*scale_factor, I*scale_factor, scale_factor / 2.0f,
-								SvgStyle().fill("blue").noStroke());
-						} // HINT : THINK ABOUT OPACITY [0.4 -> 1.0] TO EXPRESS MATCH COUNT
-					}
+				for (size_t k = 0; k < vec_pairs.size(); ++k) {
+					const size_t I = vec_pairs[k].first, J = vec_pairs[k].second;
+					// 如果这对图像匹配，则在I,J的位置上画上蓝色盒子
+					if (I < image_nums && J < image_nums)
+						svg_stream.drawSquare(J*scale_factor, I*scale_factor, scale_factor / 2.0f,
+							SvgStyle().fill("blue").noStroke());
+					// HINT : THINK ABOUT OPACITY [0.4 -> 1.0] TO EXPRESS MATCH COUNT
 				}
 				// Display axes with 0 -> image_nums annotation : _|
 				std::ostringstream os_image_nums;   os_image_nums << image_nums;
@@ -55,6 +48,34 @@ namespace mvg  {
 				svg_file_stream << svg_stream.closeSvgFile().str();
 			}
 		}
+
+		/**	将匹配图像通过邻接矩阵的方式进行存储，存储为svg格式
+		 */
+		void PairWiseMatchingToAdjacencyMatrixSVG(const size_t image_nums,
+			const PairWiseMatches &map_matches,
+			const std::string &output_name)
+		{
+			std::vector<std::pair<size_t, size_t> > vec_pairs;
+			for (PairWiseMatches::const_iterator iter = map_matches.begin(); iter != map_matches.end(); ++iter) {
+				if (!iter->second.empty())
+					vec_pairs.push_back(iter->first);
+			}
+			AdjacencyMatrixToSVG(image_nums, vec_pairs, output_name);
+		}
+
+		/**	直接遍历映射的二进制匹配文件导出邻接矩阵，不需要将匹配读入内存
+		 */
+		void PairWiseMatchingToAdjacencyMatrixSVG(const size_t image_nums,
+			const PairWiseMatchesStore &store,
+			const std::string &output_name)
+		{
+			std::vector<std::pair<size_t, size_t> > vec_pairs;
+			for (size_t k = 0; k < store.size(); ++k) {
+				if (store.matchCountAt(k) > 0)
+					vec_pairs.push_back(store.pairAt(k));
+			}
+			AdjacencyMatrixToSVG(image_nums, vec_pairs, output_name);
+		}
 	}// namespace feature
 } // namespace mvg
 
@@ -0,0 +1,428 @@
+﻿#ifndef MVG_FEATURE_PAIRWISE_MATCHES_STORE_H_
+#define MVG_FEATURE_PAIRWISE_MATCHES_STORE_H_
+
+#include "mvg/feature/indexed_match.h"
+#include <mvg/utils/memory_mapped_file.h>
+#include <mvg/utils/mvg_stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace mvg {
+	namespace feature {
+
+		/**
+		 * 二进制匹配文件的格式(小端，与本机IndexedMatch的内存布局一致)：
+		 *   PairWiseMatchesFileHeader
+		 *   PairWiseMatchesFileEntry[pair_count]   按(left, right)升序排列
+		 *   IndexedMatch[match_count]              所有图像对的匹配连续存放
+		 * 所有结构体的大小都是8字节的倍数，映射后可以直接访问，不需要拷贝
+		 */
+		static const char kPairWiseMatchesMagic[8] = { 'M', 'V', 'G', 'P', 'W', 'M', '\0', '\0' };
+		static const uint32_t kPairWiseMatchesVersion = 1;
+
+		/** 二进制匹配文件的文件头 */
+		struct PairWiseMatchesFileHeader
+		{
+			char magic[8];          //!< 文件标识 "MVGPWM"
+			uint32_t version;       //!< 文件格式版本号
+			uint32_t match_size;    //!< sizeof(IndexedMatch)，用于检测不同平台生成的文件
+			uint64_t pair_count;    //!< 图像对的个数
+			uint64_t match_count;   //!< 所有图像对的匹配总数
+		};
+
+		/** 二进制匹配文件中一个图像对的索引项 */
+		struct PairWiseMatchesFileEntry
+		{
+			uint64_t left;          //!< 左图像索引
+			uint64_t right;         //!< 右图像索引
+			uint64_t offset;        //!< 该图像对第一个匹配在匹配数组中的位置
+			uint64_t count;         //!< 该图像对的匹配个数
+		};
+
+		/**
+		 * \brief	将匹配的索引值对保存为二进制文件
+		 *
+		 * \param	map_indexed_matches	索引匹配对
+		 * \param	file_name		   	要保存的文件名
+		 *
+		 * \return	true if it succeeds, false if it fails.
+		 */
+		static bool PairedIndexedMatchToBinFile(
+			const PairWiseMatches & map_indexed_matches,
+			const std::string & file_name)
+		{
+			std::ofstream out(file_name.c_str(), std::ios::out | std::ios::binary);
+			if (!out.is_open())
+				return false;
+
+			PairWiseMatchesFileHeader header;
+			std::memcpy(header.magic, kPairWiseMatchesMagic, sizeof(header.magic));
+			header.version = kPairWiseMatchesVersion;
+			header.match_size = static_cast<uint32_t>(sizeof(IndexedMatch));
+			header.pair_count = map_indexed_matches.size();
+			header.match_count = 0;
+
+			//std::map已经按照(left, right)排序，索引项可以直接按顺序写入
+			std::vector<PairWiseMatchesFileEntry> vec_entries;
+			vec_entries.reserve(map_indexed_matches.size());
+			for (PairWiseMatches::const_iterator iter = map_indexed_matches.begin();
+				iter != map_indexed_matches.end(); ++iter)
+			{
+				PairWiseMatchesFileEntry entry;
+				entry.left = iter->first.first;
+				entry.right = iter->first.second;
+				entry.offset = header.match_count;
+				entry.count = iter->second.size();
+				header.match_count += entry.count;
+				vec_entries.push_back(entry);
+			}
+
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			if (!vec_entries.empty())
+				out.write(reinterpret_cast<const char*>(&vec_entries[0]),
+					sizeof(PairWiseMatchesFileEntry) * vec_entries.size());
+			for (PairWiseMatches::const_iterator iter = map_indexed_matches.begin();
+				iter != map_indexed_matches.end(); ++iter)
+			{
+				if (!iter->second.empty())
+					out.write(reinterpret_cast<const char*>(&iter->second[0]),
+						sizeof(IndexedMatch) * iter->second.size());
+			}
+			return out.good();
+		}
+
+		/**
+		 * \brief	逐个图像对写入二进制匹配文件，内存中只保留索引项。
+		 *			匹配先追加到临时文件(file_name + ".tmp")，close时将索引项按(left, right)排序，
+		 *			与临时文件拼接后重命名为最终的文件，中途失败不会留下不完整的文件。
+		 *			图像对可以按任意顺序写入，但不能重复
+		 *
+		 *  \code
+		 *   PairWiseMatchesWriter writer;
+		 *   if (writer.open("matches.f.bin")) {
+		 *     writer.append(0, 1, &vec_matches[0], vec_matches.size());
+		 *     writer.close();
+		 *   }
+		 *  \endcode
+		 */
+		class PairWiseMatchesWriter
+		{
+		public:
+			PairWiseMatchesWriter() : match_count_(0) {}
+			~PairWiseMatchesWriter() { discard(); }
+
+			/**	创建临时文件，之前未完成的写入被丢弃
+			 */
+			bool open(const std::string & file_name)
+			{
+				discard();
+				file_name_ = file_name;
+				temp_file_name_ = file_name + ".tmp";
+				temp_out_.open(temp_file_name_.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+				return temp_out_.is_open();
+			}
+
+			bool isOpen() const { return temp_out_.is_open(); }
+
+			/**	已写入的图像对的个数
+			 */
+			size_t size() const { return vec_entries_.size(); }
+
+			/**	写入图像对(left, right)的匹配
+			 */
+			bool append(size_t left, size_t right, const IndexedMatch * matches, size_t count)
+			{
+				if (!temp_out_.is_open())
+					return false;
+				if (count > 0)
+					temp_out_.write(reinterpret_cast<const char*>(matches), sizeof(IndexedMatch) * count);
+				if (!temp_out_.good())
+					return false;
+
+				PairWiseMatchesFileEntry entry;
+				entry.left = left;
+				entry.right = right;
+				entry.offset = match_count_;
+				entry.count = count;
+				vec_entries_.push_back(entry);
+				match_count_ += count;
+				return true;
+			}
+
+			/**
+			 * \brief	生成最终的文件并删除临时文件
+			 *
+			 * \return	写入失败或图像对重复时返回false，不生成文件
+			 */
+			bool close()
+			{
+				if (!temp_out_.is_open())
+					return false;
+				temp_out_.close();
+				bool is_ok = !temp_out_.fail();
+
+				std::sort(vec_entries_.begin(), vec_entries_.end(), EntryOrder());
+				for (size_t k = 1; k < vec_entries_.size() && is_ok; ++k)
+					is_ok = EntryOrder()(vec_entries_[k - 1], vec_entries_[k]);
+
+				if (is_ok) {
+					const std::string part_file_name = file_name_ + ".part";
+					std::ofstream out(part_file_name.c_str(), std::ios::out | std::ios::binary);
+					std::ifstream in(temp_file_name_.c_str(), std::ios::in | std::ios::binary);
+					PairWiseMatchesFileHeader header;
+					std::memcpy(header.magic, kPairWiseMatchesMagic, sizeof(header.magic));
+					header.version = kPairWiseMatchesVersion;
+					header.match_size = static_cast<uint32_t>(sizeof(IndexedMatch));
+					header.pair_count = vec_entries_.size();
+					header.match_count = match_count_;
+					out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+					if (!vec_entries_.empty())
+						out.write(reinterpret_cast<const char*>(&vec_entries_[0]),
+							sizeof(PairWiseMatchesFileEntry) * vec_entries_.size());
+
+					//匹配数组按块拷贝，不整体读入内存
+					std::vector<char> buffer(1 << 20);
+					while (in.read(&buffer[0], buffer.size()) || in.gcount() > 0)
+						out.write(&buffer[0], in.gcount());
+					is_ok = in.is_open() && out.good();
+					out.close();
+					is_ok = is_ok && !out.fail();
+					if (is_ok) {
+						std::remove(file_name_.c_str());
+						is_ok = std::rename(part_file_name.c_str(), file_name_.c_str()) == 0;
+					}
+					if (!is_ok)
+						std::remove(part_file_name.c_str());
+				}
+				discard();
+				return is_ok;
+			}
+
+			/**	丢弃未完成的写入，删除临时文件
+			 */
+			void discard()
+			{
+				if (temp_out_.is_open())
+					temp_out_.close();
+				if (!temp_file_name_.empty())
+					std::remove(temp_file_name_.c_str());
+				temp_file_name_.clear();
+				vec_entries_.clear();
+				match_count_ = 0;
+			}
+
+		private:
+			struct EntryOrder
+			{
+				bool operator()(const PairWiseMatchesFileEntry & a, const PairWiseMatchesFileEntry & b) const
+				{
+					if (a.left != b.left)
+						return a.left < b.left;
+					return a.right < b.right;
+				}
+			};
+
+			std::string file_name_;                               //!< 最终的文件名
+			std::string temp_file_name_;                          //!< 匹配数组的临时文件
+			std::ofstream temp_out_;                              //!< 临时文件的输出流
+			std::vector<PairWiseMatchesFileEntry> vec_entries_;   //!< 已写入的图像对的索引项
+			uint64_t match_count_;                                //!< 已写入的匹配总数
+		};
+
+		/**
+		 * \brief	通过内存映射只读访问二进制匹配文件，
+		 *			打开文件时只校验文件头，各图像对的匹配在访问时才从磁盘读入
+		 *
+		 *  \code
+		 *   PairWiseMatchesStore store;
+		 *   if (store.open("matches.f.bin")) {
+		 *     const IndexedMatch *matches; size_t count;
+		 *     if (store.find(0, 1, matches, count))
+		 *       ...
+		 *   }
+		 *  \endcode
+		 */
+		class PairWiseMatchesStore
+		{
+		public:
+			PairWiseMatchesStore() : entries_(NULL), matches_(NULL), pair_count_(0) {}
+
+			/**	判断文件是否为二进制匹配文件(只检查文件标识)
+			 */
+			static bool isBinaryFile(const std::string & file_name)
+			{
+				std::ifstream in(file_name.c_str(), std::ios::in | std::ios::binary);
+				char magic[sizeof(kPairWiseMatchesMagic)];
+				if (!in.read(magic, sizeof(magic)))
+					return false;
+				return std::memcmp(magic, kPairWiseMatchesMagic, sizeof(magic)) == 0;
+			}
+
+			/**
+			 * \brief	映射二进制匹配文件，并校验文件头
+			 *
+			 * \param	file_name	要打开的文件名
+			 *
+			 * \return	true if it succeeds, false if it fails.
+			 */
+			bool open(const std::string & file_name)
+			{
+				close();
+				if (!mapped_file_.open(file_name))
+					return false;
+
+				const size_t file_size = mapped_file_.size();
+				if (file_size < sizeof(PairWiseMatchesFileHeader)) {
+					close();
+					return false;
+				}
+				PairWiseMatchesFileHeader header;
+				std::memcpy(&header, mapped_file_.data(), sizeof(header));
+				if (std::memcmp(header.magic, kPairWiseMatchesMagic, sizeof(header.magic)) != 0
+					|| header.version != kPairWiseMatchesVersion
+					|| header.match_size != sizeof(IndexedMatch)) {
+					close();
+					return false;
+				}
+
+				// 文件头中的个数先与文件大小比较，再计算各部分的大小，损坏的文件不会使乘法溢出
+				const uint64_t body_size = file_size - sizeof(PairWiseMatchesFileHeader);
+				if (header.pair_count > body_size / sizeof(PairWiseMatchesFileEntry)) {
+					close();
+					return false;
+				}
+				const uint64_t matches_size = body_size - header.pair_count * sizeof(PairWiseMatchesFileEntry);
+				if (header.match_count > matches_size / sizeof(IndexedMatch)
+					|| header.match_count * sizeof(IndexedMatch) != matches_size) {
+					close();
+					return false;
+				}
+
+				pair_count_ = static_cast<size_t>(header.pair_count);
+				entries_ = reinterpret_cast<const PairWiseMatchesFileEntry*>(
+					mapped_file_.data() + sizeof(PairWiseMatchesFileHeader));
+				matches_ = reinterpret_cast<const IndexedMatch*>(
+					mapped_file_.data() + sizeof(PairWiseMatchesFileHeader)
+					+ pair_count_ * sizeof(PairWiseMatchesFileEntry));
+				for (size_t k = 0; k < pair_count_; ++k) {
+					// 分开比较offset和count，offset + count不会溢出
+					if (entries_[k].offset > header.match_count
+						|| entries_[k].count > header.match_count - entries_[k].offset) {
+						close();
+						return false;
+					}
+				}
+				return true;
+			}
+
+			/**	解除文件映射
+			 */
+			void close()
+			{
+				mapped_file_.close();
+				entries_ = NULL;
+				matches_ = NULL;
+				pair_count_ = 0;
+			}
+
+			bool isOpen() const { return mapped_file_.isOpen(); }
+
+			/**	图像对的个数
+			 */
+			size_t size() const { return pair_count_; }
+
+			/**	第k个图像对的索引 (按(left, right)升序)
+			 */
+			std::pair<size_t, size_t> pairAt(size_t k) const
+			{
+				return std::make_pair(static_cast<size_t>(entries_[k].left),
+					static_cast<size_t>(entries_[k].right));
+			}
+
+			/**	第k个图像对的匹配个数
+			 */
+			size_t matchCountAt(size_t k) const { return static_cast<size_t>(entries_[k].count); }
+
+			/**	第k个图像对的匹配首地址，指向映射内存，store关闭后失效
+			 */
+			const IndexedMatch *matchesAt(size_t k) const
+			{
+				return matches_ + entries_[k].offset;
+			}
+
+			/**
+			 * \brief	二分查找图像对(left, right)
+			 *
+			 * \param	left		   	左图像索引
+			 * \param	right		   	右图像索引
+			 * \param [out]	matches	匹配首地址，指向映射内存
+			 * \param [out]	count  	匹配个数
+			 *
+			 * \return	图像对存在返回true
+			 */
+			bool find(size_t left, size_t right,
+				const IndexedMatch *& matches, size_t & count) const
+			{
+				const PairWiseMatchesFileEntry *begin = entries_;
+				const PairWiseMatchesFileEntry *end = entries_ + pair_count_;
+				const PairWiseMatchesFileEntry *iter =
+					std::lower_bound(begin, end, std::make_pair(left, right), EntryLess());
+				if (iter == end || iter->left != left || iter->right != right)
+					return false;
+				matches = matches_ + iter->offset;
+				count = static_cast<size_t>(iter->count);
+				return true;
+			}
+
+			/**	将图像对(left, right)的匹配拷贝出来，不存在时返回false
+			 */
+			bool getMatches(size_t left, size_t right, std::vector<IndexedMatch> & vec_matches) const
+			{
+				const IndexedMatch *matches = NULL;
+				size_t count = 0;
+				if (!find(left, right, matches, count))
+					return false;
+				vec_matches.assign(matches, matches + count);
+				return true;
+			}
+
+			/**	将所有的匹配导入到PairWiseMatches中
+			 */
+			void load(PairWiseMatches & map_indexed_matches) const
+			{
+				map_indexed_matches.clear();
+				for (size_t k = 0; k < pair_count_; ++k) {
+					const IndexedMatch *matches = matchesAt(k);
+					//按序插入，利用提示位置使插入的复杂度为常数
+					map_indexed_matches.insert(map_indexed_matches.end(),
+						std::make_pair(pairAt(k),
+						std::vector<IndexedMatch>(matches, matches + matchCountAt(k))));
+				}
+			}
+
+		private:
+			struct EntryLess
+			{
+				bool operator()(const PairWiseMatchesFileEntry & entry,
+					const std::pair<size_t, size_t> & key) const
+				{
+					if (entry.left != key.first)
+						return entry.left < key.first;
+					return entry.right < key.second;
+				}
+			};
+
+			mvg::utils::MemoryMappedFile mapped_file_;//!< 映射的文件
+			const PairWiseMatchesFileEntry *entries_; //!< 图像对索引
+			const IndexedMatch *matches_;             //!< 匹配数组
+			size_t pair_count_;                       //!< 图像对的个数
+		};
+
+	}  // namespace feature
+}  // namespace mvg
+
+#endif // MVG_FEATURE_PAIRWISE_MATCHES_STORE_H_
@@ -36,18 +36,26 @@ namespace mvg {
 			}
 		}
 
+		/// 使用全局的rand()
+		struct StdRandom
+		{
+			unsigned int operator()() const { return static_cast<unsigned int>(rand() >> 3); }
+		};
+
 		/**
 		 * \brief	在[0:n-1]的范围内得到X个排好序的随机数，采样插入排序的思想
 		 *
 		 * \param	X			   	要获得的X个随机数
 		 * \param	n			   	随机数获取的范围
 		 * \param [in,out]	samples	返回获取的随机数
+		 * \param	random			随机数生成器，例如StdRandom或设定了种子的std::mt19937
 		 */
-		static void RandomSample(size_t X, size_t n, std::vector<size_t> *samples)
+		template <typename RandomT>
+		static void RandomSample(size_t X, size_t n, std::vector<size_t> *samples, RandomT & random)
 		{
 			samples->resize(X);
 			for (size_t i = 0; i < X; ++i) {
-				size_t r = (rand() >> 3) % (n - i), j;
+				size_t r = random() % (n - i), j;
 				for (j = 0; j < i && r >= (*samples)[j]; ++j)
 					++r;
 				size_t j0 = j;
@@ -57,6 +65,13 @@ namespace mvg {
 			}
 		}
 
+		/// 使用全局的rand()在[0:n-1]的范围内得到X个排好序的随机数
+		static void RandomSample(size_t X, size_t n, std::vector<size_t> *samples)
+		{
+			StdRandom random;
+			RandomSample(X, n, samples, random);
+		}
+
 	} // namespace feature
 } // namespace mvg
 #endif // MVG_FEATURE_ESTIMATION_RAND_SAMPLING_H_
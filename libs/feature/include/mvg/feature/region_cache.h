@@ -0,0 +1,329 @@
+﻿#ifndef MVG_FEATURE_REGION_CACHE_H_
+#define MVG_FEATURE_REGION_CACHE_H_
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mvg/feature/feature.h"
+#include "mvg/feature/descriptor.h"
+#include "mvg/utils/file_system.h"
+
+namespace mvg {
+	namespace feature {
+
+		/**
+		 * \brief	每幅图像的特征及描述子(区域)的缓存，按图像索引访问，
+		 *			可以在匹配、几何过滤和重建等多个阶段之间共享，每幅图像只从磁盘读取一次。
+		 *			缓存的内存超过预算时按最近最少使用(LRU)的顺序释放，
+		 *			get()返回的是引用计数的只读视图，被释放的区域在所有视图销毁前仍然有效。
+		 *			图像id直接作为下标索引连续存储，并行访问任意图像的代价为O(1)。
+		 *			只需要特征的使用者(例如几何过滤)可以不读取描述子，之后需要描述子的get()会重新读取该图像。
+		 *
+		 *  \code
+		 *   typedef RegionCache<ScalePointFeature, Descriptor<unsigned char, 128> > RegionCacheT;
+		 *   std::shared_ptr<RegionCacheT> cache(new RegionCacheT(512 << 20));
+		 *   cache->setImages(file_names, match_dir);
+		 *   RegionCacheT::RegionsPtr regions = cache->get(0);
+		 *   const std::vector<ScalePointFeature> & feats = regions->features;
+		 *  \endcode
+		 *
+		 * \tparam	FeatureT   	特征的类型
+		 * \tparam	DescriptorT	描述子的类型
+		 */
+		template <typename FeatureT, typename DescriptorT>
+		class RegionCache
+		{
+		public:
+			typedef std::vector<FeatureT> FeatsT;
+			typedef std::vector<DescriptorT> DescsT;
+
+			/**	一幅图像的特征及描述子
+			 */
+			struct Regions
+			{
+				FeatsT features;        //!< 特征
+				DescsT descriptors;     //!< 描述子，没有描述子文件时为空
+
+				/**	占用的内存大小，单位字节
+				 */
+				size_t memorySize() const
+				{
+					return sizeof(Regions) + features.capacity() * sizeof(FeatureT)
+						+ descriptors.capacity() * sizeof(DescriptorT);
+				}
+			};
+			typedef std::shared_ptr<const Regions> RegionsPtr;
+
+			/**
+			 * \brief	构造函数
+			 *
+			 * \param	memory_budget	缓存的内存预算，单位字节，0表示不限制
+			 */
+			explicit RegionCache(size_t memory_budget = 0)
+				: image_count_(0), memory_budget_(memory_budget), memory_size_(0) {}
+
+			/**
+			 * \brief	设置图像id对应的特征及描述子文件，不能与get()并发调用
+			 *
+			 * \param	image_id	 	图像的索引
+			 * \param	feat_filename	特征文件名
+			 * \param	desc_filename	描述子文件名(二进制)，为空时只读取特征
+			 */
+			void addImage(size_t image_id, const std::string & feat_filename,
+				const std::string & desc_filename = "")
+			{
+				reserve(image_id + 1);
+				if (vec_files_[image_id].first.empty())
+					++image_count_;
+				vec_files_[image_id] = std::make_pair(feat_filename, desc_filename);
+			}
+
+			/**
+			 * \brief	直接将内存中的区域放入缓存(例如刚刚提取的特征)，不能与get()并发调用，
+			 *			没有注册文件的图像被释放后无法重新读取
+			 *
+			 * \param	image_id	图像的索引
+			 * \param	regions 	图像的特征及描述子
+			 */
+			void put(size_t image_id, const RegionsPtr & regions)
+			{
+				reserve(image_id + 1);
+				if (vec_files_[image_id].first.empty() && !vec_entries_[image_id].regions)
+					++image_count_;
+				erase(image_id);
+				insert(image_id, regions, false);
+			}
+
+			/**
+			 * \brief	按照compute_matches的命名规则设置所有图像的特征及描述子文件，图像id为file_names中的索引
+			 *
+			 * \param	file_names	 	图像文件名
+			 * \param	match_dir	 	特征及描述子所在的目录
+			 */
+			void setImages(const std::vector<std::string> & file_names,
+				const std::string & match_dir)
+			{
+				for (size_t i = 0; i < file_names.size(); ++i) {
+					const std::string basename = mvg::utils::basename_part(file_names[i]);
+					addImage(i, mvg::utils::create_filespec(match_dir, basename, "feat"),
+						mvg::utils::create_filespec(match_dir, basename, "desc"));
+				}
+			}
+
+			/**	注册的图像个数
+			 */
+			size_t size() const { return image_count_; }
+
+			/**
+			 * \brief	获取图像的特征及描述子，不在缓存中时从磁盘读取，
+			 *			缓存中只有特征而需要描述子时重新读取
+			 *
+			 * \param	image_id	 	图像的索引
+			 * \param	is_load_descs	是否需要描述子，为false时不在缓存中的图像只读取特征
+			 *
+			 * \return	只读视图，图像未注册或读取失败时返回空指针
+			 */
+			RegionsPtr get(size_t image_id, bool is_load_descs = true)
+			{
+				RegionsPtr regions;
+#ifdef USE_OPENMP
+#pragma omp critical(RegionCache)
+#endif
+				{
+					regions = findAndTouch(image_id, is_load_descs);
+				}
+				if (regions)
+					return regions;
+
+				// 在临界区外读取文件，其他线程可以同时读取别的图像
+				bool is_features_only = false;
+				regions = load(image_id, is_load_descs, is_features_only);
+				if (!regions)
+					return regions;
+
+#ifdef USE_OPENMP
+#pragma omp critical(RegionCache)
+#endif
+				{
+					// 其他线程可能已经读入了同一幅图像，使用已有的结果
+					RegionsPtr cached = findAndTouch(image_id, is_load_descs);
+					if (cached) {
+						regions = cached;
+					}
+					else {
+						// 替换只有特征的项，已经获取的视图仍然有效
+						erase(image_id);
+						insert(image_id, regions, is_features_only);
+					}
+				}
+				return regions;
+			}
+
+			/**
+			 * \brief	并行读入一组图像，超过预算时先读入的图像会被释放
+			 *
+			 * \param	vec_image_ids	图像的索引
+			 * \param	is_load_descs	是否读取描述子
+			 *
+			 * \return	所有图像都读取成功返回true
+			 */
+			bool preload(const std::vector<size_t> & vec_image_ids, bool is_load_descs = true)
+			{
+				std::vector<char> vec_ok(vec_image_ids.size(), 0);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+				for (int i = 0; i < (int)vec_image_ids.size(); ++i)
+					vec_ok[i] = get(vec_image_ids[i], is_load_descs) ? 1 : 0;
+				return std::find(vec_ok.begin(), vec_ok.end(), 0) == vec_ok.end();
+			}
+
+			/**	并行读入所有注册的图像
+			 */
+			bool preloadAll(bool is_load_descs = true)
+			{
+				std::vector<size_t> vec_image_ids;
+				for (size_t i = 0; i < vec_files_.size(); ++i) {
+					if (!vec_files_[i].first.empty())
+						vec_image_ids.push_back(i);
+				}
+				return preload(vec_image_ids, is_load_descs);
+			}
+
+			/**	释放所有缓存的区域，已经获取的视图仍然有效
+			 */
+			void clear()
+			{
+#ifdef USE_OPENMP
+#pragma omp critical(RegionCache)
+#endif
+				{
+					for (size_t i = 0; i < vec_entries_.size(); ++i)
+						vec_entries_[i].regions.reset();
+					lru_list_.clear();
+					memory_size_ = 0;
+				}
+			}
+
+			/**	内存预算，单位字节，0表示不限制
+			 */
+			size_t memoryBudget() const { return memory_budget_; }
+
+			/**	当前缓存占用的内存大小，单位字节
+			 */
+			size_t memorySize() const { return memory_size_; }
+
+			/**	当前缓存的图像个数
+			 */
+			size_t cachedCount() const { return lru_list_.size(); }
+
+		private:
+			typedef std::pair<std::string, std::string> FilesT;
+
+			/**	缓存中的一项
+			 */
+			struct Entry
+			{
+				Entry() : is_features_only(false) {}
+
+				RegionsPtr regions;                         //!< 区域
+				typename std::list<size_t>::iterator lru;   //!< 在LRU链表中的位置
+				bool is_features_only;                      //!< 有描述子文件但只读取了特征
+			};
+
+			/**	查找缓存，找到时移到LRU链表的最前面，需要描述子而缓存中只有特征时视为未找到，调用时需在临界区内
+			 */
+			RegionsPtr findAndTouch(size_t image_id, bool is_load_descs)
+			{
+				if (image_id >= vec_entries_.size() || !vec_entries_[image_id].regions)
+					return RegionsPtr();
+				Entry & entry = vec_entries_[image_id];
+				if (is_load_descs && entry.is_features_only)
+					return RegionsPtr();
+				lru_list_.splice(lru_list_.begin(), lru_list_, entry.lru);
+				return entry.regions;
+			}
+
+			/**	扩展索引表，使其至少能容纳count幅图像
+			 */
+			void reserve(size_t count)
+			{
+				if (vec_files_.size() < count) {
+					vec_files_.resize(count);
+					vec_entries_.resize(count);
+				}
+			}
+
+			/**	从缓存中移除一项，调用时需在临界区内
+			 */
+			void erase(size_t image_id)
+			{
+				Entry & entry = vec_entries_[image_id];
+				if (!entry.regions)
+					return;
+				memory_size_ -= entry.regions->memorySize();
+				lru_list_.erase(entry.lru);
+				entry.regions.reset();
+			}
+
+			/**	插入缓存并按预算释放最久未使用的项，调用时需在临界区内
+			 */
+			void insert(size_t image_id, const RegionsPtr & regions, bool is_features_only)
+			{
+				lru_list_.push_front(image_id);
+				Entry & entry = vec_entries_[image_id];
+				entry.regions = regions;
+				entry.is_features_only = is_features_only;
+				entry.lru = lru_list_.begin();
+				memory_size_ += regions->memorySize();
+
+				// 至少保留刚插入的一项
+				while (memory_budget_ > 0 && memory_size_ > memory_budget_ && lru_list_.size() > 1)
+					erase(lru_list_.back());
+			}
+
+			/**
+			 * \brief	从磁盘读取一幅图像的区域，读取失败时输出文件名
+			 *
+			 * \param	image_id	 	图像的索引
+			 * \param	is_load_descs	是否读取描述子
+			 * \param [out]	is_features_only	有描述子文件但没有读取
+			 */
+			RegionsPtr load(size_t image_id, bool is_load_descs, bool & is_features_only) const
+			{
+				if (image_id >= vec_files_.size() || vec_files_[image_id].first.empty())
+					return RegionsPtr();
+
+				const FilesT & files = vec_files_[image_id];
+				std::shared_ptr<Regions> regions(new Regions);
+				if (!LoadFeatsFromFile(files.first, regions->features)) {
+					std::cerr << "Cannot read the features of image " << image_id
+						<< " from " << files.first << std::endl;
+					return RegionsPtr();
+				}
+				is_features_only = !is_load_descs && !files.second.empty();
+				if (is_load_descs && !files.second.empty()
+					&& !LoadDescsFromBinFile(files.second, regions->descriptors)) {
+					std::cerr << "Cannot read the descriptors of image " << image_id
+						<< " from " << files.second << std::endl;
+					return RegionsPtr();
+				}
+				return regions;
+			}
+
+			std::vector<FilesT> vec_files_;             //!< 每幅图像的特征及描述子文件，按图像id索引
+			std::vector<Entry> vec_entries_;            //!< 缓存的区域，按图像id索引
+			std::list<size_t> lru_list_;                //!< 缓存中的图像，最近使用的在前
+			size_t image_count_;                        //!< 注册的图像个数
+			size_t memory_budget_;                      //!< 内存预算，0表示不限制
+			size_t memory_size_;                        //!< 当前缓存占用的内存
+		};
+
+	}  // namespace feature
+}  // namespace mvg
+
+#endif // MVG_FEATURE_REGION_CACHE_H_
@@ -1,8 +1,11 @@
 ﻿#ifndef MVG_FEATURE_SIFT_HPP_
 #define MVG_FEATURE_SIFT_HPP_
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <numeric>
+#include <utility>
 
 #include "mvg/feature/feature.h"
 #include "mvg/feature/descriptor.h"
@@ -62,6 +65,9 @@ namespace mvg {
 		 * \param	is_root_sift	  	鏄惁浣跨敤root sift鏂规硶璁＄畻鐗瑰緛.
 		 * \param	contrast_threshold	DoG绠楀瓙镄勫搷搴斿€?
 		 *
+		 * \param	is_init_vlfeat	  	是否在函数内初始化和释放vlfeat的全局状态，多线程同时调用时
+		 *							应在所有线程启动前调用vl_constructor()，结束后调用vl_destructor()，并传入false
+		 * \param [out]	responses	  	不为NULL时输出每个特征的DoG峰值响应(绝对值)，与feats一一对应
 		 * \return	true if it succeeds, false if it fails.
 		 */
 		template<typename type>
@@ -70,7 +76,9 @@ namespace mvg {
 			std::vector<Descriptor<type, 128> >& descs,
 			bool is_zoom = false,
 			bool is_root_sift = false,
-			float contrast_threshold = 0.04f)
+			float contrast_threshold = 0.04f,
+			bool is_init_vlfeat = true,
+			std::vector<float> * responses = NULL)
 		{
 			// 绗竴缁勭殑绱㈠紩锛屽綋链间负-1锛屽垯锲惧儚鍦ㄨ绠楅佩鏂昂搴︾┖闂翠箣鍓嶅厛灏嗗昂搴︽墿澶т竴链?
 			int first_octave = (is_zoom == true) ? -1 : 0;
@@ -87,7 +95,8 @@ namespace mvg {
 			//杞崲涓烘诞镣圭被鍨嫔浘镀?
 			Image<float> float_image(image.GetMat().cast<float>());
 
-			vl_constructor();
+			if (is_init_vlfeat)
+				vl_constructor();
 
 			VlSiftFilt *filt = vl_sift_new(w, h, num_octaves, num_scales, first_octave);
 			if (edge_thresh >= 0)
@@ -105,6 +114,8 @@ namespace mvg {
 
 				VlSiftKeypoint const *keys = vl_sift_get_keypoints(filt);
 				int nkeys = vl_sift_get_nkeypoints(filt);
+				const int octave_width = vl_sift_get_octave_width(filt);
+				const int octave_size = octave_width * vl_sift_get_octave_height(filt);
 
 				for (int i = 0; i < nkeys; ++i) {
 					double angles[4];
@@ -121,6 +132,10 @@ namespace mvg {
 						siftDescToFloat(descr, descriptor, is_root_sift);
 						descs.push_back(descriptor);
 						feats.push_back(fp);
+						// 当前组的DoG在极值点(整数坐标)处的值
+						if (responses)
+							responses->push_back(std::abs(filt->dog[(keys[i].is - filt->s_min) * octave_size
+								+ keys[i].iy * octave_width + keys[i].ix]));
 					}
 				}
 				if (vl_sift_process_next_octave(filt))
@@ -128,7 +143,101 @@ namespace mvg {
 			}
 			vl_sift_delete(filt);
 
-			vl_destructor();
+			if (is_init_vlfeat)
+				vl_destructor();
+
+			return true;
+		}
+
+		/**
+		 * \brief	分块的Sift特征检测：图像按tile_size划分为网格，每个网格向外扩展overlap个像素
+		 *			后独立检测(多个网格并行)，只保留位于网格内的特征，并按DoG峰值响应保留每个网格
+		 *			最强的max_tile_features个特征。每幅图像的特征个数不超过网格数乘以max_tile_features，
+		 *			特征在图像中的分布也更均匀，匹配的时间和内存可以预估。
+		 *			网格限制了检测的最大尺度，尺度远大于overlap的特征可能丢失或者在网格边界处不稳定
+		 *
+		 * \tparam	type	描述子类型
+		 * \param	image			  	输入图像
+		 * \param [in,out]	feats	  	输出特征，按网格的行优先顺序排列
+		 * \param [in,out]	descs	  	输出特征描述子
+		 * \param	tile_size		  	网格的大小(像素)
+		 * \param	max_tile_features 	每个网格保留的特征个数上限
+		 * \param	overlap			  	网格向外扩展的像素数
+		 * \param	is_zoom			  	同SIFTDetector
+		 * \param	is_root_sift	  	同SIFTDetector
+		 * \param	contrast_threshold	同SIFTDetector
+		 * \param	is_init_vlfeat	  	同SIFTDetector
+		 *
+		 * \return	true if it succeeds, false if it fails.
+		 */
+		template<typename type>
+		static bool SIFTDetectorTiled(const Image<unsigned char>& image,
+			std::vector<ScalePointFeature>& feats,
+			std::vector<Descriptor<type, 128> >& descs,
+			int tile_size = 1024,
+			int max_tile_features = 2000,
+			int overlap = 64,
+			bool is_zoom = false,
+			bool is_root_sift = false,
+			float contrast_threshold = 0.04f,
+			bool is_init_vlfeat = true)
+		{
+			if (tile_size < 1 || max_tile_features < 1 || overlap < 0)
+				return false;
+			const int w = image.Width(), h = image.Height();
+			const int tile_cols = (w + tile_size - 1) / tile_size;
+			const int tile_rows = (h + tile_size - 1) / tile_size;
+			const int tile_count = tile_cols * tile_rows;
+
+			if (is_init_vlfeat)
+				vl_constructor();
+
+			std::vector<std::vector<ScalePointFeature> > vec_tile_feats(tile_count);
+			std::vector<std::vector<Descriptor<type, 128> > > vec_tile_descs(tile_count);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+			for (int t = 0; t < tile_count; ++t)
+			{
+				// 网格及扩展后的区域
+				const int cell_x = (t % tile_cols) * tile_size, cell_y = (t / tile_cols) * tile_size;
+				const int cell_w = std::min(tile_size, w - cell_x), cell_h = std::min(tile_size, h - cell_y);
+				const int x0 = std::max(0, cell_x - overlap), y0 = std::max(0, cell_y - overlap);
+				const int x1 = std::min(w, cell_x + cell_w + overlap), y1 = std::min(h, cell_y + cell_h + overlap);
+
+				Image<unsigned char> tile;
+				tile = image.GetMat().block(y0, x0, y1 - y0, x1 - x0);
+				std::vector<ScalePointFeature> vec_feats;
+				std::vector<Descriptor<type, 128> > vec_descs;
+				std::vector<float> vec_responses;
+				SIFTDetector(tile, vec_feats, vec_descs, is_zoom, is_root_sift, contrast_threshold,
+					false, &vec_responses);
+
+				// 只保留位于网格内的特征，按响应降序排列
+				std::vector<std::pair<float, size_t> > vec_candidates;
+				for (size_t k = 0; k < vec_feats.size(); ++k) {
+					const float x = vec_feats[k].x() + x0, y = vec_feats[k].y() + y0;
+					if (x >= cell_x && x < cell_x + cell_w && y >= cell_y && y < cell_y + cell_h)
+						vec_candidates.push_back(std::make_pair(-vec_responses[k], k));
+				}
+				const size_t count = std::min(vec_candidates.size(), size_t(max_tile_features));
+				std::partial_sort(vec_candidates.begin(), vec_candidates.begin() + count, vec_candidates.end());
+				for (size_t k = 0; k < count; ++k) {
+					ScalePointFeature fp = vec_feats[vec_candidates[k].second];
+					fp.x() += x0;
+					fp.y() += y0;
+					vec_tile_feats[t].push_back(fp);
+					vec_tile_descs[t].push_back(vec_descs[vec_candidates[k].second]);
+				}
+			}
+
+			for (int t = 0; t < tile_count; ++t) {
+				feats.insert(feats.end(), vec_tile_feats[t].begin(), vec_tile_feats[t].end());
+				descs.insert(descs.end(), vec_tile_descs[t].begin(), vec_tile_descs[t].end());
+			}
+
+			if (is_init_vlfeat)
+				vl_destructor();
 
 			return true;
 		}
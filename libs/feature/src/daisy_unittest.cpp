@@ -0,0 +1,91 @@
+﻿#include "testing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "mvg/feature/daisy.hpp"
+
+using namespace std;
+using namespace mvg::feature;
+using namespace mvg::image;
+
+// 平滑的随机纹理，灰度范围0-255
+static Image<float> MakeTexturedImage(int width, int height)
+{
+  Image<float> image(width, height);
+  srand(3);
+  vector<float> vec_phase(8);
+  for (size_t i = 0; i < vec_phase.size(); ++i)
+    vec_phase[i] = (rand() % 1000) / 100.f;
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      image(y, x) = 127.5f + 60.f * sin(0.21f * x + vec_phase[0]) * cos(0.13f * y + vec_phase[1])
+        + 60.f * sin(0.07f * x + 0.17f * y + vec_phase[2]);
+  return image;
+}
+
+TEST(DAISY, GridLayout)
+{
+  const Image<float> image = MakeTexturedImage(100, 80);
+  DaisyExtractor extractor(10.f, 5);
+  vector<PointFeature> feats;
+  vector<DaisyExtractor::DescriptorT> descs;
+  EXPECT_TRUE(extractor.compute(image, feats, descs));
+
+  int cols = 0, rows = 0;
+  extractor.gridSize(image.Width(), image.Height(), cols, rows);
+  EXPECT_EQ(200, DaisyExtractor::DescriptorT::kStaticSize);
+  EXPECT_EQ(size_t(cols * rows), feats.size());
+  EXPECT_EQ(feats.size(), descs.size());
+  // 按行优先顺序排列，所有采样点都在图像内
+  EXPECT_EQ(extractor.border(), feats[0].x());
+  EXPECT_EQ(extractor.border(), feats[0].y());
+  EXPECT_EQ(feats[0].x() + 5, feats[1].x());
+  EXPECT_EQ(feats[0].y() + 5, feats[cols].y());
+  EXPECT_TRUE(feats.back().x() + extractor.border() < image.Width());
+  EXPECT_TRUE(feats.back().y() + extractor.border() < image.Height());
+
+  // 描述子在一块连续的内存中
+  EXPECT_EQ(descs[0].getData() + 200, descs[1].getData());
+
+  // 图像小于描述子
+  EXPECT_FALSE(extractor.compute(Image<float>(20, 20), feats, descs));
+  EXPECT_TRUE(descs.empty());
+}
+
+TEST(DAISY, TranslationEquivariance)
+{
+  const int step = 4;
+  const Image<float> image = MakeTexturedImage(120, 90);
+  // 向右平移一个网格间隔
+  Image<float> shifted(image.Width(), image.Height());
+  for (int y = 0; y < image.Height(); ++y)
+    for (int x = 0; x < image.Width(); ++x)
+      shifted(y, x) = image(y, max(0, x - step));
+
+  DaisyExtractor extractor(12.f, step);
+  vector<PointFeature> feats, shifted_feats;
+  vector<DaisyExtractor::DescriptorT> descs, shifted_descs;
+  EXPECT_TRUE(extractor.compute(image, feats, descs));
+  EXPECT_TRUE(extractor.compute(shifted, shifted_feats, shifted_descs));
+
+  int cols = 0, rows = 0;
+  extractor.gridSize(image.Width(), image.Height(), cols, rows);
+  // 远离图像边界的网格点，平移后的描述子与原图左边一列的描述子相同，与其他位置不同
+  const int r = rows / 2;
+  for (int c = cols / 3; c < 2 * cols / 3; ++c) {
+    const float * a = descs[r * cols + c - 1].getData();
+    const float * b = shifted_descs[r * cols + c].getData();
+    const float * other = descs[r * cols + c].getData();
+    float same = 0.f, different = 0.f, norm = 0.f;
+    for (int k = 0; k < 200; ++k) {
+      same += (a[k] - b[k]) * (a[k] - b[k]);
+      different += (other[k] - b[k]) * (other[k] - b[k]);
+      norm += a[k] * a[k];
+    }
+    EXPECT_TRUE(norm > 0.f);
+    EXPECT_NEAR(0.f, same, 1e-4f);
+    EXPECT_TRUE(different > 1e-2f);
+  }
+}
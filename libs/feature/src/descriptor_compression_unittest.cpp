@@ -0,0 +1,211 @@
+#include "testing.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "mvg/feature/descriptor_compression.h"
+#include "mvg/feature/metric.h"
+
+using namespace std;
+using namespace mvg::feature;
+
+static float SquaredDistance(const float * a, const float * b, size_t dim)
+{
+  float distance = 0.f;
+  for (size_t d = 0; d < dim; ++d)
+    distance += (a[d] - b[d]) * (a[d] - b[d]);
+  return distance;
+}
+
+// count个dim维的随机描述子，分量在0-255之间
+static vector<float> RandomDescriptors(size_t count, size_t dim)
+{
+  vector<float> vec_data(count * dim);
+  for (size_t i = 0; i < vec_data.size(); ++i)
+    vec_data[i] = float(rand() % 256);
+  return vec_data;
+}
+
+TEST(DescriptorPCA, PreservesDistancesInSubspace)
+{
+  // 8维描述子都在一个2维的仿射子空间中
+  const size_t count = 200, dim = 8;
+  const float u[dim] = { 1, 2, 0, -1, 3, 0, 1, 2 }, v[dim] = { 0, 1, 3, 1, -1, 2, 0, -2 };
+  srand(5);
+  vector<float> vec_data(count * dim);
+  for (size_t i = 0; i < count; ++i) {
+    const float a = float(rand() % 100) / 10.f, b = float(rand() % 100) / 10.f;
+    for (size_t d = 0; d < dim; ++d)
+      vec_data[i * dim + d] = 100.f + a * u[d] + b * v[d];
+  }
+
+  DescriptorPCA pca;
+  EXPECT_FALSE(pca.train(&vec_data[0], count, dim, dim + 1));
+  EXPECT_TRUE(pca.train(&vec_data[0], count, dim, 2));
+  EXPECT_EQ(dim, pca.inputDimension());
+  EXPECT_EQ(2, pca.outputDimension());
+
+  vector<float> vec_projected(count * 2);
+  for (size_t i = 0; i < count; ++i)
+    pca.project(&vec_data[i * dim], &vec_projected[i * 2]);
+  for (size_t i = 1; i < count; ++i) {
+    const float original = SquaredDistance(&vec_data[0], &vec_data[i * dim], dim);
+    EXPECT_NEAR(original, SquaredDistance(&vec_projected[0], &vec_projected[i * 2], 2), 1e-3f * (1.f + original));
+  }
+
+  // 读取保存的主成分后编码结果相同
+  const string file_name = "descriptor_pca_unittest.bin";
+  EXPECT_TRUE(pca.save(file_name));
+  DescriptorPCA loaded;
+  EXPECT_TRUE(loaded.load(file_name));
+  remove(file_name.c_str());
+  unsigned char code[2], loaded_code[2];
+  for (size_t i = 0; i < count; ++i) {
+    pca.encode(&vec_data[i * dim], code);
+    loaded.encode(&vec_data[i * dim], loaded_code);
+    EXPECT_EQ(code[0], loaded_code[0]);
+    EXPECT_EQ(code[1], loaded_code[1]);
+  }
+}
+
+TEST(ProductQuantizer, EncodeDecode)
+{
+  const size_t count = 2000, dim = 16, subspace_count = 4;
+  srand(11);
+  const vector<float> vec_data = RandomDescriptors(count, dim);
+
+  ProductQuantizer pq;
+  EXPECT_FALSE(pq.train(&vec_data[0], 100, dim, subspace_count));
+  EXPECT_FALSE(pq.train(&vec_data[0], count, dim, 5));
+  EXPECT_TRUE(pq.train(&vec_data[0], count, dim, subspace_count));
+  EXPECT_EQ(dim, pq.dimension());
+  EXPECT_EQ(subspace_count, pq.subspaceCount());
+
+  // 量化误差远小于描述子之间的距离
+  double error = 0.0, spread = 0.0;
+  vector<unsigned char> code(subspace_count);
+  vector<float> decoded(dim), table(subspace_count * ProductQuantizer::kCentroidCount);
+  for (size_t i = 0; i < count; ++i) {
+    pq.encode(&vec_data[i * dim], &code[0]);
+    pq.decode(&code[0], &decoded[0]);
+    error += SquaredDistance(&vec_data[i * dim], &decoded[0], dim);
+    spread += SquaredDistance(&vec_data[i * dim], &vec_data[((i + 1) % count) * dim], dim);
+
+    // 非对称距离等于到重建描述子的距离
+    pq.distanceTable(&vec_data[0], &table[0]);
+    const float exact = SquaredDistance(&vec_data[0], &decoded[0], dim);
+    EXPECT_NEAR(exact, pq.distance(&table[0], &code[0]), 1e-3f * exact);
+  }
+  EXPECT_TRUE(error < 0.25 * spread);
+
+  const string file_name = "product_quantizer_unittest.bin";
+  EXPECT_TRUE(pq.save(file_name));
+  ProductQuantizer loaded;
+  EXPECT_TRUE(loaded.load(file_name));
+  remove(file_name.c_str());
+  vector<unsigned char> loaded_code(subspace_count);
+  for (size_t i = 0; i < count; ++i) {
+    pq.encode(&vec_data[i * dim], &code[0]);
+    loaded.encode(&vec_data[i * dim], &loaded_code[0]);
+    EXPECT_EQ(code, loaded_code);
+  }
+}
+
+// 写入码本文件头和centroid_count个中心
+static void WriteCodebook(const string & file_name, size_t dimension, size_t subspace_count, size_t centroid_count)
+{
+  FILE * file = fopen(file_name.c_str(), "wb");
+  fwrite(&dimension, sizeof(size_t), 1, file);
+  fwrite(&subspace_count, sizeof(size_t), 1, file);
+  const vector<float> centroids(centroid_count, 1.f);
+  if (!centroids.empty())
+    fwrite(&centroids[0], sizeof(float), centroids.size(), file);
+  fclose(file);
+}
+
+TEST(ProductQuantizer, RejectInvalidCodebook)
+{
+  const string file_name = "product_quantizer_invalid.bin";
+  const size_t centroid_count = 16 * ProductQuantizer::kCentroidCount;
+  ProductQuantizer pq;
+
+  WriteCodebook(file_name, 16, 4, centroid_count);
+  EXPECT_TRUE(pq.load(file_name));
+  EXPECT_EQ(16, pq.dimension());
+
+  // 维数或分段个数为零、不能整除
+  WriteCodebook(file_name, 0, 4, 0);
+  EXPECT_FALSE(pq.load(file_name));
+  WriteCodebook(file_name, 16, 0, centroid_count);
+  EXPECT_FALSE(pq.load(file_name));
+  WriteCodebook(file_name, 16, 5, centroid_count);
+  EXPECT_FALSE(pq.load(file_name));
+  // 维数过大，乘以中心个数后溢出
+  WriteCodebook(file_name, size_t(1) << (sizeof(size_t) * 8 - 4), 1, 0);
+  EXPECT_FALSE(pq.load(file_name));
+  WriteCodebook(file_name, ProductQuantizer::kMaxDimension + 1, 1, 0);
+  EXPECT_FALSE(pq.load(file_name));
+  // 码本被截断或者带有多余的数据
+  WriteCodebook(file_name, 16, 4, centroid_count - 1);
+  EXPECT_FALSE(pq.load(file_name));
+  WriteCodebook(file_name, 16, 4, centroid_count + 1);
+  EXPECT_FALSE(pq.load(file_name));
+  remove(file_name.c_str());
+
+  // 读取失败时保留原来的码本
+  EXPECT_EQ(16, pq.dimension());
+  EXPECT_EQ(4, pq.subspaceCount());
+}
+
+TEST(ArrayMatcherProductQuantization, NearestNeighbour)
+{
+  const size_t count = 1000, dim = 32, subspace_count = 8;
+  srand(13);
+  const vector<float> vec_data = RandomDescriptors(count, dim);
+  std::shared_ptr<ProductQuantizer> pq(new ProductQuantizer);
+  EXPECT_TRUE(pq->train(&vec_data[0], count, dim, subspace_count));
+
+  vector<unsigned char> vec_codes(count * subspace_count);
+  for (size_t i = 0; i < count; ++i)
+    pq->encode(&vec_data[i * dim], &vec_codes[i * subspace_count]);
+
+  // 默认构造的匹配算子没有码本
+  ArrayMatcherProductQuantization no_codebook;
+  EXPECT_FALSE(no_codebook.Build(&vec_codes[0], (int)count, (int)subspace_count));
+
+  ArrayMatcherProductQuantization matcher(pq);
+  EXPECT_FALSE(matcher.Build(&vec_codes[0], (int)count, (int)dim));
+  EXPECT_TRUE(matcher.Build(&vec_codes[0], (int)count, (int)subspace_count));
+
+  // 未编码的查询，每个描述子的最近邻是它自己
+  vector<int> vec_indice;
+  vector<float> vec_distance;
+  EXPECT_TRUE(matcher.SearchNeighboursADC(&vec_data[0], (int)count, &vec_indice, &vec_distance, 2));
+  int correct_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_TRUE(vec_distance[2 * i] <= vec_distance[2 * i + 1]);
+    if (vec_indice[2 * i] == (int)i)
+      ++correct_count;
+  }
+  EXPECT_TRUE(correct_count > 0.95 * count);
+
+  // unsigned char的未编码查询(例如SIFT)与float的查询结果相同
+  const vector<unsigned char> vec_queries(vec_data.begin(), vec_data.end());
+  vector<int> vec_uchar_indice;
+  vector<float> vec_uchar_distance;
+  EXPECT_TRUE(matcher.SearchNeighbours(&vec_queries[0], (int)count, &vec_uchar_indice, &vec_uchar_distance, 2));
+  EXPECT_EQ(vec_indice, vec_uchar_indice);
+  EXPECT_EQ(vec_distance, vec_uchar_distance);
+
+  // 数据集小于k时剩余的近邻无效
+  ArrayMatcherProductQuantization small_matcher(pq);
+  EXPECT_TRUE(small_matcher.Build(&vec_codes[0], 1, (int)subspace_count));
+  EXPECT_TRUE(small_matcher.SearchNeighboursADC(&vec_data[0], 1, &vec_indice, &vec_distance, 2));
+  EXPECT_EQ(0, vec_indice[0]);
+  EXPECT_EQ(-1, vec_indice[1]);
+
+  EXPECT_TRUE(MetricTraits<ArrayMatcherProductQuantization::MetricT>::kIsSquared);
+}
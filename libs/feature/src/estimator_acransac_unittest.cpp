@@ -186,6 +186,76 @@ TEST(RansacLineFitter, RealisticCase) {
   EXPECT_NEAR( 6.3, line[1], 1e-9);
 }
 
+// 统计模型估计次数的ACRANSAC内核
+class CountingLineKernel : public ACRANSACOneViewKernel<LineSolver, PointToLineError, Vec2>
+{
+public:
+  CountingLineKernel(const Mat &x1, int w1, int h1)
+    : ACRANSACOneViewKernel<LineSolver, PointToLineError, Vec2>(x1, w1, h1), fit_count(0) {}
+
+  void Fit(const std::vector<size_t> &samples, std::vector<Vec2> *models) const {
+    ++fit_count;
+    ACRANSACOneViewKernel<LineSolver, PointToLineError, Vec2>::Fit(samples, models);
+  }
+
+  mutable size_t fit_count;
+};
+
+TEST(RansacLineFitter, EarlyExit) {
+
+  // 默认不提前终止；内点比例0.5、样本大小为5时，以0.99的概率抽到全内点样本需要146次迭代
+  EXPECT_EQ(0, ACRansacEarlyExit().probeIterations(5, 100));
+  EXPECT_EQ(146, ACRansacEarlyExit(50, .3).probeIterations(5, 100));
+  EXPECT_EQ(146, ACRansacEarlyExit(10, .5).probeIterations(5, 100));
+
+  // 数据少于需要的内点个数时直接返回
+  {
+    Mat2X xy(2, 5);
+    xy << 1, 2, 3, 4,  5,
+          3, 5, 7, 9, 11;
+    CountingLineKernel lineKernel(xy, 12, 12);
+    std::vector<size_t> vec_inliers;
+    ACRANSAC(lineKernel, vec_inliers, 300, (Vec2*)NULL,
+      std::numeric_limits<double>::infinity(), false, ACRansacEarlyExit(6));
+    EXPECT_EQ(0, vec_inliers.size());
+    EXPECT_EQ(0, lineKernel.fit_count);
+  }
+
+  // 70%的点在直线上，提前终止的策略不影响结果
+  const int NbPoints = 30;
+  Mat2X xy(2, NbPoints);
+  srand(3);
+  for (int i = 0; i < NbPoints; ++i)
+    xy.col(i) << i, 6.3 * i - 2.0 + (rand() % 11 - 5) * 0.01;
+  for (int i = 0; i < NbPoints; i += 3)
+    xy.col(i) << xy.col(i)(0), xy.col(i)(1) + 20 + rand() % 50;
+  {
+    CountingLineKernel lineKernel(xy, 30, 200);
+    std::vector<size_t> vec_inliers;
+    Vec2 line;
+    ACRANSAC(lineKernel, vec_inliers, 300, &line,
+      std::numeric_limits<double>::infinity(), false, ACRansacEarlyExit(15, .5));
+    EXPECT_EQ(20, vec_inliers.size());
+    EXPECT_NEAR(-2.0, line[0], 0.1);
+    EXPECT_NEAR( 6.3, line[1], 0.01);
+  }
+
+  // 随机的点没有有意义的直线，探测迭代之后终止
+  Mat2X random_xy(2, NbPoints);
+  for (int i = 0; i < NbPoints; ++i)
+    random_xy.col(i) << rand() % 1000, rand() % 1000;
+  CountingLineKernel full_kernel(random_xy, 1000, 1000), early_kernel(random_xy, 1000, 1000);
+  std::vector<size_t> vec_inliers;
+  ACRANSAC(full_kernel, vec_inliers, 300);
+  EXPECT_EQ(0, vec_inliers.size());
+  const ACRansacEarlyExit early_exit(15, .5);
+  ACRANSAC(early_kernel, vec_inliers, 300, (Vec2*)NULL,
+    std::numeric_limits<double>::infinity(), false, early_exit);
+  EXPECT_EQ(0, vec_inliers.size());
+  EXPECT_EQ(early_exit.probeIterations(2, NbPoints), early_kernel.fit_count);
+  EXPECT_TRUE(early_kernel.fit_count * 10 < full_kernel.fit_count);
+}
+
 // Generate a random value between [0;1]
 static inline double randValue()  {
   return rand()/double(RAND_MAX);
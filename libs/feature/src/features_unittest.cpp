@@ -61,3 +61,61 @@ TEST(descriptorIO, BINARY) {
       EXPECT_EQ(vec_descs[i][j], vec_descs_read[i][j]);
   }
 }
+
+
+//测试二进制特征的导入导出
+TEST(featureIO, BINARY) {
+  std::vector<ScalePointFeature> vec_feats;
+  for (int i = 0; i < kCardDescs; ++i)
+    vec_feats.push_back(ScalePointFeature(i, 2.f*i, 0.5f*i, 0.1f*i));
+
+  EXPECT_TRUE(SaveFeatsToBinFile("tempFeatsBin.feat", vec_feats));
+  EXPECT_TRUE(IsFeatsBinFile("tempFeatsBin.feat"));
+
+  //LoadFeatsFromFile自动识别二进制格式
+  std::vector<ScalePointFeature> vec_feats_read;
+  EXPECT_TRUE(LoadFeatsFromFile("tempFeatsBin.feat", vec_feats_read));
+  EXPECT_EQ(kCardDescs, vec_feats_read.size());
+  for (int i = 0; i < kCardDescs; ++i)
+    EXPECT_TRUE(vec_feats[i] == vec_feats_read[i]);
+
+  //点特征只保留坐标
+  std::vector<PointFeature> vec_points_read;
+  EXPECT_TRUE(LoadFeatsFromBinFile("tempFeatsBin.feat", vec_points_read));
+  EXPECT_EQ(kCardDescs, vec_points_read.size());
+  EXPECT_EQ(vec_feats[3].x(), vec_points_read[3].x());
+  EXPECT_EQ(vec_feats[3].y(), vec_points_read[3].y());
+}
+
+//测试文本特征仍然可以导入，并行导入多个文件
+TEST(featureIO, ASCII_AND_MULTIPLE_FILES) {
+  std::vector<ScalePointFeature> vec_feats;
+  for (int i = 0; i < kCardDescs; ++i)
+    vec_feats.push_back(ScalePointFeature(i, 2.f*i, 0.5f*i, 0.25f*i));
+
+  saveFeatsToFile("tempFeats.feat", vec_feats);
+  EXPECT_FALSE(IsFeatsBinFile("tempFeats.feat"));
+  SaveFeatsToBinFile("tempFeatsBin.feat", vec_feats);
+
+  std::vector<std::string> vec_filenames;
+  vec_filenames.push_back("tempFeats.feat");
+  vec_filenames.push_back("tempFeatsBin.feat");
+  std::map<size_t, std::vector<ScalePointFeature> > map_feats;
+  EXPECT_TRUE(LoadFeatsFromFiles(vec_filenames, map_feats));
+  EXPECT_EQ(2, map_feats.size());
+  for (int i = 0; i < kCardDescs; ++i) {
+    EXPECT_TRUE(map_feats[0][i] == vec_feats[i]);
+    EXPECT_TRUE(map_feats[1][i] == vec_feats[i]);
+  }
+}
+
+TEST(featureIO, RescaleFeatures) {
+  std::vector<ScalePointFeature> vec_feats;
+  vec_feats.push_back(ScalePointFeature(0.f, 1.5f, 2.f, 0.3f));
+  // 在1/4大小的图像上检测的特征，像素中心对齐变换到原图
+  RescaleFeatures(vec_feats, 4.f);
+  EXPECT_FLOAT_EQ(1.5f, vec_feats[0].x());
+  EXPECT_FLOAT_EQ(7.5f, vec_feats[0].y());
+  EXPECT_FLOAT_EQ(8.f, vec_feats[0].scale());
+  EXPECT_FLOAT_EQ(0.3f, vec_feats[0].orientation());
+}
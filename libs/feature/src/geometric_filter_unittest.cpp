@@ -0,0 +1,131 @@
+#include "testing.h"
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "mvg/feature/features.h"
+#include "mvg/feature/geometric_filter.h"
+#include "mvg/feature/pairwise_matches_store.h"
+
+using namespace std;
+using namespace mvg;
+using namespace mvg::feature;
+
+typedef ImageCollectionGeometricFilter<ScalePointFeature> GeometricFilterT;
+
+// 测试用的几何过滤：右图像的点等于左图像的点平移(10, 0)时为内点，少于3个内点时没有结果
+struct TranslationFilter
+{
+  void Fit(const Mat & xA, const std::pair<size_t, size_t> &,
+    const Mat & xB, const std::pair<size_t, size_t> &,
+    std::vector<size_t> & vec_inliers) const
+  {
+    vec_inliers.clear();
+    for (size_t i = 0; i < (size_t)xA.cols(); ++i) {
+      if (std::abs(xB(0, i) - xA(0, i) - 10.0) < 1e-6 && std::abs(xB(1, i) - xA(1, i)) < 1e-6)
+        vec_inliers.push_back(i);
+    }
+    if (vec_inliers.size() < 3)
+      vec_inliers.clear();
+  }
+};
+
+// 所有图像的第k个特征都位于(k, 0)，平移(10, 0)对应特征k到特征k + 10
+static std::shared_ptr<GeometricFilterT::RegionCacheT> CreateRegions(size_t image_count, size_t feature_count)
+{
+  std::shared_ptr<GeometricFilterT::RegionCacheT> region_cache(new GeometricFilterT::RegionCacheT);
+  for (size_t id = 0; id < image_count; ++id) {
+    std::shared_ptr<GeometricFilterT::RegionCacheT::Regions> regions(new GeometricFilterT::RegionCacheT::Regions);
+    for (size_t k = 0; k < feature_count; ++k)
+      regions->features.push_back(ScalePointFeature(float(k), 0.f));
+    region_cache->put(id, regions);
+  }
+  return region_cache;
+}
+
+// 图像对(i, j)有(i + j) % 7个内点，以及多3个的外点
+static PairWiseMatches CreatePutatives(size_t image_count)
+{
+  PairWiseMatches map_putatives;
+  for (size_t i = 0; i < image_count; ++i) {
+    for (size_t j = i + 1; j < image_count; ++j) {
+      std::vector<IndexedMatch> & vec_matches = map_putatives[std::make_pair(i, j)];
+      const size_t inlier_count = (i + j) % 7;
+      for (size_t k = 0; k < 2 * inlier_count + 3; ++k)
+        vec_matches.push_back(IndexedMatch(k, k < inlier_count ? k + 10 : k + 3));
+    }
+  }
+  return map_putatives;
+}
+
+TEST(ImageCollectionGeometricFilter, StreamMatchesInMemory)
+{
+  const size_t image_count = 12;
+  std::shared_ptr<GeometricFilterT::RegionCacheT> region_cache = CreateRegions(image_count, 40);
+  PairWiseMatches map_putatives = CreatePutatives(image_count);
+  const std::vector<std::pair<size_t, size_t> > vec_images_size(image_count, std::make_pair(size_t(100), size_t(100)));
+
+  GeometricFilterT geometric_filter(region_cache);
+  PairWiseMatches map_geometric;
+  geometric_filter.Filter(TranslationFilter(), map_putatives, map_geometric, vec_images_size);
+
+  // 内点不少于3个的图像对保留下来，且只包含内点
+  size_t expected_pair_count = 0;
+  for (PairWiseMatches::const_iterator iter = map_putatives.begin(); iter != map_putatives.end(); ++iter) {
+    const size_t inlier_count = (iter->first.first + iter->first.second) % 7;
+    if (inlier_count < 3)
+      continue;
+    ++expected_pair_count;
+    ASSERT_TRUE(map_geometric.count(iter->first) == 1);
+    EXPECT_EQ(inlier_count, map_geometric[iter->first].size());
+  }
+  EXPECT_EQ(expected_pair_count, map_geometric.size());
+
+  // 流式过滤，每块3个图像对，结果与内存中的过滤相同
+  const std::string putative_file = "geometric_filter_putative.bin";
+  const std::string geometric_file = "geometric_filter_geometric.bin";
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(map_putatives, putative_file));
+  EXPECT_TRUE(geometric_filter.FilterStream(TranslationFilter(), putative_file, geometric_file, vec_images_size, 3));
+  PairWiseMatchesStore store;
+  EXPECT_TRUE(store.open(geometric_file));
+  PairWiseMatches map_streamed;
+  store.load(map_streamed);
+  store.close();
+  EXPECT_TRUE(map_geometric == map_streamed);
+
+  // 初始匹配少于下限的图像对直接跳过
+  geometric_filter.setMinPutativeCount(12);
+  EXPECT_TRUE(geometric_filter.FilterStream(TranslationFilter(), putative_file, geometric_file, vec_images_size));
+  EXPECT_TRUE(store.open(geometric_file));
+  for (size_t k = 0; k < store.size(); ++k) {
+    const std::vector<IndexedMatch> & vec_putatives = map_putatives[store.pairAt(k)];
+    EXPECT_TRUE(vec_putatives.size() >= 12);
+  }
+  EXPECT_TRUE(store.size() < map_geometric.size());
+  store.close();
+
+  // 内点个数或比例不足的图像对不输出，内存中和流式的过滤结果相同
+  geometric_filter.setMinPutativeCount(0);
+  geometric_filter.setMinInliers(4, 0.4f);
+  PairWiseMatches map_kept;
+  geometric_filter.Filter(TranslationFilter(), map_putatives, map_kept, vec_images_size);
+  for (PairWiseMatches::const_iterator iter = map_geometric.begin(); iter != map_geometric.end(); ++iter) {
+    const float ratio = iter->second.size() / (float)map_putatives[iter->first].size();
+    EXPECT_EQ(iter->second.size() >= 4 && ratio >= 0.4f, map_kept.count(iter->first) == 1);
+  }
+  EXPECT_TRUE(!map_kept.empty() && map_kept.size() < map_geometric.size());
+  EXPECT_TRUE(geometric_filter.FilterStream(TranslationFilter(), putative_file, geometric_file, vec_images_size, 3));
+  EXPECT_TRUE(store.open(geometric_file));
+  store.load(map_streamed);
+  store.close();
+  EXPECT_TRUE(map_kept == map_streamed);
+  geometric_filter.setMinInliers(0, 0.f);
+
+  // 初始匹配文件不存在
+  EXPECT_FALSE(geometric_filter.FilterStream(TranslationFilter(), "missing_putative.bin", geometric_file, vec_images_size));
+
+  remove(putative_file.c_str());
+  remove(geometric_file.c_str());
+}
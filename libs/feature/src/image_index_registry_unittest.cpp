@@ -0,0 +1,100 @@
+﻿#include "testing.h"
+#include "mvg/feature/features.h"
+#include "mvg/feature/image_index_registry.h"
+#include "mvg/feature/matcher_kdtree_flann.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace mvg::feature;
+
+typedef Descriptor<unsigned char, 128> DescT;
+typedef RegionCache<ScalePointFeature, DescT> RegionCacheT;
+typedef ArrayMatcherKdtreeFlann<unsigned char, flann::L2<unsigned char> > MatcherT;
+typedef ImageIndexRegistry<RegionCacheT, MatcherT> RegistryT;
+
+// 生成image_count幅图像，每幅图像有feature_count个随机的描述子
+static std::shared_ptr<RegionCacheT> CreateRegionCache(size_t image_count, size_t feature_count)
+{
+  std::shared_ptr<RegionCacheT> cache(new RegionCacheT);
+  for (size_t i = 0; i < image_count; ++i) {
+    std::shared_ptr<RegionCacheT::Regions> regions(new RegionCacheT::Regions);
+    for (size_t k = 0; k < feature_count; ++k) {
+      regions->features.push_back(ScalePointFeature(float(k), float(i)));
+      DescT desc;
+      for (size_t j = 0; j < DescT::kStaticSize; ++j)
+        desc[j] = static_cast<unsigned char>(rand() % 256);
+      regions->descriptors.push_back(desc);
+    }
+    cache->put(i, regions);
+  }
+  return cache;
+}
+
+TEST(ImageIndexRegistry, BuildOnce)
+{
+  std::shared_ptr<RegionCacheT> cache = CreateRegionCache(3, 50);
+  RegistryT registry(cache);
+  registry.buildAll(3);
+  EXPECT_EQ(3, registry.builtCount());
+
+  // 再次获取时返回同一个索引
+  RegistryT::Entry entry = registry.get(1);
+  EXPECT_TRUE(entry.isValid());
+  EXPECT_TRUE(entry.matcher == registry.get(1).matcher);
+  EXPECT_EQ(3, registry.builtCount());
+
+  // 每个描述子的最近邻是自身
+  std::vector<int> vec_indice;
+  std::vector<float> vec_distance;
+  EXPECT_TRUE(entry.matcher->SearchNeighbours(
+    entry.regions->descriptors[7].getData(), 1, &vec_indice, &vec_distance, 1));
+  EXPECT_EQ(7, vec_indice[0]);
+
+  // 没有描述子的图像
+  EXPECT_FALSE(registry.get(10).isValid());
+
+  // 释放后重新建立
+  registry.release(1);
+  EXPECT_TRUE(registry.get(1).isValid());
+  EXPECT_EQ(4, registry.builtCount());
+}
+
+TEST(ImageIndexRegistry, SaveAndLoadIndexFile)
+{
+  std::shared_ptr<RegionCacheT> cache = CreateRegionCache(1, 200);
+  const std::string index_file = "tempImageIndexRegistry.flann";
+  remove(index_file.c_str());
+
+  std::vector<int> vec_indice_built, vec_indice_loaded;
+  std::vector<float> vec_distance_built, vec_distance_loaded;
+  const unsigned char *queries = cache->get(0)->descriptors[0].getData();
+  {
+    RegistryT registry(cache);
+    registry.setIndexFile(0, index_file);
+    RegistryT::Entry entry = registry.get(0);
+    EXPECT_EQ(1, registry.builtCount());
+    EXPECT_EQ(0, registry.loadedCount());
+    entry.matcher->SearchNeighbours(queries, 20, &vec_indice_built, &vec_distance_built, 2);
+  }
+  {
+    // 重新运行时直接读取索引文件
+    RegistryT registry(cache);
+    registry.setIndexFile(0, index_file);
+    RegistryT::Entry entry = registry.get(0);
+    EXPECT_TRUE(entry.isValid());
+    EXPECT_EQ(0, registry.builtCount());
+    EXPECT_EQ(1, registry.loadedCount());
+    entry.matcher->SearchNeighbours(queries, 20, &vec_indice_loaded, &vec_distance_loaded, 2);
+  }
+  EXPECT_TRUE(vec_indice_built == vec_indice_loaded);
+  EXPECT_TRUE(vec_distance_built == vec_distance_loaded);
+
+  // 数据个数不一致时重新建立索引
+  std::shared_ptr<RegionCacheT> other = CreateRegionCache(1, 100);
+  RegistryT registry(other);
+  registry.setIndexFile(0, index_file);
+  EXPECT_TRUE(registry.get(0).isValid());
+  EXPECT_EQ(1, registry.builtCount());
+  remove(index_file.c_str());
+}
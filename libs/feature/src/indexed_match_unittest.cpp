@@ -1,5 +1,6 @@
 ﻿#include "testing.h"
 #include "mvg/feature/indexed_match.h"
+#include "mvg/feature/indexed_match_utils.h"
 
 using namespace mvg::feature;
 
@@ -52,3 +53,87 @@ TEST(IndexedMatch, DuplicateRemoval)
   EXPECT_EQ(IndexedMatch(0,1), vec_indexed_match[0]);
   EXPECT_EQ(IndexedMatch(2,3), vec_indexed_match[1]);
 }
+
+TEST(IndexedMatch, CompareImageLists)
+{
+  std::vector<std::string> vec_old_names, vec_names;
+  vec_old_names.push_back("a.jpg");
+  vec_old_names.push_back("b.jpg");
+  vec_old_names.push_back("c.jpg");
+  // b被移除，d和e是新加入的图像，a和c的顺序改变
+  vec_names.push_back("d.jpg");
+  vec_names.push_back("c.jpg");
+  vec_names.push_back("a.jpg");
+  vec_names.push_back("e.jpg");
+
+  std::vector<int> vec_new_index;
+  std::vector<bool> vec_is_new;
+  EXPECT_EQ(2, CompareImageLists(vec_old_names, vec_names, vec_new_index, vec_is_new));
+  EXPECT_EQ(2, vec_new_index[0]);
+  EXPECT_EQ(-1, vec_new_index[1]);
+  EXPECT_EQ(1, vec_new_index[2]);
+  EXPECT_TRUE(vec_is_new[0]);
+  EXPECT_FALSE(vec_is_new[1]);
+  EXPECT_FALSE(vec_is_new[2]);
+  EXPECT_TRUE(vec_is_new[3]);
+
+  // 只需要匹配包含新图像的图像对，(1,2)已经匹配过
+  const std::vector<std::pair<size_t, size_t> > vec_pairs = PairsWithNewImages(vec_is_new);
+  EXPECT_EQ(5, vec_pairs.size());
+  EXPECT_TRUE(std::find(vec_pairs.begin(), vec_pairs.end(), std::make_pair(size_t(1), size_t(2))) == vec_pairs.end());
+  EXPECT_TRUE(std::find(vec_pairs.begin(), vec_pairs.end(), std::make_pair(size_t(1), size_t(3))) != vec_pairs.end());
+}
+
+TEST(IndexedMatch, RemapPairWiseMatches)
+{
+  PairWiseMatches map_matches;
+  map_matches[std::make_pair(0, 1)].push_back(IndexedMatch(5, 6));
+  map_matches[std::make_pair(0, 2)].push_back(IndexedMatch(7, 8));
+
+  // 0 -> 2, 1被移除, 2 -> 1
+  std::vector<int> vec_new_index;
+  vec_new_index.push_back(2);
+  vec_new_index.push_back(-1);
+  vec_new_index.push_back(1);
+
+  PairWiseMatches map_remapped;
+  RemapPairWiseMatches(map_matches, vec_new_index, map_remapped);
+  EXPECT_EQ(1, map_remapped.size());
+  // 图像对交换后每个匹配的左右索引也要交换
+  const std::vector<IndexedMatch> & vec_matches = map_remapped[std::make_pair(1, 2)];
+  EXPECT_EQ(1, vec_matches.size());
+  EXPECT_EQ(IndexedMatch(8, 7), vec_matches[0]);
+}
+
+TEST(IndexedMatch, ShardPairs)
+{
+  std::vector<bool> vec_is_new(50, true);
+  const std::vector<std::pair<size_t, size_t> > vec_pairs = PairsWithNewImages(vec_is_new);
+  const size_t shard_count = 7;
+
+  // 所有分片互不相交，并集等于所有图像对，每个分片的个数相差不超过1
+  std::vector<std::pair<size_t, size_t> > vec_union;
+  for (size_t k = 0; k < shard_count; ++k) {
+    const std::vector<std::pair<size_t, size_t> > vec_shard = ShardPairs(vec_pairs, k, shard_count, 8);
+    EXPECT_TRUE(vec_shard.size() >= vec_pairs.size() / shard_count);
+    EXPECT_TRUE(vec_shard.size() <= vec_pairs.size() / shard_count + 1);
+    EXPECT_TRUE(std::is_sorted(vec_shard.begin(), vec_shard.end()));
+    // 与输入的顺序无关
+    std::vector<std::pair<size_t, size_t> > vec_reversed(vec_pairs.rbegin(), vec_pairs.rend());
+    EXPECT_TRUE(vec_shard == ShardPairs(vec_reversed, k, shard_count, 8));
+    vec_union.insert(vec_union.end(), vec_shard.begin(), vec_shard.end());
+  }
+  std::sort(vec_union.begin(), vec_union.end());
+  EXPECT_TRUE(vec_union == vec_pairs);
+
+  EXPECT_TRUE(ShardPairs(vec_pairs, 0, 1) == vec_pairs);
+  EXPECT_TRUE(ShardPairs(vec_pairs, 3, 3).empty());
+}
+
+TEST(IndexedMatch, ShardMatchesFile)
+{
+  const std::string shard_file = ShardMatchesFile("out/matches.putative.bin", 2, 8);
+  EXPECT_EQ("matches.putative.shard-2-of-8", mvg::utils::basename_part(shard_file));
+  EXPECT_EQ("bin", mvg::utils::extension_part(shard_file));
+  EXPECT_EQ("matches.putative.shard-2-of-8.images", mvg::utils::basename_part(ImageListFile(shard_file)));
+}
@@ -0,0 +1,97 @@
+﻿#include "testing.h"
+#include <cstdlib>
+#include <vector>
+
+#include "mvg/feature/matcher_brute_force_simd.h"
+
+using namespace std;
+using namespace mvg::feature;
+
+// 标量的穷举搜索，用于比较
+static void ExhaustiveSearch(const vector<unsigned char> &dataset, int rows_num,
+  const unsigned char *query, int dimension, int *best_index, float *best_distance)
+{
+  *best_index = -1;
+  *best_distance = 0.f;
+  for (int r = 0; r < rows_num; ++r) {
+    const float distance = SquaredEuclideanDistanceSimple<unsigned char>()(
+      query, &dataset[r * dimension], dimension);
+    if (*best_index < 0 || distance < *best_distance) {
+      *best_index = r;
+      *best_distance = distance;
+    }
+  }
+}
+
+TEST(Matching, ArrayMatcherBruteForceSIMD_Simple_Dim4)
+{
+  float array[] = {
+    0, 1, 2, 3,
+    4, 5, 6, 7,
+    8, 9, 10, 11};
+  ArrayMatcherBruteForceSIMD<float> matcher;
+  EXPECT_TRUE( matcher.Build(array, 3, 4) );
+
+  float query[] = {4, 5, 6, 7};
+  int nIndice = -1;
+  float fDistance = -1.0f;
+  EXPECT_TRUE( matcher.SearchNeighbour( query, &nIndice, &fDistance) );
+
+  EXPECT_EQ( 1, nIndice);
+  EXPECT_NEAR( 0.0f, fDistance, 1e-8);
+}
+
+TEST(Matching, ArrayMatcherBruteForceSIMD_NN)
+{
+  float array[] = {0, 1, 2, 5, 6};
+  ArrayMatcherBruteForceSIMD<float> matcher;
+  EXPECT_TRUE( matcher.Build(array, 5, 1) );
+
+  float query[] = {2};
+  vector<int> vec_nIndice;
+  vector<float> vec_fDistance;
+  EXPECT_TRUE( matcher.SearchNeighbours(query, 1, &vec_nIndice, &vec_fDistance, 5) );
+  EXPECT_EQ( 5, vec_nIndice.size());
+  EXPECT_EQ( 5, vec_fDistance.size());
+
+  EXPECT_EQ(2, vec_nIndice[0]);
+  EXPECT_EQ(1, vec_nIndice[1]);
+  EXPECT_EQ(0, vec_nIndice[2]);
+  EXPECT_EQ(3, vec_nIndice[3]);
+  EXPECT_EQ(4, vec_nIndice[4]);
+
+  // 请求的近邻个数超过数据个数
+  EXPECT_FALSE( matcher.SearchNeighbours(query, 1, &vec_nIndice, &vec_fDistance, 6) );
+}
+
+TEST(Matching, ArrayMatcherBruteForceSIMD_Descriptor128)
+{
+  // 数据和查询的个数都不是分块大小的倍数
+  const int dimension = 128;
+  const int rows_num = 600;
+  const int query_num = 70;
+  vector<unsigned char> dataset(rows_num * dimension), queries(query_num * dimension);
+  for (size_t i = 0; i < dataset.size(); ++i)
+    dataset[i] = static_cast<unsigned char>(rand() % 256);
+  for (size_t i = 0; i < queries.size(); ++i)
+    queries[i] = static_cast<unsigned char>(rand() % 256);
+
+  ArrayMatcherBruteForceSIMD<unsigned char> matcher;
+  EXPECT_TRUE( matcher.Build(&dataset[0], rows_num, dimension) );
+
+  vector<int> vec_nIndice;
+  vector<float> vec_fDistance;
+  EXPECT_TRUE( matcher.SearchNeighbours(&queries[0], query_num, &vec_nIndice, &vec_fDistance, 2) );
+  EXPECT_EQ( 2 * query_num, vec_nIndice.size());
+
+  for (int q = 0; q < query_num; ++q) {
+    int best_index;
+    float best_distance;
+    ExhaustiveSearch(dataset, rows_num, &queries[q * dimension], dimension, &best_index, &best_distance);
+    EXPECT_EQ( best_index, vec_nIndice[2 * q]);
+    EXPECT_EQ( best_distance, vec_fDistance[2 * q]);
+    // 第二近邻不小于最近邻
+    EXPECT_TRUE( vec_fDistance[2 * q] <= vec_fDistance[2 * q + 1]);
+    EXPECT_TRUE( vec_nIndice[2 * q] != vec_nIndice[2 * q + 1]);
+  }
+}
@@ -5,6 +5,10 @@
 #include "mvg/math/numeric.h"
 #include "mvg/feature/matcher_brute_force.h"
 #include "mvg/feature/matcher_kdtree_flann.h"
+#include "mvg/feature/matcher_brute_force_simd.h"
+#include "mvg/feature/features.h"
+#include "mvg/feature/descriptor_compression.h"
+#include "mvg/feature/matcher_all_in_memory.h"
 
 using namespace std;
 
@@ -128,3 +132,193 @@ TEST(Matching, ArrayMatcher_Kdtree_Flann_Simple__NN)
 //  float fDistance = -1.0f;
 //  EXPECT_FALSE( matcher.SearchNeighbour( &array[0], &nIndice, &fDistance) );
 //}
+
+typedef Descriptor<unsigned char, 128> DescT;
+typedef KeypointSet<vector<ScalePointFeature>, vector<DescT> > KeypointSetT;
+typedef MatcherAllInMemory<KeypointSetT, ArrayMatcherBruteForceSIMD<unsigned char> > CollectionMatcherT;
+
+// 生成一幅图像的区域，第k个特征的描述子所有元素都为values[k]
+static std::shared_ptr<CollectionMatcherT::RegionCacheT::Regions> MakeRegions(
+  const unsigned char *values, size_t count)
+{
+  std::shared_ptr<CollectionMatcherT::RegionCacheT::Regions> regions(
+    new CollectionMatcherT::RegionCacheT::Regions);
+  for (size_t k = 0; k < count; ++k) {
+    regions->features.push_back(ScalePointFeature(float(k), float(k)));
+    DescT desc;
+    for (size_t i = 0; i < DescT::kStaticSize; ++i)
+      desc[i] = values[k];
+    regions->descriptors.push_back(desc);
+  }
+  return regions;
+}
+
+TEST(Matching, MatcherAllInMemory_Symmetric)
+{
+  // 图像1的特征0在图像0中的最近邻是特征0，而图像0的特征0的最近邻是图像1的特征1，不是互为最近邻
+  const unsigned char values0[] = {10, 16};
+  const unsigned char values1[] = {0, 14};
+  vector<string> file_names(2);
+
+  for (int symmetric = 0; symmetric < 2; ++symmetric) {
+    std::shared_ptr<CollectionMatcherT::RegionCacheT> cache(new CollectionMatcherT::RegionCacheT);
+    cache->put(0, MakeRegions(values0, 2));
+    cache->put(1, MakeRegions(values1, 2));
+
+    CollectionMatcherT matcher(0.8f, cache);
+    matcher.setSymmetric(symmetric != 0);
+    EXPECT_TRUE(matcher.LoadData(file_names, ""));
+    PairWiseMatches map_matches;
+    matcher.Match(file_names, map_matches);
+
+    EXPECT_EQ(1, map_matches.size());
+    const vector<IndexedMatch> & vec_matches = map_matches[std::make_pair(size_t(0), size_t(1))];
+    EXPECT_TRUE(std::find(vec_matches.begin(), vec_matches.end(), IndexedMatch(1, 1)) != vec_matches.end());
+    if (symmetric) {
+      EXPECT_EQ(1, vec_matches.size());
+    }
+    else {
+      // 只进行比率测试时两个匹配都保留
+      EXPECT_EQ(2, vec_matches.size());
+      EXPECT_TRUE(std::find(vec_matches.begin(), vec_matches.end(), IndexedMatch(0, 0)) != vec_matches.end());
+    }
+  }
+}
+
+TEST(Matching, MatcherAllInMemory_SelectedPairs)
+{
+  const unsigned char values0[] = {10, 16};
+  const unsigned char values1[] = {0, 14};
+  std::shared_ptr<CollectionMatcherT::RegionCacheT> cache(new CollectionMatcherT::RegionCacheT);
+  cache->put(0, MakeRegions(values0, 2));
+  cache->put(1, MakeRegions(values1, 2));
+  cache->put(2, MakeRegions(values0, 2));
+  vector<string> file_names(3);
+
+  CollectionMatcherT matcher(0.8f, cache);
+  EXPECT_TRUE(matcher.LoadData(file_names, ""));
+
+  // 增量匹配时只匹配新图像2与其他图像组成的图像对，已有的匹配保持不变
+  PairWiseMatches map_matches;
+  map_matches[std::make_pair(size_t(0), size_t(1))].push_back(IndexedMatch(0, 0));
+  vector<std::pair<size_t, size_t> > vec_pairs;
+  vec_pairs.push_back(std::make_pair(size_t(0), size_t(2)));
+  vec_pairs.push_back(std::make_pair(size_t(1), size_t(2)));
+  matcher.Match(file_names, vec_pairs, map_matches);
+
+  EXPECT_EQ(3, map_matches.size());
+  EXPECT_EQ(1, map_matches[std::make_pair(size_t(0), size_t(1))].size());
+  // 图像2与图像0完全相同，两个特征都匹配到自身
+  const vector<IndexedMatch> & vec_matches = map_matches[std::make_pair(size_t(0), size_t(2))];
+  EXPECT_EQ(2, vec_matches.size());
+  EXPECT_TRUE(std::find(vec_matches.begin(), vec_matches.end(), IndexedMatch(1, 1)) != vec_matches.end());
+}
+
+TEST(Matching, MatcherAllInMemory_BlockSchedule)
+{
+  // 10幅图像，图像i与图像i % 3的特征相同
+  const unsigned char values[3][2] = { {10, 16}, {0, 14}, {40, 90} };
+  const size_t image_count = 10;
+  vector<string> file_names(image_count);
+
+  PairWiseMatches map_reference;
+  for (size_t block_size = 1; block_size <= 16; block_size *= 4) {
+    for (int budget = 0; budget < 2; ++budget) {
+      // 有内存预算时按I块逐行建立和释放索引，预算足够大，放入的区域不会被释放
+      std::shared_ptr<CollectionMatcherT::RegionCacheT> cache(
+        new CollectionMatcherT::RegionCacheT(budget ? (1 << 20) : 0));
+      for (size_t i = 0; i < image_count; ++i)
+        cache->put(i, MakeRegions(values[i % 3], 2));
+
+      CollectionMatcherT matcher(0.8f, cache);
+      matcher.setBlockSize(block_size);
+      EXPECT_EQ(block_size, matcher.blockSize());
+      EXPECT_TRUE(matcher.LoadData(file_names, ""));
+      PairWiseMatches map_matches;
+      matcher.Match(file_names, map_matches);
+
+      EXPECT_EQ(image_count * (image_count - 1) / 2, map_matches.size());
+      if (map_reference.empty())
+        map_reference = map_matches;
+      EXPECT_TRUE(map_reference == map_matches);
+    }
+  }
+  // 特征相同的图像对两个特征都匹配到自身
+  EXPECT_EQ(2, map_reference[std::make_pair(size_t(2), size_t(5))].size());
+}
+
+typedef Descriptor<unsigned char, 16> CodeT;
+typedef KeypointSet<vector<ScalePointFeature>, vector<CodeT> > CodeKeypointSetT;
+typedef MatcherAllInMemory<CodeKeypointSetT, ArrayMatcherProductQuantization, DescT> PQCollectionMatcherT;
+
+// 创建使用同一个码本的乘积量化匹配算子
+struct PQMatcherFactory
+{
+  std::shared_ptr<const ProductQuantizer> quantizer;
+  std::shared_ptr<ArrayMatcherProductQuantization> operator()() const
+  {
+    return std::shared_ptr<ArrayMatcherProductQuantization>(new ArrayMatcherProductQuantization(quantizer));
+  }
+};
+
+TEST(Matching, MatcherAllInMemory_ProductQuantizationQueries)
+{
+  // 图像1的特征k与图像0的特征count - 1 - k的描述子相同
+  const size_t count = 300;
+  srand(7);
+  vector<DescT> vec_descs(count);
+  vector<float> vec_data;
+  for (size_t k = 0; k < count; ++k) {
+    for (size_t i = 0; i < DescT::kStaticSize; ++i) {
+      vec_descs[k][i] = static_cast<unsigned char>(rand() % 256);
+      vec_data.push_back(float(vec_descs[k][i]));
+    }
+  }
+  std::shared_ptr<ProductQuantizer> pq(new ProductQuantizer);
+  EXPECT_TRUE(pq->train(&vec_data[0], count, DescT::kStaticSize, CodeT::kStaticSize));
+
+  std::shared_ptr<PQCollectionMatcherT::RegionCacheT> code_cache(new PQCollectionMatcherT::RegionCacheT);
+  std::shared_ptr<PQCollectionMatcherT::QueryCacheT> query_cache(new PQCollectionMatcherT::QueryCacheT);
+  for (size_t i = 0; i < 2; ++i) {
+    std::shared_ptr<PQCollectionMatcherT::RegionCacheT::Regions> codes(new PQCollectionMatcherT::RegionCacheT::Regions);
+    std::shared_ptr<PQCollectionMatcherT::QueryCacheT::Regions> queries(new PQCollectionMatcherT::QueryCacheT::Regions);
+    for (size_t k = 0; k < count; ++k) {
+      const DescT & desc = vec_descs[i == 0 ? k : count - 1 - k];
+      CodeT code;
+      pq->encode(desc.getData(), code.getData());
+      codes->features.push_back(ScalePointFeature(float(k), float(k)));
+      codes->descriptors.push_back(code);
+      queries->features.push_back(ScalePointFeature(float(k), float(k)));
+      queries->descriptors.push_back(desc);
+    }
+    code_cache->put(i, codes);
+    query_cache->put(i, queries);
+  }
+  vector<string> file_names(2);
+
+  // 码本通过匹配器工厂传入，查询使用未压缩的描述子
+  PQMatcherFactory factory;
+  factory.quantizer = pq;
+  std::shared_ptr<PQCollectionMatcherT::IndexRegistryT> registry(new PQCollectionMatcherT::IndexRegistryT(code_cache));
+  registry->setMatcherFactory(factory);
+  PQCollectionMatcherT matcher(0.8f, code_cache);
+  matcher.setSymmetric(true);
+  matcher.setQueryCache(query_cache);
+  matcher.setIndexRegistry(registry);
+  EXPECT_TRUE(matcher.LoadData(file_names, ""));
+  PairWiseMatches map_matches;
+  EXPECT_TRUE(matcher.Match(file_names, map_matches));
+
+  const vector<IndexedMatch> & vec_matches = map_matches[std::make_pair(size_t(0), size_t(1))];
+  EXPECT_TRUE(vec_matches.size() > 0.9 * count);
+  for (size_t k = 0; k < vec_matches.size(); ++k)
+    EXPECT_EQ(count - 1, vec_matches[k]._i + vec_matches[k]._j);
+
+  // 查询描述子与编码的个数不一致时匹配失败
+  std::shared_ptr<PQCollectionMatcherT::QueryCacheT::Regions> partial(
+    new PQCollectionMatcherT::QueryCacheT::Regions(*query_cache->get(1)));
+  partial->descriptors.pop_back();
+  query_cache->put(1, partial);
+  map_matches.clear();
+  EXPECT_FALSE(matcher.Match(file_names, map_matches));
+}
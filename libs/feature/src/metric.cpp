@@ -0,0 +1,405 @@
+﻿#include "feature_precomp.h"  // 预编译头
+
+#include "mvg/feature/metric.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MVG_METRIC_SSE2 1
+#include <immintrin.h>
+// AVX2/AVX-512的函数单独指定目标指令集编译，整个库不需要额外的编译选项
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define MVG_METRIC_AVX2 1
+#endif
+#if (defined(__clang__) && __clang_major__ >= 8) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 7) || (defined(_MSC_VER) && _MSC_VER >= 1920)
+#define MVG_METRIC_AVX512 1
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MVG_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MVG_TARGET(isa)
+#endif
+
+using namespace mvg::system;
+
+namespace mvg {
+	namespace feature {
+		namespace {
+
+			// 每个字节中1的个数
+			const unsigned char kBitCount[256] = {
+#define MVG_B2(n) n, n + 1, n + 1, n + 2
+#define MVG_B4(n) MVG_B2(n), MVG_B2(n + 1), MVG_B2(n + 1), MVG_B2(n + 2)
+#define MVG_B6(n) MVG_B4(n), MVG_B4(n + 1), MVG_B4(n + 1), MVG_B4(n + 2)
+				MVG_B6(0), MVG_B6(1), MVG_B6(1), MVG_B6(2)
+#undef MVG_B6
+#undef MVG_B4
+#undef MVG_B2
+			};
+
+			//////////////////////////////////////////////////////////////////////////
+			// 标量版本
+
+			int SquaredEuclideanU8Scalar(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				int result = 0;
+				for (size_t i = 0; i < size; ++i) {
+					const int diff = int(a[i]) - int(b[i]);
+					result += diff * diff;
+				}
+				return result;
+			}
+
+			float SquaredEuclideanF32Scalar(const float *a, const float *b, size_t size)
+			{
+				float result = 0.f;
+				for (size_t i = 0; i < size; ++i) {
+					const float diff = a[i] - b[i];
+					result += diff * diff;
+				}
+				return result;
+			}
+
+			unsigned int HammingU8Scalar(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				unsigned int result = 0;
+				for (size_t i = 0; i < size; ++i)
+					result += kBitCount[a[i] ^ b[i]];
+				return result;
+			}
+
+			void DotProducts4I16Scalar(const short *query, size_t query_stride,
+				const short *row, int padded_dimension, int *dots)
+			{
+				const short *q0 = query;
+				const short *q1 = q0 + query_stride;
+				const short *q2 = q1 + query_stride;
+				const short *q3 = q2 + query_stride;
+				dots[0] = dots[1] = dots[2] = dots[3] = 0;
+				for (int i = 0; i < padded_dimension; ++i) {
+					const int r = row[i];
+					dots[0] += r * q0[i];
+					dots[1] += r * q1[i];
+					dots[2] += r * q2[i];
+					dots[3] += r * q3[i];
+				}
+			}
+
+			const MetricKernels kScalarKernels = {
+				SIMD_NONE, SquaredEuclideanU8Scalar, SquaredEuclideanF32Scalar, HammingU8Scalar,
+				DotProducts4I16Scalar
+			};
+
+#ifdef MVG_METRIC_SSE2
+			//////////////////////////////////////////////////////////////////////////
+			// SSE2版本
+
+			MVG_TARGET("sse2")
+			inline int HorizontalSumSSE2(__m128i v)
+			{
+				v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+				v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+				return _mm_cvtsi128_si32(v);
+			}
+
+			MVG_TARGET("sse2")
+			int SquaredEuclideanU8SSE2(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				__m128i acc = _mm_setzero_si128();
+				size_t i = 0;
+				for (; i + 16 <= size; i += 16) {
+					// 无符号饱和减法得到差的绝对值，扩展为16位后用madd求平方和
+					const __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+					const __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+					const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+					const __m128i lo = _mm_unpacklo_epi8(diff, zero);
+					const __m128i hi = _mm_unpackhi_epi8(diff, zero);
+					acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+				}
+				return HorizontalSumSSE2(acc) + SquaredEuclideanU8Scalar(a + i, b + i, size - i);
+			}
+
+			MVG_TARGET("sse2")
+			float SquaredEuclideanF32SSE2(const float *a, const float *b, size_t size)
+			{
+				__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+				size_t i = 0;
+				for (; i + 8 <= size; i += 8) {
+					const __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+					const __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+					acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+					acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+				}
+				float sums[4];
+				_mm_storeu_ps(sums, _mm_add_ps(acc0, acc1));
+				return (sums[0] + sums[1]) + (sums[2] + sums[3])
+					+ SquaredEuclideanF32Scalar(a + i, b + i, size - i);
+			}
+
+			MVG_TARGET("sse2")
+			unsigned int HammingU8SSE2(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				const __m128i m1 = _mm_set1_epi8(0x55);
+				const __m128i m2 = _mm_set1_epi8(0x33);
+				const __m128i m4 = _mm_set1_epi8(0x0F);
+				__m128i acc = _mm_setzero_si128();
+				size_t i = 0;
+				for (; i + 16 <= size; i += 16) {
+					// 按字节并行统计1的个数，再用sad求和
+					__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + i)),
+						_mm_loadu_si128((const __m128i *)(b + i)));
+					v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+					v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+					v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+					acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+				}
+				return static_cast<unsigned int>(HorizontalSumSSE2(acc))
+					+ HammingU8Scalar(a + i, b + i, size - i);
+			}
+
+			MVG_TARGET("sse2")
+			void DotProducts4I16SSE2(const short *query, size_t query_stride,
+				const short *row, int padded_dimension, int *dots)
+			{
+				const short *q0 = query;
+				const short *q1 = q0 + query_stride;
+				const short *q2 = q1 + query_stride;
+				const short *q3 = q2 + query_stride;
+				__m128i acc0 = _mm_setzero_si128(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+				for (int i = 0; i < padded_dimension; i += 8) {
+					// 数据只读取一次，与4个查询分别相乘累加
+					const __m128i r = _mm_loadu_si128((const __m128i *)(row + i));
+					acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(r, _mm_loadu_si128((const __m128i *)(q0 + i))));
+					acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(r, _mm_loadu_si128((const __m128i *)(q1 + i))));
+					acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(r, _mm_loadu_si128((const __m128i *)(q2 + i))));
+					acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(r, _mm_loadu_si128((const __m128i *)(q3 + i))));
+				}
+				// 转置后相加，得到4个累加器各自的和
+				const __m128i t0 = _mm_add_epi32(_mm_unpacklo_epi32(acc0, acc1), _mm_unpackhi_epi32(acc0, acc1));
+				const __m128i t1 = _mm_add_epi32(_mm_unpacklo_epi32(acc2, acc3), _mm_unpackhi_epi32(acc2, acc3));
+				_mm_storeu_si128((__m128i *)dots,
+					_mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1)));
+			}
+
+			const MetricKernels kSSE2Kernels = {
+				SIMD_SSE2, SquaredEuclideanU8SSE2, SquaredEuclideanF32SSE2, HammingU8SSE2,
+				DotProducts4I16SSE2
+			};
+#endif
+
+#ifdef MVG_METRIC_AVX2
+			//////////////////////////////////////////////////////////////////////////
+			// AVX2版本，剩余的元素在函数内处理，避免调用SSE编码的函数造成AVX-SSE切换的开销
+
+			MVG_TARGET("avx2") inline int HorizontalSumAVX2(__m256i v)
+			{
+				return HorizontalSumSSE2(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+			}
+
+			MVG_TARGET("avx2")
+			int SquaredEuclideanU8AVX2(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				__m256i acc = _mm256_setzero_si256();
+				size_t i = 0;
+				for (; i + 32 <= size; i += 32) {
+					const __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+					const __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+					const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+					const __m256i lo = _mm256_unpacklo_epi8(diff, zero);
+					const __m256i hi = _mm256_unpackhi_epi8(diff, zero);
+					acc = _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+				}
+				int result = HorizontalSumAVX2(acc);
+				for (; i < size; ++i) {
+					const int diff = int(a[i]) - int(b[i]);
+					result += diff * diff;
+				}
+				return result;
+			}
+
+			MVG_TARGET("avx2,fma")
+			float SquaredEuclideanF32AVX2(const float *a, const float *b, size_t size)
+			{
+				__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+				size_t i = 0;
+				for (; i + 16 <= size; i += 16) {
+					const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+					const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+					acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+					acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+				}
+				const __m256 acc = _mm256_add_ps(acc0, acc1);
+				const __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+				float sums[4];
+				_mm_storeu_ps(sums, sum);
+				float result = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+				for (; i < size; ++i) {
+					const float diff = a[i] - b[i];
+					result += diff * diff;
+				}
+				return result;
+			}
+
+			MVG_TARGET("avx2")
+			unsigned int HammingU8AVX2(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				// 用pshufb查表统计每4位中1的个数
+				const __m256i lookup = _mm256_setr_epi8(
+					0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+					0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+				const __m256i low_mask = _mm256_set1_epi8(0x0F);
+				__m256i acc = _mm256_setzero_si256();
+				size_t i = 0;
+				for (; i + 32 <= size; i += 32) {
+					const __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+						_mm256_loadu_si256((const __m256i *)(b + i)));
+					const __m256i count = _mm256_add_epi8(
+						_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_mask)),
+						_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask)));
+					acc = _mm256_add_epi64(acc, _mm256_sad_epu8(count, _mm256_setzero_si256()));
+				}
+				unsigned int result = static_cast<unsigned int>(HorizontalSumAVX2(acc));
+				for (; i < size; ++i)
+					result += kBitCount[a[i] ^ b[i]];
+				return result;
+			}
+
+			MVG_TARGET("avx2")
+			void DotProducts4I16AVX2(const short *query, size_t query_stride,
+				const short *row, int padded_dimension, int *dots)
+			{
+				const short *q0 = query;
+				const short *q1 = q0 + query_stride;
+				const short *q2 = q1 + query_stride;
+				const short *q3 = q2 + query_stride;
+				__m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+				for (int i = 0; i < padded_dimension; i += 16) {
+					const __m256i r = _mm256_loadu_si256((const __m256i *)(row + i));
+					acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(r, _mm256_loadu_si256((const __m256i *)(q0 + i))));
+					acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(r, _mm256_loadu_si256((const __m256i *)(q1 + i))));
+					acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(r, _mm256_loadu_si256((const __m256i *)(q2 + i))));
+					acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(r, _mm256_loadu_si256((const __m256i *)(q3 + i))));
+				}
+				const __m256i sum = _mm256_hadd_epi32(_mm256_hadd_epi32(acc0, acc1), _mm256_hadd_epi32(acc2, acc3));
+				_mm_storeu_si128((__m128i *)dots,
+					_mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+			}
+
+			const MetricKernels kAVX2Kernels = {
+				SIMD_AVX2, SquaredEuclideanU8AVX2, SquaredEuclideanF32AVX2, HammingU8AVX2,
+				DotProducts4I16AVX2
+			};
+#endif
+
+#ifdef MVG_METRIC_AVX512
+			//////////////////////////////////////////////////////////////////////////
+			// AVX-512版本，剩余的元素使用掩码读取
+
+			MVG_TARGET("avx512f,avx512bw")
+			inline __mmask64 TailMask64(size_t count)
+			{
+				return count >= 64 ? ~__mmask64(0) : ((__mmask64(1) << count) - 1);
+			}
+
+			MVG_TARGET("avx512f,avx512bw")
+			int SquaredEuclideanU8AVX512(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				const __m512i zero = _mm512_setzero_si512();
+				__m512i acc = _mm512_setzero_si512();
+				for (size_t i = 0; i < size; i += 64) {
+					const __mmask64 mask = TailMask64(size - i);
+					const __m512i va = _mm512_maskz_loadu_epi8(mask, a + i);
+					const __m512i vb = _mm512_maskz_loadu_epi8(mask, b + i);
+					const __m512i diff = _mm512_or_si512(_mm512_subs_epu8(va, vb), _mm512_subs_epu8(vb, va));
+					const __m512i lo = _mm512_unpacklo_epi8(diff, zero);
+					const __m512i hi = _mm512_unpackhi_epi8(diff, zero);
+					acc = _mm512_add_epi32(acc, _mm512_add_epi32(_mm512_madd_epi16(lo, lo), _mm512_madd_epi16(hi, hi)));
+				}
+				return _mm512_reduce_add_epi32(acc);
+			}
+
+			MVG_TARGET("avx512f,avx512bw")
+			float SquaredEuclideanF32AVX512(const float *a, const float *b, size_t size)
+			{
+				__m512 acc = _mm512_setzero_ps();
+				for (size_t i = 0; i < size; i += 16) {
+					const __mmask16 mask = size - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (size - i)) - 1);
+					const __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+					acc = _mm512_fmadd_ps(diff, diff, acc);
+				}
+				return _mm512_reduce_add_ps(acc);
+			}
+
+			MVG_TARGET("avx512f,avx512bw")
+			unsigned int HammingU8AVX512(const unsigned char *a, const unsigned char *b, size_t size)
+			{
+				// 每个128位通道都是0~15中1的个数: 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+				const __m512i lookup = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+				const __m512i low_mask = _mm512_set1_epi8(0x0F);
+				__m512i acc = _mm512_setzero_si512();
+				for (size_t i = 0; i < size; i += 64) {
+					const __mmask64 mask = TailMask64(size - i);
+					const __m512i v = _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, a + i),
+						_mm512_maskz_loadu_epi8(mask, b + i));
+					const __m512i count = _mm512_add_epi8(
+						_mm512_shuffle_epi8(lookup, _mm512_and_si512(v, low_mask)),
+						_mm512_shuffle_epi8(lookup, _mm512_and_si512(_mm512_srli_epi16(v, 4), low_mask)));
+					acc = _mm512_add_epi64(acc, _mm512_sad_epu8(count, _mm512_setzero_si512()));
+				}
+				return static_cast<unsigned int>(_mm512_reduce_add_epi64(acc));
+			}
+
+			// 点积的维度通常只有128，直接使用AVX2版本
+			const MetricKernels kAVX512Kernels = {
+				SIMD_AVX512, SquaredEuclideanU8AVX512, SquaredEuclideanF32AVX512, HammingU8AVX512,
+				DotProducts4I16AVX2
+			};
+#endif
+
+		}  // namespace
+
+		const MetricKernels * GetMetricKernels(SimdLevel level)
+		{
+			if (level > getSimdLevel())
+				return NULL;
+			switch (level)
+			{
+			case SIMD_NONE:
+				return &kScalarKernels;
+#ifdef MVG_METRIC_SSE2
+			case SIMD_SSE2:
+				return &kSSE2Kernels;
+#endif
+#ifdef MVG_METRIC_AVX2
+			case SIMD_AVX2:
+				return &kAVX2Kernels;
+#endif
+#ifdef MVG_METRIC_AVX512
+			case SIMD_AVX512:
+				return &kAVX512Kernels;
+#endif
+			default:
+				return NULL;
+			}
+		}
+
+		/// 处理器和编译器都支持的最高指令集的距离函数
+		static const MetricKernels * SelectBestMetricKernels()
+		{
+			const MetricKernels *kernels = NULL;
+			for (int level = getSimdLevel(); kernels == NULL; --level)
+				kernels = GetMetricKernels(SimdLevel(level));
+			return kernels;
+		}
+
+		const MetricKernels & GetMetricKernels()
+		{
+			// 函数内静态变量的初始化是线程安全的(C++11)，只选择一次
+			static const MetricKernels * const best_kernels = SelectBestMetricKernels();
+			return *best_kernels;
+		}
+
+	}  // namespace feature
+}  // namespace mvg
@@ -3,9 +3,12 @@
 #include "flann/algorithms/dist.h"
 #include <iostream>
 #include <bitset>
+#include <cstdlib>
 #include <string>
+#include <vector>
 
 using namespace mvg::feature;
+using namespace mvg::system;
 
 template<typename Metric>
 typename Metric::ResultType DistanceT()
@@ -33,3 +36,130 @@ TEST(Metric, SquaredEuclideanDistanceVectorized)
   EXPECT_EQ(168, DistanceT<SquaredEuclideanDistanceVectorized<float> >());
   EXPECT_EQ(168, DistanceT<SquaredEuclideanDistanceVectorized<double> >());
 }
+
+TEST(Metric, HammingDistanceSimple)
+{
+  unsigned char array1[] = {0x00, 0xFF, 0x0F, 0x01};
+  unsigned char array2[] = {0xFF, 0xFF, 0xF0, 0x03};
+  EXPECT_EQ(17, HammingDistanceSimple<unsigned char>()(array1, array2, 4));
+  unsigned int array3[] = {0xFFFFFFFF, 0};
+  unsigned int array4[] = {0, 1};
+  EXPECT_EQ(33, HammingDistanceSimple<unsigned int>()(array3, array4, 2));
+}
+
+// 长度覆盖各个指令集剩余元素的处理
+static const size_t kMetricSizes[] = {0, 1, 3, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 128, 200, 257};
+static const size_t kMetricSizeCount = sizeof(kMetricSizes) / sizeof(kMetricSizes[0]);
+
+TEST(Metric, SIMD_KernelsAvailable)
+{
+  // 标量版本总是可用，运行时选择的版本不超过处理器支持的级别
+  EXPECT_TRUE(GetMetricKernels(SIMD_NONE) != NULL);
+  EXPECT_TRUE(GetMetricKernels().level <= getSimdLevel());
+  EXPECT_TRUE(GetMetricKernels(GetMetricKernels().level) == &GetMetricKernels());
+  std::cout << "SIMD level: " << getSimdLevelName(GetMetricKernels().level) << std::endl;
+}
+
+TEST(Metric, SIMD_SquaredEuclideanU8)
+{
+  for (int level = SIMD_NONE; level <= SIMD_AVX512; ++level) {
+    const MetricKernels *kernels = GetMetricKernels(SimdLevel(level));
+    if (kernels == NULL)
+      continue;
+    for (size_t s = 0; s < kMetricSizeCount; ++s) {
+      const size_t size = kMetricSizes[s];
+      std::vector<unsigned char> a(size + 1), b(size + 1);
+      for (size_t i = 0; i < size; ++i) {
+        a[i] = static_cast<unsigned char>(rand() % 256);
+        b[i] = static_cast<unsigned char>(rand() % 256);
+      }
+      // 最大差值，两个方向
+      if (size > 1) {
+        a[0] = 255; b[0] = 0;
+        a[size - 1] = 0; b[size - 1] = 255;
+      }
+      EXPECT_EQ(SquaredEuclideanDistanceSimple<unsigned char>()(&a[0], &b[0], size),
+        kernels->squared_euclidean_u8(&a[0], &b[0], size));
+    }
+  }
+}
+
+TEST(Metric, SIMD_SquaredEuclideanF32)
+{
+  for (int level = SIMD_NONE; level <= SIMD_AVX512; ++level) {
+    const MetricKernels *kernels = GetMetricKernels(SimdLevel(level));
+    if (kernels == NULL)
+      continue;
+    for (size_t s = 0; s < kMetricSizeCount; ++s) {
+      const size_t size = kMetricSizes[s];
+      std::vector<float> a(size + 1), b(size + 1);
+      for (size_t i = 0; i < size; ++i) {
+        a[i] = rand() / float(RAND_MAX) - 0.5f;
+        b[i] = rand() / float(RAND_MAX) - 0.5f;
+      }
+      // 累加顺序不同，允许舍入误差
+      const float expected = SquaredEuclideanDistanceSimple<float>()(&a[0], &b[0], size);
+      EXPECT_NEAR(expected, kernels->squared_euclidean_f32(&a[0], &b[0], size), 1e-5 * (1 + expected));
+    }
+  }
+}
+
+TEST(Metric, SIMD_HammingU8)
+{
+  for (int level = SIMD_NONE; level <= SIMD_AVX512; ++level) {
+    const MetricKernels *kernels = GetMetricKernels(SimdLevel(level));
+    if (kernels == NULL)
+      continue;
+    for (size_t s = 0; s < kMetricSizeCount; ++s) {
+      const size_t size = kMetricSizes[s];
+      std::vector<unsigned char> a(size + 1), b(size + 1);
+      for (size_t i = 0; i < size; ++i) {
+        a[i] = static_cast<unsigned char>(rand() % 256);
+        b[i] = static_cast<unsigned char>(rand() % 256);
+      }
+      if (size > 0) {
+        a[0] = 0xFF; b[0] = 0x00;
+      }
+      EXPECT_EQ(HammingDistanceSimple<unsigned char>()(&a[0], &b[0], size),
+        kernels->hamming_u8(&a[0], &b[0], size));
+    }
+  }
+}
+
+TEST(Metric, SIMD_DotProducts4I16)
+{
+  const int padded_dimensions[] = {16, 32, 128, 144};
+  for (int level = SIMD_NONE; level <= SIMD_AVX512; ++level) {
+    const MetricKernels *kernels = GetMetricKernels(SimdLevel(level));
+    if (kernels == NULL)
+      continue;
+    for (size_t s = 0; s < sizeof(padded_dimensions) / sizeof(padded_dimensions[0]); ++s) {
+      const int dimension = padded_dimensions[s];
+      // 4个查询之间留出间隔，检查query_stride的处理
+      const size_t stride = dimension + 16;
+      std::vector<short> query(stride * 4), row(dimension);
+      for (size_t i = 0; i < query.size(); ++i)
+        query[i] = static_cast<short>(rand() % 256);
+      for (int i = 0; i < dimension; ++i)
+        row[i] = static_cast<short>(rand() % 256);
+      int dots[4];
+      kernels->dot_products4_i16(&query[0], stride, &row[0], dimension, dots);
+      for (int j = 0; j < 4; ++j) {
+        int expected = 0;
+        for (int i = 0; i < dimension; ++i)
+          expected += int(row[i]) * int(query[j * stride + i]);
+        EXPECT_EQ(expected, dots[j]);
+      }
+    }
+  }
+}
+
+TEST(Metric, SIMD_Functors)
+{
+  EXPECT_EQ(168, DistanceT<SquaredEuclideanDistanceSIMD<unsigned char> >());
+  EXPECT_EQ(168, DistanceT<SquaredEuclideanDistanceSIMD<float> >());
+
+  unsigned char array1[] = {0x00, 0xFF, 0x0F, 0x01};
+  unsigned char array2[] = {0xFF, 0xFF, 0xF0, 0x03};
+  EXPECT_EQ(17, HammingDistanceSIMD()(array1, array2, 4));
+}
@@ -0,0 +1,172 @@
+﻿#include "testing.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "mvg/feature/orb.hpp"
+#include "mvg/feature/matcher_brute_force_simd.h"
+#include "mvg/feature/matcher_lsh_flann.h"
+#include "mvg/feature/matching_filters.h"
+
+using namespace std;
+using namespace mvg::feature;
+using namespace mvg::image;
+
+// 随机矩形组成的纹理图像，角点足够多
+static Image<unsigned char> MakeTexturedImage(int width, int height)
+{
+  Image<unsigned char> image(width, height, true, 128);
+  srand(1);
+  for (int k = 0; k < 400; ++k) {
+    const int x0 = rand() % width, y0 = rand() % height;
+    const int x1 = min(width, x0 + 4 + rand() % 16), y1 = min(height, y0 + 4 + rand() % 16);
+    const unsigned char value = static_cast<unsigned char>(rand() % 256);
+    for (int y = y0; y < y1; ++y)
+      for (int x = x0; x < x1; ++x)
+        image(y, x) = value;
+  }
+  return image;
+}
+
+// 顺时针旋转90度，原图的(x, y)变为(height - 1 - y, x)
+static Image<unsigned char> Rotate90(const Image<unsigned char> & image)
+{
+  Image<unsigned char> rotated(image.Height(), image.Width());
+  for (int y = 0; y < rotated.Height(); ++y)
+    for (int x = 0; x < rotated.Width(); ++x)
+      rotated(y, x) = image(image.Height() - 1 - x, y);
+  return rotated;
+}
+
+TEST(ORB, Detect)
+{
+  const Image<unsigned char> image = MakeTexturedImage(320, 240);
+  vector<ScalePointFeature> feats;
+  vector<BinaryDescriptor> descs;
+  EXPECT_TRUE(ORBDetector(image, feats, descs, 500));
+  EXPECT_EQ(feats.size(), descs.size());
+  EXPECT_TRUE(feats.size() > 100);
+  EXPECT_TRUE(feats.size() <= 500);
+  for (size_t i = 0; i < feats.size(); ++i) {
+    EXPECT_TRUE(feats[i].x() >= 0 && feats[i].x() < image.Width());
+    EXPECT_TRUE(feats[i].y() >= 0 && feats[i].y() < image.Height());
+  }
+
+  // 均匀的图像没有角点
+  vector<ScalePointFeature> flat_feats;
+  vector<BinaryDescriptor> flat_descs;
+  EXPECT_TRUE(ORBDetector(Image<unsigned char>(100, 100, true, 50), flat_feats, flat_descs));
+  EXPECT_EQ(0, flat_feats.size());
+}
+
+TEST(ORB, RotationInvariantHammingMatching)
+{
+  const Image<unsigned char> image = MakeTexturedImage(320, 240);
+  const Image<unsigned char> rotated = Rotate90(image);
+
+  vector<ScalePointFeature> feats, rotated_feats;
+  vector<BinaryDescriptor> descs, rotated_descs;
+  EXPECT_TRUE(ORBDetector(image, feats, descs, 500));
+  EXPECT_TRUE(ORBDetector(rotated, rotated_feats, rotated_descs, 500));
+  ASSERT_TRUE(feats.size() > 10 && rotated_feats.size() > 10);
+
+  ArrayMatcherBruteForceSIMD<unsigned char, HammingDistanceSIMD> matcher;
+  EXPECT_TRUE(matcher.Build(rotated_descs[0].getData(), (int)rotated_descs.size(), BinaryDescriptor::kStaticSize));
+  vector<int> vec_indice;
+  vector<unsigned int> vec_distance;
+  EXPECT_TRUE(matcher.SearchNeighbours(descs[0].getData(), (int)descs.size(), &vec_indice, &vec_distance, 2));
+
+  // 汉明距离的比率不取平方
+  const float ratio = DistanceRatioThreshold<HammingDistanceSIMD>(0.8f);
+  EXPECT_FLOAT_EQ(0.8f, ratio);
+  int match_count = 0, correct_count = 0;
+  for (size_t i = 0; i < descs.size(); ++i) {
+    if (vec_distance[2 * i] >= ratio * vec_distance[2 * i + 1])
+      continue;
+    ++match_count;
+    const ScalePointFeature & a = feats[i];
+    const ScalePointFeature & b = rotated_feats[vec_indice[2 * i]];
+    const float dx = b.x() - (image.Height() - 1 - a.y());
+    const float dy = b.y() - a.x();
+    if (dx * dx + dy * dy < 4.f)
+      ++correct_count;
+  }
+  EXPECT_TRUE(match_count > 50);
+  EXPECT_TRUE(correct_count > 0.9 * match_count);
+}
+
+TEST(ORB, LshMatcherFindsIdenticalDescriptors)
+{
+  const Image<unsigned char> image = MakeTexturedImage(320, 240);
+  vector<ScalePointFeature> feats;
+  vector<BinaryDescriptor> descs;
+  EXPECT_TRUE(ORBDetector(image, feats, descs, 500));
+  ASSERT_TRUE(descs.size() > 10);
+
+  ArrayMatcherLshFlann<unsigned char> matcher;
+  EXPECT_TRUE(matcher.Build(descs[0].getData(), (int)descs.size(), BinaryDescriptor::kStaticSize));
+  vector<int> vec_indice;
+  vector<unsigned int> vec_distance;
+  EXPECT_TRUE(matcher.SearchNeighbours(descs[0].getData(), (int)descs.size(), &vec_indice, &vec_distance, 1));
+  // 相同的描述子落在同一个哈希桶中，一定能找到
+  for (size_t i = 0; i < descs.size(); ++i)
+    EXPECT_EQ(0u, vec_distance[i]);
+  EXPECT_FALSE(MetricTraits<ArrayMatcherLshFlann<unsigned char>::MetricT>::kIsSquared);
+}
+
+TEST(ORB, LshMatcherEmptyBucketsInSymmetricMatches)
+{
+  // 每行最多4位为1，全1的查询在每个哈希表(12位的键)中都落在空桶里
+  const int rows_num = 8, dimension = 32;
+  vector<unsigned char> dataset(rows_num * dimension, 0);
+  for (int r = 0; r < rows_num; ++r)
+    dataset[r * dimension] = static_cast<unsigned char>(r);
+  vector<unsigned char> queries(2 * dimension, 0xFF);
+  std::copy(&dataset[3 * dimension], &dataset[4 * dimension], queries.begin());
+
+  ArrayMatcherLshFlann<unsigned char> matcher(6, 12, 0);
+  EXPECT_TRUE(matcher.Build(&dataset[0], rows_num, dimension));
+  vector<int> vec_indice;
+  vector<unsigned int> vec_distance;
+  EXPECT_TRUE(matcher.SearchNeighbours(&queries[0], 2, &vec_indice, &vec_distance, 2));
+  EXPECT_EQ(3, vec_indice[0]);
+  EXPECT_EQ(0u, vec_distance[0]);
+  EXPECT_EQ(-1, vec_indice[2]);
+  EXPECT_EQ(-1, vec_indice[3]);
+
+  // 没有近邻的查询被跳过，不能用-1去索引反向匹配
+  vector<int> vec_reverse_matches(rows_num * 2, -1);
+  vec_reverse_matches[3 * 2] = 0;
+  vector<int> vec_good_index;
+  SymmetricMatches(vec_indice, vec_reverse_matches, 2, vec_good_index);
+  EXPECT_EQ(1, vec_good_index.size());
+  EXPECT_EQ(0, vec_good_index[0]);
+}
+
+TEST(ORB, LshMatcherMissingSecondNeighbourFailsRatioTest)
+{
+  // 全0和全1的两行在每个哈希表中都落在不同的桶里，全0的查询只有一个候选
+  const int dimension = 32;
+  vector<unsigned char> dataset(2 * dimension, 0);
+  std::fill(dataset.begin() + dimension, dataset.end(), 0xFF);
+  const vector<unsigned char> query(dimension, 0);
+
+  ArrayMatcherLshFlann<unsigned char> matcher(6, 12, 0);
+  EXPECT_TRUE(matcher.Build(&dataset[0], 2, dimension));
+  vector<int> vec_indice;
+  vector<unsigned int> vec_distance;
+  EXPECT_TRUE(matcher.SearchNeighbours(&query[0], 1, &vec_indice, &vec_distance, 2));
+  EXPECT_EQ(0, vec_indice[0]);
+  EXPECT_EQ(0u, vec_distance[0]);
+  EXPECT_EQ(-1, vec_indice[1]);
+
+  // 最近邻的距离为0，但没有次近邻时不能通过比率测试
+  vector<int> vec_ratio_index;
+  DistanceRatioFilter(vec_distance.begin(), vec_distance.end(), 2, vec_ratio_index, 0.8f);
+  EXPECT_TRUE(vec_ratio_index.empty());
+
+  // 有次近邻时照常比较
+  vec_distance[1] = 10;
+  DistanceRatioFilter(vec_distance.begin(), vec_distance.end(), 2, vec_ratio_index, 0.8f);
+  EXPECT_EQ(1, vec_ratio_index.size());
+}
@@ -0,0 +1,81 @@
+﻿#include "testing.h"
+#include "mvg/feature/features.h"
+#include "mvg/feature/pair_selection_vlad.h"
+
+#include <cstdlib>
+
+using namespace mvg::feature;
+
+typedef Descriptor<unsigned char, 128> DescT;
+typedef RegionCache<ScalePointFeature, DescT> RegionCacheT;
+
+// 生成group_count组图像，每组image_per_group幅，同一组的描述子来自同一组原型加上噪声
+static std::shared_ptr<RegionCacheT> CreateGroups(size_t group_count, size_t image_per_group)
+{
+  const size_t prototype_count = 8;
+  std::vector<DescT> vec_prototypes(group_count * prototype_count);
+  for (size_t p = 0; p < vec_prototypes.size(); ++p)
+    for (size_t d = 0; d < DescT::kStaticSize; ++d)
+      vec_prototypes[p][d] = static_cast<unsigned char>(rand() % 200);
+
+  std::shared_ptr<RegionCacheT> cache(new RegionCacheT);
+  for (size_t g = 0; g < group_count; ++g) {
+    for (size_t n = 0; n < image_per_group; ++n) {
+      std::shared_ptr<RegionCacheT::Regions> regions(new RegionCacheT::Regions);
+      for (size_t k = 0; k < 100; ++k) {
+        DescT desc = vec_prototypes[g * prototype_count + k % prototype_count];
+        for (size_t d = 0; d < DescT::kStaticSize; ++d)
+          desc[d] = static_cast<unsigned char>(desc[d] + rand() % 20);
+        regions->features.push_back(ScalePointFeature(float(k), float(n)));
+        regions->descriptors.push_back(desc);
+      }
+      cache->put(g * image_per_group + n, regions);
+    }
+  }
+  return cache;
+}
+
+TEST(VladPairSelector, SelectPairsWithinGroups)
+{
+  const size_t group_count = 3, image_per_group = 4;
+  std::shared_ptr<RegionCacheT> cache = CreateGroups(group_count, image_per_group);
+
+  VladPairSelector<RegionCacheT> selector(cache, 4);
+  VladPairSelector<RegionCacheT>::PairsT vec_pairs;
+  EXPECT_TRUE(selector.selectPairs(group_count * image_per_group, image_per_group - 1, vec_pairs));
+  EXPECT_EQ(4, selector.wordCount());
+
+  // 每幅图像的候选正好是同一组的其他图像
+  EXPECT_EQ(group_count * image_per_group * (image_per_group - 1) / 2, vec_pairs.size());
+  for (size_t k = 0; k < vec_pairs.size(); ++k) {
+    EXPECT_TRUE(vec_pairs[k].first < vec_pairs[k].second);
+    EXPECT_EQ(vec_pairs[k].first / image_per_group, vec_pairs[k].second / image_per_group);
+  }
+}
+
+TEST(VladPairSelector, IndexAgreesWithExhaustiveRanking)
+{
+  // 组内的图像也各不相同，每幅图像的排序不只由分组决定
+  const size_t group_count = 5, image_per_group = 6, image_count = group_count * image_per_group;
+  std::shared_ptr<RegionCacheT> cache = CreateGroups(group_count, image_per_group);
+
+  VladPairSelector<RegionCacheT> selector(cache, 8);
+  EXPECT_TRUE(selector.computeVocabulary(image_count));
+  selector.computeGlobalDescriptors(image_count);
+  for (size_t top_k = 1; top_k < 8; top_k += 3) {
+    const VladPairSelector<RegionCacheT>::PairsT vec_exhaustive = selector.topKPairsExhaustive(top_k);
+    EXPECT_FALSE(vec_exhaustive.empty());
+    // 检查的叶子结点个数不少于图像个数时，kd树的检索结果是精确的
+    EXPECT_TRUE(vec_exhaustive == selector.topKPairs(top_k, (int)image_count));
+  }
+  // 候选个数超过图像个数时每幅图像与其他所有图像组成图像对
+  EXPECT_EQ(image_count * (image_count - 1) / 2, selector.topKPairs(image_count + 5).size());
+}
+
+TEST(VladPairSelector, TooFewDescriptors)
+{
+  std::shared_ptr<RegionCacheT> cache = CreateGroups(1, 2);
+  VladPairSelector<RegionCacheT> selector(cache, 1000);
+  VladPairSelector<RegionCacheT>::PairsT vec_pairs;
+  EXPECT_FALSE(selector.selectPairs(2, 5, vec_pairs));
+}
@@ -0,0 +1,225 @@
+﻿#include "testing.h"
+#include "mvg/feature/indexed_match.h"
+#include "mvg/feature/indexed_match_utils.h"
+#include "mvg/feature/pairwise_matches_store.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace mvg::feature;
+
+// 构造三个图像对的匹配，其中一个图像对没有匹配
+static PairWiseMatches CreateMatches()
+{
+  PairWiseMatches map_matches;
+  std::vector<IndexedMatch> vec_matches;
+  vec_matches.push_back(IndexedMatch(0, 1));
+  vec_matches.push_back(IndexedMatch(2, 3));
+  map_matches[std::make_pair(0, 1)] = vec_matches;
+  vec_matches.push_back(IndexedMatch(10, 20));
+  map_matches[std::make_pair(1, 5)] = vec_matches;
+  map_matches[std::make_pair(2, 3)] = std::vector<IndexedMatch>();
+  return map_matches;
+}
+
+TEST(PairWiseMatchesStore, RoundTrip)
+{
+  const std::string file_name = "pairwise_matches_store_roundtrip.bin";
+  const PairWiseMatches map_matches = CreateMatches();
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(map_matches, file_name));
+  EXPECT_TRUE(PairWiseMatchesStore::isBinaryFile(file_name));
+
+  PairWiseMatchesStore store;
+  EXPECT_TRUE(store.open(file_name));
+  EXPECT_EQ(3, store.size());
+
+  // 按(left, right)升序排列
+  EXPECT_TRUE(std::make_pair(size_t(0), size_t(1)) == store.pairAt(0));
+  EXPECT_TRUE(std::make_pair(size_t(1), size_t(5)) == store.pairAt(1));
+  EXPECT_TRUE(std::make_pair(size_t(2), size_t(3)) == store.pairAt(2));
+  EXPECT_EQ(2, store.matchCountAt(0));
+  EXPECT_EQ(3, store.matchCountAt(1));
+  EXPECT_EQ(0, store.matchCountAt(2));
+
+  PairWiseMatches map_loaded;
+  store.load(map_loaded);
+  EXPECT_TRUE(map_matches == map_loaded);
+
+  store.close();
+  remove(file_name.c_str());
+}
+
+TEST(PairWiseMatchesStore, Find)
+{
+  const std::string file_name = "pairwise_matches_store_find.bin";
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(CreateMatches(), file_name));
+
+  PairWiseMatchesStore store;
+  EXPECT_TRUE(store.open(file_name));
+
+  const IndexedMatch *matches = NULL;
+  size_t count = 0;
+  EXPECT_TRUE(store.find(1, 5, matches, count));
+  EXPECT_EQ(3, count);
+  EXPECT_EQ(IndexedMatch(10, 20), matches[2]);
+
+  // 不存在的图像对
+  EXPECT_FALSE(store.find(5, 1, matches, count));
+  EXPECT_FALSE(store.find(3, 4, matches, count));
+
+  std::vector<IndexedMatch> vec_matches;
+  EXPECT_TRUE(store.getMatches(0, 1, vec_matches));
+  EXPECT_EQ(2, vec_matches.size());
+  EXPECT_TRUE(store.getMatches(2, 3, vec_matches));
+  EXPECT_TRUE(vec_matches.empty());
+
+  store.close();
+  remove(file_name.c_str());
+}
+
+TEST(PairWiseMatchesStore, EmptyMatches)
+{
+  const std::string file_name = "pairwise_matches_store_empty.bin";
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(PairWiseMatches(), file_name));
+
+  PairWiseMatchesStore store;
+  EXPECT_TRUE(store.open(file_name));
+  EXPECT_EQ(0, store.size());
+  const IndexedMatch *matches = NULL;
+  size_t count = 0;
+  EXPECT_FALSE(store.find(0, 1, matches, count));
+
+  store.close();
+  remove(file_name.c_str());
+}
+
+TEST(PairWiseMatchesStore, ImportTextAndBinary)
+{
+  const std::string text_file = "pairwise_matches_store_import.txt";
+  const std::string bin_file = "pairwise_matches_store_import.bin";
+  const PairWiseMatches map_matches = CreateMatches();
+  {
+    std::ofstream file(text_file.c_str());
+    EXPECT_TRUE(PairedIndexedMatchToStream(map_matches, file));
+  }
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(map_matches, bin_file));
+  EXPECT_FALSE(PairWiseMatchesStore::isBinaryFile(text_file));
+
+  // 导入函数自动识别文件格式
+  PairWiseMatches map_text, map_binary;
+  EXPECT_TRUE(pairedIndexedMatchImport(text_file, map_text));
+  EXPECT_TRUE(pairedIndexedMatchImport(bin_file, map_binary));
+  EXPECT_TRUE(map_text == map_binary);
+  EXPECT_TRUE(map_matches == map_binary);
+
+  remove(text_file.c_str());
+  remove(bin_file.c_str());
+}
+
+TEST(PairWiseMatchesStore, RejectTruncatedFile)
+{
+  const std::string file_name = "pairwise_matches_store_truncated.bin";
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(CreateMatches(), file_name));
+
+  // 截断文件，文件大小与文件头记录的不一致
+  std::string content;
+  {
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(file_name.c_str(), std::ios::binary);
+    out.write(content.data(), content.size() - sizeof(IndexedMatch));
+  }
+
+  PairWiseMatchesStore store;
+  EXPECT_FALSE(store.open(file_name));
+  EXPECT_FALSE(store.isOpen());
+
+  remove(file_name.c_str());
+}
+
+// 修改文件中的一个64位整数后重新打开
+static bool OpenModified(const std::string & file_name, const std::string & content,
+  size_t position, uint64_t value)
+{
+  std::string modified = content;
+  std::memcpy(&modified[position], &value, sizeof(value));
+  {
+    std::ofstream out(file_name.c_str(), std::ios::binary);
+    out.write(modified.data(), modified.size());
+  }
+  PairWiseMatchesStore store;
+  return store.open(file_name);
+}
+
+TEST(PairWiseMatchesStore, RejectOverflowingCounts)
+{
+  const std::string file_name = "pairwise_matches_store_overflow.bin";
+  EXPECT_TRUE(PairedIndexedMatchToBinFile(CreateMatches(), file_name));
+  std::string content;
+  {
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  PairWiseMatchesFileHeader header;
+  std::memcpy(&header, content.data(), sizeof(header));
+  const size_t match_count_position = offsetof(PairWiseMatchesFileHeader, match_count);
+  const size_t pair_count_position = offsetof(PairWiseMatchesFileHeader, pair_count);
+  const size_t entry_position = sizeof(PairWiseMatchesFileHeader);
+
+  // 未修改的文件可以打开
+  EXPECT_TRUE(OpenModified(file_name, content, match_count_position, header.match_count));
+
+  // 个数乘以结构体大小后回绕，与文件大小相同
+  const uint64_t wrap = ~uint64_t(0) / sizeof(IndexedMatch) + 1;
+  EXPECT_FALSE(OpenModified(file_name, content, match_count_position, header.match_count + wrap));
+  EXPECT_FALSE(OpenModified(file_name, content, pair_count_position,
+    header.pair_count + ~uint64_t(0) / sizeof(PairWiseMatchesFileEntry) + 1));
+
+  // offset + count回绕后不超过匹配总数
+  EXPECT_FALSE(OpenModified(file_name, content, entry_position + offsetof(PairWiseMatchesFileEntry, offset),
+    ~uint64_t(0)));
+  EXPECT_FALSE(OpenModified(file_name, content, entry_position + offsetof(PairWiseMatchesFileEntry, count),
+    ~uint64_t(0)));
+
+  remove(file_name.c_str());
+}
+
+TEST(PairWiseMatchesWriter, AppendInAnyOrder)
+{
+  const std::string file_name = "pairwise_matches_writer.bin";
+  const PairWiseMatches map_matches = CreateMatches();
+
+  // 逆序写入，关闭后按(left, right)排序
+  PairWiseMatchesWriter writer;
+  EXPECT_FALSE(writer.append(0, 1, NULL, 0));
+  EXPECT_TRUE(writer.open(file_name));
+  for (PairWiseMatches::const_reverse_iterator iter = map_matches.rbegin();
+    iter != map_matches.rend(); ++iter) {
+    const IndexedMatch * matches = iter->second.empty() ? NULL : &iter->second[0];
+    EXPECT_TRUE(writer.append(iter->first.first, iter->first.second, matches, iter->second.size()));
+  }
+  EXPECT_EQ(3, writer.size());
+  EXPECT_TRUE(writer.close());
+  EXPECT_FALSE(std::ifstream((file_name + ".tmp").c_str()).is_open());
+
+  PairWiseMatchesStore store;
+  EXPECT_TRUE(store.open(file_name));
+  PairWiseMatches map_loaded;
+  store.load(map_loaded);
+  EXPECT_TRUE(map_matches == map_loaded);
+  store.close();
+
+  // 重复的图像对不生成文件
+  remove(file_name.c_str());
+  EXPECT_TRUE(writer.open(file_name));
+  EXPECT_TRUE(writer.append(0, 1, &map_matches.begin()->second[0], 1));
+  EXPECT_TRUE(writer.append(0, 1, &map_matches.begin()->second[0], 1));
+  EXPECT_FALSE(writer.close());
+  EXPECT_FALSE(std::ifstream(file_name.c_str()).is_open());
+  EXPECT_FALSE(std::ifstream((file_name + ".tmp").c_str()).is_open());
+}
@@ -1,5 +1,7 @@
 ﻿#include "mvg/feature/random_sampling.h"
 #include "testing.h"
+#include <algorithm>
+#include <random>
 #include <set>
 
 using namespace mvg::feature;
@@ -35,3 +37,28 @@ TEST(RandomSampleTest, NoRepetions) {
     }
   }
 }
+
+// 设定种子的生成器：无重复、排好序，相同的种子得到相同的采样
+TEST(RandomSampleTest, SeededGenerator) {
+
+  std::vector<size_t> samples, samples_again;
+  std::mt19937 generator(7), generator_again(7);
+  for (size_t total = 1; total < 500; total *= 2) { //数据集大小
+    for (size_t num_samples = 1; num_samples <= total; num_samples *= 2) { //给出一致的大小
+      RandomSample(num_samples, total, &samples, generator);
+      RandomSample(num_samples, total, &samples_again, generator_again);
+      EXPECT_TRUE(samples == samples_again);
+      std::set<size_t> myset(samples.begin(), samples.end());
+      EXPECT_EQ(num_samples, myset.size());
+      EXPECT_TRUE(*myset.rbegin() < total);
+      EXPECT_TRUE(std::equal(samples.begin(), samples.end(), myset.begin()));
+    }
+  }
+
+  // 不同的种子得到不同的序列
+  std::mt19937 generator_a(1), generator_b(2);
+  bool is_different = false;
+  for (int i = 0; i < 8; ++i)
+    is_different |= (generator_a() != generator_b());
+  EXPECT_TRUE(is_different);
+}
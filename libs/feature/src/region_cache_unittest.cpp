@@ -0,0 +1,158 @@
+﻿#include "testing.h"
+#include "mvg/feature/features.h"
+#include "mvg/feature/region_cache.h"
+
+#include <cstdio>
+#include <sstream>
+
+using namespace mvg::feature;
+
+typedef Descriptor<unsigned char, 128> DescT;
+typedef RegionCache<ScalePointFeature, DescT> RegionCacheT;
+
+// 生成image_count幅图像的特征及描述子文件，第i幅图像有i+1个特征
+static void CreateRegionFiles(size_t image_count, RegionCacheT & cache)
+{
+  for (size_t i = 0; i < image_count; ++i) {
+    std::vector<ScalePointFeature> vec_feats;
+    std::vector<DescT> vec_descs;
+    for (size_t k = 0; k <= i; ++k) {
+      vec_feats.push_back(ScalePointFeature(float(k), float(i)));
+      DescT desc;
+      for (size_t j = 0; j < DescT::kStaticSize; ++j)
+        desc[j] = static_cast<unsigned char>(i + k);
+      vec_descs.push_back(desc);
+    }
+    std::ostringstream os;
+    os << "tempRegionCache" << i;
+    SaveFeatsToBinFile(os.str() + ".feat", vec_feats);
+    SaveDescsToBinFile(os.str() + ".desc", vec_descs);
+    cache.addImage(i, os.str() + ".feat", os.str() + ".desc");
+  }
+}
+
+static void RemoveRegionFiles(size_t image_count)
+{
+  for (size_t i = 0; i < image_count; ++i) {
+    std::ostringstream os;
+    os << "tempRegionCache" << i;
+    remove((os.str() + ".feat").c_str());
+    remove((os.str() + ".desc").c_str());
+  }
+}
+
+TEST(RegionCache, LoadOnce)
+{
+  RegionCacheT cache;
+  CreateRegionFiles(4, cache);
+  EXPECT_EQ(4, cache.size());
+  EXPECT_EQ(0, cache.cachedCount());
+
+  RegionCacheT::RegionsPtr regions = cache.get(2);
+  EXPECT_TRUE(regions.get() != NULL);
+  EXPECT_EQ(3, regions->features.size());
+  EXPECT_EQ(3, regions->descriptors.size());
+  EXPECT_EQ(2.f, regions->features[1].y());
+  EXPECT_EQ(3, regions->descriptors[1][0]);
+
+  // 再次获取时返回同一份数据
+  EXPECT_TRUE(regions == cache.get(2));
+  EXPECT_EQ(1, cache.cachedCount());
+
+  // 未注册的图像
+  EXPECT_TRUE(cache.get(10).get() == NULL);
+
+  EXPECT_TRUE(cache.preloadAll());
+  EXPECT_EQ(4, cache.cachedCount());
+  RemoveRegionFiles(4);
+}
+
+TEST(RegionCache, LeastRecentlyUsedEviction)
+{
+  RegionCacheT probe;
+  CreateRegionFiles(4, probe);
+  // 预算只够保存两幅最大的图像
+  const size_t budget = 2 * probe.get(3)->memorySize();
+
+  RegionCacheT cache(budget);
+  CreateRegionFiles(4, cache);
+  RegionCacheT::RegionsPtr regions0 = cache.get(0);
+  cache.get(1);
+  cache.get(0); // 0成为最近使用的图像
+  cache.get(3);
+  EXPECT_TRUE(cache.memorySize() <= budget);
+
+  // 1最久未被使用，被释放；0仍然在缓存中
+  EXPECT_TRUE(regions0 == cache.get(0));
+
+  // 释放后已经获取的视图仍然有效
+  cache.clear();
+  EXPECT_EQ(0, cache.cachedCount());
+  EXPECT_EQ(1, regions0->features.size());
+  EXPECT_TRUE(regions0 != cache.get(0));
+  RemoveRegionFiles(4);
+}
+
+TEST(RegionCache, FeaturesOnly)
+{
+  RegionCacheT cache;
+  CreateRegionFiles(2, cache);
+  cache.addImage(1, "tempRegionCache1.feat");
+  RegionCacheT::RegionsPtr regions = cache.get(1);
+  EXPECT_EQ(2, regions->features.size());
+  EXPECT_TRUE(regions->descriptors.empty());
+  RemoveRegionFiles(2);
+}
+
+TEST(RegionCache, DescriptorsLoadedAfterFeaturesOnly)
+{
+  RegionCacheT cache;
+  CreateRegionFiles(2, cache);
+  // 几何过滤先读入只有特征的区域
+  EXPECT_TRUE(cache.preloadAll(false));
+  RegionCacheT::RegionsPtr features_only = cache.get(1, false);
+  EXPECT_EQ(2, features_only->features.size());
+  EXPECT_TRUE(features_only->descriptors.empty());
+
+  // 匹配需要描述子时重新读取，之后只需要特征的访问也使用完整的区域
+  RegionCacheT::RegionsPtr regions = cache.get(1);
+  EXPECT_EQ(2, regions->features.size());
+  EXPECT_EQ(2, regions->descriptors.size());
+  EXPECT_TRUE(regions == cache.get(1, false));
+  EXPECT_EQ(2, cache.cachedCount());
+  // 已经获取的视图仍然有效
+  EXPECT_TRUE(features_only->descriptors.empty());
+  RemoveRegionFiles(2);
+}
+
+TEST(RegionCache, MissingFiles)
+{
+  RegionCacheT cache;
+  CreateRegionFiles(2, cache);
+  RemoveRegionFiles(2);
+  cache.addImage(1, "tempRegionCache1.feat");
+  EXPECT_TRUE(cache.get(0).get() == NULL);
+  EXPECT_TRUE(cache.get(1, false).get() == NULL);
+  EXPECT_FALSE(cache.preloadAll());
+  EXPECT_EQ(0, cache.cachedCount());
+}
+
+TEST(RegionCache, PutInMemoryRegions)
+{
+  RegionCacheT cache;
+  std::shared_ptr<RegionCacheT::Regions> regions(new RegionCacheT::Regions);
+  regions->features.push_back(ScalePointFeature(1.f, 2.f));
+  // 图像id不需要连续
+  cache.put(5, regions);
+  EXPECT_EQ(1, cache.size());
+  EXPECT_EQ(1, cache.cachedCount());
+  EXPECT_TRUE(cache.get(5) == regions);
+  EXPECT_TRUE(cache.get(4).get() == NULL);
+
+  // 替换已有的区域
+  std::shared_ptr<RegionCacheT::Regions> other(new RegionCacheT::Regions);
+  cache.put(5, other);
+  EXPECT_EQ(1, cache.size());
+  EXPECT_TRUE(cache.get(5) == other);
+  EXPECT_EQ(other->memorySize(), cache.memorySize());
+}
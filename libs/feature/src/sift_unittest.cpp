@@ -0,0 +1,69 @@
+﻿#include "testing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "mvg/feature/sift.hpp"
+
+using namespace std;
+using namespace mvg::feature;
+using namespace mvg::image;
+
+// 随机的圆斑组成的纹理图像
+static Image<unsigned char> MakeBlobImage(int width, int height)
+{
+  Image<unsigned char> image(width, height, true, 128);
+  srand(7);
+  for (int k = 0; k < 300; ++k) {
+    const int cx = rand() % width, cy = rand() % height, radius = 2 + rand() % 8;
+    const unsigned char value = static_cast<unsigned char>(rand() % 2 ? 230 : 20);
+    for (int y = max(0, cy - radius); y < min(height, cy + radius + 1); ++y)
+      for (int x = max(0, cx - radius); x < min(width, cx + radius + 1); ++x)
+        if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius)
+          image(y, x) = value;
+  }
+  return image;
+}
+
+TEST(SIFT, TiledBudget)
+{
+  const Image<unsigned char> image = MakeBlobImage(400, 300);
+  const int tile_size = 128, max_tile_features = 20;
+
+  vector<ScalePointFeature> feats;
+  vector<Descriptor<unsigned char, 128> > descs;
+  EXPECT_TRUE(SIFTDetectorTiled(image, feats, descs, tile_size, max_tile_features, 32));
+  EXPECT_EQ(feats.size(), descs.size());
+  // 4 x 3个网格，每个网格最多max_tile_features个特征
+  EXPECT_TRUE(feats.size() > 0);
+  EXPECT_TRUE(feats.size() <= size_t(12 * max_tile_features));
+
+  vector<int> vec_tile_count(12, 0);
+  for (size_t i = 0; i < feats.size(); ++i) {
+    ASSERT_TRUE(feats[i].x() >= 0 && feats[i].x() < image.Width());
+    ASSERT_TRUE(feats[i].y() >= 0 && feats[i].y() < image.Height());
+    ++vec_tile_count[int(feats[i].y()) / tile_size * 4 + int(feats[i].x()) / tile_size];
+  }
+  for (size_t t = 0; t < vec_tile_count.size(); ++t)
+    EXPECT_TRUE(vec_tile_count[t] <= max_tile_features);
+}
+
+TEST(SIFT, SingleTileMatchesSIFTDetector)
+{
+  const Image<unsigned char> image = MakeBlobImage(200, 150);
+
+  vector<ScalePointFeature> feats;
+  vector<Descriptor<unsigned char, 128> > descs;
+  vector<float> responses;
+  EXPECT_TRUE(SIFTDetector(image, feats, descs, false, false, 0.04f, true, &responses));
+  EXPECT_EQ(feats.size(), responses.size());
+  for (size_t i = 0; i < responses.size(); ++i)
+    EXPECT_TRUE(responses[i] > 0.f);
+
+  // 一个网格覆盖整幅图像并且不限制个数时，与SIFTDetector的结果相同
+  vector<ScalePointFeature> tiled_feats;
+  vector<Descriptor<unsigned char, 128> > tiled_descs;
+  EXPECT_TRUE(SIFTDetectorTiled(image, tiled_feats, tiled_descs, 256, 1000000, 0));
+  EXPECT_EQ(feats.size(), tiled_feats.size());
+}
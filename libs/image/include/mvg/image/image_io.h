@@ -58,6 +58,18 @@ namespace mvg {
 		int ReadJpg(const char *, std::vector<unsigned char> *, int * w, int * h, int * depth);
 		int ReadJpgStream(FILE *, std::vector<unsigned char> *, int * w, int * h, int * depth);
 
+		/**
+		 * \brief	缩小读取jpg图像，利用libjpeg的DCT缩放直接解码为1/2、1/4或1/8大小
+		 *
+		 * \param	max_dimension	目标最大边长，选择使图像最大边长不超过它的最小缩小倍数(最多为8)，0表示不缩小
+		 * \param	is_gray		 	是否直接解码为灰度图像(YCbCr图像只解码亮度分量)
+		 * \param [out]	scale	 	缩小的倍数，原图坐标约为(解码后的坐标 + 0.5) * scale - 0.5
+		 */
+		int ReadJpgScaled(const char *, std::vector<unsigned char> *, int * w, int * h, int * depth,
+			int max_dimension, bool is_gray, int * scale);
+		int ReadJpgStreamScaled(FILE *, std::vector<unsigned char> *, int * w, int * h, int * depth,
+			int max_dimension, bool is_gray, int * scale);
+
 		int ReadPnm(const char *, std::vector<unsigned char> *, int * w, int * h, int * depth);
 		int ReadPnmStream(FILE *, std::vector<unsigned char> *, int * w, int * h, int * depth);
 
@@ -137,6 +149,20 @@ namespace mvg {
 			return res;
 		}
 
+		/**
+		 * \brief	读取灰度图像，图像最大边长超过max_dimension时缩小读取。
+		 *			jpg图像直接解码为缩小的灰度图像(只解码亮度)，解码时间和内存都随之减少；
+		 *			max_dimension为0时与readImage(path, im)相同，其他格式按原分辨率读取
+		 *
+		 * \param	path		 	图片文件路径
+		 * \param [out]	im	 	返回的灰度图像
+		 * \param	max_dimension	目标最大边长，0表示不缩小
+		 * \param [out]	scale	 	缩小的倍数(1、2、4或8)
+		 *
+		 * \return	读取成功返回1
+		 */
+		int IMAGE_IMPEXP readImage(const char * path, Image<unsigned char> * im, int max_dimension, int * scale);
+
 		//--------
 		//-- Image Writing
 		//--------
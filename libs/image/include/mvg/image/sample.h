@@ -114,7 +114,7 @@ namespace mvg {
 		inline void DownsampleChannelsBy2(const Image<T> &in, Image<T> *out) {
 			int height = in.Height() / 2;
 			int width = in.Width() / 2;
-			out->Resize(height, width);
+			out->Resize(width, height);
 			for (int r = 0; r < height; ++r) {
 				for (int c = 0; c < width; ++c) {
 					(*out)(r, c) = (in(2 * r, 2 * c) +
@@ -132,7 +132,7 @@ namespace mvg {
 			int height = in.Height() / 2;
 			int width = in.Width() / 2;
 			int channels = in.Channels();
-			out->Resize(height, width);
+			out->Resize(width, height);
 			for (int r = 0; r < height; ++r) {
 				for (int c = 0; c < width; ++c) {
 					for (int m = 0; m < channels; ++m)
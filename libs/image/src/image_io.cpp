@@ -1,5 +1,6 @@
 ﻿#include "mvg/image/image.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <cmath>
@@ -112,6 +113,37 @@ namespace mvg {
 			int * w,
 			int * h,
 			int * depth) {
+			int scale = 1;
+			return ReadJpgStreamScaled(file, ptr, w, h, depth, 0, false, &scale);
+		}
+
+		int ReadJpgScaled(const char * filename,
+			std::vector<unsigned char> * ptr,
+			int * w,
+			int * h,
+			int * depth,
+			int max_dimension,
+			bool is_gray,
+			int * scale) {
+
+			FILE *file = fopen(filename, "rb");
+			if (!file) {
+				std::cerr << "Error: Couldn't open " << filename << " fopen returned 0";
+				return 0;
+			}
+			int res = ReadJpgStreamScaled(file, ptr, w, h, depth, max_dimension, is_gray, scale);
+			fclose(file);
+			return res;
+		}
+
+		int ReadJpgStreamScaled(FILE * file,
+			std::vector<unsigned char> * ptr,
+			int * w,
+			int * h,
+			int * depth,
+			int max_dimension,
+			bool is_gray,
+			int * scale) {
 			jpeg_decompress_struct cinfo;
 			struct my_error_mgr jerr;
 			cinfo.err = jpeg_std_error(&jerr.pub);
@@ -125,6 +157,17 @@ namespace mvg {
 			jpeg_create_decompress(&cinfo);
 			jpeg_stdio_src(&cinfo, file);
 			jpeg_read_header(&cinfo, TRUE);
+
+			// 利用DCT缩放直接解码为1/2、1/4或1/8大小，不需要先解码全分辨率的图像
+			*scale = 1;
+			const int max_size = (std::max)(cinfo.image_width, cinfo.image_height);
+			while (max_dimension > 0 && *scale < 8 && (max_size + *scale - 1) / *scale > max_dimension)
+				*scale *= 2;
+			cinfo.scale_num = 1;
+			cinfo.scale_denom = *scale;
+			// YCbCr可以直接只解码亮度分量，其他颜色空间(如CMYK)按原样解码
+			if (is_gray && (cinfo.jpeg_color_space == JCS_YCbCr || cinfo.jpeg_color_space == JCS_GRAYSCALE))
+				cinfo.out_color_space = JCS_GRAYSCALE;
 			jpeg_start_decompress(&cinfo);
 
 			int row_stride = cinfo.output_width * cinfo.output_components;
@@ -148,6 +191,32 @@ namespace mvg {
 		}
 
 
+		int readImage(const char * path, Image<unsigned char> * im, int max_dimension, int * scale)
+		{
+			*scale = 1;
+			// 不缩小时与readImage(path, im)完全相同(RGB解码后转换为灰度)，保持默认的特征不变
+			if (max_dimension <= 0 || GetFormat(path) != Jpg)
+				return readImage(path, im);
+
+			std::vector<unsigned char> ptr;
+			int w, h, depth;
+			int res = ReadJpgScaled(path, &ptr, &w, &h, &depth, max_dimension, true, scale);
+			if (res != 1)
+				return res;
+			if (depth == 1) {
+				(*im) = Eigen::Map<Image<unsigned char>::Base>(&ptr[0], h, w);
+			}
+			else if (depth == 3) {
+				//-- Must convert RGB to gray
+				Image<RGBColor> rgbColIm;
+				rgbColIm = Eigen::Map<Image<RGBColor>::Base>((RGBColor*)&ptr[0], h, w);
+				ConvertPixelType(rgbColIm, im);
+			}
+			else
+				return 0;
+			return res;
+		}
+
 		int WriteJpg(const char * filename,
 			const std::vector<unsigned char> & array,
 			int w,
@@ -119,6 +119,28 @@ TEST(ImageIOTest, Jpg) {
   remove(filename.c_str());
 }
 
+TEST(ImageIOTest, Jpg_Scaled) {
+  Image<RGBColor> image(64, 48, true, RGBColor(200, 100, 50));
+  string filename = ("test_write_jpg_scaled.jpg");
+  EXPECT_TRUE(WriteJpg(filename.c_str(), image, 100));
+
+  // 最大边长64缩小到不超过16，需要缩小4倍，并且直接解码为灰度图像
+  Image<unsigned char> read_image;
+  int scale = 0;
+  EXPECT_TRUE(readImage(filename.c_str(), &read_image, 16, &scale));
+  EXPECT_EQ(4, scale);
+  EXPECT_EQ(16, read_image.Width());
+  EXPECT_EQ(12, read_image.Height());
+  EXPECT_EQ(1, read_image.Channels());
+
+  // max_dimension为0时按原始分辨率解码
+  EXPECT_TRUE(readImage(filename.c_str(), &read_image, 0, &scale));
+  EXPECT_EQ(1, scale);
+  EXPECT_EQ(64, read_image.Width());
+  EXPECT_EQ(48, read_image.Height());
+  remove(filename.c_str());
+}
+
 TEST(ReadPnm, Pgm) {
   Image<unsigned char> image;
   string pgm_filename = MVG_GLOBAL_SRC_DIR + "/data/image_test/two_pixels.pgm";
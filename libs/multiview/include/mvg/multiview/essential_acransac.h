@@ -41,6 +41,10 @@ namespace mvg {
 					Mat3 >
 					KernelType;
 
+				// 对应点少于最终保留的内点个数，不需要估计
+				if (xA.cols() < KernelType::MINIMUM_SAMPLES * 2.5)
+					return;
+
 				KernelType kernel(xA, imgSizeA.first, imgSizeA.second,
 					xB, imgSizeB.first, imgSizeB.second,
 					camera_matrix, camera_matrix);
@@ -49,7 +53,7 @@ namespace mvg {
 				Mat3 E;
 				double upper_bound_precision = m_dPrecision;
 				std::pair<double, double> acransac_out =
-					ACRANSAC(kernel, vec_inliers, max_iteration, &E, upper_bound_precision);
+					ACRANSAC(kernel, vec_inliers, max_iteration, &E, upper_bound_precision, false, early_exit);
 
 				if (vec_inliers.size() < KernelType::MINIMUM_SAMPLES *2.5)  {
 					vec_inliers.clear();
@@ -59,6 +63,7 @@ namespace mvg {
 			double m_dPrecision;  //upper_bound of the precision
 			size_t max_iteration; //!< 最大的迭代数
 			Mat3 camera_matrix; //!< 相机内参矩阵
+			ACRansacEarlyExit early_exit; //!< 内点不可能达到要求时提前终止，默认不启用
 		};
 	}// namespace multiview
 } // namespace mvg
@@ -34,6 +34,10 @@ namespace mvg {
 					Mat3 >
 					KernelType;
 
+				// 对应点少于最终保留的内点个数，不需要估计
+				if (xA.cols() < KernelType::MINIMUM_SAMPLES * 2.5)
+					return;
+
 				KernelType kernel(xA, imgSizeA.first, imgSizeA.second,
 					xB, imgSizeB.first, imgSizeB.second, true);
 
@@ -41,7 +45,7 @@ namespace mvg {
 				Mat3 fundamental_matrix;
 				double upper_bound_precision = m_dPrecision;
 				std::pair<double, double> acransac_out =
-					ACRANSAC(kernel, vec_inliers, max_iteration, &fundamental_matrix, upper_bound_precision);
+					ACRANSAC(kernel, vec_inliers, max_iteration, &fundamental_matrix, upper_bound_precision, false, early_exit);
 
 				if (vec_inliers.size() < KernelType::MINIMUM_SAMPLES *2.5)  {
 					vec_inliers.clear();
@@ -50,6 +54,7 @@ namespace mvg {
 
 			double m_dPrecision;  //upper_bound of the precision
 			size_t max_iteration; //maximal number of iteration used
+			ACRansacEarlyExit early_exit; //!< 内点不可能达到要求时提前终止，默认不启用
 		};
 	}
 }; // namespace mvg
@@ -89,7 +89,7 @@ namespace mvg{
 				T predicted_x, predicted_y;
 
 				// Apply distortion to the normalized points.
-				ApplyRadialDistortionIntrinsics(
+				mvg::camera::ApplyRadialDistortionIntrinsics(
 					focal_length,
 					focal_length,
 					principal_point_x,
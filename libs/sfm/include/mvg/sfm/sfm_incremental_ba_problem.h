@@ -0,0 +1,140 @@
+﻿#ifndef MVG_SFM_INCREMENTAL_BA_PROBLEM_H
+#define MVG_SFM_INCREMENTAL_BA_PROBLEM_H
+
+#include "mvg/sfm/link_pragmas.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ceres/ceres.h"
+#include "mvg/math/numeric.h"
+
+using namespace mvg::math;
+
+namespace mvg{
+	namespace sfm{
+
+		/**
+		 * \brief	增量式重建中跨多轮BA保持的ceres::Problem。
+		 *			相机外参[R|t]、内参组[focal,ppx,ppy,k1,k2,k3]和三维点的参数块保存在位置不变的存储中，
+		 *			观测加入或删除时增量地更新残差块，每次求解只需要建立新观测的残差块和设置固定的参数块
+		 */
+		class SFM_IMPEXP IncrementalBundleAdjustmentProblem
+		{
+		public:
+			/**
+			 * \param	is_refine_point_and_distortion	为false时内参组中只优化焦距
+			 */
+			explicit IncrementalBundleAdjustmentProblem(bool is_refine_point_and_distortion = true);
+
+			/// 设置相机的外参及其所属的内参组，相机已经存在时更新外参
+			void SetCamera(size_t image_id, size_t intrinsic_group, const Mat3 & R, const Vec3 & t);
+
+			/// 设置内参组的参数
+			void SetIntrinsic(size_t intrinsic_group, const Vec6 & intrinsic);
+
+			/// 内参组是否已经存在
+			bool HasIntrinsic(size_t intrinsic_group) const
+			{
+				return map_intrinsics_.find(intrinsic_group) != map_intrinsics_.end();
+			}
+
+			/// 设置三维点的坐标
+			void SetPoint(size_t track_id, const Vec3 & point_3d);
+
+			/// 加入三维点在图像中的观测，残差块在下次求解时建立。观测已经存在时不做任何操作
+			void AddObservation(size_t track_id, size_t image_id, const Vec2 & x);
+
+			/// 删除三维点在图像中的观测
+			void RemoveObservation(size_t track_id, size_t image_id);
+
+			/// 删除三维点及其所有的观测
+			void RemovePoint(size_t track_id);
+
+			/**
+			 * \brief	建立新观测的残差块并求解
+			 *
+			 * \param	options					求解的参数
+			 * \param	fixed_image_id			全局BA中固定的相机，用来确定场景的坐标系
+			 * \param	set_local_cameras		为NULL时优化所有的参数(全局BA)；否则只优化这些相机和它们看到的三维点，
+			 *									其余相机、所有内参组和其余三维点保持不变(局部BA)
+			 * \param [out]	summary				求解的结果
+			 *
+			 * \return	结果是否可用
+			 */
+			bool Solve(const ceres::Solver::Options & options, size_t fixed_image_id,
+				const std::set<size_t> * set_local_cameras, ceres::Solver::Summary * summary);
+
+			/// 相机的外参
+			void GetCamera(size_t image_id, Mat3 & R, Vec3 & t) const;
+
+			/// 相机所属的内参组
+			size_t GetIntrinsicGroup(size_t image_id) const
+			{
+				return map_cameras_.find(image_id)->second.intrinsic_group;
+			}
+
+			/// 内参组的参数
+			Vec6 GetIntrinsic(size_t intrinsic_group) const;
+
+			/// 三维点的坐标
+			Vec3 GetPoint(size_t track_id) const;
+
+			/// 观测的个数，包括还没有建立残差块的观测
+			size_t NbObservations() const
+			{
+				return map_residuals_.size() + map_pending_.size();
+			}
+
+			double setupSeconds() const { return setup_seconds_; }            //!< 最近一次求解中建立残差块和设置固定参数块的时间
+			double solveSeconds() const { return solve_seconds_; }            //!< 最近一次求解的时间
+			double totalSetupSeconds() const { return total_setup_seconds_; } //!< 所有求解的准备时间之和
+			double totalSolveSeconds() const { return total_solve_seconds_; } //!< 所有求解的时间之和
+
+		private:
+			typedef std::pair<size_t, size_t> ObservationKey; //!< (TrackId, ImageId)
+
+			struct CameraBlock
+			{
+				double extrinsic[6];     //!< 角轴表示的旋转和平移
+				size_t intrinsic_group;  //!< 所属的内参组
+			};
+
+			struct IntrinsicBlock
+			{
+				double intrinsic[6];
+			};
+
+			struct PointBlock
+			{
+				double point[3];
+			};
+
+			/// 固定参数块并记录，下次求解之前恢复
+			void SetBlockConstant(double * block);
+
+			std::map<size_t, CameraBlock> map_cameras_;        //!< 每个相机的外参
+			std::map<size_t, IntrinsicBlock> map_intrinsics_;  //!< 每个内参组的参数
+			std::map<size_t, PointBlock> map_points_;          //!< 每个三维点的坐标
+
+			std::map<ObservationKey, ceres::ResidualBlockId> map_residuals_;        //!< 已经建立的残差块
+			std::map<ObservationKey, std::pair<double, double> > map_pending_;     //!< 还没有建立残差块的观测
+			std::vector<double *> vec_constant_blocks_;                             //!< 上次求解固定的参数块
+
+			std::shared_ptr<ceres::LossFunction> loss_function_;                           //!< 所有残差共用的损失函数
+			std::shared_ptr<ceres::LocalParameterization> intrinsic_parameterization_;     //!< 只优化焦距时的内参参数化，可以为空
+			ceres::Problem problem_;   //!< 不拥有损失函数和参数化，在它们之前析构
+
+			double setup_seconds_;
+			double solve_seconds_;
+			double total_setup_seconds_;
+			double total_solve_seconds_;
+		};
+
+	} // namespace sfm
+} // namespace mvg
+
+#endif // MVG_SFM_INCREMENTAL_BA_PROBLEM_H
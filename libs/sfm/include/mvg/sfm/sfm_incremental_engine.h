@@ -16,6 +16,8 @@
 
 namespace mvg{
 	namespace sfm{
+		class IncrementalBundleAdjustmentProblem;
+
 		//Estimate E -> So R,t for the first pair
 		// Maintain a track list that explain 3D reconstructed scene
 		// Add images with Resection with the 3D tracks.
@@ -50,14 +52,62 @@ namespace mvg{
 			bool FindImagesWithPossibleResection(std::vector<size_t> & vec_possible_indexes);
 
 			/// Add to the current scene the desired image indexes.
+			/// 各图像的切除在不变的场景上同时计算，然后按照候选的顺序依次加入场景
 			bool Resection(std::vector<size_t> & vec_possible_indexes);
 
 			/// Add a single Image to the scene and triangulate new possible tracks
 			bool Resection(size_t imageIndex);
 
+			/// 单张图像的切除结果，由ComputeResection计算，CommitResection加入场景
+			struct ResectionResult
+			{
+				size_t image_index;
+				bool is_resected;          //!< 切除是否成功
+				Mat34 P;                   //!< 切除得到的投影矩阵
+				double error_max;          //!< ACRANSAC估计的误差阈值
+				size_t nb_correspondences; //!< 用于切除的2D-3D对应个数
+				size_t nb_inliers;         //!< 切除的内点个数
+			};
+
+			/**
+			 * \brief	只读取当前的场景计算图像的切除，可以在多个线程中对不同的图像同时调用。
+			 *			采样使用以图像索引为种子的随机数生成器，结果与线程的个数和调度无关
+			 *
+			 * \param	imageIndex		要切除的图像
+			 * \param [out]	result	切除的结果
+			 * \param	is_verbose		是否输出ACRANSAC的迭代信息，并行切除时关闭
+			 *
+			 * \return	切除是否成功
+			 */
+			bool ComputeResection(size_t imageIndex, ResectionResult & result, bool is_verbose) const;
+
+			/**
+			 * \brief	把切除的结果加入场景：加入相机，用当前已经三角化的轨迹划分内点和外点，并三角化新的轨迹
+			 *
+			 * \param	result	ComputeResection的结果，之后加入的轨迹也按照结果中的投影矩阵和阈值判断
+			 *
+			 * \return	切除是否成功
+			 */
+			bool CommitResection(const ResectionResult & result);
+
 			/// Discard track with too large residual error
 			size_t badTrackRejector(double dPrecision);
 
+			/**
+			 * \brief	局部BA的窗口：新加入的相机，以及与它们共同看到最多三维点的local_ba_neighbour_count_个相机
+			 *
+			 * \param	vec_new_images				本轮加入的图像，没有重建成功的被忽略
+			 * \param [out]	set_local_cameras	窗口中的相机
+			 */
+			void LocalBundleAdjustmentCameras(const std::vector<size_t> & vec_new_images,
+				std::set<size_t> & set_local_cameras) const;
+
+			/// 重建的相机及其内参组加入BA问题
+			void AddCameraToBundleAdjustment(size_t imageId);
+
+			/// 三角化的三维点及其在map_reconstructed_中的观测加入BA问题
+			void AddTrackToBundleAdjustment(size_t trackId);
+
 		public:
 			/// Give a color to all the 3D points
 			void ColorizeTracks(std::vector<Vec3> & vec_tracks_color) const;
@@ -67,8 +117,13 @@ namespace mvg{
 				return reconstructor_data_;
 			}
 
-			/// Bundle adjustment to refine Structure and Motion
-			void BundleAdjustment();
+			/**
+			 * \brief	Bundle adjustment to refine Structure and Motion
+			 *
+			 * \param	set_local_cameras	为NULL时优化所有的相机和三维点(全局BA)；否则只优化这些相机及它们看到的三维点，
+			 *							其余相机和所有内参保持不变(局部BA)
+			 */
+			void BundleAdjustment(const std::set<size_t> * set_local_cameras = NULL);
 
 			// Return MSE (Mean Square Error) and an histogram of residual values.
 			double ComputeResidualsHistogram(Histogram<double> * histo);
@@ -119,6 +174,21 @@ namespace mvg{
 				is_refine_point_and_distortion_ = is_refine_point_and_distortion;
 			}
 
+			/**
+			 * \brief	每轮切除后只进行局部BA，相机个数比上次全局BA增长global_growth_ratio时才进行全局BA
+			 *
+			 * \param	is_use_local_bundle_adjustment	是否使用局部BA
+			 * \param	global_growth_ratio				触发全局BA的相机个数的增长比例
+			 * \param	neighbour_count					局部BA中除新加入的相机之外优化的共视相机个数
+			 */
+			void setLocalBundleAdjustment(bool is_use_local_bundle_adjustment,
+				double global_growth_ratio = 0.25, size_t neighbour_count = 10)
+			{
+				is_use_local_bundle_adjustment_ = is_use_local_bundle_adjustment;
+				global_ba_growth_ratio_ = global_growth_ratio;
+				local_ba_neighbour_count_ = neighbour_count;
+			}
+
 		private:
 
 			std::vector<mvg::feature::CameraInfo> camera_image_names_;//!<对应的图像
@@ -130,10 +200,16 @@ namespace mvg{
 			//-- Visibility information
 			mvg::feature::PairWiseMatches map_matches_fundamental_; // pairwise matches for Fundamental model
 			mvg::tracking::MapTracks map_tracks_; // reconstructed track (visibility per 3D point)
+			mvg::tracking::TracksPerImageIndex tracks_per_image_;//!< map_tracks_的倒排索引，与map_tracks_同步更新
 
 			std::pair<size_t, size_t> initial_pair_;//!< 初始匹配对
 			bool is_use_bundle_adjustment_;//!<是否使用BA
 			bool is_refine_point_and_distortion_; // Boolean used to know if Principal point and Radial disto is refined
+			bool is_use_local_bundle_adjustment_;//!<每轮切除后是否只进行局部BA
+			double global_ba_growth_ratio_;//!<相机个数增长的比例达到该值时进行全局BA
+			size_t local_ba_neighbour_count_;//!<局部BA中优化的共视相机个数
+			size_t global_ba_camera_count_;//!<上次全局BA时的相机个数
+			std::shared_ptr<IncrementalBundleAdjustmentProblem> ba_problem_;//!< 跨多轮BA保持的问题，随相机、三维点和观测的增删增量更新
 
 			// -----
 			// Future reconstructed data
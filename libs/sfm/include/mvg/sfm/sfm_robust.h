@@ -204,6 +204,8 @@ static double Error(const Mat34 & P, const Vec2 & point_2d, const Vec3 & point_3
 };
 
 /// Compute the robust resection of the 3D<->2D correspondences.
+/// generator为采样使用的随机数生成器，为NULL时使用全局的rand()；
+/// is_verbose为true时输出ACRANSAC的迭代信息，多个线程同时切除时应关闭
 bool robustResection(
   const std::pair<size_t,size_t> & imageSize,
   const Mat & point_2d,
@@ -211,7 +213,9 @@ bool robustResection(
   std::vector<size_t> * pvec_inliers,
   const Mat3 * K = NULL,
   Mat34 * P = NULL,
-  double * maxError = NULL)
+  double * maxError = NULL,
+  std::mt19937 * generator = NULL,
+  bool is_verbose = true)
 {
   double dPrecision = std::numeric_limits<double>::infinity();
   size_t MINIMUM_SAMPLES = 0;
@@ -228,7 +232,7 @@ bool robustResection(
     KernelType kernel(point_2d, imageSize.first, imageSize.second, point_3d);
     // Robustly estimation of the Projection matrix and it's precision
     std::pair<double,double> acransac_out = ACRANSAC(kernel, *pvec_inliers,
-      ACRANSAC_ITER, P, dPrecision, true);
+      ACRANSAC_ITER, P, dPrecision, is_verbose, ACRansacEarlyExit(), generator);
     *maxError = acransac_out.first;
 
   }
@@ -245,7 +249,7 @@ bool robustResection(
     KernelType kernel(point_2d, point_3d, *K);
     // Robustly estimation of the Projection matrix and it's precision
     std::pair<double,double> acransac_out = ACRANSAC(kernel, *pvec_inliers,
-      ACRANSAC_ITER, P, dPrecision, true);
+      ACRANSAC_ITER, P, dPrecision, is_verbose, ACRansacEarlyExit(), generator);
     *maxError = acransac_out.first;
   }
 
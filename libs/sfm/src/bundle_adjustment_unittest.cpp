@@ -9,6 +9,7 @@
 
 #include "mvg/sfm/pinhole_ceres_functor.h"
 #include "mvg/sfm/problem_data_container.h"
+#include "mvg/sfm/sfm_incremental_ba_problem.h"
 
 using namespace mvg::multiview;
 using namespace mvg::sfm;
@@ -121,4 +122,63 @@ TEST(BundleAdjustment, EffectiveMinimization_RTf) {
 	EXPECT_TRUE(residual_before > residual_after);
 }
 
+/**	增量式BA问题：增删观测后再次求解，局部BA中窗口之外的参数保持不变
+ */
+TEST(IncrementalBundleAdjustmentProblem, AddRemoveAndLocalWindow) {
+
+	const int nviews = 4;
+	const int npoints = 30;
+	NViewDataSet d = NRealisticCamerasRing(nviews, npoints);
+
+	IncrementalBundleAdjustmentProblem ba_problem;
+	Vec6 intrinsic;
+	intrinsic << d.camera_matrix_[0](0, 0), d.camera_matrix_[0](0, 2), d.camera_matrix_[0](1, 2), 0.0, 0.0, 0.0;
+	ba_problem.SetIntrinsic(0, intrinsic);
+	for (int j = 0; j < nviews; ++j)
+		ba_problem.SetCamera(j, 0, d.rotation_matrix_[j], d.translation_vector_[j]);
+
+	// 三维点加上偏移，观测没有噪声
+	for (int i = 0; i < npoints; ++i) {
+		ba_problem.SetPoint(i, d.point_3d_.col(i) + Vec3(.05, -.05, .02));
+		for (int j = 0; j < nviews; ++j)
+			ba_problem.AddObservation(i, j, d.projected_points_[j].col(i));
+	}
+	EXPECT_EQ(nviews * npoints, ba_problem.NbObservations());
 
+	ceres::Solver::Options options;
+	options.linear_solver_type = ceres::DENSE_SCHUR;
+	options.minimizer_progress_to_stdout = false;
+	options.logging_type = ceres::SILENT;
+
+	ceres::Solver::Summary summary;
+	EXPECT_TRUE(ba_problem.Solve(options, 0, NULL, &summary));
+	EXPECT_TRUE(summary.final_cost < 1e-6 * summary.initial_cost);
+
+	// 删除一个观测和一个三维点，参数块保持在问题中
+	ba_problem.RemoveObservation(0, 1);
+	ba_problem.RemovePoint(1);
+	EXPECT_EQ(nviews * npoints - 1 - nviews, ba_problem.NbObservations());
+
+	// 局部BA只优化相机3
+	Mat3 R1, R3, R;
+	Vec3 t1, t3, t;
+	ba_problem.GetCamera(1, R1, t1);
+	ba_problem.GetCamera(3, R3, t3);
+	const Vec6 intrinsic_before = ba_problem.GetIntrinsic(0);
+	ba_problem.SetCamera(3, 0, R3, t3 + Vec3(.02, 0, 0));
+	std::set<size_t> set_local_cameras;
+	set_local_cameras.insert(3);
+	EXPECT_TRUE(ba_problem.Solve(options, 0, &set_local_cameras, &summary));
+
+	ba_problem.GetCamera(1, R, t);
+	EXPECT_EQ(0.0, (t - t1).norm());
+	EXPECT_EQ(0.0, (R - R1).norm());
+	EXPECT_EQ(0.0, (ba_problem.GetIntrinsic(0) - intrinsic_before).norm());
+	ba_problem.GetCamera(3, R, t);
+	EXPECT_NEAR(0.0, (t - t3).norm(), 1e-4);
+
+	// 再次全局BA时局部BA固定的参数块恢复为可变
+	EXPECT_TRUE(ba_problem.Solve(options, 0, NULL, &summary));
+	EXPECT_EQ(nviews * npoints - 1 - nviews, summary.num_residuals_reduced / 2);
+	EXPECT_TRUE(ba_problem.totalSolveSeconds() >= ba_problem.solveSeconds());
+}
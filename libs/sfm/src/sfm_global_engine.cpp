@@ -794,12 +794,14 @@ namespace mvg{
 
 			// a. Read images names
 			std::string lists_file = mvg::utils::create_filespec(matches_path_, "lists", "txt");
-			std::string sComputedMatchesFile_E = mvg::utils::create_filespec(matches_path_, "matches.e", "txt");
+			std::string sComputedMatchesFile_E = mvg::utils::create_filespec(matches_path_, "matches.e", "bin");
+			if (!mvg::utils::is_file(sComputedMatchesFile_E))
+				sComputedMatchesFile_E = mvg::utils::create_filespec(matches_path_, "matches.e", "txt");
 			if (!mvg::utils::is_file(lists_file) ||
 				!mvg::utils::is_file(sComputedMatchesFile_E))
 			{
 				std::cerr << std::endl
-					<< "One of the input required file is not a present (lists.txt, matches.e.txt)" << std::endl;
+					<< "One of the input required file is not a present (lists.txt, matches.e.bin or matches.e.txt)" << std::endl;
 				return false;
 			}
 
@@ -845,14 +847,14 @@ namespace mvg{
 			}
 
 			// Read features:
+			std::vector<std::string> feat_filenames(vec_file_names_.size());
 			for (size_t i = 0; i < vec_file_names_.size(); ++i)  {
-				const size_t camIndex = i;
-				if (!LoadFeatsFromFile(
-					mvg::utils::create_filespec(matches_path_, mvg::utils::basename_part(vec_file_names_[camIndex]), ".feat"),
-					map_features_[camIndex])) {
-					std::cerr << "Bad reading of feature files" << std::endl;
-					return false;
-				}
+				feat_filenames[i] = mvg::utils::create_filespec(matches_path_,
+					mvg::utils::basename_part(vec_file_names_[i]), ".feat");
+			}
+			if (!LoadFeatsFromFiles(feat_filenames, map_features_)) {
+				std::cerr << "Bad reading of feature files" << std::endl;
+				return false;
 			}
 			return true;
 		}
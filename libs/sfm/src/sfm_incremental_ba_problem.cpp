@@ -0,0 +1,231 @@
+﻿#include "sfm_precomp.h"
+#include "mvg/sfm/sfm_incremental_ba_problem.h"
+#include "mvg/sfm/pinhole_brown_rt_ceres_functor.h"
+
+#include "mvg/utils/timer.h"
+#include "mvg/utils/notify.h"
+
+namespace mvg{
+	namespace sfm{
+
+		/// 问题拥有代价函数，快速删除残差块；损失函数和参数化由IncrementalBundleAdjustmentProblem拥有
+		static ceres::Problem::Options PersistentProblemOptions()
+		{
+			ceres::Problem::Options options;
+			options.enable_fast_removal = true;
+			options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+			options.local_parameterization_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+			return options;
+		}
+
+		IncrementalBundleAdjustmentProblem::IncrementalBundleAdjustmentProblem(bool is_refine_point_and_distortion)
+			: loss_function_(new ceres::HuberLoss(4.0)),
+			problem_(PersistentProblemOptions()),
+			setup_seconds_(0.0),
+			solve_seconds_(0.0),
+			total_setup_seconds_(0.0),
+			total_solve_seconds_(0.0)
+		{
+			if (!is_refine_point_and_distortion) {
+				// Last five elements are ppx,ppy and radial disto factors.
+				std::vector<int> vec_constant_PPAndRadialDisto;
+				vec_constant_PPAndRadialDisto.push_back(OFFSET_PRINCIPAL_POINT_X);
+				vec_constant_PPAndRadialDisto.push_back(OFFSET_PRINCIPAL_POINT_Y);
+				vec_constant_PPAndRadialDisto.push_back(OFFSET_K1);
+				vec_constant_PPAndRadialDisto.push_back(OFFSET_K2);
+				vec_constant_PPAndRadialDisto.push_back(OFFSET_K3);
+				intrinsic_parameterization_.reset(new ceres::SubsetParameterization(6, vec_constant_PPAndRadialDisto));
+			}
+		}
+
+		void IncrementalBundleAdjustmentProblem::SetCamera(size_t image_id, size_t intrinsic_group, const Mat3 & R, const Vec3 & t)
+		{
+			CameraBlock & camera = map_cameras_[image_id];
+			ceres::RotationMatrixToAngleAxis((const double*)R.data(), camera.extrinsic);
+			camera.extrinsic[3] = t[0];
+			camera.extrinsic[4] = t[1];
+			camera.extrinsic[5] = t[2];
+			camera.intrinsic_group = intrinsic_group;
+		}
+
+		void IncrementalBundleAdjustmentProblem::SetIntrinsic(size_t intrinsic_group, const Vec6 & intrinsic)
+		{
+			IntrinsicBlock & block = map_intrinsics_[intrinsic_group];
+			for (int i = 0; i < 6; ++i)
+				block.intrinsic[i] = intrinsic(i);
+		}
+
+		void IncrementalBundleAdjustmentProblem::SetPoint(size_t track_id, const Vec3 & point_3d)
+		{
+			PointBlock & block = map_points_[track_id];
+			block.point[0] = point_3d[0];
+			block.point[1] = point_3d[1];
+			block.point[2] = point_3d[2];
+		}
+
+		void IncrementalBundleAdjustmentProblem::AddObservation(size_t track_id, size_t image_id, const Vec2 & x)
+		{
+			const ObservationKey key(track_id, image_id);
+			if (map_residuals_.find(key) == map_residuals_.end())
+				map_pending_.insert(std::make_pair(key, std::make_pair(x[0], x[1])));
+		}
+
+		void IncrementalBundleAdjustmentProblem::RemoveObservation(size_t track_id, size_t image_id)
+		{
+			const ObservationKey key(track_id, image_id);
+			map_pending_.erase(key);
+			std::map<ObservationKey, ceres::ResidualBlockId>::iterator iter = map_residuals_.find(key);
+			if (iter != map_residuals_.end()) {
+				problem_.RemoveResidualBlock(iter->second);
+				map_residuals_.erase(iter);
+			}
+		}
+
+		void IncrementalBundleAdjustmentProblem::RemovePoint(size_t track_id)
+		{
+			// 观测按(TrackId, ImageId)排序，三维点的观测是连续的区间
+			const ObservationKey first(track_id, 0);
+			const ObservationKey last(track_id + 1, 0);
+			map_pending_.erase(map_pending_.lower_bound(first), map_pending_.lower_bound(last));
+
+			std::map<ObservationKey, ceres::ResidualBlockId>::iterator iter = map_residuals_.lower_bound(first);
+			const std::map<ObservationKey, ceres::ResidualBlockId>::iterator iter_end = map_residuals_.lower_bound(last);
+			for (; iter != iter_end; ++iter)
+				problem_.RemoveResidualBlock(iter->second);
+			map_residuals_.erase(map_residuals_.lower_bound(first), iter_end);
+
+			std::map<size_t, PointBlock>::iterator iter_point = map_points_.find(track_id);
+			if (iter_point != map_points_.end()) {
+				if (problem_.HasParameterBlock(iter_point->second.point))
+					problem_.RemoveParameterBlock(iter_point->second.point);
+				map_points_.erase(iter_point);
+			}
+		}
+
+		void IncrementalBundleAdjustmentProblem::SetBlockConstant(double * block)
+		{
+			if (problem_.HasParameterBlock(block)) {
+				problem_.SetParameterBlockConstant(block);
+				vec_constant_blocks_.push_back(block);
+			}
+		}
+
+		bool IncrementalBundleAdjustmentProblem::Solve(const ceres::Solver::Options & options, size_t fixed_image_id,
+			const std::set<size_t> * set_local_cameras, ceres::Solver::Summary * summary)
+		{
+			mvg::utils::Timer timer;
+			timer.Start();
+
+			// 为新的观测建立残差块；缺少三维点、相机或内参块的观测保留到下次求解
+			size_t num_unresolved = 0;
+			for (std::map<ObservationKey, std::pair<double, double> >::iterator iter = map_pending_.begin();
+				iter != map_pending_.end();)
+			{
+				std::map<size_t, PointBlock>::iterator iter_point = map_points_.find(iter->first.first);
+				std::map<size_t, CameraBlock>::iterator iter_camera = map_cameras_.find(iter->first.second);
+				std::map<size_t, IntrinsicBlock>::iterator iter_intrinsic = map_intrinsics_.end();
+				if (iter_camera != map_cameras_.end())
+					iter_intrinsic = map_intrinsics_.find(iter_camera->second.intrinsic_group);
+				if (iter_point == map_points_.end() || iter_camera == map_cameras_.end() ||
+					iter_intrinsic == map_intrinsics_.end())
+				{
+					++num_unresolved;
+					++iter;
+					continue;
+				}
+
+				double * intrinsic = iter_intrinsic->second.intrinsic;
+				if (!problem_.HasParameterBlock(intrinsic))
+					problem_.AddParameterBlock(intrinsic, 6, intrinsic_parameterization_.get());
+
+				const double observation[2] = { iter->second.first, iter->second.second };
+				ceres::CostFunction* cost_function =
+					new ceres::AutoDiffCostFunction<ErrorFunc_Refine_Camera_3DPoints, 2, 6, 6, 3>(
+					new ErrorFunc_Refine_Camera_3DPoints(observation));
+				map_residuals_[iter->first] = problem_.AddResidualBlock(cost_function,
+					loss_function_.get(),
+					intrinsic,
+					iter_camera->second.extrinsic,
+					iter_point->second.point);
+				map_pending_.erase(iter++);
+			}
+			if (num_unresolved > 0)
+			{
+				MVG_WARN << "IncrementalBundleAdjustmentProblem: " << num_unresolved
+					<< " observation(s) wait for a missing point, camera or intrinsic block" << std::endl;
+			}
+
+			// 恢复上次求解固定的参数块，被删除的三维点已经不在问题中
+			for (size_t i = 0; i < vec_constant_blocks_.size(); ++i) {
+				if (problem_.HasParameterBlock(vec_constant_blocks_[i]))
+					problem_.SetParameterBlockVariable(vec_constant_blocks_[i]);
+			}
+			vec_constant_blocks_.clear();
+
+			if (set_local_cameras == NULL) {
+				//-- Lock the first camera to better deal with scene orientation ambiguity
+				std::map<size_t, CameraBlock>::iterator iter_camera = map_cameras_.find(fixed_image_id);
+				if (iter_camera != map_cameras_.end())
+					SetBlockConstant(iter_camera->second.extrinsic);
+			}
+			else {
+				// 窗口中的相机看到的三维点
+				std::set<size_t> set_local_points;
+				for (std::map<ObservationKey, ceres::ResidualBlockId>::const_iterator iter = map_residuals_.begin();
+					iter != map_residuals_.end(); ++iter)
+				{
+					if (set_local_cameras->find(iter->first.second) != set_local_cameras->end())
+						set_local_points.insert(iter->first.first);
+				}
+
+				// 其余的参数保持不变，只与固定参数块相关的残差在求解之前被ceres去掉
+				for (std::map<size_t, CameraBlock>::iterator iter = map_cameras_.begin(); iter != map_cameras_.end(); ++iter) {
+					if (set_local_cameras->find(iter->first) == set_local_cameras->end())
+						SetBlockConstant(iter->second.extrinsic);
+				}
+				for (std::map<size_t, IntrinsicBlock>::iterator iter = map_intrinsics_.begin(); iter != map_intrinsics_.end(); ++iter)
+					SetBlockConstant(iter->second.intrinsic);
+				for (std::map<size_t, PointBlock>::iterator iter = map_points_.begin(); iter != map_points_.end(); ++iter) {
+					if (set_local_points.find(iter->first) == set_local_points.end())
+						SetBlockConstant(iter->second.point);
+				}
+			}
+			setup_seconds_ = timer.Stop();
+			total_setup_seconds_ += setup_seconds_;
+
+			if (problem_.NumResidualBlocks() == 0) {
+				solve_seconds_ = 0.0;
+				return false;
+			}
+
+			timer.Start();
+			ceres::Solve(options, &problem_, summary);
+			solve_seconds_ = timer.Stop();
+			total_solve_seconds_ += solve_seconds_;
+			return summary->IsSolutionUsable();
+		}
+
+		void IncrementalBundleAdjustmentProblem::GetCamera(size_t image_id, Mat3 & R, Vec3 & t) const
+		{
+			const double * extrinsic = map_cameras_.find(image_id)->second.extrinsic;
+			// angle axis to rotation matrix
+			ceres::AngleAxisToRotationMatrix(extrinsic, R.data());
+			t = Vec3(extrinsic[3], extrinsic[4], extrinsic[5]);
+		}
+
+		Vec6 IncrementalBundleAdjustmentProblem::GetIntrinsic(size_t intrinsic_group) const
+		{
+			const double * intrinsic = map_intrinsics_.find(intrinsic_group)->second.intrinsic;
+			Vec6 values;
+			values << intrinsic[0], intrinsic[1], intrinsic[2], intrinsic[3], intrinsic[4], intrinsic[5];
+			return values;
+		}
+
+		Vec3 IncrementalBundleAdjustmentProblem::GetPoint(size_t track_id) const
+		{
+			const double * point = map_points_.find(track_id)->second.point;
+			return Vec3(point[0], point[1], point[2]);
+		}
+
+	} // namespace sfm
+} // namespace mvg
@@ -9,7 +9,7 @@
 #include "mvg/feature/indexed_match_utils.h"
 #include "mvg/feature/indexed_match.h"
 #include "mvg/sfm/pinhole_brown_rt_ceres_functor.h"
-#include "mvg/sfm/problem_data_container.h"
+#include "mvg/sfm/sfm_incremental_ba_problem.h"
 #include "mvg/sfm/sfm_incremental_engine.h"
 #include "mvg/sfm/sfm_robust.h"
 
@@ -42,7 +42,11 @@ namespace mvg{
 			: ReconstructionEngine(image_path, matches_path, out_dir),
 			initial_pair_(std::make_pair<size_t, size_t>(0, 0)),
 			is_refine_point_and_distortion_(true),
-			is_use_bundle_adjustment_(true)
+			is_use_bundle_adjustment_(true),
+			is_use_local_bundle_adjustment_(false),
+			global_ba_growth_ratio_(0.25),
+			local_ba_neighbour_count_(10),
+			global_ba_camera_count_(0)
 		{
 			is_html_report_ = is_html_report;
 			if (!mvg::utils::folder_exists(out_dir)) {
@@ -83,6 +87,8 @@ namespace mvg{
 			if (!readInputData())
 				return false;
 
+			ba_problem_.reset(new IncrementalBundleAdjustmentProblem(is_refine_point_and_distortion_));
+
 			// 增量式重建
 			std::pair<size_t, size_t> initial_pair_index;
 			if (!InitialPairChoice(initial_pair_index))
@@ -93,6 +99,7 @@ namespace mvg{
 				return false;
 
 			BundleAdjustment(); // Adjust 3D point and camera parameters.
+			global_ba_camera_count_ = reconstructor_data_.map_Camera.size();
 
 			size_t round = 0;
 			bool bImageAdded = false;
@@ -110,14 +117,40 @@ namespace mvg{
 				++round;
 				if (bImageAdded && is_use_bundle_adjustment_)
 				{
+					// 局部BA只优化本轮加入的相机及其共视相机，模型增长到一定比例时才进行全局BA
+					std::set<size_t> set_local_cameras;
+					bool is_global = true;
+					if (is_use_local_bundle_adjustment_ && reconstructor_data_.map_Camera.size() <
+						global_ba_camera_count_ * (1.0 + global_ba_growth_ratio_))
+					{
+						LocalBundleAdjustmentCameras(vec_possible_resection_indexes, set_local_cameras);
+						is_global = set_local_cameras.size() == reconstructor_data_.map_Camera.size();
+					}
+
 					// Perform BA until all point are under the given precision
-					do
+					if (is_global || !set_local_cameras.empty())
 					{
-						BundleAdjustment();
-					} while (badTrackRejector(4.0) != 0);
+						do
+						{
+							BundleAdjustment(is_global ? NULL : &set_local_cameras);
+						} while (badTrackRejector(4.0) != 0);
+					}
+					if (is_global)
+						global_ba_camera_count_ = reconstructor_data_.map_Camera.size();
 				}
 			}
 
+			// 最后一次只进行了局部BA时，对整个模型再进行一次全局BA
+			if (is_use_bundle_adjustment_ && is_use_local_bundle_adjustment_
+				&& global_ba_camera_count_ != reconstructor_data_.map_Camera.size())
+			{
+				do
+				{
+					BundleAdjustment();
+				} while (badTrackRejector(4.0) != 0);
+				global_ba_camera_count_ = reconstructor_data_.map_Camera.size();
+			}
+
 			//-- Reconstruction done.
 			//-- Display some statistics
 			MVG_INFO << "\n\n-------------------------------" << "\n"
@@ -125,6 +158,8 @@ namespace mvg{
 				<< "-- #Camera calibrated: " << reconstructor_data_.map_Camera.size()
 				<< " from " << camera_image_names_.size() << " input images.\n"
 				<< "-- #Tracks, #3D points: " << reconstructor_data_.map_3d_points.size() << "\n"
+				<< "-- Bundle adjustment time (s): setup " << ba_problem_->totalSetupSeconds()
+				<< ", solve " << ba_problem_->totalSolveSeconds() << "\n"
 				<< "-------------------------------" << "\n";
 
 			Histogram<double> h;
@@ -176,12 +211,15 @@ namespace mvg{
 			}
 
 			std::string file_lists = mvg::utils::create_filespec(matches_path_, "lists", "txt");
-			std::string computed_matches_file = mvg::utils::create_filespec(matches_path_, "matches.f", "txt");
+			// 优先读取二进制匹配文件，兼容旧的文本文件
+			std::string computed_matches_file = mvg::utils::create_filespec(matches_path_, "matches.f", "bin");
+			if (!mvg::utils::is_file(computed_matches_file))
+				computed_matches_file = mvg::utils::create_filespec(matches_path_, "matches.f", "txt");
 			if (!mvg::utils::is_file(file_lists) ||
 				!mvg::utils::is_file(computed_matches_file))
 			{
 				std::cerr << std::endl
-					<< "One of the input required file is not a present (lists.txt, matches.f.txt)" << std::endl;
+					<< "One of the input required file is not a present (lists.txt, matches.f.bin or matches.f.txt)" << std::endl;
 				return false;
 			}
 
@@ -226,6 +264,7 @@ namespace mvg{
 				MVG_INFO << std::endl << "Track export to internal struct" << std::endl;
 				//-- Build tracks with STL compliant type :
 				tracks_builder.ExportToSTL(map_tracks_);
+				tracks_per_image_.Build(map_tracks_);
 
 				MVG_INFO << std::endl << "Track stats" << std::endl;
 				{
@@ -257,14 +296,14 @@ namespace mvg{
 			}
 
 			// Read features:
+			std::vector<std::string> feat_filenames(camera_image_names_.size());
 			for (size_t i = 0; i < camera_image_names_.size(); ++i)  {
-				const size_t camIndex = i;
-				if (!LoadFeatsFromFile(
-					mvg::utils::create_filespec(matches_path_, mvg::utils::basename_part(camera_image_names_[camIndex].image_name), ".feat"),
-					map_features_[camIndex])) {
-					std::cerr << "Bad reading of feature files" << std::endl;
-					return false;
-				}
+				feat_filenames[i] = mvg::utils::create_filespec(matches_path_,
+					mvg::utils::basename_part(camera_image_names_[i].image_name), ".feat");
+			}
+			if (!LoadFeatsFromFiles(feat_filenames, map_features_)) {
+				std::cerr << "Bad reading of feature files" << std::endl;
+				return false;
 			}
 
 			if (is_html_report_)
@@ -398,7 +437,9 @@ namespace mvg{
 			std::set<size_t> set_image_index;
 			set_image_index.insert(I);
 			set_image_index.insert(J);
-			TracksUtilsMap::GetTracksInImages(set_image_index, map_tracks_, map_tracksCommon);
+			std::vector<size_t> vec_common_track_ids;
+			tracks_per_image_.CommonTracks(I, J, vec_common_track_ids);
+			TracksUtilsMap::GetTracksInImages(vec_common_track_ids, set_image_index, map_tracks_, map_tracksCommon);
 
 			// b. Get corresponding features
 			std::vector<ScalePointFeature> & vec_featI = map_features_[I];
@@ -516,6 +557,7 @@ namespace mvg{
 						if (angle > 2.)  {
 							reconstructor_data_.map_3d_points[trackId] = vec_3dPoint[cptIndex];
 							reconstructor_data_.set_trackId.insert(trackId);
+							tracks_per_image_.SetTriangulated(trackId, map_tracks_[trackId]);
 							map_reconstructed_[trackId].insert(make_pair(I, vec_index[cptIndex]._i));
 							map_reconstructed_[trackId].insert(make_pair(J, vec_index[cptIndex]._j));
 						}
@@ -525,7 +567,10 @@ namespace mvg{
 					//Remove this track entry with ImageIndexes
 					map_tracks_[trackId].erase(I);
 					map_tracks_[trackId].erase(J);
+					tracks_per_image_.EraseObservation(trackId, I);
+					tracks_per_image_.EraseObservation(trackId, J);
 					if (map_tracks_[trackId].size() < 2)  {
+						tracks_per_image_.EraseTrack(trackId, map_tracks_[trackId]);
 						map_tracks_[trackId].clear();
 						map_tracks_.erase(trackId);
 					}
@@ -562,6 +607,14 @@ namespace mvg{
 
 				vec_added_order_.push_back(I);
 				vec_added_order_.push_back(J);
+
+				AddCameraToBundleAdjustment(I);
+				AddCameraToBundleAdjustment(J);
+				for (MapTracks::const_iterator iter = map_reconstructed_.begin();
+					iter != map_reconstructed_.end(); ++iter)
+				{
+					AddTrackToBundleAdjustment(iter->first);
+				}
 			}
 
 
@@ -663,26 +716,12 @@ namespace mvg{
 			{
 				const size_t imageIndex = *iter;
 
-				// Compute 2D - 3D possible content
-				mvg::tracking::MapTracks map_tracksCommon;
-				std::set<size_t> set_image_index;
-				set_image_index.insert(imageIndex);
-				TracksUtilsMap::GetTracksInImages(set_image_index, map_tracks_, map_tracksCommon);
-
-				if (!map_tracksCommon.empty())
+				// Count the common possible putative point
+				//  with the already 3D reconstructed trackId (2D - 3D possible content)
+				if (!tracks_per_image_.TracksInImage(imageIndex).empty())
 				{
-					std::set<size_t> set_tracksIds;
-					TracksUtilsMap::GetTracksIdVector(map_tracksCommon, &set_tracksIds);
-
-					// Count the common possible putative point
-					//  with the already 3D reconstructed trackId
-					std::vector<size_t> vec_trackIdForResection;
-					set_intersection(set_tracksIds.begin(), set_tracksIds.end(),
-						reconstructor_data_.set_trackId.begin(),
-						reconstructor_data_.set_trackId.end(),
-						std::back_inserter(vec_trackIdForResection));
-
-					vec_putative.push_back(make_pair(imageIndex, vec_trackIdForResection.size()));
+					vec_putative.push_back(make_pair(imageIndex,
+						tracks_per_image_.TriangulatedTracksInImage(imageIndex).size()));
 				}
 			}
 
@@ -713,20 +752,30 @@ namespace mvg{
 		/// Add to the current scene the desired image indexes.
 		bool IncrementalReconstructionEngine::Resection(std::vector<size_t> & vec_possible_indexes)
 		{
+			// 在当前的场景上同时计算所有候选图像的切除，计算过程中场景不变
+			std::vector<ResectionResult, Eigen::aligned_allocator<ResectionResult> > vec_results(vec_possible_indexes.size());
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+			for (int i = 0; i < static_cast<int>(vec_possible_indexes.size()); ++i)
+			{
+				ComputeResection(vec_possible_indexes[i], vec_results[i], false);
+			}
+
+			// 按照候选的顺序依次加入场景，后加入的图像可以使用先加入的图像三角化的轨迹
 			bool is_ok = false;
-			for (std::vector<size_t>::const_iterator iter = vec_possible_indexes.begin();
-				iter != vec_possible_indexes.end();
-				++iter)
+			for (size_t i = 0; i < vec_results.size(); ++i)
 			{
-				vec_added_order_.push_back(*iter);
-				bool bResect = Resection(*iter);
+				const size_t imageIndex = vec_possible_indexes[i];
+				vec_added_order_.push_back(imageIndex);
+				bool bResect = CommitResection(vec_results[i]);
 				is_ok |= bResect;
 				if (!bResect) {
 					// Resection was not possible (we remove the image from the remaining list)
 					std::cerr << std::endl
-						<< "Resection of image: " << *iter << " was not possible" << std::endl;
+						<< "Resection of image: " << imageIndex << " was not possible" << std::endl;
 				}
-				set_remaining_image_id_.erase(*iter);
+				set_remaining_image_id_.erase(imageIndex);
 			}
 			return is_ok;
 		}
@@ -734,29 +783,34 @@ namespace mvg{
 		/// Add a single Image to the scene and triangulate new possible tracks
 		bool IncrementalReconstructionEngine::Resection(size_t imageIndex)
 		{
-			MVG_INFO << std::endl
-				<< "-------------------------------" << std::endl
-				<< "-- Resection of camera index: " << imageIndex << std::endl
-				<< "-------------------------------" << std::endl;
+			ResectionResult result;
+			ComputeResection(imageIndex, result, true);
+			return CommitResection(result);
+		}
+
+		bool IncrementalReconstructionEngine::ComputeResection(size_t imageIndex, ResectionResult & result,
+			bool is_verbose) const
+		{
+			result.image_index = imageIndex;
+			result.is_resected = false;
+			result.error_max = std::numeric_limits<double>::max();
+			result.nb_correspondences = 0;
+			result.nb_inliers = 0;
+
+			// Compute 2D - 3D possible content:
+			//  3D reconstructed trackId that contain the Image Id of interest
+			const std::set<size_t> & set_trackIdForResection = tracks_per_image_.TriangulatedTracksInImage(imageIndex);
+			std::map< size_t, std::vector<ScalePointFeature> >::const_iterator iter_features = map_features_.find(imageIndex);
+			// Normally it must not crash even if it have 0 matches
+			if (set_trackIdForResection.empty() || iter_features == map_features_.end())
+				return false;
 
-			// Compute 2D - 3D possible content
 			mvg::tracking::MapTracks map_tracksCommon;
 			std::set<size_t> set_image_index;
 			set_image_index.insert(imageIndex);
-			TracksUtilsMap::GetTracksInImages(set_image_index, map_tracks_, map_tracksCommon);
-
-			std::set<size_t> set_tracksIds;
-			TracksUtilsMap::GetTracksIdVector(map_tracksCommon, &set_tracksIds);
-
-			// Intersect 3D reconstructed trackId with the one that contain the Image Id of interest
-			std::set<size_t> set_trackIdForResection;
-			set_intersection(set_tracksIds.begin(), set_tracksIds.end(),
-				reconstructor_data_.set_trackId.begin(),
-				reconstructor_data_.set_trackId.end(),
-				std::inserter(set_trackIdForResection, set_trackIdForResection.begin()));
-
-			// Load feature corresponding to imageIndex
-			const std::vector<ScalePointFeature> & vec_featsImageIndex = map_features_[imageIndex];
+			TracksUtilsMap::GetTracksInImages(
+				std::vector<size_t>(set_trackIdForResection.begin(), set_trackIdForResection.end()),
+				set_image_index, map_tracks_, map_tracksCommon);
 
 			// Get back featId and tracksID that will be used for the resection
 			std::vector<size_t> vec_featIdForResection;
@@ -765,23 +819,8 @@ namespace mvg{
 				imageIndex,
 				&vec_featIdForResection);
 
-			MVG_INFO << std::endl << std::endl
-				<< " Tracks in: " << imageIndex << std::endl
-				<< " \t" << map_tracksCommon.size() << std::endl
-				<< " #Reconstructed tracks:" << std::endl
-				<< " \t" << reconstructor_data_.set_trackId.size() << std::endl
-				<< " #Tracks Valid for resection:" << std::endl
-				<< " \t" << set_trackIdForResection.size() << std::endl;
-
-			// Normally it must not crash even if it have 0 matches
-			if (set_trackIdForResection.empty())
-			{
-				// Too few matches (even 0 before....) images with empty connection
-				set_remaining_image_id_.erase(imageIndex);
-				return false;
-			}
-
 			// Create point_2d, and point_3d array
+			const std::vector<ScalePointFeature> & vec_featsImageIndex = iter_features->second;
 			Mat point_2d(2, set_trackIdForResection.size());
 			Mat point_3d(3, set_trackIdForResection.size());
 
@@ -791,31 +830,64 @@ namespace mvg{
 				iterfeatId != vec_featIdForResection.end();
 				++iterfeatId, ++iterTrackId, ++cpt)
 			{
-				point_3d.col(cpt) = reconstructor_data_.map_3d_points[*iterTrackId];
+				point_3d.col(cpt) = reconstructor_data_.map_3d_points.find(*iterTrackId)->second;
 				point_2d.col(cpt) = vec_featsImageIndex[*iterfeatId].coords().cast<double>();
 			}
+			result.nb_correspondences = set_trackIdForResection.size();
 
 			//-------------
 			std::vector<size_t> vec_inliers;
 			Mat34 P;
-			double errorMax = std::numeric_limits<double>::max();
+			// 每张图像使用自己的随机数生成器，同时计算的切除互不影响
+			std::mt19937 generator(static_cast<std::mt19937::result_type>(imageIndex));
 
 			const mvg::feature::IntrinsicCameraInfo & intrinsicCam = vec_intrinsic_groups_[camera_image_names_[imageIndex].intrinsic_id];
 
-			bool bResection = robustResection(
+			result.is_resected = robustResection(
 				std::make_pair(intrinsicCam.width, intrinsicCam.height),
 				point_2d, point_3d,
 				&vec_inliers,
 				// If intrinsics guess exist use it, else use a standard 6 points pose resection
 				(intrinsicCam.is_known_intrinsic == true) ? &intrinsicCam.camera_matrix : NULL,
-				&P, &errorMax);
+				&P, &result.error_max, &generator, is_verbose);
+			result.nb_inliers = vec_inliers.size();
+			if (result.is_resected)
+				result.P = P;
+			return result.is_resected;
+		}
+
+		bool IncrementalReconstructionEngine::CommitResection(const ResectionResult & result)
+		{
+			const size_t imageIndex = result.image_index;
+
+			MVG_INFO << std::endl
+				<< "-------------------------------" << std::endl
+				<< "-- Resection of camera index: " << imageIndex << std::endl
+				<< "-------------------------------" << std::endl;
+
+			MVG_INFO << std::endl << std::endl
+				<< " Tracks in: " << imageIndex << std::endl
+				<< " \t" << tracks_per_image_.TracksInImage(imageIndex).size() << std::endl
+				<< " #Reconstructed tracks:" << std::endl
+				<< " \t" << reconstructor_data_.set_trackId.size() << std::endl
+				<< " #Tracks Valid for resection:" << std::endl
+				<< " \t" << result.nb_correspondences << std::endl;
+
+			if (result.nb_correspondences == 0)
+			{
+				// Too few matches (even 0 before....) images with empty connection
+				set_remaining_image_id_.erase(imageIndex);
+				return false;
+			}
+
+			const double errorMax = result.error_max;
 
 			MVG_INFO << std::endl
 				<< "-------------------------------" << std::endl
 				<< "-- Robust Resection of camera index: " << imageIndex << std::endl
-				<< "-- Resection status: " << bResection << std::endl
-				<< "-- #Points used for Resection: " << vec_featIdForResection.size() << std::endl
-				<< "-- #Points validated by robust Resection: " << vec_inliers.size() << std::endl
+				<< "-- Resection status: " << result.is_resected << std::endl
+				<< "-- #Points used for Resection: " << result.nb_correspondences << std::endl
+				<< "-- #Points validated by robust Resection: " << result.nb_inliers << std::endl
 				<< "-- Threshold: " << errorMax << std::endl
 				<< "-------------------------------" << std::endl;
 
@@ -832,19 +904,21 @@ namespace mvg{
 					<< "-- Robust Resection of camera index: <" << imageIndex << "> image: "
 					<< mvg::utils::basename_part(camera_image_names_[imageIndex].image_name) << "<br>"
 					<< "-- Threshold: " << errorMax << "<br>"
-					<< "-- Resection status: " << (bResection ? "OK" : "FAILED") << "<br>"
-					<< "-- Nb points used for Resection: " << vec_featIdForResection.size() << "<br>"
-					<< "-- Nb points validated by robust estimation: " << vec_inliers.size() << "<br>"
+					<< "-- Resection status: " << (result.is_resected ? "OK" : "FAILED") << "<br>"
+					<< "-- Nb points used for Resection: " << result.nb_correspondences << "<br>"
+					<< "-- Nb points validated by robust estimation: " << result.nb_inliers << "<br>"
 					<< "-- % points validated: "
-					<< vec_inliers.size() / static_cast<float>(vec_featIdForResection.size()) << "<br>"
+					<< result.nb_inliers / static_cast<float>(result.nb_correspondences) << "<br>"
 					<< "-------------------------------" << "<br>";
 				html_doc_stream_->pushInfo(os.str());
 			}
 
-			if (!bResection) {
+			if (!result.is_resected) {
 				return false;
 			}
 
+			const Mat34 & P = result.P;
+
 			//-- Add the camera to the _reconstruction data.
 			reconstructor_data_.set_imagedId.insert(imageIndex);
 			{
@@ -865,16 +939,41 @@ namespace mvg{
 					Vec6 & intrinsic = map_intrinsics_per_group_[map_intrinsic_id_per_image_id_[imageIndex]];
 					intrinsic << cam._f, cam._ppx, cam._ppy, cam._k1, cam._k2, cam._k3;
 				}
+				AddCameraToBundleAdjustment(imageIndex);
 			}
 			map_ac_threshold_.insert(std::make_pair(imageIndex, errorMax));
 			set_remaining_image_id_.erase(imageIndex);
 
+			// 当前已经三角化的轨迹，包括本轮先加入的图像新三角化的轨迹，都用切除的结果划分内点和外点
+			const std::set<size_t> set_trackIdForResection = tracks_per_image_.TriangulatedTracksInImage(imageIndex);
+			mvg::tracking::MapTracks map_tracksCommon;
+			std::set<size_t> set_image_index;
+			set_image_index.insert(imageIndex);
+			TracksUtilsMap::GetTracksInImages(
+				std::vector<size_t>(set_trackIdForResection.begin(), set_trackIdForResection.end()),
+				set_image_index, map_tracks_, map_tracksCommon);
+
+			std::vector<size_t> vec_featIdForResection;
+			TracksUtilsMap::GetFeatIndexPerViewAndTrackId(map_tracksCommon,
+				set_trackIdForResection,
+				imageIndex,
+				&vec_featIdForResection);
+
+			const std::vector<ScalePointFeature> & vec_featsImageIndex = map_features_[imageIndex];
+
 			// Evaluate residuals:
 			std::vector<double> vec_ResectionResidual;
-			for (size_t i = 0; i < point_3d.cols(); ++i)
+			vec_ResectionResidual.reserve(set_trackIdForResection.size());
 			{
-				double dResidual = PinholeCamera::Residual(P, point_3d.col(i), point_2d.col(i));
-				vec_ResectionResidual.push_back(dResidual);
+				std::set<size_t>::const_iterator iterTrackId = set_trackIdForResection.begin();
+				for (std::vector<size_t>::const_iterator iterfeatId = vec_featIdForResection.begin();
+					iterfeatId != vec_featIdForResection.end();
+					++iterfeatId, ++iterTrackId)
+				{
+					double dResidual = PinholeCamera::Residual(P, reconstructor_data_.map_3d_points[*iterTrackId],
+						vec_featsImageIndex[*iterfeatId].coords().cast<double>());
+					vec_ResectionResidual.push_back(dResidual);
+				}
 			}
 
 			if (is_html_report_)
@@ -891,8 +990,7 @@ namespace mvg{
 				jsxGraph.close();
 				html_doc_stream_->pushInfo(jsxGraph.toStr());
 
-				if (bResection)  {
-
+				{
 					Histogram<double> histo(0, 2 * errorMax, 10);
 					histo.Add(vec_ResectionResidual.begin(), vec_ResectionResidual.end());
 					std::vector<double> xBin = histo.GetXbinsValue();
@@ -911,7 +1009,7 @@ namespace mvg{
 
 			// Add new entry to reconstructed track and
 			//  remove outlier from the tracks
-			cpt = 0;
+			size_t cpt = 0;
 			std::vector<size_t>::iterator iterfeatId = vec_featIdForResection.begin();
 			for (std::set<size_t>::const_iterator iterTrackId = set_trackIdForResection.begin();
 				iterTrackId != set_trackIdForResection.end(); ++iterTrackId, ++cpt, ++iterfeatId)
@@ -919,10 +1017,13 @@ namespace mvg{
 				if (vec_ResectionResidual[cpt] < errorMax) {
 					// Inlier, add the point to the reconstructed track
 					map_reconstructed_[*iterTrackId].insert(make_pair(imageIndex, *iterfeatId));
+					ba_problem_->AddObservation(*iterTrackId, imageIndex,
+						vec_featsImageIndex[*iterfeatId].coords().cast<double>());
 				}
 				else {
 					// Outlier remove this entry from the tracks
 					map_tracks_[*iterTrackId].erase(imageIndex);
+					tracks_per_image_.EraseObservation(*iterTrackId, imageIndex);
 				}
 			}
 
@@ -942,24 +1043,14 @@ namespace mvg{
 		  size_t I = std::min(imageIndex, indexI);
 		  size_t J = std::max(imageIndex, indexI);
 
-		  // Compute possible content (match between indexI, indexJ)
+		  //-- Do we have new Track to add ? (common content between indexI, indexJ not yet reconstructed)
+		  std::vector<size_t> vec_tracksToAdd;
+		  if (!tracks_per_image_.CommonTracks(I, J, vec_tracksToAdd, true)) { continue; }
+
 		  map_tracksCommon.clear(); set_image_index.clear();
 		  set_image_index.insert(I); set_image_index.insert(J);
-		  TracksUtilsMap::GetTracksInImages(set_image_index, map_tracks_, map_tracksCommon);
-
-		  if (map_tracksCommon.empty()) { continue; } // no common content
+		  TracksUtilsMap::GetTracksInImages(vec_tracksToAdd, set_image_index, map_tracks_, map_tracksCommon);
 
-		  set_tracksIds.clear();
-		  TracksUtilsMap::GetTracksIdVector(map_tracksCommon, &set_tracksIds);
-
-		  //-- Compute if we have something to add to the scene ?
-		  std::vector<size_t> vec_tracksToAdd;
-		  //-- Do we have new Track to add ?
-		  set_difference(set_tracksIds.begin(), set_tracksIds.end(),
-			  reconstructor_data_.set_trackId.begin(), reconstructor_data_.set_trackId.end(),
-			  back_inserter(vec_tracksToAdd));
-
-		  if (!vec_tracksToAdd.empty())
 		  {
 			  const Mat34 & P1 = reconstructor_data_.map_Camera.find(I)->second.projection_matrix_;
 			  const Mat34 & P2 = reconstructor_data_.map_Camera.find(J)->second.projection_matrix_;
@@ -1021,8 +1112,10 @@ namespace mvg{
 						  if (angle > 2) {
 							  reconstructor_data_.map_3d_points[trackId] = vec_3dPoint[i];
 							  reconstructor_data_.set_trackId.insert(trackId);
+							  tracks_per_image_.SetTriangulated(trackId, map_tracks_[trackId]);
 							  map_reconstructed_[trackId].insert(make_pair(I, vec_index[i]._i));
 							  map_reconstructed_[trackId].insert(make_pair(J, vec_index[i]._j));
+							  AddTrackToBundleAdjustment(trackId);
 						  }
 					  }
 				  }
@@ -1121,6 +1214,7 @@ namespace mvg{
 				for (std::set<size_t>::const_iterator iterTT = setI.begin();
 					iterTT != setI.end(); ++iterTT, ++rejectedMeasurement) {
 					map_reconstructed_[trackId].erase(*iterTT);
+					ba_problem_->RemoveObservation(trackId, *iterTT);
 				}
 
 				// If remaining tracks is too small, remove it
@@ -1128,7 +1222,9 @@ namespace mvg{
 					map_reconstructed_[trackId].clear();
 					map_reconstructed_.erase(trackId);
 					reconstructor_data_.set_trackId.erase(trackId);
+					tracks_per_image_.SetTriangulated(trackId, map_tracks_[trackId], false);
 					reconstructor_data_.map_3d_points.erase(trackId);
+					ba_problem_->RemovePoint(trackId);
 					++rejectedTrack;
 				}
 			}
@@ -1240,209 +1336,77 @@ namespace mvg{
 			}
 		}
 
-		void IncrementalReconstructionEngine::BundleAdjustment()
+		void IncrementalReconstructionEngine::LocalBundleAdjustmentCameras(const std::vector<size_t> & vec_new_images,
+			std::set<size_t> & set_local_cameras) const
 		{
-			MVG_INFO << "--      BUNDLE ADJUSTMENT      --" << std::endl;
-
-			//-- All the data that I must fill:
-			using namespace std;
-
-			const size_t nbCams = reconstructor_data_.map_Camera.size();
-			const size_t nbIntrinsics = map_images_id_per_intrinsic_group_.size();
-			const size_t nbPoints3D = reconstructor_data_.map_3d_points.size();
+			set_local_cameras.clear();
 
-			// Count the number of measurement (sum of the reconstructed track length)
-			size_t nbmeasurements = 0;
-			for (std::map<size_t, Vec3>::const_iterator iter = reconstructor_data_.map_3d_points.begin();
-				iter != reconstructor_data_.map_3d_points.end();
-				++iter)
+			// 统计其他相机与新加入的相机共同看到的三维点个数
+			std::map<size_t, size_t> map_covisible_count;
+			for (std::vector<size_t>::const_iterator iter = vec_new_images.begin();
+				iter != vec_new_images.end(); ++iter)
 			{
-				const size_t trackId = iter->first;
-				// Look through the track and add point position
-				const tracking::SubmapTrack & track = map_reconstructed_[trackId];
-				nbmeasurements += track.size();
-			}
-
-			MVG_INFO << "#Cams: " << nbCams << std::endl
-				<< "#Intrinsics: " << nbIntrinsics << std::endl
-				<< "#Points3D: " << nbPoints3D << std::endl
-				<< "#measurements: " << nbmeasurements << std::endl;
-
-			// Setup a BA problem
-			using namespace mvg::sfm;
-			BA_Problem_data_camMotionAndIntrinsic<6, 6> ba_problem;
-			// Will refine extrinsics[R,t] per camera and grouped intrinsics [focal,ppx,ppy,k1,k2,k3].
-
-			// Configure the size of the problem
-			ba_problem.num_cameras_ = nbCams;
-			ba_problem.num_intrinsic_ = nbIntrinsics;
-			ba_problem.num_points_ = nbPoints3D;
-			ba_problem.num_observations_ = nbmeasurements;
-
-			ba_problem.point_index_.reserve(ba_problem.num_observations_);
-			ba_problem.camera_index_extrinsic.reserve(ba_problem.num_observations_);
-			ba_problem.camera_index_intrinsic.reserve(ba_problem.num_observations_);
-			ba_problem.observations_.reserve(2 * ba_problem.num_observations_);
-
-			ba_problem.num_parameters_ =
-				6 * ba_problem.num_cameras_ // #[Rotation|translation]
-				+ 6 * ba_problem.num_intrinsic_ // #[f,ppx,ppy,k1,k2,k3]
-				+ 3 * ba_problem.num_points_; // #[X]
-			ba_problem.parameters_.reserve(ba_problem.num_parameters_);
-
-			// Setup extrinsic parameters
-			std::set<size_t> set_camIndex;
-			std::map<size_t, size_t> map_camIndexToNumber_extrinsic, map_camIndexToNumber_intrinsic;
-			size_t cpt = 0;
-			for (ReconstructorHelper::Map_BrownPinholeCamera::const_iterator iter = reconstructor_data_.map_Camera.begin();
-				iter != reconstructor_data_.map_Camera.end();  ++iter, ++cpt)
-			{
-				// in order to map camera index to contiguous number
-				set_camIndex.insert(iter->first);
-				map_camIndexToNumber_extrinsic.insert(std::make_pair(iter->first, cpt));
-
-				Mat3 R = iter->second.rotation_matrix_;
-				double angleAxis[3];
-				ceres::RotationMatrixToAngleAxis((const double*)R.data(), angleAxis);
-				// translation
-				Vec3 t = iter->second.translation_vector_;
-				ba_problem.parameters_.push_back(angleAxis[0]);
-				ba_problem.parameters_.push_back(angleAxis[1]);
-				ba_problem.parameters_.push_back(angleAxis[2]);
-				ba_problem.parameters_.push_back(t[0]);
-				ba_problem.parameters_.push_back(t[1]);
-				ba_problem.parameters_.push_back(t[2]);
-			}
-
-			// Setup intrinsic parameters groups
-			cpt = 0;
-			for (std::map<size_t, Vec6 >::const_iterator iterIntrinsicGroup = map_intrinsics_per_group_.begin();
-				iterIntrinsicGroup != map_intrinsics_per_group_.end();
-				++iterIntrinsicGroup, ++cpt)
-			{
-				const Vec6 & intrinsic = iterIntrinsicGroup->second;
-				ba_problem.parameters_.push_back(intrinsic(0)); // FOCAL_LENGTH
-				ba_problem.parameters_.push_back(intrinsic(1)); // PRINCIPAL_POINT_X
-				ba_problem.parameters_.push_back(intrinsic(2)); // PRINCIPAL_POINT_Y
-				ba_problem.parameters_.push_back(intrinsic(3)); // K1
-				ba_problem.parameters_.push_back(intrinsic(4)); // K2
-				ba_problem.parameters_.push_back(intrinsic(5)); // K3
+				if (reconstructor_data_.map_Camera.find(*iter) != reconstructor_data_.map_Camera.end())
+					set_local_cameras.insert(*iter);
 			}
-
-			cpt = 0;
-			// Link each camera to it's intrinsic group
-			for (std::map<size_t, std::vector<size_t> >::const_iterator iterIntrinsicGroup = map_images_id_per_intrinsic_group_.begin();
-				iterIntrinsicGroup != map_images_id_per_intrinsic_group_.end(); ++iterIntrinsicGroup, ++cpt)
+			for (std::set<size_t>::const_iterator iter = set_local_cameras.begin();
+				iter != set_local_cameras.end(); ++iter)
 			{
-				const std::vector<size_t> vec_imagesId = iterIntrinsicGroup->second;
-				for (std::vector<size_t>::const_iterator iter_vec = vec_imagesId.begin();
-					iter_vec != vec_imagesId.end(); ++iter_vec)
+				const std::set<size_t> & set_trackIds = tracks_per_image_.TriangulatedTracksInImage(*iter);
+				for (std::set<size_t>::const_iterator iterT = set_trackIds.begin();
+					iterT != set_trackIds.end(); ++iterT)
 				{
-					const size_t camIndex = *iter_vec;
-					map_camIndexToNumber_intrinsic.insert(std::make_pair(camIndex, cpt));
-				}
-			}
-
-			// Setup 3D points
-			for (std::map<size_t, Vec3>::const_iterator iter = reconstructor_data_.map_3d_points.begin();
-				iter != reconstructor_data_.map_3d_points.end();
-				++iter)
-			{
-				const Vec3 & point_3d = iter->second;
-				ba_problem.parameters_.push_back(point_3d[0]);
-				ba_problem.parameters_.push_back(point_3d[1]);
-				ba_problem.parameters_.push_back(point_3d[2]);
-			}
-
-			// fill measurements
-			cpt = 0;
-			for (std::map<size_t, Vec3>::const_iterator iter = reconstructor_data_.map_3d_points.begin();
-				iter != reconstructor_data_.map_3d_points.end();
-				++iter)
-			{
-				const size_t trackId = iter->first;
-				// Look through the track and add point position
-				const tracking::SubmapTrack & track = map_reconstructed_[trackId];
-
-				for (tracking::SubmapTrack::const_iterator iterTrack = track.begin();
-					iterTrack != track.end();
-					++iterTrack)
-				{
-					const size_t imageId = iterTrack->first;
-					const size_t featId = iterTrack->second;
-
-					// If imageId reconstructed:
-					//  - Add measurements (the feature position)
-					//  - Add camidx (map the image number to the camera index)
-					//  - Add ptidx (the 3D corresponding point index) (must be increasing)
-
-					if (set_camIndex.find(imageId) != set_camIndex.end())
+					MapTracks::const_iterator iterReconstructed = map_reconstructed_.find(*iterT);
+					if (iterReconstructed == map_reconstructed_.end())
+						continue;
+					const tracking::SubmapTrack & track = iterReconstructed->second;
+					for (tracking::SubmapTrack::const_iterator iterTrack = track.begin();
+						iterTrack != track.end(); ++iterTrack)
 					{
-						const std::vector<ScalePointFeature> & vec_feats = map_features_[imageId];
-						const ScalePointFeature & ptFeat = vec_feats[featId];
-
-						ba_problem.observations_.push_back(ptFeat.x());
-						ba_problem.observations_.push_back(ptFeat.y());
-
-						ba_problem.point_index_.push_back(cpt);
-						ba_problem.camera_index_extrinsic.push_back(map_camIndexToNumber_extrinsic[imageId]);
-						ba_problem.camera_index_intrinsic.push_back(map_camIndexToNumber_intrinsic[imageId]);
+						if (set_local_cameras.find(iterTrack->first) == set_local_cameras.end())
+							++map_covisible_count[iterTrack->first];
 					}
 				}
-				++cpt;
 			}
 
-			// Parameterization used to restrict camera intrinsics (Brown model or Pinhole Model).
-			ceres::SubsetParameterization *constant_transform_parameterization = NULL;
-			if (!is_refine_point_and_distortion_) {
-				std::vector<int> vec_constant_PPAndRadialDisto;
+			// 共同的三维点最多的相机加入窗口，个数相同时按图像索引排序保证结果确定
+			std::vector< std::pair<size_t, size_t> > vec_covisible(map_covisible_count.begin(), map_covisible_count.end());
+			std::stable_sort(vec_covisible.begin(), vec_covisible.end(),
+				sort_pair_second<size_t, size_t, std::greater<size_t> >());
+			for (size_t i = 0; i < vec_covisible.size() && i < local_ba_neighbour_count_; ++i)
+				set_local_cameras.insert(vec_covisible[i].first);
+		}
 
-				// Last five elements are ppx,ppy and radial disto factors.
-				vec_constant_PPAndRadialDisto.push_back(1); // PRINCIPAL_POINT_X FIXED
-				vec_constant_PPAndRadialDisto.push_back(2); // PRINCIPAL_POINT_Y FIXED
-				vec_constant_PPAndRadialDisto.push_back(3); // K1 FIXED
-				vec_constant_PPAndRadialDisto.push_back(4); // K2 FIXED
-				vec_constant_PPAndRadialDisto.push_back(5); // K3 FIXED
+		void IncrementalReconstructionEngine::AddCameraToBundleAdjustment(size_t imageId)
+		{
+			const BrownPinholeCamera & cam = reconstructor_data_.map_Camera.find(imageId)->second;
+			const size_t intrinsicId = map_intrinsic_id_per_image_id_[imageId];
+			ba_problem_->SetCamera(imageId, intrinsicId, cam.rotation_matrix_, cam.translation_vector_);
+			if (!ba_problem_->HasIntrinsic(intrinsicId))
+				ba_problem_->SetIntrinsic(intrinsicId, map_intrinsics_per_group_[intrinsicId]);
+		}
 
-				constant_transform_parameterization =
-					new ceres::SubsetParameterization(6, vec_constant_PPAndRadialDisto);
+		void IncrementalReconstructionEngine::AddTrackToBundleAdjustment(size_t trackId)
+		{
+			ba_problem_->SetPoint(trackId, reconstructor_data_.map_3d_points[trackId]);
+			const tracking::SubmapTrack & track = map_reconstructed_[trackId];
+			for (tracking::SubmapTrack::const_iterator iterTrack = track.begin();
+				iterTrack != track.end(); ++iterTrack)
+			{
+				const ScalePointFeature & ptFeat = map_features_[iterTrack->first][iterTrack->second];
+				ba_problem_->AddObservation(trackId, iterTrack->first, ptFeat.coords().cast<double>());
 			}
+		}
 
-			// Create residuals for each observation in the bundle adjustment problem. The
-			// parameters for cameras and points are added automatically.
-			ceres::Problem problem;
-			// Set a LossFunction to be less penalized by false measurements
-			//  - set it to NULL if you don't want use a lossFunction.
-			ceres::LossFunction * p_LossFunction = new ceres::HuberLoss(4.0);
-			for (size_t i = 0; i < ba_problem.num_observations(); ++i) {
-				// Each Residual block takes a point and a camera as input and outputs a 2
-				// dimensional residual. Internally, the cost function stores the observed
-				// image location and compares the reprojection against the observation.
-				ceres::CostFunction* cost_function =
-					new ceres::AutoDiffCostFunction<ErrorFunc_Refine_Camera_3DPoints, 2, 6, 6, 3>(
-					new ErrorFunc_Refine_Camera_3DPoints(
-					&ba_problem.observations()[2 * i + 0]));
-
-				problem.AddResidualBlock(cost_function,
-					p_LossFunction, // replaced by NULL if you don't want a LossFunction
-					ba_problem.mutable_camera_intrisic_for_observation(i),
-					ba_problem.mutable_camera_extrinsic_for_observation(i),
-					ba_problem.mutable_point_for_observation(i));
-
-				if (!is_refine_point_and_distortion_) {
-					problem.SetParameterization(ba_problem.mutable_camera_intrisic_for_observation(i),
-						constant_transform_parameterization);
-				}
-			}
+		void IncrementalReconstructionEngine::BundleAdjustment(const std::set<size_t> * set_local_cameras)
+		{
+			const bool is_local = set_local_cameras != NULL;
+			MVG_INFO << (is_local ? "--   LOCAL BUNDLE ADJUSTMENT   --" : "--      BUNDLE ADJUSTMENT      --") << std::endl;
 
-			//-- Lock the first camera to better deal with scene orientation ambiguity
-			if (vec_added_order_.size() > 0 && map_camIndexToNumber_extrinsic.size() > 0)
-			{
-				// First camera is the first one that have been used
-				problem.SetParameterBlockConstant(
-					ba_problem.mutable_camera_extrinsic_for_observation(
-					map_camIndexToNumber_extrinsic[vec_added_order_[0]]));
-			}
+			MVG_INFO << "#Cams: " << reconstructor_data_.map_Camera.size() << std::endl
+				<< "#Intrinsics: " << map_images_id_per_intrinsic_group_.size() << std::endl
+				<< "#Points3D: " << reconstructor_data_.map_3d_points.size() << std::endl
+				<< "#measurements: " << ba_problem_->NbObservations() << std::endl;
 
 			// Configure a BA engine and run it
 			//  Make Ceres automatically detect the bundle structure.
@@ -1468,28 +1432,31 @@ namespace mvg{
 #endif // USE_OPENMP
 
 			// Solve BA
+			//  The persistent problem only creates the residuals of the new observations,
+			//  and the first camera that have been used is locked in a global BA.
 			ceres::Solver::Summary summary;
-			ceres::Solve(options, &problem, &summary);
+			const bool is_usable = ba_problem_->Solve(options,
+				vec_added_order_.empty() ? 0 : vec_added_order_[0],
+				set_local_cameras, &summary);
 			MVG_INFO << summary.FullReport() << std::endl;
+			MVG_INFO << "Bundle Adjustment time (s): setup " << ba_problem_->setupSeconds()
+				<< ", solve " << ba_problem_->solveSeconds() << std::endl;
 
 			// If no error, get back refined parameters
-			if (summary.IsSolutionUsable())
+			if (is_usable)
 			{
 				// Display statistics about the minimization
 				MVG_INFO << std::endl
 					<< "Bundle Adjustment statistics:\n"
-					<< " Initial RMSE: " << std::sqrt(summary.initial_cost / (ba_problem.num_observations_*2.)) << "\n"
-					<< " Final RMSE: " << std::sqrt(summary.final_cost / (ba_problem.num_observations_*2.)) << "\n"
+					<< " Initial RMSE: " << std::sqrt(summary.initial_cost / summary.num_residuals_reduced) << "\n"
+					<< " Final RMSE: " << std::sqrt(summary.final_cost / summary.num_residuals_reduced) << "\n"
 					<< std::endl;
 
 				// Get back 3D points
-				cpt = 0;
 				for (std::map<size_t, Vec3>::iterator iter = reconstructor_data_.map_3d_points.begin();
-					iter != reconstructor_data_.map_3d_points.end(); ++iter, ++cpt)
+					iter != reconstructor_data_.map_3d_points.end(); ++iter)
 				{
-					const double * pt = ba_problem.mutable_points() + cpt * 3;
-					Vec3 & point_3d = iter->second;
-					point_3d = Vec3(pt[0], pt[1], pt[2]);
+					iter->second = ba_problem_->GetPoint(iter->first);
 				}
 
 				// Get back camera external and intrinsic parameters
@@ -1497,17 +1464,14 @@ namespace mvg{
 					iter != reconstructor_data_.map_Camera.end(); ++iter)
 				{
 					const size_t imageId = iter->first;
-					const size_t extrinsicId = map_camIndexToNumber_extrinsic[imageId];
-					// Get back extrinsic pointer
-					const double * camE = ba_problem.mutable_cameras_extrinsic() + extrinsicId * 6;
+					if (is_local && set_local_cameras->find(imageId) == set_local_cameras->end())
+						continue;
 					Mat3 R;
-					// angle axis to rotation matrix
-					ceres::AngleAxisToRotationMatrix(camE, R.data());
-					Vec3 t(camE[3], camE[4], camE[5]);
+					Vec3 t;
+					ba_problem_->GetCamera(imageId, R, t);
 
 					// Get back the intrinsic group of the camera
-					const size_t intrinsicId = map_camIndexToNumber_intrinsic[imageId];
-					const double * camIntrinsics = ba_problem.mutable_cameras_intrinsic() + intrinsicId * 6;
+					const Vec6 camIntrinsics = ba_problem_->GetIntrinsic(ba_problem_->GetIntrinsicGroup(imageId));
 					// Update the camera with update intrinsic and extrinsic parameters
 					BrownPinholeCamera & sCam = iter->second;
 					sCam = BrownPinholeCamera(
@@ -1521,28 +1485,22 @@ namespace mvg{
 						camIntrinsics[OFFSET_K3]);
 				}
 
-				//-- Update each intrinsic parameters group
-				cpt = 0;
+				//-- Update each intrinsic parameters group (constant in local BA)
+				size_t cpt = 0;
 				for (std::map<size_t, Vec6 >::iterator iterIntrinsicGroup = map_intrinsics_per_group_.begin();
-					iterIntrinsicGroup != map_intrinsics_per_group_.end();
+					!is_local && iterIntrinsicGroup != map_intrinsics_per_group_.end();
 					++iterIntrinsicGroup, ++cpt)
 				{
-					const double * camIntrinsics = ba_problem.mutable_cameras_intrinsic() + cpt * 6;
 					Vec6 & intrinsic = iterIntrinsicGroup->second;
-					intrinsic << camIntrinsics[OFFSET_FOCAL_LENGTH],
-						camIntrinsics[OFFSET_PRINCIPAL_POINT_X],
-						camIntrinsics[OFFSET_PRINCIPAL_POINT_Y],
-						camIntrinsics[OFFSET_K1],
-						camIntrinsics[OFFSET_K2],
-						camIntrinsics[OFFSET_K3];
+					intrinsic = ba_problem_->GetIntrinsic(iterIntrinsicGroup->first);
 
 					MVG_INFO << " for camera Idx=[" << cpt << "]: " << std::endl
-						<< "\t focal: " << camIntrinsics[OFFSET_FOCAL_LENGTH] << std::endl
-						<< "\t ppx: " << camIntrinsics[OFFSET_PRINCIPAL_POINT_X] << std::endl
-						<< "\t ppy: " << camIntrinsics[OFFSET_PRINCIPAL_POINT_Y] << std::endl
-						<< "\t k1: " << camIntrinsics[OFFSET_K1] << std::endl
-						<< "\t k2: " << camIntrinsics[OFFSET_K2] << std::endl
-						<< "\t k3: " << camIntrinsics[OFFSET_K3] << std::endl;
+						<< "\t focal: " << intrinsic[OFFSET_FOCAL_LENGTH] << std::endl
+						<< "\t ppx: " << intrinsic[OFFSET_PRINCIPAL_POINT_X] << std::endl
+						<< "\t ppy: " << intrinsic[OFFSET_PRINCIPAL_POINT_Y] << std::endl
+						<< "\t k1: " << intrinsic[OFFSET_K1] << std::endl
+						<< "\t k2: " << intrinsic[OFFSET_K2] << std::endl
+						<< "\t k3: " << intrinsic[OFFSET_K3] << std::endl;
 				}
 			}
 		}
@@ -28,139 +28,170 @@
 #include <algorithm>
 #include <iostream>
 #include <functional>
+#include <limits>
 #include <vector>
 #include <set>
 #include <map>
 #include <memory>
 
-#include "lemon/list_graph.h"
-#include "lemon/unionfind.h"
-using namespace lemon;
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 #include "mvg/feature/indexed_match.h"
+#include "mvg/utils/mvg_stdint.h"
 
 namespace mvg  {
 	namespace tracking{
 		using namespace mvg::feature;
 
+		//  结构用来存储跟踪，为对应{ImageId,FeatureId}的集合
+		typedef std::map<size_t, size_t> SubmapTrack;
+		// 表示跟踪的集合{TrackId, SubmapTrack}
+		typedef std::map< size_t, SubmapTrack > MapTracks;
+
 		/**
-		 * \brief	构建一个轻量级的map，通过vector<std::pari<T1,T2> >进行构建
-		 * 			方便进行插入运算
-		 *
-		 * \tparam	T1	Generic type parameter.
-		 * \tparam	T2	Generic type parameter.
+		 * \brief	以CSR格式存储的tracks，第t个track的观测为[track_offsets[t], track_offsets[t + 1])，
+		 *			每个track内的观测按(图像索引, 特征索引)升序排列
 		 */
-		template<typename T1, typename T2>
-		class flat_pair_map
+		struct FlatTracks
 		{
-			typedef std::pair<T1, T2> P;
-		public:
-			typedef typename std::vector< P >::iterator iterator;
+			std::vector<uint32_t> track_offsets;        //!< 每个track第一个观测的位置，共NbTracks() + 1项
+			std::vector<uint32_t> observation_images;   //!< 每个观测的图像索引
+			std::vector<uint32_t> observation_features; //!< 每个观测的特征索引
 
-			typename std::vector< P >::iterator find(const T1 & val)  {
-				return std::lower_bound(m_vec.begin(), m_vec.end(), val, SuperiorToFirst);
-			}
+			size_t size() const { return track_offsets.empty() ? 0 : track_offsets.size() - 1; }
+			size_t trackLength(size_t track_id) const { return track_offsets[track_id + 1] - track_offsets[track_id]; }
 
-			T2 & operator[](const T1 & val) {
-				return std::lower_bound(m_vec.begin(), m_vec.end(), val, SuperiorToFirst)->second;
+			void clear()
+			{
+				track_offsets.assign(1, 0);
+				observation_images.clear();
+				observation_features.clear();
 			}
-
-			void sort()  { std::sort(m_vec.begin(), m_vec.end(), SortPairAscend); }
-			void push_back(const P & val)  { m_vec.push_back(val); }
-			void clear()  { m_vec.clear(); }
-			void reserve(size_t count)  { m_vec.reserve(count); }
-
-		private:
-			std::vector< P > m_vec;
-
-			static bool SortPairAscend(const P &a, const P &b) { return a.first < b.first; }
-			static bool SuperiorToFirst(const P &a, const T1 &b) { return a.first < b; }
 		};
 
-		//  结构用来存储跟踪，为对应{ImageId,FeatureId}的集合
-		typedef std::map<size_t, size_t> SubmapTrack;
-		// 表示跟踪的集合{TrackId, SubmapTrack}
-		typedef std::map< size_t, SubmapTrack > MapTracks;
 		/**	构建tracks
+		 *  每幅图像的特征按图像索引依次排列，(I, f)的观测编号为图像I的偏移加f，
+		 *  所有观测在uint32_t的数组上进行并查集合并(路径减半)，每个集合的根为编号最小的观测，
+		 *  结果按根的编号排序保存为CSR格式，内存与观测个数成线性关系
 		 */
 		struct TracksBuilder
 		{
 			typedef std::pair<size_t, size_t> IndexedFeaturePair;//!< 匹配的特征对
-			typedef lemon::ListDigraph::NodeMap<size_t> IndexMap;
-			typedef lemon::UnionFindEnum< IndexMap > UnionFindObject;
-
-			typedef flat_pair_map< lemon::ListDigraph::Node, IndexedFeaturePair> MapNodeIndex;
-			typedef flat_pair_map< IndexedFeaturePair, lemon::ListDigraph::Node > MapIndexNode;
-
-			lemon::ListDigraph g; //!<图节点容器，存放图节点
-			MapNodeIndex reverse_my_Map; //Node to index map
-			std::shared_ptr<IndexMap> index;
-			std::shared_ptr<UnionFindObject> myTracksUF;
-
-			const UnionFindObject & getUnionFindEnum() const { return *myTracksUF; }
-			const MapNodeIndex & getReverseMap() const { return reverse_my_Map; }
 
 			/// Build tracks for a given series of pairWise matches
 			bool Build(const PairWiseMatches &  map_pair_wise_matches)
 			{
-				typedef std::set<IndexedFeaturePair> SetIndexedPair;
-				SetIndexedPair myset;
+				tracks_.clear();
+				image_offsets_.assign(1, 0);
+
+				// 每幅图像用到的最大特征索引决定观测编号的偏移
+				size_t image_count = 0;
+				std::vector<PairWiseMatches::const_iterator> vec_pairs;
+				vec_pairs.reserve(map_pair_wise_matches.size());
 				for (PairWiseMatches::const_iterator iter = map_pair_wise_matches.begin();
-					iter != map_pair_wise_matches.end();
-					++iter)
+					iter != map_pair_wise_matches.end(); ++iter)
 				{
-					const size_t & I = iter->first.first;
-					const size_t & J = iter->first.second;
-					const std::vector<IndexedMatch> & vec_filtered_matches = iter->second;
-					// We have correspondences between I and J image index.
-
-					for (size_t k = 0; k < vec_filtered_matches.size(); ++k)
+					image_count = (std::max)(image_count, (std::max)(iter->first.first, iter->first.second) + 1);
+					vec_pairs.push_back(iter);
+				}
+#ifdef USE_OPENMP
+				const int thread_count = omp_get_max_threads();
+#else
+				const int thread_count = 1;
+#endif
+				std::vector<std::vector<size_t> > vec_thread_feature_counts(thread_count, std::vector<size_t>(image_count, 0));
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+				for (int k = 0; k < (int)vec_pairs.size(); ++k)
+				{
+#ifdef USE_OPENMP
+					std::vector<size_t> & feature_counts = vec_thread_feature_counts[omp_get_thread_num()];
+#else
+					std::vector<size_t> & feature_counts = vec_thread_feature_counts[0];
+#endif
+					const size_t I = vec_pairs[k]->first.first;
+					const size_t J = vec_pairs[k]->first.second;
+					const std::vector<IndexedMatch> & vec_filtered_matches = vec_pairs[k]->second;
+					for (size_t m = 0; m < vec_filtered_matches.size(); ++m)
 					{
-						// Look if one of the feature already belong to a track :
-						myset.insert(std::make_pair(I, vec_filtered_matches[k]._i));
-						myset.insert(std::make_pair(J, vec_filtered_matches[k]._j));
+						feature_counts[I] = (std::max)(feature_counts[I], size_t(vec_filtered_matches[m]._i) + 1);
+						feature_counts[J] = (std::max)(feature_counts[J], size_t(vec_filtered_matches[m]._j) + 1);
 					}
 				}
-
-				// Build the node indirection for each referenced feature
-				MapIndexNode my_Map;
-				my_Map.reserve(myset.size());
-				reverse_my_Map.reserve(myset.size());
-				for (SetIndexedPair::const_iterator iter = myset.begin();
-					iter != myset.end();
-					++iter)
+				image_offsets_.assign(image_count + 1, 0);
+				for (size_t i = 0; i < image_count; ++i)
 				{
-					lemon::ListDigraph::Node node = g.addNode();
-					my_Map.push_back(std::make_pair(*iter, node));
-					reverse_my_Map.push_back(std::make_pair(node, *iter));
+					size_t feature_count = 0;
+					for (int t = 0; t < thread_count; ++t)
+						feature_count = (std::max)(feature_count, vec_thread_feature_counts[t][i]);
+					image_offsets_[i + 1] = image_offsets_[i] + feature_count;
 				}
-
-				// Sort the flat_pair_map
-				my_Map.sort();
-				reverse_my_Map.sort();
-
-				// Add the element of myset to the UnionFind insert method.
-				index = std::shared_ptr<IndexMap>(new IndexMap(g));
-				myTracksUF = std::shared_ptr<UnionFindObject>(new UnionFindObject(*index));
-				for (lemon::ListDigraph::NodeIt it(g); it != INVALID; ++it) {
-					myTracksUF->insert(it);
+				std::vector<std::vector<size_t> >().swap(vec_thread_feature_counts);
+				const size_t observation_count = image_offsets_.back();
+				if (observation_count >= std::numeric_limits<uint32_t>::max())
+				{
+					std::cerr << "Too many observations for the track builder: " << observation_count << std::endl;
+					image_offsets_.assign(1, 0);
+					return false;
 				}
 
 				// Make the union according the pair matches
-				for (PairWiseMatches::const_iterator iter = map_pair_wise_matches.begin();
-					iter != map_pair_wise_matches.end();
-					++iter)
+				std::vector<uint32_t> vec_parent(observation_count);
+				for (size_t x = 0; x < observation_count; ++x)
+					vec_parent[x] = static_cast<uint32_t>(x);
+				std::vector<unsigned char> vec_is_used(observation_count, 0);
+				for (size_t k = 0; k < vec_pairs.size(); ++k)
 				{
-					const size_t & I = iter->first.first;
-					const size_t & J = iter->first.second;
-					const std::vector<IndexedMatch> & vec_filtered_matches = iter->second;
-					// We have correspondences between I and J image index.
+					const size_t offset_I = image_offsets_[vec_pairs[k]->first.first];
+					const size_t offset_J = image_offsets_[vec_pairs[k]->first.second];
+					const std::vector<IndexedMatch> & vec_filtered_matches = vec_pairs[k]->second;
+					for (size_t m = 0; m < vec_filtered_matches.size(); ++m)
+					{
+						const uint32_t a = static_cast<uint32_t>(offset_I + vec_filtered_matches[m]._i);
+						const uint32_t b = static_cast<uint32_t>(offset_J + vec_filtered_matches[m]._j);
+						vec_is_used[a] = vec_is_used[b] = 1;
+						Union(vec_parent, a, b);
+					}
+				}
 
-					for (size_t k = 0; k < vec_filtered_matches.size(); ++k)
+				// 根总是集合中编号最小的观测，parent[x] <= x，按编号升序一遍即可全部指向根，
+				// 同时将根替换为track的编号
+				std::vector<uint32_t> vec_track_lengths;
+				for (size_t x = 0; x < observation_count; ++x)
+				{
+					if (!vec_is_used[x])
+						continue;
+					const uint32_t root = vec_parent[x];
+					if (root == x) {
+						vec_parent[x] = static_cast<uint32_t>(vec_track_lengths.size());
+						vec_track_lengths.push_back(0);
+					}
+					else {
+						vec_parent[x] = vec_parent[root];
+					}
+					++vec_track_lengths[vec_parent[x]];
+				}
+
+				// 导出CSR格式，按编号升序填入，每个track内的观测自然按(图像, 特征)排序
+				tracks_.track_offsets.resize(vec_track_lengths.size() + 1);
+				tracks_.track_offsets[0] = 0;
+				for (size_t t = 0; t < vec_track_lengths.size(); ++t)
+					tracks_.track_offsets[t + 1] = tracks_.track_offsets[t] + vec_track_lengths[t];
+				tracks_.observation_images.resize(tracks_.track_offsets.back());
+				tracks_.observation_features.resize(tracks_.track_offsets.back());
+				std::vector<uint32_t> vec_cursor(tracks_.track_offsets.begin(), tracks_.track_offsets.end() - 1);
+				for (size_t i = 0; i < image_count; ++i)
+				{
+					for (size_t x = image_offsets_[i]; x < image_offsets_[i + 1]; ++x)
 					{
-						IndexedFeaturePair pairI = std::make_pair(I, vec_filtered_matches[k]._i);
-						IndexedFeaturePair pairJ = std::make_pair(J, vec_filtered_matches[k]._j);
-						myTracksUF->join(my_Map[pairI], my_Map[pairJ]);
+						if (!vec_is_used[x])
+							continue;
+						const uint32_t position = vec_cursor[vec_parent[x]]++;
+						tracks_.observation_images[position] = static_cast<uint32_t>(i);
+						tracks_.observation_features[position] = static_cast<uint32_t>(x - image_offsets_[i]);
 					}
 				}
 				return false;
@@ -169,119 +200,163 @@ namespace mvg  {
 			/// Remove bad tracks, conflict tracks (many times the same image index in a track)
 			bool Filter(size_t nLengthSupTo = 2)
 			{
-				// Remove bad tracks (shorter, conflicts (Many times the same image index)...)
-
-				// Remove tracks that have a conflict (many times the same image index)
-				std::set<int> set_classToErase;
-				for (lemon::UnionFindEnum< IndexMap >::ClassIt cit(*myTracksUF); cit != INVALID; ++cit) {
-					size_t cpt = 0;
-					std::set<size_t> myset;
-					for (lemon::UnionFindEnum< IndexMap >::ItemIt iit(*myTracksUF, cit); iit != INVALID; ++iit) {
-						myset.insert(reverse_my_Map[iit].first);
-						++cpt;
-					}
-					if (myset.size() != cpt || myset.size() < nLengthSupTo)
-					{
-						set_classToErase.insert(cit.operator int());
-					}
+				std::vector<unsigned char> vec_is_kept(tracks_.size(), 0);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+				for (int t = 0; t < (int)tracks_.size(); ++t)
+				{
+					// 观测按图像排序，相邻的观测属于同一幅图像即为冲突
+					bool is_conflict = false;
+					for (uint32_t k = tracks_.track_offsets[t] + 1; k < tracks_.track_offsets[t + 1] && !is_conflict; ++k)
+						is_conflict = tracks_.observation_images[k] == tracks_.observation_images[k - 1];
+					vec_is_kept[t] = !is_conflict && tracks_.trackLength(t) >= nLengthSupTo;
 				}
-				for_each(set_classToErase.begin(), set_classToErase.end(),
-					std::bind1st(std::mem_fun(&UnionFindObject::eraseClass), myTracksUF.get()));
+				KeepTracks(vec_is_kept);
 				return false;
 			}
 
 			/// Remove the pair that have too few correspondences.
 			bool FilterPairWiseMinimumMatches(size_t min_matches_occurences, bool is_verbose = false)
 			{
-				std::vector<size_t> vec_tracks_to_remove;
-				std::map< size_t, std::set<size_t> > map_tracks_id_per_images;
-
-				//-- Count the number of track per image Id
-				for (lemon::UnionFindEnum< IndexMap >::ClassIt cit(*myTracksUF); cit != INVALID; ++cit) {
-					size_t trackId = cit.operator int();
-					for (lemon::UnionFindEnum< IndexMap >::ItemIt iit(*myTracksUF, cit); iit != INVALID; ++iit) {
-						const MapNodeIndex::iterator iterTrackValue = reverse_my_Map.find(iit);
-						const IndexedFeaturePair & currentPair = iterTrackValue->second;
-						map_tracks_id_per_images[currentPair.first].insert(trackId);
-					}
+				// 每个track中所有的图像对(I, J)(I <= J)，I == J时统计图像I的track个数
+				const uint64_t image_count = image_offsets_.size() - 1;
+				std::vector<uint64_t> vec_pair_keys;
+				std::vector<uint32_t> vec_images;
+				for (size_t t = 0; t < tracks_.size(); ++t)
+				{
+					TrackImages(t, vec_images);
+					for (size_t a = 0; a < vec_images.size(); ++a)
+						for (size_t b = a; b < vec_images.size(); ++b)
+							vec_pair_keys.push_back(vec_images[a] * image_count + vec_images[b]);
 				}
+				std::sort(vec_pair_keys.begin(), vec_pair_keys.end());
 
-				//-- Compute cross images matches
-				for (std::map<size_t, std::set<size_t> >::const_iterator iter = map_tracks_id_per_images.begin();
-					iter != map_tracks_id_per_images.end();
-					++iter)
+				// 只保留数量不足的图像对
+				std::vector<uint64_t> vec_weak_pairs;
+				for (size_t k = 0; k < vec_pair_keys.size();)
 				{
-					const std::set<size_t> & setA = iter->second;
-					for (std::map<size_t, std::set<size_t> >::const_iterator iter2 = iter;
-						iter2 != map_tracks_id_per_images.end();  ++iter2)
-					{
-						const std::set<size_t> & setB = iter2->second;
-						std::vector<size_t> inter;
-
-						std::set_intersection(setA.begin(), setA.end(), setB.begin(), setB.end(), back_inserter(inter));
-
-						if (inter.size() < min_matches_occurences)
-							copy(inter.begin(), inter.end(), back_inserter(vec_tracks_to_remove));
+					size_t next = k + 1;
+					while (next < vec_pair_keys.size() && vec_pair_keys[next] == vec_pair_keys[k])
+						++next;
+					if (next - k < min_matches_occurences)
+						vec_weak_pairs.push_back(vec_pair_keys[k]);
+					k = next;
+				}
+				std::vector<uint64_t>().swap(vec_pair_keys);
+
+				std::vector<unsigned char> vec_is_kept(tracks_.size(), 1);
+				size_t removed_count = 0;
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:removed_count)
+#endif
+				for (int t = 0; t < (int)tracks_.size(); ++t)
+				{
+					std::vector<uint32_t> vec_track_images;
+					TrackImages(t, vec_track_images);
+					bool is_weak = false;
+					for (size_t a = 0; a < vec_track_images.size() && !is_weak; ++a)
+						for (size_t b = a; b < vec_track_images.size() && !is_weak; ++b)
+							is_weak = std::binary_search(vec_weak_pairs.begin(), vec_weak_pairs.end(),
+								vec_track_images[a] * image_count + vec_track_images[b]);
+					if (is_weak) {
+						vec_is_kept[t] = 0;
+						++removed_count;
 					}
 				}
-				std::sort(vec_tracks_to_remove.begin(), vec_tracks_to_remove.end());
-				std::vector<size_t>::iterator it = std::unique(vec_tracks_to_remove.begin(), vec_tracks_to_remove.end());
-				vec_tracks_to_remove.resize(std::distance(vec_tracks_to_remove.begin(), it));
 				if (is_verbose)
-					std::cout << std::endl << std::endl << vec_tracks_to_remove.size()
+					std::cout << std::endl << std::endl << removed_count
 					<< " Tracks will be removed" << std::endl;
-				std::for_each(vec_tracks_to_remove.begin(), vec_tracks_to_remove.end(),
-					std::bind1st(std::mem_fun(&UnionFindObject::eraseClass), myTracksUF.get()));
+				KeepTracks(vec_is_kept);
 				return false;
 			}
 
 			bool ExportToStream(std::ostream & os)
 			{
-				size_t cpt = 0;
-				for (lemon::UnionFindEnum< IndexMap >::ClassIt cit(*myTracksUF); cit != INVALID; ++cit) {
-					os << "Class: " << cpt++ << std::endl;
-					size_t cptTrackLength = 0;
-					for (lemon::UnionFindEnum< IndexMap >::ItemIt iit(*myTracksUF, cit); iit != INVALID; ++iit) {
-						++cptTrackLength;
-					}
-					os << "\t" << "track length: " << cptTrackLength << std::endl;
-
-					for (lemon::UnionFindEnum< IndexMap >::ItemIt iit(*myTracksUF, cit); iit != INVALID; ++iit) {
-						os << reverse_my_Map[iit].first << "  " << reverse_my_Map[iit].second << std::endl;
+				for (size_t t = 0; t < tracks_.size(); ++t) {
+					os << "Class: " << t << std::endl;
+					os << "\t" << "track length: " << tracks_.trackLength(t) << std::endl;
+					for (uint32_t k = tracks_.track_offsets[t]; k < tracks_.track_offsets[t + 1]; ++k) {
+						os << tracks_.observation_images[k] << "  " << tracks_.observation_features[k] << std::endl;
 					}
 				}
 				return os.good();
 			}
 
-			/// Return the number of connected set in the UnionFind structure (tree forest)
+			/// Return the number of tracks
 			size_t NbTracks() const
 			{
-				size_t cpt = 0;
-				for (lemon::UnionFindEnum< IndexMap >::ClassIt cit(*myTracksUF); cit != INVALID; ++cit)
-					++cpt;
-				return cpt;
+				return tracks_.size();
 			}
 
+			/// 以CSR格式存储的tracks
+			const FlatTracks & tracks() const { return tracks_; }
+
 			/// Export tracks as a map (each entry is a sequence of imageId and featureIndex):
 			///  {TrackIndex => {(imageIndex, featureIndex), ... ,(imageIndex, featureIndex)}
 			void ExportToSTL(MapTracks & map_tracks)
 			{
 				map_tracks.clear();
+				for (size_t t = 0; t < tracks_.size(); ++t) {
+					MapTracks::iterator iterN = map_tracks.insert(map_tracks.end(), std::make_pair(t, SubmapTrack()));
+					for (uint32_t k = tracks_.track_offsets[t]; k < tracks_.track_offsets[t + 1]; ++k) {
+						iterN->second[tracks_.observation_images[k]] = tracks_.observation_features[k];
+					}
+				}
+			}
+
+		private:
+			/// 合并a和b所在的集合，编号较大的根指向较小的根
+			static void Union(std::vector<uint32_t> & vec_parent, uint32_t a, uint32_t b)
+			{
+				a = Find(vec_parent, a);
+				b = Find(vec_parent, b);
+				if (a < b)
+					vec_parent[b] = a;
+				else if (b < a)
+					vec_parent[a] = b;
+			}
 
-				size_t cptClass = 0;
-				for (lemon::UnionFindEnum< IndexMap >::ClassIt cit(*myTracksUF); cit != INVALID; ++cit, ++cptClass) {
-					std::pair<MapTracks::iterator, bool> ret =
-						map_tracks.insert(std::pair<size_t, SubmapTrack >(cptClass, SubmapTrack()));
-					MapTracks::iterator iterN = ret.first;
+			/// 查找x所在集合的根，同时进行路径减半
+			static uint32_t Find(std::vector<uint32_t> & vec_parent, uint32_t x)
+			{
+				while (vec_parent[x] != x) {
+					vec_parent[x] = vec_parent[vec_parent[x]];
+					x = vec_parent[x];
+				}
+				return x;
+			}
 
-					for (lemon::UnionFindEnum< IndexMap >::ItemIt iit(*myTracksUF, cit); iit != INVALID; ++iit) {
-						const MapNodeIndex::iterator iterTrackValue = reverse_my_Map.find(iit);
-						const IndexedFeaturePair & currentPair = iterTrackValue->second;
+			/// 第t个track中不重复的图像
+			void TrackImages(size_t t, std::vector<uint32_t> & vec_images) const
+			{
+				vec_images.assign(tracks_.observation_images.begin() + tracks_.track_offsets[t],
+					tracks_.observation_images.begin() + tracks_.track_offsets[t + 1]);
+				vec_images.erase(std::unique(vec_images.begin(), vec_images.end()), vec_images.end());
+			}
 
-						iterN->second[currentPair.first] = currentPair.second;
-					}
+			/// 只保留标记的track，保持原来的顺序
+			void KeepTracks(const std::vector<unsigned char> & vec_is_kept)
+			{
+				FlatTracks kept_tracks;
+				kept_tracks.clear();
+				for (size_t t = 0; t < tracks_.size(); ++t)
+				{
+					if (!vec_is_kept[t])
+						continue;
+					kept_tracks.observation_images.insert(kept_tracks.observation_images.end(),
+						tracks_.observation_images.begin() + tracks_.track_offsets[t],
+						tracks_.observation_images.begin() + tracks_.track_offsets[t + 1]);
+					kept_tracks.observation_features.insert(kept_tracks.observation_features.end(),
+						tracks_.observation_features.begin() + tracks_.track_offsets[t],
+						tracks_.observation_features.begin() + tracks_.track_offsets[t + 1]);
+					kept_tracks.track_offsets.push_back(static_cast<uint32_t>(kept_tracks.observation_images.size()));
 				}
+				std::swap(tracks_, kept_tracks);
 			}
+
+			std::vector<size_t> image_offsets_; //!< 每幅图像第一个特征的观测编号，共图像个数 + 1项
+			FlatTracks tracks_;                 //!< 构建的tracks
 		};
 
 		struct TracksUtilsMap
@@ -314,6 +389,36 @@ namespace mvg  {
 				return !map_tracks_out.empty();
 			}
 
+			/// 只在vec_track_ids给出的tracks中查找包含set_image_index所有图像的tracks，
+			/// 与TracksPerImageIndex的查询结果配合使用，时间与vec_track_ids的大小成正比
+			static bool GetTracksInImages(
+				const std::vector<size_t> & vec_track_ids,
+				const std::set<size_t> & set_image_index,
+				const MapTracks & map_tracks_in,
+				MapTracks & map_tracks_out)
+			{
+				map_tracks_out.clear();
+				for (size_t i = 0; i < vec_track_ids.size(); ++i)
+				{
+					MapTracks::const_iterator tracks_iter = map_tracks_in.find(vec_track_ids[i]);
+					if (tracks_iter == map_tracks_in.end())
+						continue;
+
+					std::map<size_t, size_t> map_temp;
+					for (std::set<size_t>::const_iterator iterIndex = set_image_index.begin();
+						iterIndex != set_image_index.end(); ++iterIndex)
+					{
+						SubmapTrack::const_iterator iterSearch = tracks_iter->second.find(*iterIndex);
+						if (iterSearch != tracks_iter->second.end())
+							map_temp[iterSearch->first] = iterSearch->second;
+					}
+
+					if (!map_temp.empty() && map_temp.size() == set_image_index.size())
+						map_tracks_out.insert(map_tracks_out.end(), make_pair(tracks_iter->first, map_temp));
+				}
+				return !map_tracks_out.empty();
+			}
+
 			/// Return the tracksId as a set (sorted increasing)
 			static void GetTracksIdVector(
 				const MapTracks & map_tracks,
@@ -374,8 +479,7 @@ namespace mvg  {
 				vec_indexref.clear();
 				for (size_t i = 0; i < vec_filterIndex.size(); ++i)
 				{
-					MapTracks::const_iterator itF =
-						find_if(map_tracks.begin(), map_tracks.end(), FunctorMapFirstEqual(vec_filterIndex[i]));
+					MapTracks::const_iterator itF = map_tracks.find(vec_filterIndex[i]);
 					const SubmapTrack & map_ref = itF->second;
 					SubmapTrack::const_iterator iter = map_ref.begin();
 					size_t indexI = iter->second;
@@ -423,6 +527,117 @@ namespace mvg  {
 			}
 		};
 
+		/**
+		 * \brief	图像到track的倒排索引{ImageId => 升序的TrackId}，另外记录每幅图像中已经三角化的tracks。
+		 *			在MapTracks中删除观测或标记三角化时增量更新，避免每次查询都遍历所有的tracks
+		 */
+		class TracksPerImageIndex
+		{
+		public:
+			/// 由所有的tracks建立索引，之前的三角化标记被清除
+			void Build(const MapTracks & map_tracks)
+			{
+				tracks_per_image_.clear();
+				triangulated_per_image_.clear();
+				for (MapTracks::const_iterator tracks_iter = map_tracks.begin();
+					tracks_iter != map_tracks.end(); ++tracks_iter)
+				{
+					const SubmapTrack & track = tracks_iter->second;
+					for (SubmapTrack::const_iterator iter = track.begin(); iter != track.end(); ++iter)
+						imageEntry(tracks_per_image_, iter->first).insert(tracks_iter->first);
+				}
+			}
+
+			/// 添加track在一幅图像中的观测
+			void AddObservation(size_t track_id, size_t image_id)
+			{
+				imageEntry(tracks_per_image_, image_id).insert(track_id);
+			}
+
+			/// 删除track在一幅图像中的观测
+			void EraseObservation(size_t track_id, size_t image_id)
+			{
+				if (image_id < tracks_per_image_.size())
+					tracks_per_image_[image_id].erase(track_id);
+				if (image_id < triangulated_per_image_.size())
+					triangulated_per_image_[image_id].erase(track_id);
+			}
+
+			/// 删除track在所有图像中的观测
+			void EraseTrack(size_t track_id, const SubmapTrack & track)
+			{
+				for (SubmapTrack::const_iterator iter = track.begin(); iter != track.end(); ++iter)
+					EraseObservation(track_id, iter->first);
+			}
+
+			/// 标记track已经(is_triangulated为true)或不再(为false)三角化
+			void SetTriangulated(size_t track_id, const SubmapTrack & track, bool is_triangulated = true)
+			{
+				for (SubmapTrack::const_iterator iter = track.begin(); iter != track.end(); ++iter)
+				{
+					if (is_triangulated)
+						imageEntry(triangulated_per_image_, iter->first).insert(track_id);
+					else if (iter->first < triangulated_per_image_.size())
+						triangulated_per_image_[iter->first].erase(track_id);
+				}
+			}
+
+			/// 图像中的所有tracks
+			const std::set<size_t> & TracksInImage(size_t image_id) const
+			{
+				return imageEntry(tracks_per_image_, image_id);
+			}
+
+			/// 图像中已经三角化的tracks
+			const std::set<size_t> & TriangulatedTracksInImage(size_t image_id) const
+			{
+				return imageEntry(triangulated_per_image_, image_id);
+			}
+
+			/**
+			 * \brief	两幅图像共同的tracks，按升序输出
+			 * \param	is_untriangulated_only	为true时只输出还没有三角化的tracks
+			 * \return	是否有共同的tracks
+			 */
+			bool CommonTracks(size_t image_i, size_t image_j, std::vector<size_t> & vec_track_ids,
+				bool is_untriangulated_only = false) const
+			{
+				vec_track_ids.clear();
+				// 遍历较小的集合，在较大的集合中查找
+				const std::set<size_t> & tracks_i = TracksInImage(image_i);
+				const std::set<size_t> & tracks_j = TracksInImage(image_j);
+				const bool is_i_smaller = tracks_i.size() <= tracks_j.size();
+				const std::set<size_t> & smaller = is_i_smaller ? tracks_i : tracks_j;
+				const std::set<size_t> & larger = is_i_smaller ? tracks_j : tracks_i;
+				const std::set<size_t> & triangulated = TriangulatedTracksInImage(is_i_smaller ? image_i : image_j);
+				for (std::set<size_t>::const_iterator iter = smaller.begin(); iter != smaller.end(); ++iter)
+				{
+					if (is_untriangulated_only && triangulated.count(*iter))
+						continue;
+					if (larger.count(*iter))
+						vec_track_ids.push_back(*iter);
+				}
+				return !vec_track_ids.empty();
+			}
+
+		private:
+			static std::set<size_t> & imageEntry(std::vector< std::set<size_t> > & vec_index, size_t image_id)
+			{
+				if (image_id >= vec_index.size())
+					vec_index.resize(image_id + 1);
+				return vec_index[image_id];
+			}
+
+			static const std::set<size_t> & imageEntry(const std::vector< std::set<size_t> > & vec_index, size_t image_id)
+			{
+				static const std::set<size_t> empty_set;
+				return image_id < vec_index.size() ? vec_index[image_id] : empty_set;
+			}
+
+			std::vector< std::set<size_t> > tracks_per_image_;          //!< 每幅图像中的tracks
+			std::vector< std::set<size_t> > triangulated_per_image_;    //!< 每幅图像中已经三角化的tracks
+		};
+
 	} // namespace tracking
 } // namespace mvg
 
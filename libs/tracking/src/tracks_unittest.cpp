@@ -164,3 +164,102 @@ TEST(Tracks, Conflict) {
   }
 }
 
+TEST(Tracks, FlatTracks) {
+
+  /*
+  A    B    C
+  0 -> 0 -> 0
+  1 -> 1 -> 6
+  2 -> 3
+  */
+  PairWiseMatches map_pairwisematches;
+  IndexedMatch testAB[] = {IndexedMatch(0,0), IndexedMatch(1,1), IndexedMatch(2,3)};
+  IndexedMatch testBC[] = {IndexedMatch(0,0), IndexedMatch(1,6)};
+  map_pairwisematches[ std::make_pair(0,1) ] = std::vector<IndexedMatch>(testAB, testAB+3);
+  map_pairwisematches[ std::make_pair(1,2) ] = std::vector<IndexedMatch>(testBC, testBC+2);
+
+  TracksBuilder trackBuilder;
+  trackBuilder.Build( map_pairwisematches );
+
+  // 每个track的观测在连续的区间中，按(图像, 特征)排序
+  const FlatTracks & tracks = trackBuilder.tracks();
+  const uint32_t GT_Offsets[] = {0, 3, 6, 8};
+  const uint32_t GT_Images[] = {0, 1, 2, 0, 1, 2, 0, 1};
+  const uint32_t GT_Features[] = {0, 0, 0, 1, 1, 6, 2, 3};
+  EXPECT_EQ(3, tracks.size());
+  EXPECT_TRUE(std::vector<uint32_t>(GT_Offsets, GT_Offsets+4) == tracks.track_offsets);
+  EXPECT_TRUE(std::vector<uint32_t>(GT_Images, GT_Images+8) == tracks.observation_images);
+  EXPECT_TRUE(std::vector<uint32_t>(GT_Features, GT_Features+8) == tracks.observation_features);
+  EXPECT_EQ(2, tracks.trackLength(2));
+
+  // 图像B和C共有的track只有2个，少于3个时这两个track被删除
+  trackBuilder.FilterPairWiseMinimumMatches(3);
+  EXPECT_EQ(1, trackBuilder.NbTracks());
+  MapTracks map_tracks;
+  trackBuilder.ExportToSTL(map_tracks);
+  EXPECT_EQ(1, map_tracks.size());
+  EXPECT_EQ(2, map_tracks[0].size());
+  EXPECT_EQ(2, map_tracks[0][0]);
+  EXPECT_EQ(3, map_tracks[0][1]);
+}
+
+TEST(Tracks, PerImageIndex) {
+
+  /*
+  A    B    C
+  0 -> 0 -> 0
+  1 -> 1 -> 6
+  2 -> 3
+  */
+  PairWiseMatches map_pairwisematches;
+  IndexedMatch testAB[] = {IndexedMatch(0,0), IndexedMatch(1,1), IndexedMatch(2,3)};
+  IndexedMatch testBC[] = {IndexedMatch(0,0), IndexedMatch(1,6)};
+  map_pairwisematches[ std::make_pair(0,1) ] = std::vector<IndexedMatch>(testAB, testAB+3);
+  map_pairwisematches[ std::make_pair(1,2) ] = std::vector<IndexedMatch>(testBC, testBC+2);
+
+  TracksBuilder trackBuilder;
+  trackBuilder.Build( map_pairwisematches );
+  MapTracks map_tracks;
+  trackBuilder.ExportToSTL(map_tracks);
+
+  TracksPerImageIndex index;
+  index.Build(map_tracks);
+  EXPECT_EQ(3, index.TracksInImage(0).size());
+  EXPECT_EQ(3, index.TracksInImage(1).size());
+  EXPECT_EQ(2, index.TracksInImage(2).size());
+  EXPECT_TRUE(index.TracksInImage(5).empty());
+
+  // 与遍历所有tracks的结果相同
+  std::vector<size_t> vec_common;
+  EXPECT_TRUE(index.CommonTracks(2, 0, vec_common));
+  std::set<size_t> set_image_index;
+  set_image_index.insert(0);
+  set_image_index.insert(2);
+  MapTracks map_tracksCommon;
+  TracksUtilsMap::GetTracksInImages(set_image_index, map_tracks, map_tracksCommon);
+  std::set<size_t> set_tracksIds;
+  TracksUtilsMap::GetTracksIdVector(map_tracksCommon, &set_tracksIds);
+  EXPECT_TRUE(std::vector<size_t>(set_tracksIds.begin(), set_tracksIds.end()) == vec_common);
+  MapTracks map_indexedCommon;
+  TracksUtilsMap::GetTracksInImages(vec_common, set_image_index, map_tracks, map_indexedCommon);
+  EXPECT_TRUE(map_tracksCommon == map_indexedCommon);
+
+  // 三角化的track不再是三角化的候选
+  const size_t triangulatedId = vec_common[0];
+  index.SetTriangulated(triangulatedId, map_tracks[triangulatedId]);
+  EXPECT_EQ(1, index.TriangulatedTracksInImage(0).size());
+  EXPECT_EQ(1, index.TriangulatedTracksInImage(2).count(triangulatedId));
+  EXPECT_TRUE(index.CommonTracks(0, 2, vec_common, true));
+  EXPECT_EQ(1, vec_common.size());
+
+  // 删除观测后索引同步更新
+  const size_t trackId = vec_common[0];
+  index.EraseObservation(trackId, 2);
+  EXPECT_FALSE(index.CommonTracks(0, 2, vec_common, true));
+  EXPECT_EQ(1, index.TracksInImage(2).size());
+  index.EraseTrack(trackId, map_tracks[trackId]);
+  EXPECT_EQ(0, index.TracksInImage(1).count(trackId));
+  index.SetTriangulated(triangulatedId, map_tracks[triangulatedId], false);
+  EXPECT_TRUE(index.TriangulatedTracksInImage(0).empty());
+  EXPECT_TRUE(index.TriangulatedTracksInImage(1).empty());
+}
@@ -0,0 +1,78 @@
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "mvg/utils/timer.h"
+#include "mvg/feature/indexed_match.h"
+#include "mvg/feature/indexed_match_utils.h"
+#include "mvg/feature/pairwise_matches_store.h"
+
+using namespace mvg::utils;
+using namespace mvg::feature;
+
+// 比较文本匹配文件与二进制匹配文件的导入时间
+// 用法：matches_io_benchmark [图像个数] [每对图像的匹配个数]
+int main(int argc, char **argv)
+{
+	const size_t image_count = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 200;
+	const size_t match_count = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 500;
+
+	// 生成模拟的匹配，每幅图像与之后的10幅图像存在匹配
+	PairWiseMatches map_matches;
+	for (size_t i = 0; i < image_count; ++i) {
+		for (size_t j = i + 1; j < image_count && j <= i + 10; ++j) {
+			std::vector<IndexedMatch> &vec_matches = map_matches[std::make_pair(i, j)];
+			vec_matches.reserve(match_count);
+			for (size_t k = 0; k < match_count; ++k)
+				vec_matches.push_back(IndexedMatch(rand() % 10000, rand() % 10000));
+		}
+	}
+	std::cout << "Pairs: " << map_matches.size()
+		<< " matches per pair: " << match_count << std::endl;
+
+	const std::string text_file = "matches_benchmark.txt";
+	const std::string bin_file = "matches_benchmark.bin";
+	Timer timer;
+
+	timer.Start();
+	{
+		std::ofstream file(text_file.c_str());
+		PairedIndexedMatchToStream(map_matches, file);
+	}
+	std::cout << "Write text   : " << timer.Stop() << " s" << std::endl;
+
+	timer.Start();
+	PairedIndexedMatchToBinFile(map_matches, bin_file);
+	std::cout << "Write binary : " << timer.Stop() << " s" << std::endl;
+
+	PairWiseMatches map_loaded;
+	timer.Start();
+	pairedIndexedMatchImport(text_file, map_loaded);
+	std::cout << "Load text    : " << timer.Stop() << " s" << std::endl;
+
+	timer.Start();
+	pairedIndexedMatchImport(bin_file, map_loaded);
+	std::cout << "Load binary  : " << timer.Stop() << " s" << std::endl;
+
+	// 只映射文件，并遍历所有的匹配，不进行拷贝
+	timer.Start();
+	size_t checksum = 0;
+	{
+		PairWiseMatchesStore store;
+		if (store.open(bin_file)) {
+			for (size_t k = 0; k < store.size(); ++k) {
+				const IndexedMatch *matches = store.matchesAt(k);
+				for (size_t m = 0; m < store.matchCountAt(k); ++m)
+					checksum += matches[m]._i;
+			}
+		}
+	}
+	std::cout << "Mmap binary  : " << timer.Stop() << " s (checksum " << checksum << ")" << std::endl;
+
+	std::cout << (map_loaded == map_matches ? "Round trip OK" : "Round trip FAILED") << std::endl;
+
+	remove(text_file.c_str());
+	remove(bin_file.c_str());
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "mvg/utils/timer.h"
+#include "mvg/feature/features.h"
+#include "mvg/feature/indexed_match.h"
+#include "mvg/feature/region_cache.h"
+
+using namespace mvg::utils;
+using namespace mvg::feature;
+
+typedef Descriptor<unsigned char, 128> DescriptorT;
+typedef RegionCache<ScalePointFeature, DescriptorT> RegionCacheT;
+
+// 比较图像集匹配中按索引访问图像及图像对的开销：
+//  旧的实现：std::map + std::advance，每次访问O(N)
+//  新的实现：按图像id连续存储的RegionCache及展开的图像对数组，每次访问O(1)
+// 用法：matching_scaling_benchmark [最大图像个数，默认10000]
+int main(int argc, char **argv)
+{
+	const size_t max_image_count = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 10000;
+	// 旧的实现复杂度为O(N^3)，图像过多时不再测试
+	const size_t max_legacy_image_count = 2000;
+	const size_t pair_per_image = 10;
+
+	Timer timer;
+	for (size_t image_count = 100; image_count <= max_image_count; image_count *= 10) {
+		// 每幅图像8个特征
+		RegionCacheT region_cache;
+		std::map<size_t, std::vector<ScalePointFeature> > map_features;
+		for (size_t i = 0; i < image_count; ++i) {
+			std::shared_ptr<RegionCacheT::Regions> regions(new RegionCacheT::Regions);
+			regions->features.assign(8, ScalePointFeature(float(i), float(i)));
+			regions->descriptors.resize(8);
+			region_cache.put(i, regions);
+			if (image_count <= max_legacy_image_count)
+				map_features[i] = regions->features;
+		}
+		const double pair_count = image_count * (image_count - 1) / 2.0;
+		std::cout << "Images: " << image_count << std::endl;
+
+		// 1. 匹配：访问所有的图像对(i, j)
+		size_t checksum = 0;
+		timer.Start();
+		for (size_t i = 0; i < image_count; ++i) {
+			const RegionCacheT::RegionsPtr regions_i = region_cache.get(i);
+			for (size_t j = i + 1; j < image_count; ++j)
+				checksum += regions_i->features.size() + region_cache.get(j)->features.size();
+		}
+		double seconds = timer.Stop();
+		std::cout << "  matcher dense   : " << seconds << " s, "
+			<< seconds * 1e9 / pair_count << " ns/pair" << std::endl;
+
+		if (image_count <= max_legacy_image_count) {
+			timer.Start();
+			for (size_t i = 0; i < image_count; ++i) {
+				std::map<size_t, std::vector<ScalePointFeature> >::const_iterator iter_i = map_features.begin();
+				std::advance(iter_i, i);
+				for (size_t j = i + 1; j < image_count; ++j) {
+					std::map<size_t, std::vector<ScalePointFeature> >::const_iterator iter_j = map_features.begin();
+					std::advance(iter_j, j);
+					checksum += iter_i->second.size() + iter_j->second.size();
+				}
+			}
+			seconds = timer.Stop();
+			std::cout << "  matcher legacy  : " << seconds << " s, "
+				<< seconds * 1e9 / pair_count << " ns/pair" << std::endl;
+		}
+
+		// 2. 几何过滤：每幅图像与之后的pair_per_image幅图像存在匹配
+		PairWiseMatches map_matches;
+		for (size_t i = 0; i < image_count; ++i)
+			for (size_t j = i + 1; j < image_count && j <= i + pair_per_image; ++j)
+				map_matches[std::make_pair(i, j)].push_back(IndexedMatch(0, 0));
+
+		timer.Start();
+		std::vector<PairWiseMatches::const_iterator> vec_pairs;
+		vec_pairs.reserve(map_matches.size());
+		for (PairWiseMatches::const_iterator iter = map_matches.begin(); iter != map_matches.end(); ++iter)
+			vec_pairs.push_back(iter);
+		for (size_t k = 0; k < vec_pairs.size(); ++k)
+			checksum += region_cache.get(vec_pairs[k]->first.first)->features.size()
+				+ region_cache.get(vec_pairs[k]->first.second)->features.size();
+		seconds = timer.Stop();
+		std::cout << "  filter dense    : " << seconds << " s, "
+			<< seconds * 1e9 / map_matches.size() << " ns/pair" << std::endl;
+
+		if (image_count <= max_legacy_image_count) {
+			timer.Start();
+			for (size_t k = 0; k < map_matches.size(); ++k) {
+				PairWiseMatches::const_iterator iter = map_matches.begin();
+				std::advance(iter, k);
+				std::map<size_t, std::vector<ScalePointFeature> >::const_iterator iter_i = map_features.begin();
+				std::map<size_t, std::vector<ScalePointFeature> >::const_iterator iter_j = map_features.begin();
+				std::advance(iter_i, iter->first.first);
+				std::advance(iter_j, iter->first.second);
+				checksum += iter_i->second.size() + iter_j->second.size();
+			}
+			seconds = timer.Stop();
+			std::cout << "  filter legacy   : " << seconds << " s, "
+				<< seconds * 1e9 / map_matches.size() << " ns/pair" << std::endl;
+		}
+		std::cout << "  (checksum " << checksum << ")" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "mvg/utils/timer.h"
+#include "mvg/feature/features.h"
+#include "mvg/feature/matcher_all_in_memory.h"
+#include "mvg/feature/matcher_brute_force_simd.h"
+
+using namespace mvg::utils;
+using namespace mvg::feature;
+
+typedef Descriptor<unsigned char, 128> DescriptorT;
+typedef KeypointSet<std::vector<ScalePointFeature>, std::vector<DescriptorT> > KeypointSetT;
+typedef MatcherAllInMemory<KeypointSetT, ArrayMatcherBruteForceSIMD<unsigned char> > CollectionMatcherT;
+
+// 所有图像对匹配的线程扩展性：图像对空间按(I块, J块)分块动态调度，
+// 线程数从1倍增到最大线程数，输出每次的时间、加速比和并行效率
+// 用法：matching_thread_scaling_benchmark [图像个数，默认100] [每幅图像的特征个数，默认500]
+//       [最大线程数，默认为处理器个数] [图像块的大小，默认8]
+// 多线程需要以MVG_USE_OPENMP=ON(默认)编译；没有OpenMP时只能测量单线程，例如64线程的扩展性无法测量
+int main(int argc, char **argv)
+{
+	const size_t image_count = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 100;
+	const size_t feature_count = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 500;
+#ifdef USE_OPENMP
+	const int max_thread_count = argc > 3 ? atoi(argv[3]) : omp_get_num_procs();
+#else
+	const int max_thread_count = 1;
+	std::cout << "Built without OpenMP (MVG_USE_OPENMP=OFF or OpenMP not found), "
+		"thread scaling cannot be measured: only one thread is used" << std::endl;
+#endif
+	const size_t block_size = argc > 4 ? static_cast<size_t>(atoi(argv[4])) : 8;
+
+	// 随机的描述子，所有图像放在没有内存预算的缓存中
+	std::shared_ptr<CollectionMatcherT::RegionCacheT> region_cache(new CollectionMatcherT::RegionCacheT);
+	srand(0);
+	for (size_t i = 0; i < image_count; ++i) {
+		std::shared_ptr<CollectionMatcherT::RegionCacheT::Regions> regions(new CollectionMatcherT::RegionCacheT::Regions);
+		regions->features.resize(feature_count);
+		regions->descriptors.resize(feature_count);
+		for (size_t k = 0; k < feature_count; ++k) {
+			regions->features[k] = ScalePointFeature(float(k % 1000), float(k / 1000));
+			for (size_t d = 0; d < DescriptorT::kStaticSize; ++d)
+				regions->descriptors[k][d] = static_cast<unsigned char>(rand() % 256);
+		}
+		region_cache->put(i, regions);
+	}
+	const std::vector<std::string> file_names(image_count);
+	std::cout << "Images: " << image_count << ", features per image: " << feature_count
+		<< ", pairs: " << image_count * (image_count - 1) / 2 << ", block size: " << block_size << std::endl;
+
+	Timer timer;
+	double single_thread_seconds = 0.0;
+	for (int thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+#ifdef USE_OPENMP
+		omp_set_num_threads(thread_count);
+#endif
+		// 索引在计时之前建立，只比较匹配本身
+		CollectionMatcherT matcher(0.8f, region_cache);
+		matcher.setBlockSize(block_size);
+		matcher.LoadData(file_names, "");
+		matcher.indexRegistry()->buildAll(image_count);
+		PairWiseMatches map_matches;
+		timer.Start();
+		matcher.Match(file_names, map_matches);
+		const double seconds = timer.Stop();
+		if (thread_count == 1)
+			single_thread_seconds = seconds;
+
+		const double speedup = single_thread_seconds / seconds;
+		std::cout << "  threads " << thread_count << " : " << seconds << " s, speedup "
+			<< speedup << ", efficiency " << speedup / thread_count
+			<< " (" << map_matches.size() << " pairs)" << std::endl;
+	}
+	return 0;
+}